@@ -0,0 +1,121 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Sampling profiler interrupt, from the EL1 physical timer through a GICv2
+ *
+ * U-Boot otherwise runs with IRQs masked and not routed to its exception
+ * level, so these and the GIC's setup are only changed while the profiler
+ * runs and are put back when it stops. Other interrupts are left to the
+ * normal IRQ handler.
+ */
+
+#include <common.h>
+#include <profile.h>
+#include <asm/gic.h>
+#include <asm/io.h>
+#include <asm/system.h>
+
+#if !defined(GICD_BASE) || !defined(GICC_BASE)
+#error "The profiler needs GICD_BASE and GICC_BASE"
+#endif
+
+/* Non-secure EL1 physical timer PPI */
+#define PROFILE_TIMER_IRQ	30
+
+#define CNTP_CTL_ENABLE		BIT(0)
+
+static ulong profile_ticks;
+static ulong saved_route;
+static u32 saved_gicd_ctlr, saved_gicc_ctlr, saved_gicc_pmr, saved_igroup;
+
+static void profile_timer_arm(void)
+{
+	asm volatile("msr cntp_tval_el0, %0" : : "r" (profile_ticks));
+	asm volatile("msr cntp_ctl_el0, %0" : : "r" (CNTP_CTL_ENABLE));
+	isb();
+}
+
+static void profile_route_irq(bool enable)
+{
+	ulong val;
+
+	if (current_el() == 3) {
+		asm volatile("mrs %0, scr_el3" : "=r" (val));
+		if (enable) {
+			saved_route = val;
+			val |= SCR_EL3_IRQ_EN;
+		} else {
+			val = saved_route;
+		}
+		asm volatile("msr scr_el3, %0" : : "r" (val));
+	} else if (current_el() == 2) {
+		asm volatile("mrs %0, hcr_el2" : "=r" (val));
+		if (enable) {
+			saved_route = val;
+			val |= HCR_EL2_IMO_EN;
+		} else {
+			val = saved_route;
+		}
+		asm volatile("msr hcr_el2, %0" : : "r" (val));
+	}
+	isb();
+}
+
+int arch_profile_start(uint hz)
+{
+	ulong gicd = GICD_BASE, gicc = GICC_BASE;
+
+	profile_ticks = get_tbclk() / hz;
+	if (!profile_ticks)
+		return -EINVAL;
+
+	saved_gicd_ctlr = readl(gicd + GICD_CTLR);
+	saved_gicc_ctlr = readl(gicc + GICC_CTLR);
+	saved_gicc_pmr = readl(gicc + GICC_PMR);
+	saved_igroup = readl(gicd + GICD_IGROUPRn);
+
+	/* Group 0 so that it is seen in the secure state too, if writable */
+	clrbits_le32(gicd + GICD_IGROUPRn, BIT(PROFILE_TIMER_IRQ));
+	writeb(0x80, gicd + GICD_IPRIORITYRn + PROFILE_TIMER_IRQ);
+	writel(BIT(PROFILE_TIMER_IRQ), gicd + GICD_ISENABLERn);
+	setbits_le32(gicd + GICD_CTLR, 0x3);
+	writel(GICC_INT_PRI_THRESHOLD, gicc + GICC_PMR);
+	setbits_le32(gicc + GICC_CTLR, 0x3);
+
+	profile_route_irq(true);
+	profile_timer_arm();
+	asm volatile("msr daifclr, #2");
+
+	return 0;
+}
+
+void arch_profile_stop(void)
+{
+	ulong gicd = GICD_BASE, gicc = GICC_BASE;
+
+	asm volatile("msr daifset, #2");
+	asm volatile("msr cntp_ctl_el0, %0" : : "r" (0UL));
+	writel(BIT(PROFILE_TIMER_IRQ), gicd + GICD_ICENABLERn);
+	writel(saved_igroup, gicd + GICD_IGROUPRn);
+	writel(saved_gicc_pmr, gicc + GICC_PMR);
+	writel(saved_gicc_ctlr, gicc + GICC_CTLR);
+	writel(saved_gicd_ctlr, gicd + GICD_CTLR);
+	profile_route_irq(false);
+}
+
+bool arch_profile_irq(struct pt_regs *regs, u32 iar)
+{
+	u32 irq = iar & GICC_IAR_INT_ID_MASK;
+
+	/* A spurious interrupt needs no end of interrupt */
+	if (irq == GICC_INT_SPURIOUS)
+		return true;
+	if (irq != PROFILE_TIMER_IRQ)
+		return false;
+
+	/* The registers are saved below the interrupted frames */
+	profile_sample(regs->elr, regs->regs[29], (ulong)regs);
+	profile_timer_arm();
+	writel(iar, GICC_BASE + GICC_EOIR);
+
+	return true;
+}
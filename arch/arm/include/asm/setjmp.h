@@ -24,4 +24,12 @@ typedef struct jmp_buf_data jmp_buf[1];
 int setjmp(jmp_buf jmp);
 void longjmp(jmp_buf jmp, int ret);
 
+#if defined(__aarch64__)
+/*
+ * Set up @jmp so that longjmp() to it calls @func on a new stack, whose
+ * highest address is @stack_top. @func must never return.
+ */
+void initjmp(jmp_buf jmp, void (*func)(void), void *stack_top);
+#endif
+
 #endif /* _SETJMP_H_ */
@@ -7,6 +7,11 @@
 #include <common.h>
 #include <linux/compiler.h>
 #include <efi_loader.h>
+#include <profile.h>
+#if CONFIG_IS_ENABLED(PROFILE)
+#include <asm/gic.h>
+#include <asm/io.h>
+#endif
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -35,12 +40,11 @@ static void generic_handle_irq(unsigned int hwirq, struct pt_regs *regs)
 	return;
 }
 
-static void gic_handle_irq(struct pt_regs *regs)
+static void gic_handle_irq(struct pt_regs *regs, u32 irqstat)
 {
-	u32 irqstat, irqnr;
+	u32 irqnr;
 	void __iomem *cpu_base = (void *)GICC_BASE;
 
-	irqstat = readl(cpu_base + GICC_IAR);
 	irqnr = irqstat & GICC_IAR_INT_ID_MASK;
 	if (irqnr < 16) {
 		writel(irqstat, cpu_base + GICC_EOIR);
@@ -145,8 +149,18 @@ void do_sync(struct pt_regs *pt_regs, unsigned int esr)
  */
 void do_irq(struct pt_regs *pt_regs, unsigned int esr)
 {
+#if CONFIG_IS_ENABLED(PROFILE) || \
+	(!defined(CONFIG_SPL_BUILD) && defined(CONFIG_HOBOT_BIFSD))
+	/* Acknowledged once, for whichever handler it belongs to */
+	u32 iar = readl(GICC_BASE + GICC_IAR);
+#endif
+
+#if CONFIG_IS_ENABLED(PROFILE)
+	if (arch_profile_irq(pt_regs, iar))
+		return;
+#endif
 #if !defined(CONFIG_SPL_BUILD) && defined(CONFIG_HOBOT_BIFSD)
-	gic_handle_irq(pt_regs);
+	gic_handle_irq(pt_regs, iar);
 #else
 	efi_restore_gd();
 	printf("\"Irq\" handler, esr 0x%08x\n", esr);
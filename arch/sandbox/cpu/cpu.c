@@ -8,6 +8,7 @@
 #include <errno.h>
 #include <linux/libfdt.h>
 #include <os.h>
+#include <profile.h>
 #include <asm/io.h>
 #include <asm/setjmp.h>
 #include <asm/state.h>
@@ -177,3 +178,15 @@ void longjmp(jmp_buf jmp, int ret)
 	while (1)
 		;
 }
+
+#if CONFIG_IS_ENABLED(PROFILE)
+int arch_profile_start(uint hz)
+{
+	return os_profile_start(hz, profile_sample);
+}
+
+void arch_profile_stop(void)
+{
+	os_profile_stop();
+}
+#endif
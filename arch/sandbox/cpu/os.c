@@ -3,17 +3,22 @@
  * Copyright (c) 2011 The Chromium OS Authors.
  */
 
+/* For the register names in ucontext_t */
+#define _GNU_SOURCE
+
 #include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <getopt.h>
 #include <setjmp.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <termios.h>
 #include <time.h>
+#include <ucontext.h>
 #include <unistd.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
@@ -651,3 +656,88 @@ void os_longjmp(ulong *jmp, int ret)
 {
 	longjmp((struct __jmp_buf_tag *)jmp, ret);
 }
+
+static void (*os_profile_func)(unsigned long pc, unsigned long fp,
+			       unsigned long sp);
+
+static void os_profile_handler(int sig, siginfo_t *info, void *ctx)
+{
+	ucontext_t *uc = ctx;
+	mcontext_t *mc = &uc->uc_mcontext;
+
+#if defined(__x86_64__)
+	os_profile_func(mc->gregs[REG_RIP], mc->gregs[REG_RBP],
+			mc->gregs[REG_RSP]);
+#elif defined(__i386__)
+	os_profile_func(mc->gregs[REG_EIP], mc->gregs[REG_EBP],
+			mc->gregs[REG_ESP]);
+#elif defined(__aarch64__)
+	os_profile_func(mc->pc, mc->regs[29], mc->sp);
+#endif
+}
+
+int os_profile_start(unsigned int hz,
+		     void (*func)(unsigned long pc, unsigned long fp,
+				  unsigned long sp))
+{
+	struct itimerval timer;
+	struct sigaction act;
+
+#if !defined(__x86_64__) && !defined(__i386__) && !defined(__aarch64__)
+	return -ENOSYS;
+#endif
+	os_profile_func = func;
+	memset(&act, '\0', sizeof(act));
+	act.sa_sigaction = os_profile_handler;
+	act.sa_flags = SA_SIGINFO | SA_RESTART;
+	sigemptyset(&act.sa_mask);
+	if (sigaction(SIGPROF, &act, NULL))
+		return -errno;
+
+	/* SIGPROF counts the CPU time used, so time spent waiting is skipped */
+	timer.it_interval.tv_sec = 0;
+	timer.it_interval.tv_usec = hz > 1000000 ? 1 : 1000000 / hz;
+	timer.it_value = timer.it_interval;
+	if (setitimer(ITIMER_PROF, &timer, NULL))
+		return -errno;
+
+	return 0;
+}
+
+void os_profile_stop(void)
+{
+	struct itimerval timer;
+
+	memset(&timer, '\0', sizeof(timer));
+	setitimer(ITIMER_PROF, &timer, NULL);
+	signal(SIGPROF, SIG_IGN);
+}
+
+void *os_context_create(void (*func)(void), void *stack, size_t size)
+{
+	ucontext_t *ctx;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx || !func)
+		return ctx;
+	if (getcontext(ctx)) {
+		free(ctx);
+		return NULL;
+	}
+	ctx->uc_stack.ss_sp = stack;
+	ctx->uc_stack.ss_size = size;
+	ctx->uc_link = NULL;
+	makecontext(ctx, func, 0);
+
+	return ctx;
+}
+
+void os_context_switch(void *from, void *to)
+{
+	swapcontext(from, to);
+}
+
+void os_context_free(void *ctx)
+{
+	free(ctx);
+}
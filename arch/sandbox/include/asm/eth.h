@@ -9,8 +9,29 @@
 #ifndef __ETH_H
 #define __ETH_H
 
+struct udevice;
+
+/* Number of packets sandbox_eth_recv_packet() can queue */
+#define SANDBOX_ETH_RECV_QUEUE	64
+
+/*
+ * Handler for packets sent on a sandbox Ethernet device. Returns true if
+ * the packet was consumed, false to let the device mock ARP and ping.
+ */
+typedef bool sandbox_eth_tx_hand_f(struct udevice *dev, void *packet,
+				   int length);
+
 void sandbox_eth_disable_response(int index, bool disable);
 
 void sandbox_eth_skip_timeout(void);
 
+void sandbox_eth_set_tx_handler(int index, sandbox_eth_tx_hand_f *handler);
+
+void sandbox_eth_set_recv_queue(int index, int depth);
+
+uint sandbox_eth_recv_dropped(int index);
+
+int sandbox_eth_recv_packet(struct udevice *dev, const void *packet,
+			    int length);
+
 #endif /* __ETH_H */
@@ -847,12 +847,22 @@ static void hb_boot_args_cmd_set(int boot_mode)
 	memset(tmp, 0, sizeof(tmp));
 #if defined CONFIG_HB_BOOT_FROM_MMC
 		if (if_secure) {
+#ifdef BOOTCOMMAND_AVB_VERIFY
+			snprintf(tmp, sizeof(tmp), BOOTCOMMAND_AVB_VERIFY,
+				 boot_partition);
+#else
 			snprintf(tmp, sizeof(tmp), "avb_verify; "CONFIG_BOOTCOMMAND,
 				 boot_partition, boot_partition);
+#endif
 			env_set("bootcmd", tmp);
 		} else {
+#ifdef CONFIG_CMD_BOOTIMG
+			snprintf(tmp, sizeof(tmp), CONFIG_BOOTCOMMAND,
+				 boot_partition);
+#else
 			snprintf(tmp, sizeof(tmp), CONFIG_BOOTCOMMAND,
 				 boot_partition, boot_partition);
+#endif
 #if (CONFIG_BOOTDELAY == 0) && defined(CONFIG_PARALLEL_CPU_CORE_ONE)
 		/*The boot image(boot.img) was preinstalled in DDR earlier,
 		*so not need reread from eMMC, just run bootm command*/
@@ -883,7 +893,16 @@ static void hb_boot_args_cmd_set(int boot_mode)
 
 #if (defined(CONFIG_HB_BOOT_FROM_NOR) || defined(CONFIG_HB_BOOT_FROM_NAND)) && !defined(CONFIG_DISTRO_DEFAULTS)
 		if (if_secure) {
+#if defined CONFIG_HB_BOOT_FROM_NOR
+			/* The whole partition is in memory already, hash it there */
+			snprintf(tmp, sizeof(tmp), HB_SET_WDT "avb_verify %x %llx; "
+				 "bootm %x", BOOTIMG_ADDR,
+				 (unsigned long long)boot_mtd->size,
+				 BOOTIMG_ADDR);
+			env_set("bootcmd", tmp);
+#else
 			env_set("bootcmd", HB_SET_WDT "avb_verify; bootm "__stringify(BOOTIMG_ADDR));
+#endif
 		} else {
 			env_set("bootcmd", HB_SET_WDT "bootm "__stringify(BOOTIMG_ADDR));
 		}
@@ -9,6 +9,7 @@
 #include <command.h>
 #include <image.h>
 #include <malloc.h>
+#include <mapmem.h>
 #include <mmc.h>
 
 #include <ota.h>
@@ -253,6 +254,7 @@ int do_avb_verify_part(cmd_tbl_t *cmdtp, int flag,
 	if (avb_ops->read_is_device_unlocked(avb_ops, &unlocked) !=
 	    AVB_IO_RESULT_OK) {
 		printf("Can't determine device lock state.\n");
+		avb_ops_set_preload(avb_ops, NULL, NULL, 0);
 		return CMD_RET_FAILURE;
 	}
 
@@ -274,6 +276,9 @@ int do_avb_verify_part(cmd_tbl_t *cmdtp, int flag,
 				AVB_HASHTREE_ERROR_MODE_RESTART_AND_INVALIDATE,
 				&out_data);
 
+	/* A preload only holds for this verification */
+	avb_ops_set_preload(avb_ops, NULL, NULL, 0);
+
 	switch (slot_result) {
 	case AVB_SLOT_VERIFY_RESULT_OK:
 		/* Until we don't have support of changing unlock states, we
@@ -324,6 +329,60 @@ int do_avb_verify_part(cmd_tbl_t *cmdtp, int flag,
 	return res;
 }
 
+int do_avb_preload(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	const char *part;
+	ulong addr;
+	size_t bytes;
+
+	if (!avb_ops) {
+		printf("AVB 2.0 is not initialized, run 'avb init' first\n");
+		return CMD_RET_FAILURE;
+	}
+
+	if (argc != 4)
+		return CMD_RET_USAGE;
+
+	part = argv[1];
+	addr = simple_strtoul(argv[2], NULL, 16);
+	bytes = simple_strtoul(argv[3], NULL, 16);
+
+	if (avb_ops_set_preload(avb_ops, part, map_sysmem(addr, bytes), bytes)) {
+		printf("Partition name '%s' is too long\n", part);
+		return CMD_RET_FAILURE;
+	}
+
+	return CMD_RET_SUCCESS;
+}
+
+#if defined(CONFIG_AVB_HASHTREE) && defined(CONFIG_HB_BOOT_FROM_MMC)
+int do_avb_verify_hashtree(cmd_tbl_t *cmdtp, int flag, int argc,
+			   char * const argv[])
+{
+	struct avb_hashtree_stats stats;
+	int ret;
+
+	if (!avb_ops) {
+		printf("AVB 2.0 is not initialized, run 'avb init' first\n");
+		return CMD_RET_FAILURE;
+	}
+
+	if (argc != 2)
+		return CMD_RET_USAGE;
+
+	ret = avb_verify_hashtree(avb_ops, argv[1], &stats);
+	if (ret) {
+		printf("Hash tree verification of '%s' failed (%d)\n", argv[1],
+		       ret);
+		return CMD_RET_FAILURE;
+	}
+
+	avb_hashtree_print_stats(argv[1], &stats);
+
+	return CMD_RET_SUCCESS;
+}
+#endif
+
 int do_avb_is_unlocked(cmd_tbl_t *cmdtp, int flag,
 		       int argc, char * const argv[])
 {
@@ -357,7 +416,11 @@ static cmd_tbl_t cmd_avb[] = {
 	U_BOOT_CMD_MKENT(read_part, 5, 0, do_avb_read_part, "", ""),
 	U_BOOT_CMD_MKENT(read_part_hex, 4, 0, do_avb_read_part_hex, "", ""),
 	U_BOOT_CMD_MKENT(write_part, 5, 0, do_avb_write_part, "", ""),
+	U_BOOT_CMD_MKENT(preload, 4, 0, do_avb_preload, "", ""),
 	U_BOOT_CMD_MKENT(verify, 1, 0, do_avb_verify_part, "", ""),
+#if defined(CONFIG_AVB_HASHTREE) && defined(CONFIG_HB_BOOT_FROM_MMC)
+	U_BOOT_CMD_MKENT(verify-hashtree, 2, 0, do_avb_verify_hashtree, "", ""),
+#endif
 };
 
 static int do_avb(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
@@ -392,16 +455,26 @@ U_BOOT_CMD(
 	"    partition <partname> and print to stdout\n"
 	"avb write_part <partname> <offset> <num> <addr> - write <num> bytes to\n"
 	"    <partname> by <offset> using data from <addr>\n"
+	"avb preload <partname> <addr> <num> - tell that the first <num> bytes\n"
+	"    of partition <partname> are at <addr>, verify then hashes them there\n"
 	"avb verify - run verification process using hash data\n"
 	"    from vbmeta structure\n"
+#if defined(CONFIG_AVB_HASHTREE) && defined(CONFIG_HB_BOOT_FROM_MMC)
+	"avb verify-hashtree <partname> - check all of\n"
+	"    <partname> against its hash tree from vbmeta\n"
+#endif
 	);
 
 static int do_avb_verify(cmd_tbl_t *cmdtp, int flag, int argc,
 		char *const argv[])
 {
 	char *cmd = NULL;
+	char preload[128];
 	int ret = 0;
 
+	if (argc != 1 && argc != 3)
+		return CMD_RET_USAGE;
+
 	/* avb init */
 #if defined CONFIG_HB_BOOT_FROM_NOR
 	cmd = "avb init sf 0";
@@ -415,6 +488,17 @@ static int do_avb_verify(cmd_tbl_t *cmdtp, int flag, int argc,
 	if (ret != 0)
 		printf("avb init failed! \n");
 
+	/* hash the boot image where it was loaded rather than reading it */
+	if (argc == 3) {
+		snprintf(preload, sizeof(preload), "avb preload %s %s %s",
+			 boot_partition, argv[1], argv[2]);
+		ret = run_command(preload, 0);
+		if (ret != 0) {
+			printf("avb preload failed! \n");
+			return CMD_RET_FAILURE;
+		}
+	}
+
 	/* avb verify */
 	cmd = "avb verify";
 	ret = run_command(cmd, 0);
@@ -428,7 +512,8 @@ static int do_avb_verify(cmd_tbl_t *cmdtp, int flag, int argc,
 	return ret;
 }
 
-U_BOOT_CMD(avb_verify, 1, 0, do_avb_verify,
+U_BOOT_CMD(avb_verify, 3, 0, do_avb_verify,
 	"verify signature and hash in vbmeta partition",
-	"avb_verify - verify vbmeta"
+	"[<addr> <size>] - verify vbmeta\n"
+	"    <addr> <size>: the boot partition was loaded to <addr>, hash it there"
 	);
@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Check a partition against the hash tree described by its own AVB footer
+ */
+
+#include <common.h>
+#include <avb_hashtree.h>
+#include <blk.h>
+#include <command.h>
+#include <part.h>
+
+static int avb_hashtree_get_part(const char *ifname, const char *dev_str,
+				 const char *part_str, struct blk_desc **descp,
+				 disk_partition_t *info)
+{
+	char *endp;
+	int part;
+	int ret;
+
+	ret = blk_get_device_by_str(ifname, dev_str, descp);
+	if (ret < 0)
+		return ret;
+
+	part = simple_strtoul(part_str, &endp, 10);
+	if (*endp)
+		return part_get_info_by_name(*descp, part_str, info) < 0 ?
+			-ENOENT : 0;
+
+	return part_get_info(*descp, part, info);
+}
+
+static int do_avb_hashtree(cmd_tbl_t *cmdtp, int flag, int argc,
+			   char * const argv[])
+{
+	struct avb_hashtree_stats stats;
+	struct avb_hashtree tree;
+	struct blk_desc *desc;
+	disk_partition_t info;
+	int ret;
+
+	if (argc != 4)
+		return CMD_RET_USAGE;
+
+	if (avb_hashtree_get_part(argv[1], argv[2], argv[3], &desc, &info)) {
+		printf("Cannot find partition %s on %s %s\n", argv[3], argv[1],
+		       argv[2]);
+		return CMD_RET_FAILURE;
+	}
+
+	ret = avb_hashtree_from_footer(desc, &info, NULL, &tree);
+	if (ret) {
+		printf("No hash tree in the AVB footer of %s (%d)\n", argv[3],
+		       ret);
+		return CMD_RET_FAILURE;
+	}
+
+	ret = avb_hashtree_verify(desc, &info, &tree, &stats);
+	if (ret) {
+		printf("Hash tree verification of %s failed (%d)\n", argv[3],
+		       ret);
+		return CMD_RET_FAILURE;
+	}
+
+	avb_hashtree_print_stats(argv[3], &stats);
+
+	return CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD(
+	avb_hashtree, 4, 0, do_avb_hashtree,
+	"check a partition against the hash tree in its AVB footer",
+	"<interface> <dev> <part>\n"
+	"    - check every block of partition <part> (number or name) of\n"
+	"      <interface> <dev> and every level of its dm-verity hash tree.\n"
+	"      The footer is not authenticated: use 'avb verify-hashtree' to\n"
+	"      check against the signed vbmeta."
+);
@@ -0,0 +1,248 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Load a boot image from a partition without reading the whole partition
+ *
+ * Boot partitions are sized for the largest image they may ever hold, so
+ * most of a partition is usually padding. The image header tells how many
+ * bytes are in use: read the first blocks, parse the legacy, FIT or Android
+ * header and fetch the rest of the image with one large read.
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <command.h>
+#include <image.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <part.h>
+#include <android_image.h>
+
+/* Enough to hold any supported header, an Android one being the largest */
+#define BOOTIMG_PROBE_SIZE	2048
+
+static int bootimg_get_part(const char *ifname, const char *dev_str,
+			    const char *part_str, struct blk_desc **descp,
+			    disk_partition_t *info)
+{
+	char *endp;
+	int part;
+	int ret;
+
+	ret = blk_get_device_by_str(ifname, dev_str, descp);
+	if (ret < 0)
+		return ret;
+
+	part = simple_strtoul(part_str, &endp, 10);
+	if (*endp)
+		return part_get_info_by_name(*descp, part_str, info) < 0 ?
+			-ENOENT : 0;
+	if (!part)
+		return part_get_info_whole_disk(*descp, info);
+
+	return part_get_info(*descp, part, info);
+}
+
+/* Read @size bytes from block-aligned byte @offset of the partition */
+static int bootimg_read(struct blk_desc *desc, disk_partition_t *info,
+			ulong offset, ulong size, void *buf)
+{
+	lbaint_t start = offset / info->blksz;
+	lbaint_t count = DIV_ROUND_UP(size, info->blksz);
+
+	if (start + count > info->size) {
+		printf("Image exceeds the partition (%lu bytes)\n",
+		       (ulong)(info->size * info->blksz));
+		return -EFBIG;
+	}
+
+	if (blk_dread(desc, info->start + start, count, buf) != count)
+		return -EIO;
+
+	return 0;
+}
+
+#if IMAGE_ENABLE_FIT
+/* End of a FIT, including the data of images stored after the FDT */
+static ulong bootimg_fit_end(const void *fit)
+{
+	ulong end = fdt_totalsize(fit);
+	int images, node;
+	int pos, size;
+
+	images = fdt_path_offset(fit, FIT_IMAGES_PATH);
+	if (images < 0)
+		return end;
+
+	fdt_for_each_subnode(node, fit, images) {
+		if (!fit_image_get_data_position(fit, node, &pos))
+			;
+		else if (!fit_image_get_data_offset(fit, node, &pos))
+			pos += ALIGN(fdt_totalsize(fit), 4);
+		else
+			continue;
+		if (fit_image_get_data_size(fit, node, &size))
+			continue;
+		end = max(end, (ulong)pos + size);
+	}
+
+	return end;
+}
+#endif
+
+/*
+ * Work out the size of the image whose header is in @hdr and, with @direct,
+ * where it has to be loaded for its kernel to sit at its load address
+ */
+static int bootimg_parse(const void *hdr, bool direct, ulong *sizep,
+			 ulong *addrp)
+{
+	switch (genimg_get_format(hdr)) {
+#if defined(CONFIG_IMAGE_FORMAT_LEGACY)
+	case IMAGE_FORMAT_LEGACY:
+		if (!image_check_hcrc(hdr)) {
+			puts("Bad header checksum\n");
+			return -EINVAL;
+		}
+		*sizep = image_get_image_size(hdr);
+		if (direct)
+			*addrp = image_get_load(hdr) - image_get_header_size();
+		return 0;
+#endif
+#if IMAGE_ENABLE_FIT
+	case IMAGE_FORMAT_FIT:
+		/* The external data is only known once the FDT is loaded */
+		*sizep = fdt_totalsize(hdr);
+		if (direct) {
+			puts("FIT images cannot be loaded in place\n");
+			return -EINVAL;
+		}
+		return 0;
+#endif
+#ifdef CONFIG_ANDROID_BOOT_IMAGE
+	case IMAGE_FORMAT_ANDROID: {
+		const struct andr_img_hdr *andr = hdr;
+		ulong kload = android_image_get_kload(andr);
+
+		*sizep = android_image_get_end(andr) - (ulong)andr;
+		/* kload points inside @hdr for execute-in-place kernels */
+		if (direct && kload != (ulong)andr + andr->page_size)
+			*addrp = kload - andr->page_size;
+		return 0;
+	}
+#endif
+	default:
+		puts("Unknown image format\n");
+		return -EINVAL;
+	}
+}
+
+static int do_bootimg_load(cmd_tbl_t *cmdtp, int flag, int argc,
+			   char * const argv[])
+{
+	struct blk_desc *desc;
+	disk_partition_t info;
+	ulong addr = load_addr;
+	ulong probe_size, loaded, size;
+	bool direct = false;
+	void *probe, *buf;
+	int ret;
+
+	if (argc > 1 && !strcmp(argv[1], "-x")) {
+		direct = true;
+		argc--;
+		argv++;
+	}
+	if (argc < 4 || argc > 5)
+		return CMD_RET_USAGE;
+	if (argc == 5)
+		addr = simple_strtoul(argv[4], NULL, 16);
+
+	if (bootimg_get_part(argv[1], argv[2], argv[3], &desc, &info)) {
+		printf("Cannot find partition %s on %s %s\n", argv[3], argv[1],
+		       argv[2]);
+		return CMD_RET_FAILURE;
+	}
+
+	probe_size = roundup(BOOTIMG_PROBE_SIZE, info.blksz);
+	probe = memalign(ARCH_DMA_MINALIGN, probe_size);
+	if (!probe)
+		return CMD_RET_FAILURE;
+
+	ret = bootimg_read(desc, &info, 0, probe_size, probe);
+	if (!ret)
+		ret = bootimg_parse(probe, direct, &size, &addr);
+	if (ret) {
+		free(probe);
+		return CMD_RET_FAILURE;
+	}
+
+	buf = map_sysmem(addr, 0);
+	memcpy(buf, probe, probe_size);
+	free(probe);
+
+	/* Everything past the probe, in as few reads as possible */
+	loaded = probe_size;
+	if (size > loaded) {
+		ret = bootimg_read(desc, &info, loaded, size - loaded,
+				   buf + loaded);
+		loaded = roundup(size, info.blksz);
+	}
+#if IMAGE_ENABLE_FIT
+	if (!ret && genimg_get_format(buf) == IMAGE_FORMAT_FIT) {
+		size = bootimg_fit_end(buf);
+		if (size > loaded) {
+			ret = bootimg_read(desc, &info, loaded, size - loaded,
+					   buf + loaded);
+			loaded = roundup(size, info.blksz);
+		}
+	}
+#endif
+	unmap_sysmem(buf);
+	if (ret) {
+		printf("Error reading image: %d\n", ret);
+		return CMD_RET_FAILURE;
+	}
+
+	printf("%lu bytes read of %lu byte partition to 0x%lx\n", loaded,
+	       (ulong)(info.size * info.blksz), addr);
+	env_set_hex("fileaddr", addr);
+	env_set_hex("filesize", size);
+
+	return CMD_RET_SUCCESS;
+}
+
+static cmd_tbl_t cmd_bootimg_sub[] = {
+	U_BOOT_CMD_MKENT(load, 6, 0, do_bootimg_load, "", ""),
+};
+
+static int do_bootimg(cmd_tbl_t *cmdtp, int flag, int argc,
+		      char * const argv[])
+{
+	cmd_tbl_t *cp;
+
+	cp = find_cmd_tbl(argv[1], cmd_bootimg_sub,
+			  ARRAY_SIZE(cmd_bootimg_sub));
+
+	/* Strip off leading 'bootimg' command argument */
+	argc--;
+	argv++;
+
+	if (!cp || argc > cp->maxargs)
+		return CMD_RET_USAGE;
+	if (flag == CMD_FLAG_REPEAT && !cp->repeatable)
+		return CMD_RET_SUCCESS;
+
+	return cp->cmd(cmdtp, flag, argc, argv);
+}
+
+U_BOOT_CMD(
+	bootimg, CONFIG_SYS_MAXARGS, 0, do_bootimg,
+	"load a boot image from a partition",
+	"load [-x] <interface> <dev> <part> [addr]\n"
+	"    - read the image in partition <part> (number or name) of\n"
+	"      <interface> <dev> to [addr], or $loadaddr, reading only the\n"
+	"      bytes its legacy, FIT or Android header accounts for.\n"
+	"      -x: load the image so that its kernel is already at its load\n"
+	"      address, [addr] is then ignored.\n"
+	"      Sets $fileaddr and $filesize."
+);
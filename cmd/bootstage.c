@@ -4,6 +4,8 @@
  */
 
 #include <common.h>
+#include <malloc.h>
+#include <mapmem.h>
 
 static int do_bootstage_report(cmd_tbl_t *cmdtp, int flag, int argc,
 			       char * const argv[])
@@ -57,10 +59,58 @@ static int do_bootstage_stash(cmd_tbl_t *cmdtp, int flag, int argc,
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(BOOTSTAGE_PROFILE)
+static int do_bootstage_trace(cmd_tbl_t *cmdtp, int flag, int argc,
+			      char * const argv[])
+{
+	ulong addr, size;
+	char *buf, *endp;
+	int len;
+
+	len = bootstage_event_export(NULL, 0);
+	if (argc < 2) {
+		buf = malloc(len + 1);
+		if (!buf) {
+			printf("Cannot allocate %#x bytes for trace\n", len + 1);
+			return CMD_RET_FAILURE;
+		}
+		bootstage_event_export(buf, len + 1);
+		puts(buf);
+		free(buf);
+
+		return 0;
+	}
+
+	addr = simple_strtoul(argv[1], &endp, 16);
+	if (*argv[1] == 0 || *endp != 0)
+		return CMD_RET_USAGE;
+	size = len + 1;
+	if (argc > 2) {
+		size = simple_strtoul(argv[2], &endp, 16);
+		if (*argv[2] == 0 || *endp != 0)
+			return CMD_RET_USAGE;
+	}
+	if (size < len + 1) {
+		printf("Trace needs %#x bytes\n", len + 1);
+		return CMD_RET_FAILURE;
+	}
+
+	buf = map_sysmem(addr, size);
+	bootstage_event_export(buf, size);
+	unmap_sysmem(buf);
+	env_set_hex("filesize", len);
+
+	return 0;
+}
+#endif
+
 static cmd_tbl_t cmd_bootstage_sub[] = {
 	U_BOOT_CMD_MKENT(report, 2, 1, do_bootstage_report, "", ""),
 	U_BOOT_CMD_MKENT(stash, 4, 0, do_bootstage_stash, "", ""),
 	U_BOOT_CMD_MKENT(unstash, 4, 0, do_bootstage_stash, "", ""),
+#if CONFIG_IS_ENABLED(BOOTSTAGE_PROFILE)
+	U_BOOT_CMD_MKENT(trace, 3, 0, do_bootstage_trace, "", ""),
+#endif
 };
 
 /*
@@ -91,4 +141,8 @@ U_BOOT_CMD(bootstage, 4, 1, do_boostage,
 	"report                      - Print a report\n"
 	"stash [<start> [<size>]]    - Stash data into memory\n"
 	"unstash [<start> [<size>]]  - Unstash data from memory"
+#if CONFIG_IS_ENABLED(BOOTSTAGE_PROFILE)
+	"\ntrace [<addr> [<size>]]     - Print the profile as a JSON timeline,\n"
+	"                              or write it to memory"
+#endif
 );
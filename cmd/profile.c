@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Control of the sampling profiler
+ */
+
+#include <common.h>
+#include <command.h>
+#include <profile.h>
+
+#define PROFILE_DEFAULT_HZ	1000
+#define PROFILE_DEFAULT_TOP	20
+
+static void show_stats(void)
+{
+	struct profile_stats stats;
+
+	profile_get_stats(&stats);
+	if (stats.hz)
+		printf("Running at %u Hz, ", stats.hz);
+	else
+		printf("Stopped, ");
+	printf("%u samples in %u stacks, %u lost\n", stats.samples,
+	       stats.stacks, stats.lost);
+}
+
+static int do_profile_start(cmd_tbl_t *cmdtp, int flag, int argc,
+			    char * const argv[])
+{
+	uint hz = PROFILE_DEFAULT_HZ;
+	int ret;
+
+	if (argc > 1)
+		hz = simple_strtoul(argv[1], NULL, 10);
+	ret = profile_start(hz);
+	if (ret) {
+		printf("Cannot start profiler (err=%d)\n", ret);
+		return CMD_RET_FAILURE;
+	}
+
+	return 0;
+}
+
+static int do_profile_stop(cmd_tbl_t *cmdtp, int flag, int argc,
+			   char * const argv[])
+{
+	profile_stop();
+	show_stats();
+
+	return 0;
+}
+
+static int do_profile_reset(cmd_tbl_t *cmdtp, int flag, int argc,
+			    char * const argv[])
+{
+	profile_reset();
+
+	return 0;
+}
+
+static int do_profile_stats(cmd_tbl_t *cmdtp, int flag, int argc,
+			    char * const argv[])
+{
+	show_stats();
+
+	return 0;
+}
+
+static int do_profile_show(cmd_tbl_t *cmdtp, int flag, int argc,
+			   char * const argv[])
+{
+	profile_show_folded();
+
+	return 0;
+}
+
+static int do_profile_top(cmd_tbl_t *cmdtp, int flag, int argc,
+			  char * const argv[])
+{
+	int count = PROFILE_DEFAULT_TOP;
+
+	if (argc > 1)
+		count = simple_strtoul(argv[1], NULL, 10);
+	profile_show_top(count);
+
+	return 0;
+}
+
+static cmd_tbl_t cmd_profile_sub[] = {
+	U_BOOT_CMD_MKENT(start, 2, 0, do_profile_start, "", ""),
+	U_BOOT_CMD_MKENT(stop, 1, 0, do_profile_stop, "", ""),
+	U_BOOT_CMD_MKENT(reset, 1, 0, do_profile_reset, "", ""),
+	U_BOOT_CMD_MKENT(stats, 1, 0, do_profile_stats, "", ""),
+	U_BOOT_CMD_MKENT(show, 1, 0, do_profile_show, "", ""),
+	U_BOOT_CMD_MKENT(top, 2, 0, do_profile_top, "", ""),
+};
+
+static int do_profile(cmd_tbl_t *cmdtp, int flag, int argc,
+		      char * const argv[])
+{
+	cmd_tbl_t *c;
+
+	if (argc < 2)
+		return CMD_RET_USAGE;
+
+	/* Strip off leading 'profile' command argument */
+	argc--;
+	argv++;
+
+	c = find_cmd_tbl(argv[0], cmd_profile_sub, ARRAY_SIZE(cmd_profile_sub));
+	if (c)
+		return c->cmd(cmdtp, flag, argc, argv);
+	else
+		return CMD_RET_USAGE;
+}
+
+U_BOOT_CMD(profile, 3, 0, do_profile,
+	"Sampling profiler",
+	"start [<hz>]  - Start sampling, by default 1000 times a second\n"
+	"profile stop          - Stop sampling\n"
+	"profile reset         - Drop all samples\n"
+	"profile stats         - Show the number of samples\n"
+	"profile show          - Print the stacks in folded form, for flamegraph.pl\n"
+	"profile top [<count>] - Print the functions with the most samples"
+);
@@ -0,0 +1,31 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * SquashFS commands, thin wrappers around the generic fs commands
+ */
+
+#include <common.h>
+#include <command.h>
+#include <fs.h>
+
+static int do_sqfs_ls(cmd_tbl_t *cmdtp, int flag, int argc,
+		      char *const argv[])
+{
+	return do_ls(cmdtp, flag, argc, argv, FS_TYPE_SQUASHFS);
+}
+
+static int do_sqfs_load(cmd_tbl_t *cmdtp, int flag, int argc,
+			char *const argv[])
+{
+	return do_load(cmdtp, flag, argc, argv, FS_TYPE_SQUASHFS);
+}
+
+U_BOOT_CMD(sqfsls, 4, 1, do_sqfs_ls,
+	   "list files in a directory (default /)",
+	   "<interface> <dev[:part]> [directory]\n"
+	   "    - list files from 'dev' on 'interface' in 'directory'");
+
+U_BOOT_CMD(sqfsload, 7, 0, do_sqfs_load,
+	   "load binary file from a SquashFS filesystem",
+	   "<interface> [<dev[:part]> [addr [filename [bytes [pos]]]]]\n"
+	   "    - load binary file 'filename' from 'dev' on 'interface'\n"
+	   "      to address 'addr' from SquashFS filesystem");
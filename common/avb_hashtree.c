@@ -0,0 +1,428 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Verification of dm-verity hash trees described by AVB hashtree descriptors
+ *
+ * Partitions such as the root filesystem are too large to hash at boot, so
+ * AVB only passes their root digest to the kernel and dm-verity checks
+ * blocks as they are read. For factory checks and recovery-mode scans this
+ * checks the whole partition from U-Boot instead: the tree is read once and
+ * each level is checked against the one above it, then the data is streamed
+ * in large reads and checked against the lowest level.
+ */
+
+#include <common.h>
+#include <avb_hashtree.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <watchdog.h>
+#include <div64.h>
+#include <linux/log2.h>
+#include <linux/sizes.h>
+#include <u-boot/sha1.h>
+#include <u-boot/sha256.h>
+#include <../lib/libavb/libavb.h>
+
+/* Data is read and hashed this many bytes at a time */
+#define AVB_HASHTREE_CHUNK		SZ_8M
+#define AVB_HASHTREE_VBMETA_MAX		SZ_64K
+
+enum {
+	AVB_HASHTREE_SHA1,
+	AVB_HASHTREE_SHA256,
+};
+
+/* Hash state after the salt, which every block starts from */
+struct avb_hashtree_ctx {
+	int algo;
+	u32 digest_len;
+	u32 digest_size;	/* space taken by a digest in the tree */
+	union {
+#ifdef CONFIG_SHA1
+		sha1_context sha1;
+#endif
+		sha256_context sha256;
+	} salted;
+};
+
+/* @count blocks of @block_size at @data, to check against @expect */
+struct avb_hashtree_job {
+	const struct avb_hashtree_ctx *ctx;
+	const u8 *data;
+	u32 block_size;
+	ulong count;
+	const u8 *expect;
+};
+
+static void avb_hashtree_digest(const struct avb_hashtree_ctx *ctx,
+				const u8 *block, u32 size, u8 *digest)
+{
+	switch (ctx->algo) {
+#ifdef CONFIG_SHA1
+	case AVB_HASHTREE_SHA1: {
+		sha1_context sha1 = ctx->salted.sha1;
+
+		sha1_update(&sha1, block, size);
+		sha1_finish(&sha1, digest);
+		break;
+	}
+#endif
+	default: {
+		sha256_context sha256 = ctx->salted.sha256;
+
+		sha256_update(&sha256, block, size);
+		sha256_finish(&sha256, digest);
+		break;
+	}
+	}
+}
+
+/* Returns the first block that does not match, or ULONG_MAX */
+static ulong avb_hashtree_run(const struct avb_hashtree_job *job)
+{
+	const struct avb_hashtree_ctx *ctx = job->ctx;
+	u8 digest[AVB_HASHTREE_MAX_DIGEST];
+	ulong i;
+
+	for (i = 0; i < job->count; i++) {
+		avb_hashtree_digest(ctx, job->data + i * job->block_size,
+				    job->block_size, digest);
+		if (memcmp(digest, job->expect + i * ctx->digest_size,
+			   ctx->digest_len))
+			return i;
+	}
+
+	return ULONG_MAX;
+}
+
+static int avb_hashtree_read(struct blk_desc *desc, disk_partition_t *info,
+			     u64 offset, u64 size, void *buf)
+{
+	lbaint_t start = offset / info->blksz;
+	lbaint_t count = DIV_ROUND_UP(size, info->blksz);
+
+	if (offset % info->blksz || start + count > info->size) {
+		printf("Hash tree points outside the partition\n");
+		return -EINVAL;
+	}
+	if (blk_dread(desc, info->start + start, count, buf) != count)
+		return -EIO;
+
+	return 0;
+}
+
+static int avb_hashtree_init(struct avb_hashtree_ctx *ctx,
+			     const struct avb_hashtree *tree,
+			     disk_partition_t *info)
+{
+	if (!strcmp(tree->algo, "sha256")) {
+		ctx->algo = AVB_HASHTREE_SHA256;
+		ctx->digest_len = SHA256_SUM_LEN;
+		sha256_starts(&ctx->salted.sha256);
+		sha256_update(&ctx->salted.sha256, tree->salt, tree->salt_len);
+#ifdef CONFIG_SHA1
+	} else if (!strcmp(tree->algo, "sha1")) {
+		ctx->algo = AVB_HASHTREE_SHA1;
+		ctx->digest_len = SHA1_SUM_LEN;
+		sha1_starts(&ctx->salted.sha1);
+		sha1_update(&ctx->salted.sha1, tree->salt, tree->salt_len);
+#endif
+	} else {
+		printf("Unsupported hash algorithm '%s'\n", tree->algo);
+		return -EPROTONOSUPPORT;
+	}
+	ctx->digest_size = roundup_pow_of_two(ctx->digest_len);
+
+	if (tree->root_digest_len != ctx->digest_len) {
+		printf("Root digest is %u bytes, expected %u\n",
+		       tree->root_digest_len, ctx->digest_len);
+		return -EINVAL;
+	}
+	if (!is_power_of_2(tree->data_block_size) ||
+	    !is_power_of_2(tree->hash_block_size) ||
+	    tree->data_block_size % info->blksz ||
+	    tree->hash_block_size % info->blksz ||
+	    tree->data_block_size > AVB_HASHTREE_CHUNK ||
+	    tree->hash_block_size < ctx->digest_size) {
+		printf("Unsupported hash tree block sizes %u/%u\n",
+		       tree->data_block_size, tree->hash_block_size);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/*
+ * Work out the size and offset of each level, the lowest one first. The
+ * levels are stored top first, the top one being a single hash block.
+ */
+static int avb_hashtree_levels(const struct avb_hashtree *tree,
+			       const struct avb_hashtree_ctx *ctx,
+			       u64 *level_offset, u64 *level_size)
+{
+	u64 size = tree->image_size;
+	u32 block_size = tree->data_block_size;
+	u64 offset = 0;
+	int levels = 0;
+	int i;
+
+	while (size > block_size) {
+		if (levels == AVB_HASHTREE_MAX_LEVELS)
+			return -EINVAL;
+		size = roundup(DIV_ROUND_UP(size, block_size) *
+			       ctx->digest_size, tree->hash_block_size);
+		level_size[levels++] = size;
+		block_size = tree->hash_block_size;
+	}
+
+	for (i = levels - 1; i >= 0; i--) {
+		level_offset[i] = offset;
+		offset += level_size[i];
+	}
+
+	if (!levels) {
+		printf("Image is too small for a hash tree\n");
+		return -EINVAL;
+	}
+	if (offset != tree->tree_size) {
+		printf("Hash tree is %llu bytes, expected %llu\n",
+		       tree->tree_size, offset);
+		return -EINVAL;
+	}
+
+	return levels;
+}
+
+int avb_hashtree_verify(struct blk_desc *desc, disk_partition_t *info,
+			const struct avb_hashtree *tree,
+			struct avb_hashtree_stats *stats)
+{
+	u64 level_offset[AVB_HASHTREE_MAX_LEVELS];
+	u64 level_size[AVB_HASHTREE_MAX_LEVELS];
+	u8 digest[AVB_HASHTREE_MAX_DIGEST];
+	ulong start = get_timer(0);
+	struct avb_hashtree_ctx ctx;
+	struct avb_hashtree_job job;
+	u8 *tree_buf, *buf;
+	u64 offset, len;
+	int levels, i;
+	ulong bad;
+	int ret;
+
+	ret = avb_hashtree_init(&ctx, tree, info);
+	if (ret)
+		return ret;
+
+	levels = avb_hashtree_levels(tree, &ctx, level_offset, level_size);
+	if (levels < 0)
+		return levels;
+
+	tree_buf = malloc_cache_aligned(tree->tree_size);
+	buf = malloc_cache_aligned(AVB_HASHTREE_CHUNK);
+	if (!tree_buf || !buf) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	ret = avb_hashtree_read(desc, info, tree->tree_offset, tree->tree_size,
+				tree_buf);
+	if (ret)
+		goto out;
+
+	/* The top level is covered by the root digest */
+	avb_hashtree_digest(&ctx, tree_buf + level_offset[levels - 1],
+			    tree->hash_block_size, digest);
+	if (memcmp(digest, tree->root_digest, ctx.digest_len)) {
+		printf("Hash tree does not match the root digest\n");
+		ret = -EBADMSG;
+		goto out;
+	}
+
+	/* Every other level by the one above it */
+	job.ctx = &ctx;
+	job.block_size = tree->hash_block_size;
+	for (i = levels - 2; i >= 0; i--) {
+		job.data = tree_buf + level_offset[i];
+		job.count = level_size[i] / tree->hash_block_size;
+		job.expect = tree_buf + level_offset[i + 1];
+		bad = avb_hashtree_run(&job);
+		if (bad != ULONG_MAX) {
+			printf("Hash tree level %d block %lu does not match\n",
+			       i, bad);
+			ret = -EBADMSG;
+			goto out;
+		}
+	}
+
+	/* And the data by the lowest level */
+	job.block_size = tree->data_block_size;
+	for (offset = 0; offset < tree->image_size; offset += len) {
+		len = min_t(u64, tree->image_size - offset, AVB_HASHTREE_CHUNK);
+		ret = avb_hashtree_read(desc, info, offset, len, buf);
+		if (ret)
+			goto out;
+
+		/* A partial last block is hashed zero-padded */
+		if (len % tree->data_block_size)
+			memset(buf + len, '\0', tree->data_block_size -
+			       len % tree->data_block_size);
+
+		job.data = buf;
+		job.count = DIV_ROUND_UP(len, tree->data_block_size);
+		job.expect = tree_buf + level_offset[0] +
+			offset / tree->data_block_size * ctx.digest_size;
+		bad = avb_hashtree_run(&job);
+		if (bad != ULONG_MAX) {
+			printf("Data block %llu does not match the hash tree\n",
+			       offset / tree->data_block_size + bad);
+			ret = -EBADMSG;
+			goto out;
+		}
+		WATCHDOG_RESET();
+	}
+
+	if (stats) {
+		stats->bytes = tree->image_size + tree->tree_size;
+		stats->levels = levels;
+		stats->time_ms = get_timer(start);
+	}
+out:
+	free(buf);
+	free(tree_buf);
+
+	return ret;
+}
+
+void avb_hashtree_print_stats(const char *name,
+			      const struct avb_hashtree_stats *stats)
+{
+	ulong ms = max(stats->time_ms, 1UL);
+
+	printf("%s: %llu bytes, %d levels, %lu ms, %llu MB/s\n",
+	       name, stats->bytes, stats->levels, stats->time_ms,
+	       lldiv(stats->bytes, ms * 1000));
+}
+
+static int avb_hashtree_from_descriptor(const void *desc, size_t size,
+					const char *name,
+					struct avb_hashtree *tree)
+{
+	const AvbHashtreeDescriptor *htd = desc;
+	const u8 *data = desc + sizeof(*htd);
+	u32 name_len, salt_len, digest_len;
+	size_t algo_len;
+
+	if (size < sizeof(*htd))
+		return -EINVAL;
+
+	name_len = be32_to_cpu(htd->partition_name_len);
+	salt_len = be32_to_cpu(htd->salt_len);
+	digest_len = be32_to_cpu(htd->root_digest_len);
+	if ((u64)name_len + salt_len + digest_len > size - sizeof(*htd))
+		return -EINVAL;
+
+	if (name && (name_len != strlen(name) || memcmp(data, name, name_len)))
+		return -ENOENT;
+
+	algo_len = strnlen((const char *)htd->hash_algorithm,
+			   sizeof(htd->hash_algorithm));
+	if (algo_len >= sizeof(tree->algo) || salt_len > sizeof(tree->salt) ||
+	    digest_len > sizeof(tree->root_digest))
+		return -EINVAL;
+
+	memset(tree, '\0', sizeof(*tree));
+	memcpy(tree->algo, htd->hash_algorithm, algo_len);
+	tree->image_size = be64_to_cpu(htd->image_size);
+	tree->tree_offset = be64_to_cpu(htd->tree_offset);
+	tree->tree_size = be64_to_cpu(htd->tree_size);
+	tree->data_block_size = be32_to_cpu(htd->data_block_size);
+	tree->hash_block_size = be32_to_cpu(htd->hash_block_size);
+	tree->salt_len = salt_len;
+	tree->root_digest_len = digest_len;
+	memcpy(tree->salt, data + name_len, salt_len);
+	memcpy(tree->root_digest, data + name_len + salt_len, digest_len);
+
+	return 0;
+}
+
+int avb_hashtree_from_vbmeta(const u8 *vbmeta, u64 size, const char *name,
+			     struct avb_hashtree *tree)
+{
+	const AvbVBMetaImageHeader *hdr = (const void *)vbmeta;
+	const AvbDescriptor *desc;
+	u64 auth_size, aux_size, offset, end, len;
+	int ret;
+
+	if (size < sizeof(*hdr) || memcmp(hdr->magic, AVB_MAGIC, AVB_MAGIC_LEN))
+		return -ENOENT;
+
+	auth_size = be64_to_cpu(hdr->authentication_data_block_size);
+	aux_size = be64_to_cpu(hdr->auxiliary_data_block_size);
+	offset = be64_to_cpu(hdr->descriptors_offset);
+	len = be64_to_cpu(hdr->descriptors_size);
+	if (auth_size > size || aux_size > size || offset > aux_size ||
+	    len > aux_size - offset || sizeof(*hdr) + auth_size + aux_size > size)
+		return -EINVAL;
+
+	offset += sizeof(*hdr) + auth_size;
+	end = offset + len;
+	while (offset + sizeof(*desc) <= end) {
+		desc = (const void *)(vbmeta + offset);
+		len = be64_to_cpu(desc->num_bytes_following);
+		if (len > end - offset - sizeof(*desc))
+			return -EINVAL;
+		if (be64_to_cpu(desc->tag) == AVB_DESCRIPTOR_TAG_HASHTREE) {
+			ret = avb_hashtree_from_descriptor(desc,
+							   sizeof(*desc) + len,
+							   name, tree);
+			if (ret != -ENOENT)
+				return ret;
+		}
+		offset += sizeof(*desc) + len;
+	}
+
+	return -ENOENT;
+}
+
+int avb_hashtree_from_footer(struct blk_desc *desc, disk_partition_t *info,
+			     const char *name, struct avb_hashtree *tree)
+{
+	u64 part_size = (u64)info->size * info->blksz;
+	const AvbFooter *footer;
+	u64 vbmeta_offset, vbmeta_size, start;
+	u8 *buf;
+	int ret;
+
+	buf = malloc_cache_aligned(AVB_HASHTREE_VBMETA_MAX + 2 * info->blksz);
+	if (!buf)
+		return -ENOMEM;
+
+	ret = avb_hashtree_read(desc, info, part_size - info->blksz,
+				info->blksz, buf);
+	if (ret)
+		goto out;
+
+	footer = (const void *)(buf + info->blksz - AVB_FOOTER_SIZE);
+	if (memcmp(footer->magic, AVB_FOOTER_MAGIC, AVB_FOOTER_MAGIC_LEN)) {
+		ret = -ENOENT;
+		goto out;
+	}
+
+	vbmeta_offset = be64_to_cpu(footer->vbmeta_offset);
+	vbmeta_size = be64_to_cpu(footer->vbmeta_size);
+	if (vbmeta_size > AVB_HASHTREE_VBMETA_MAX ||
+	    vbmeta_offset > part_size - vbmeta_size) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	start = rounddown(vbmeta_offset, info->blksz);
+	ret = avb_hashtree_read(desc, info, start,
+				vbmeta_offset - start + vbmeta_size, buf);
+	if (!ret)
+		ret = avb_hashtree_from_vbmeta(buf + vbmeta_offset - start,
+					       vbmeta_size, name, tree);
+out:
+	free(buf);
+
+	return ret;
+}
@@ -11,6 +11,7 @@
 #include <malloc.h>
 #include <part.h>
 #include <mtd.h>
+#include <linux/sizes.h>
 #include "../cmd/legacy-mtd-utils.h"
 
 #ifdef CONFIG_CMD_SF
@@ -984,6 +985,45 @@ static AvbIOResult get_size_of_partition(AvbOps *ops,
 	return AVB_IO_RESULT_OK;
 }
 
+/**
+ * get_preloaded_partition() - gives the in-memory copy of a partition
+ *
+ * @ops: contains AVB ops handlers
+ * @partition: partition name, NUL-terminated UTF-8 string
+ * @num_bytes: amount of bytes needed from the start of the partition
+ * @out_pointer: returns the start of the data, or NULL if it is not in memory
+ * @out_num_bytes_preloaded: returns the amount of bytes available there
+ *
+ * libavb hashes the data in place when it is preloaded and reads the
+ * partition otherwise.
+ *
+ * @return:
+ *      AVB_IO_RESULT_OK, always
+ */
+static AvbIOResult get_preloaded_partition(AvbOps *ops,
+					   const char *partition,
+					   size_t num_bytes,
+					   u8 **out_pointer,
+					   size_t *out_num_bytes_preloaded)
+{
+	struct AvbOpsData *ops_data = ops->user_data;
+
+	*out_pointer = NULL;
+	if (!ops_data->preload_addr || strcmp(partition, ops_data->preload_part))
+		return AVB_IO_RESULT_OK;
+
+	if (num_bytes > ops_data->preload_size) {
+		printf("%s: %zu bytes preloaded, %zu needed, reading it again\n",
+		       partition, ops_data->preload_size, num_bytes);
+		return AVB_IO_RESULT_OK;
+	}
+
+	*out_pointer = ops_data->preload_addr;
+	*out_num_bytes_preloaded = num_bytes;
+
+	return AVB_IO_RESULT_OK;
+}
+
 /**
  * ============================================================================
  * AVB2.0 AvbOps alloc/initialisation/free
@@ -1051,11 +1091,51 @@ AvbOps *avb_ops_alloc(const char *if_typename, int boot_device)
 	ops_data->ops.get_unique_guid_for_partition =
 		get_unique_guid_for_partition;
 	ops_data->ops.get_size_of_partition = get_size_of_partition;
+	ops_data->ops.get_preloaded_partition = get_preloaded_partition;
 	ops_data->dev = boot_device;
 
 	return &ops_data->ops;
 }
 
+/**
+ * avb_ops_set_preload() - tells that a partition is already in memory
+ *
+ * @ops: AvbOps, contains AVB ops handlers
+ * @partition: partition name, including any A/B suffix, or NULL
+ * @addr: where the first @size bytes of the partition were loaded
+ * @size: amount of bytes loaded, 0 to forget about a previous preload
+ *
+ * Verification then hashes these bytes where they are instead of reading
+ * the partition into a buffer of its own. They are left untouched, so they
+ * can be booted afterwards without reading the partition a second time.
+ * The preload only holds for one verification: call this again with a NULL
+ * @partition once avb_slot_verify() returns, so that a later verification
+ * does not hash memory that may have been reused since.
+ *
+ * @return: 0 on success, -EINVAL if the partition name is too long
+ */
+int avb_ops_set_preload(AvbOps *ops, const char *partition, void *addr,
+			size_t size)
+{
+	struct AvbOpsData *ops_data = ops->user_data;
+
+	if (!partition || !size) {
+		ops_data->preload_part[0] = '\0';
+		ops_data->preload_addr = NULL;
+		ops_data->preload_size = 0;
+		return 0;
+	}
+
+	if (strlen(partition) >= sizeof(ops_data->preload_part))
+		return -EINVAL;
+
+	strcpy(ops_data->preload_part, partition);
+	ops_data->preload_addr = addr;
+	ops_data->preload_size = size;
+
+	return 0;
+}
+
 void avb_ops_free(AvbOps *ops)
 {
 	struct AvbOpsData *ops_data;
@@ -1068,3 +1148,67 @@ void avb_ops_free(AvbOps *ops)
 	if (ops_data)
 		avb_free(ops_data);
 }
+
+#if defined(CONFIG_AVB_HASHTREE) && defined(CONFIG_HB_BOOT_FROM_MMC)
+/**
+ * avb_verify_hashtree() - checks a whole partition against its hash tree
+ *
+ * @ops: AvbOps, contains AVB ops handlers
+ * @partition: partition name
+ * @stats: returns statistics of the check
+ *
+ * The hashtree descriptor is taken from the vbmeta partition, once that is
+ * known to be signed by the trusted key.
+ *
+ * @return: 0 if the partition matches its hash tree, -ve on error
+ */
+int avb_verify_hashtree(AvbOps *ops, const char *partition,
+			struct avb_hashtree_stats *stats)
+{
+	struct avb_hashtree tree;
+	struct mmc_part *part;
+	const u8 *pk_data;
+	size_t pk_len, vbmeta_size;
+	bool trusted = false;
+	u8 *vbmeta;
+	int ret;
+
+	vbmeta = memalign(SZ_64K, SZ_64K);	/* SPACC_ALIGN */
+	if (!vbmeta)
+		return -ENOMEM;
+
+	if (read_from_partition(ops, "vbmeta", 0, SZ_64K, vbmeta,
+				&vbmeta_size) != AVB_IO_RESULT_OK) {
+		ret = -EIO;
+		goto out;
+	}
+
+	if (avb_vbmeta_image_verify(vbmeta, vbmeta_size, &pk_data, &pk_len) !=
+	    AVB_VBMETA_VERIFY_RESULT_OK ||
+	    validate_vbmeta_public_key(ops, pk_data, pk_len, NULL, 0,
+				       &trusted) != AVB_IO_RESULT_OK ||
+	    !trusted) {
+		printf("vbmeta is not signed by the trusted key\n");
+		ret = -EPERM;
+		goto out;
+	}
+
+	ret = avb_hashtree_from_vbmeta(vbmeta, vbmeta_size, partition, &tree);
+	if (ret) {
+		printf("No hash tree for '%s' in vbmeta\n", partition);
+		goto out;
+	}
+
+	part = get_partition(ops, partition);
+	if (!part) {
+		ret = -ENOENT;
+		goto out;
+	}
+	ret = avb_hashtree_verify(part->mmc_blk, &part->info, &tree, stats);
+	free(part);
+out:
+	free(vbmeta);
+
+	return ret;
+}
+#endif
@@ -32,6 +32,7 @@
 #endif
 #include <mmc.h>
 #include <nand.h>
+#include <netdev.h>
 #include <of_live.h>
 #include <onenand_uboot.h>
 #include <scsi.h>
@@ -45,6 +46,7 @@
 #include <asm/mmu.h>
 #endif
 #include <asm/sections.h>
+#include <dm/device-internal.h>
 #include <dm/root.h>
 #include <linux/compiler.h>
 #include <linux/err.h>
@@ -450,6 +452,58 @@ static int initr_mmc(void)
 	mmc_initialize(gd->bd);
 	return 0;
 }
+
+#if CONFIG_IS_ENABLED(INITCALL_ASYNC) && CONFIG_IS_ENABLED(DM_MMC)
+/*
+ * Send each card its first operating-conditions command, which it can take
+ * some hundreds of milliseconds to act on. mmc_init() then finishes the job
+ * in initr_mmc_join(), as it would on first use of the card.
+ *
+ * The controllers are probed in the order mmc_initialize() uses, so that
+ * they are numbered the same, but quietly: initr_mmc() still prints the
+ * banner and the devices, and reports any probe failure, in its usual place.
+ */
+static int initr_mmc_start(void)
+{
+	struct udevice *dev;
+	struct uclass *uc;
+	struct mmc *mmc;
+
+	if (uclass_get(UCLASS_MMC, &uc))
+		return 0;
+	mmc_probe_seq();
+	uclass_foreach_dev(dev, uc) {
+		if (device_probe(dev))
+			continue;
+		mmc = mmc_get_mmc_dev(dev);
+		if (!mmc || !device_active(dev) || mmc->has_init ||
+		    mmc->init_in_progress || !mmc_getcd(mmc))
+			continue;
+		mmc_start_init(mmc);
+	}
+
+	return 0;
+}
+
+static int initr_mmc_join(void)
+{
+	struct udevice *dev;
+	struct uclass *uc;
+	struct mmc *mmc;
+
+	initr_mmc();
+	if (uclass_get(UCLASS_MMC, &uc))
+		return 0;
+	uclass_foreach_dev(dev, uc) {
+		mmc = mmc_get_mmc_dev(dev);
+		/* A card which fails is tried again when it is used */
+		if (mmc && mmc->init_in_progress)
+			mmc_init(mmc);
+	}
+
+	return 0;
+}
+#endif
 #endif
 
 /*
@@ -614,6 +668,18 @@ static int initr_net(void)
 #endif
 	return 0;
 }
+
+#if CONFIG_IS_ENABLED(INITCALL_ASYNC) && defined(CONFIG_TARGET_XJ3)
+/*
+ * The PHY must be held in reset for 100ms before the driver is probed.
+ * Start that here and let initr_net() wait for whatever is left.
+ */
+static int initr_net_start(void)
+{
+	hb_eth_phy_reset_start();
+	return 0;
+}
+#endif
 #endif
 
 #ifdef CONFIG_POST
@@ -1028,6 +1094,25 @@ static init_fnc_t init_sequence_r[] = {
 	run_main_loop,
 };
 
+#if CONFIG_IS_ENABLED(INITCALL_ASYNC)
+/*
+ * Initcalls above which are started as soon as what they depend on has run,
+ * then finished in their usual place
+ */
+static struct initcall_async init_async_r[] = {
+#if defined(CONFIG_MMC) && CONFIG_IS_ENABLED(DM_MMC)
+	/* Card power and board set-up must come first */
+	INITCALL_ASYNC(initr_mmc, initr_mmc_start, initr_mmc_join,
+		       power_init_board),
+#endif
+#if defined(CONFIG_HB_ETH_GMAC) && defined(CONFIG_TARGET_XJ3) && \
+	defined(CONFIG_MMC)
+	/* Drive the reset pins after MMC has set up its pins, as before */
+	INITCALL_ASYNC(initr_net, initr_net_start, initr_net, initr_mmc),
+#endif
+};
+#endif
+
 void board_init_r(gd_t *new_gd, ulong dest_addr)
 {
 	/*
@@ -1052,10 +1137,24 @@ void board_init_r(gd_t *new_gd, ulong dest_addr)
 #ifdef CONFIG_NEEDS_MANUAL_RELOC
 	for (i = 0; i < ARRAY_SIZE(init_sequence_r); i++)
 		init_sequence_r[i] += gd->reloc_off;
+#if CONFIG_IS_ENABLED(INITCALL_ASYNC)
+	for (i = 0; i < ARRAY_SIZE(init_async_r); i++) {
+		init_async_r[i].func += gd->reloc_off;
+		init_async_r[i].start += gd->reloc_off;
+		init_async_r[i].join += gd->reloc_off;
+		init_async_r[i].after += gd->reloc_off;
+	}
+#endif
 #endif
 
+#if CONFIG_IS_ENABLED(INITCALL_ASYNC)
+	if (initcall_run_list_async(init_sequence_r, init_async_r,
+				    ARRAY_SIZE(init_async_r)))
+		hang();
+#else
 	if (initcall_run_list(init_sequence_r))
 		hang();
+#endif
 
 	/* NOTREACHED - run_main_loop() does not return */
 	hang();
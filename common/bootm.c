@@ -13,6 +13,7 @@
 #include <lmb.h>
 #include <malloc.h>
 #include <mapmem.h>
+#include <profile.h>
 #include <asm/io.h>
 #include <linux/lzo.h>
 #include <lzma/LzmaTypes.h>
@@ -526,6 +527,9 @@ ulong bootm_disable_interrupts(void)
 	 * overwrite all exception vector code, so we cannot easily
 	 * recover from any failures any more...
 	 */
+#if CONFIG_IS_ENABLED(PROFILE)
+	profile_stop();
+#endif
 	iflag = disable_interrupts();
 #ifdef CONFIG_NETCONSOLE
 	/* Stop the ethernet stack if NetConsole could have left it up */
@@ -18,6 +18,10 @@ DECLARE_GLOBAL_DATA_PTR;
 
 enum {
 	RECORD_COUNT = CONFIG_VAL(BOOTSTAGE_RECORD_COUNT),
+#ifdef ENABLE_BOOTSTAGE_PROFILE
+	EVENT_COUNT = CONFIG_BOOTSTAGE_PROFILE_COUNT,
+	EVENT_MAX_US = (1 << 28) - 1,
+#endif
 };
 
 struct bootstage_record {
@@ -28,10 +32,22 @@ struct bootstage_record {
 	enum bootstage_id id;
 };
 
+/* A profile event, see bootstage_event_add() */
+struct bootstage_event {
+	const void *name;
+	uint32_t start_us;
+	uint32_t duration_us : 28;
+	uint32_t type : 4;	/* enum bootstage_event_type */
+};
+
 struct bootstage_data {
 	uint rec_count;
 	uint next_id;
 	struct bootstage_record record[RECORD_COUNT];
+#ifdef ENABLE_BOOTSTAGE_PROFILE
+	uint event_count;	/* Number of events, including any replaced */
+	struct bootstage_event event[EVENT_COUNT];
+#endif
 };
 
 enum {
@@ -50,6 +66,9 @@ struct bootstage_hdr {
 int bootstage_relocate(void)
 {
 	struct bootstage_data *data = gd->bootstage;
+#ifdef ENABLE_BOOTSTAGE_PROFILE
+	ulong old_start;
+#endif
 	int i;
 
 	/*
@@ -60,6 +79,25 @@ int bootstage_relocate(void)
 	for (i = 0; i < data->rec_count; i++)
 		data->record[i].name = strdup(data->record[i].name);
 
+#ifdef ENABLE_BOOTSTAGE_PROFILE
+	/*
+	 * Event names are in the image, so move those that still point into
+	 * the copy which ran before relocation. This goes by address rather
+	 * than GD_FLG_RELOC, since board_init_r() already runs from the new
+	 * copy before that flag is set.
+	 */
+	old_start = gd->relocaddr - gd->reloc_off;
+	for (i = 0; gd->reloc_off &&
+	     i < min(data->event_count, (uint)EVENT_COUNT); i++) {
+		struct bootstage_event *ev = &data->event[i];
+		ulong name = (ulong)ev->name;
+
+		if (ev->type != BOOTSTAGE_EVENT_INITCALL &&
+		    name >= old_start && name < old_start + gd->mon_len)
+			ev->name = (const char *)ev->name + gd->reloc_off;
+	}
+#endif
+
 	return 0;
 }
 
@@ -195,6 +233,80 @@ uint32_t bootstage_accum(enum bootstage_id id)
 	return duration;
 }
 
+#ifdef ENABLE_BOOTSTAGE_PROFILE
+void bootstage_event_add(enum bootstage_event_type type, const void *name,
+			 ulong start_us)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_event *ev;
+	ulong duration_us;
+
+	if (!data)
+		return;
+	duration_us = timer_get_boot_us() - start_us;
+	ev = &data->event[data->event_count++ % EVENT_COUNT];
+	ev->name = name;
+	ev->start_us = start_us;
+	ev->duration_us = min(duration_us, (ulong)EVENT_MAX_US);
+	ev->type = type;
+}
+
+void *bootstage_event_save(void)
+{
+	struct bootstage_data *data = gd->bootstage;
+	char *save;
+
+	if (!data)
+		return NULL;
+	save = malloc(sizeof(data->event_count) + sizeof(data->event));
+	if (!save)
+		return NULL;
+	memcpy(save, &data->event_count, sizeof(data->event_count));
+	memcpy(save + sizeof(data->event_count), data->event,
+	       sizeof(data->event));
+
+	return save;
+}
+
+void bootstage_event_restore(void *save)
+{
+	struct bootstage_data *data = gd->bootstage;
+	char *ptr = save;
+
+	if (!data || !save)
+		return;
+	memcpy(&data->event_count, ptr, sizeof(data->event_count));
+	memcpy(data->event, ptr + sizeof(data->event_count),
+	       sizeof(data->event));
+	free(save);
+}
+
+static const char *const event_type_name[BOOTSTAGE_EVENT_TYPE_COUNT] = {
+	"initcall",
+	"probe",
+	"cmd",
+};
+
+/* Get the oldest event still in the ring, and the number of events */
+static struct bootstage_event *first_event(struct bootstage_data *data,
+					   uint *countp)
+{
+	if (data->event_count <= EVENT_COUNT) {
+		*countp = data->event_count;
+		return data->event;
+	}
+	*countp = EVENT_COUNT;
+
+	return &data->event[data->event_count % EVENT_COUNT];
+}
+
+static struct bootstage_event *next_event(struct bootstage_data *data,
+					  struct bootstage_event *ev)
+{
+	return ++ev == data->event + EVENT_COUNT ? data->event : ev;
+}
+#endif
+
 /**
  * Get a record name as a printable string
  *
@@ -240,6 +352,49 @@ static int h_compare_record(const void *r1, const void *r2)
 }
 
 #ifdef CONFIG_OF_LIBFDT
+#ifdef ENABLE_BOOTSTAGE_PROFILE
+/**
+ * Add the total time in each kind of profile event to a device tree
+ *
+ * @param blob		Device tree blob
+ * @param bootstage	Offset of the bootstage node
+ * @return 0 on success, != 0 on failure.
+ */
+static int add_profile_devicetree(struct fdt_header *blob, int bootstage)
+{
+	struct bootstage_data *data = gd->bootstage;
+	uint total_us[BOOTSTAGE_EVENT_TYPE_COUNT] = {};
+	uint num[BOOTSTAGE_EVENT_TYPE_COUNT] = {};
+	struct bootstage_event *ev;
+	char prop[20];
+	uint count;
+	int node;
+	int i;
+
+	for (ev = first_event(data, &count), i = 0; i < count;
+	     ev = next_event(data, ev), i++) {
+		total_us[ev->type] += ev->duration_us;
+		num[ev->type]++;
+	}
+
+	node = fdt_add_subnode(blob, bootstage, "profile");
+	if (node < 0)
+		return -EINVAL;
+	if (fdt_setprop_cell(blob, node, "dropped", data->event_count - count))
+		return -EINVAL;
+	for (i = 0; i < BOOTSTAGE_EVENT_TYPE_COUNT; i++) {
+		snprintf(prop, sizeof(prop), "%s-count", event_type_name[i]);
+		if (fdt_setprop_cell(blob, node, prop, num[i]))
+			return -EINVAL;
+		snprintf(prop, sizeof(prop), "%s-us", event_type_name[i]);
+		if (fdt_setprop_cell(blob, node, prop, total_us[i]))
+			return -EINVAL;
+	}
+
+	return 0;
+}
+#endif
+
 /**
  * Add all bootstage timings to a device tree.
  *
@@ -292,6 +447,11 @@ static int add_bootstages_devicetree(struct fdt_header *blob)
 			return -EINVAL;
 	}
 
+#ifdef ENABLE_BOOTSTAGE_PROFILE
+	if (add_profile_devicetree(blob, bootstage))
+		return -EINVAL;
+#endif
+
 	return 0;
 }
 
@@ -336,6 +496,82 @@ void bootstage_report(void)
 	}
 }
 
+#ifdef ENABLE_BOOTSTAGE_PROFILE
+/**
+ * Append formatted text to a buffer
+ *
+ * Like append_data(), this writes as much as fits and always advances the
+ * length, so the total length is known even if the buffer is too small.
+ *
+ * @param buf	Buffer to write to
+ * @param size	Size of buffer
+ * @param len	Length written so far
+ * @param fmt	printf() format string
+ * @return new length
+ */
+static int __attribute__ ((format (__printf__, 4, 5)))
+	append_text(char *buf, int size, int len, const char *fmt, ...)
+{
+	va_list args;
+	int ret;
+
+	va_start(args, fmt);
+	ret = vsnprintf(len < size ? buf + len : NULL,
+			len < size ? size - len : 0, fmt, args);
+	va_end(args);
+
+	return len + ret;
+}
+
+int bootstage_event_export(char *buf, int size)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_record *rec;
+	struct bootstage_event *ev;
+	const char *sep = "";
+	char name[20];
+	uint count;
+	int len;
+	int i;
+
+	len = append_text(buf, size, 0, "{\"traceEvents\":[\n");
+
+	/* Bootstage marks are instants on the timeline */
+	for (i = 0, rec = data->record; i < data->rec_count; i++, rec++) {
+		if (rec->start_us ||
+		    (rec->id != BOOTSTAGE_ID_AWAKE && !rec->time_us))
+			continue;
+		len = append_text(buf, size, len,
+				  "%s{\"name\":\"%s\",\"cat\":\"bootstage\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%lu,\"pid\":0,\"tid\":0}",
+				  sep, get_record_name(name, sizeof(name), rec),
+				  rec->time_us);
+		sep = ",\n";
+	}
+
+	for (ev = first_event(data, &count), i = 0; i < count;
+	     ev = next_event(data, ev), i++) {
+		len = append_text(buf, size, len, "%s{\"name\":\"", sep);
+		if (ev->type == BOOTSTAGE_EVENT_INITCALL)
+			len = append_text(buf, size, len, "%#lx",
+					  (ulong)ev->name);
+		else
+			len = append_text(buf, size, len, "%s",
+					  (const char *)ev->name);
+		len = append_text(buf, size, len,
+				  "\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%u,\"dur\":%u,\"pid\":0,\"tid\":0}",
+				  event_type_name[ev->type], ev->start_us,
+				  ev->duration_us);
+		sep = ",\n";
+	}
+
+	len = append_text(buf, size, len,
+			  "\n],\"otherData\":{\"dropped\":\"%u\"}}\n",
+			  data->event_count - count);
+
+	return len;
+}
+#endif
+
 /**
  * Append data to a memory buffer
  *
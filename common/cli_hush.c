@@ -3252,6 +3252,213 @@ static int parse_stream_outer(struct in_str *inp, int flag)
 #endif /* __U_BOOT__ */
 }
 
+#ifdef CONFIG_HUSH_CACHE
+/*
+ * Parsed scripts, kept so that running the same text again skips parsing.
+ * Parsing depends only on the text, the flags and IFS. All the lines of a
+ * script are parsed before the first one runs, so scripts which mention IFS,
+ * and might change it for the lines after, are not cached. Each run works on
+ * a copy of the lists, since running a 'for' loop changes them and
+ * run_list() frees them.
+ */
+struct hush_cache {
+	char *text;		/* script, or NULL if this entry is unused */
+	u32 hash;		/* of @text, to skip most comparisons */
+	int flag;		/* FLAG_... passed to parse_string_outer() */
+	int count;		/* number of lists in @lists */
+	struct pipe **lists;	/* one list for each line, run in turn */
+	ulong used;		/* when it was last run, for choosing a victim */
+	int busy;		/* number of runs in progress */
+};
+
+static struct hush_cache hush_cache[CONFIG_HUSH_CACHE_ENTRIES];
+static ulong hush_cache_clock;
+
+static u32 hush_cache_hash(const char *s)
+{
+	u32 hash = 2166136261u;
+
+	while (*s)
+		hash = (hash ^ (uchar)*s++) * 16777619;
+
+	return hash;
+}
+
+static void hush_cache_free(struct hush_cache *entry)
+{
+	int i;
+
+	for (i = 0; i < entry->count; i++)
+		free_pipe_list(entry->lists[i], 0);
+	free(entry->lists);
+	free(entry->text);
+	entry->text = NULL;
+	entry->lists = NULL;
+	entry->count = 0;
+}
+
+void hush_cache_flush(void)
+{
+	struct hush_cache *entry;
+
+	for (entry = hush_cache; entry < hush_cache + ARRAY_SIZE(hush_cache);
+	     entry++) {
+		if (entry->text && !entry->busy)
+			hush_cache_free(entry);
+	}
+}
+
+static struct pipe *copy_pipe_list(struct pipe *head);
+
+static void copy_child(struct child_prog *dst, struct child_prog *src)
+{
+	int a;
+
+	*dst = *src;
+	if (src->argv) {
+		dst->argv = xmalloc((src->argc + 1) * sizeof(*dst->argv));
+		dst->argv_nonnull = xmalloc((src->argc + 1) *
+					    sizeof(*dst->argv_nonnull));
+		for (a = 0; a < src->argc; a++)
+			dst->argv[a] = xstrdup(src->argv[a]);
+		dst->argv[a] = NULL;
+		memcpy(dst->argv_nonnull, src->argv_nonnull,
+		       (src->argc + 1) * sizeof(*dst->argv_nonnull));
+	}
+	if (src->group)
+		dst->group = copy_pipe_list(src->group);
+}
+
+static struct pipe *copy_pipe_list(struct pipe *head)
+{
+	struct pipe *list = NULL, **tail = &list;
+	struct pipe *pi, *new_p;
+	int i;
+
+	for (pi = head; pi; pi = pi->next) {
+		new_p = xmalloc(sizeof(*new_p));
+		*new_p = *pi;
+		new_p->next = NULL;
+		/* There is an uncounted, empty child after the others */
+		if (pi->progs) {
+			new_p->progs = xmalloc((pi->num_progs + 1) *
+					       sizeof(*new_p->progs));
+			for (i = 0; i <= pi->num_progs; i++)
+				copy_child(&new_p->progs[i], &pi->progs[i]);
+		}
+		*tail = new_p;
+		tail = &new_p->next;
+	}
+
+	return list;
+}
+
+/* Parse as parse_stream_outer() would, keeping the lists instead of running */
+static int hush_cache_parse(struct hush_cache *entry, const char *s, int flag)
+{
+	struct in_str input;
+	struct p_context ctx;
+	o_string temp = NULL_O_STRING;
+	char *p = NULL;
+	int rcode;
+
+	/* parse_string_outer() ends the text with a newline if it has none */
+	if (!(p = strchr(s, '\n')) || *++p) {
+		p = xmalloc(strlen(s) + 2);
+		strcpy(p, s);
+		strcat(p, "\n");
+		s = p;
+	} else {
+		p = NULL;
+	}
+	setup_string_in_str(&input, s);
+	do {
+		ctx.type = flag;
+		initialize_context(&ctx);
+		update_ifs_map();
+		if (!(flag & FLAG_PARSE_SEMICOLON) || (flag & FLAG_REPARSING))
+			mapset((uchar *)";$&|", 0);
+		input.promptmode = 1;
+		rcode = parse_stream(&temp, &ctx, &input,
+				     flag & FLAG_CONT_ON_NEWLINE ? -1 : '\n');
+		if (rcode == 1 || ctx.old_flag != 0) {
+			/* Leave syntax errors to parse_stream_outer() */
+			if (ctx.old_flag != 0)
+				free(ctx.stack);
+			b_free(&temp);
+			free_pipe_list(ctx.list_head, 0);
+			free(p);
+			return -1;
+		}
+		done_word(&temp, &ctx);
+		done_pipe(&ctx, PIPE_SEQ);
+		b_free(&temp);
+		entry->lists = xrealloc(entry->lists, (entry->count + 1) *
+					sizeof(*entry->lists));
+		entry->lists[entry->count++] = ctx.list_head;
+	} while (rcode != -1 && !(flag & FLAG_EXIT_FROM_LOOP) && b_peek(&input));
+	free(p);
+
+	return 0;
+}
+
+/* Find the script in the cache, parsing it into a free entry if not there */
+static struct hush_cache *hush_cache_get(const char *s, int flag)
+{
+	struct hush_cache *entry, *victim = NULL;
+	u32 hash = hush_cache_hash(s);
+
+	for (entry = hush_cache; entry < hush_cache + ARRAY_SIZE(hush_cache);
+	     entry++) {
+		if (entry->text && entry->hash == hash && entry->flag == flag &&
+		    !strcmp(entry->text, s))
+			return entry;
+		if (entry->busy)
+			continue;
+		if (!victim || !entry->text ||
+		    (victim->text && entry->used < victim->used))
+			victim = entry;
+	}
+
+	/* A different field separator would give a different parse */
+	if (!victim || env_get("IFS") || strstr(s, "IFS"))
+		return NULL;
+	if (victim->text)
+		hush_cache_free(victim);
+	if (hush_cache_parse(victim, s, flag)) {
+		hush_cache_free(victim);
+		return NULL;
+	}
+	victim->text = xstrdup(s);
+	victim->hash = hash;
+	victim->flag = flag;
+
+	return victim;
+}
+
+/* Run each list as parse_stream_outer() would after parsing it */
+static int hush_cache_run(struct hush_cache *entry)
+{
+	int code = 1;
+	int i;
+
+	entry->used = ++hush_cache_clock;
+	entry->busy++;
+	for (i = 0; i < entry->count; i++) {
+		code = run_list(copy_pipe_list(entry->lists[i]));
+		if (code == -2) {	/* exit */
+			code = 0;
+			break;
+		}
+		if (code == -1)
+			flag_repeat = 0;
+	}
+	entry->busy--;
+
+	return (code != 0) ? 1 : 0;
+}
+#endif
+
 #ifndef __U_BOOT__
 static int parse_string_outer(const char *s, int flag)
 #else
@@ -3262,10 +3469,18 @@ int parse_string_outer(const char *s, int flag)
 #ifdef __U_BOOT__
 	char *p = NULL;
 	int rcode;
+#ifdef CONFIG_HUSH_CACHE
+	struct hush_cache *entry;
+#endif
 	if (!s)
 		return 1;
 	if (!*s)
 		return 0;
+#ifdef CONFIG_HUSH_CACHE
+	entry = hush_cache_get(s, flag);
+	if (entry)
+		return hush_cache_run(entry);
+#endif
 	if (!(p = strchr(s, '\n')) || *++p) {
 		p = xmalloc(strlen(s) + 2);
 		strcpy(p, s);
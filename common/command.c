@@ -13,6 +13,8 @@
 #include <console.h>
 #include <linux/ctype.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
 /*
  * Use puts() instead of printf() to avoid printf buffer overflow
  * for long help messages
@@ -116,10 +118,89 @@ cmd_tbl_t *find_cmd_tbl(const char *cmd, cmd_tbl_t *table, int table_len)
 	return NULL;	/* not found or ambiguous command */
 }
 
+#ifdef CONFIG_CMDLINE
+/*
+ * The linker sorts the command list by symbol, which is not always the
+ * command's name (help is declared as question_mark but named "?"). After
+ * relocation, when it can be kept, build an index of the list sorted by
+ * name so that it can be searched by bisection. The list is nearly sorted
+ * already, so an insertion sort is quick, and it keeps entries of the same
+ * name in list order as find_cmd_tbl() sees them.
+ */
+static cmd_tbl_t **cmd_index;
+
+static cmd_tbl_t **cmd_tbl_index(cmd_tbl_t *table, int table_len)
+{
+	static bool tried;
+	cmd_tbl_t *cmdtp;
+	int i, j;
+
+	if (tried || !(gd->flags & GD_FLG_RELOC))
+		return cmd_index;
+	tried = true;
+
+	cmd_index = malloc(table_len * sizeof(*cmd_index));
+	if (!cmd_index)
+		return NULL;
+	for (i = 0; i < table_len; i++) {
+		cmdtp = table + i;
+		for (j = i; j && strcmp(cmd_index[j - 1]->name, cmdtp->name) > 0;
+		     j--)
+			cmd_index[j] = cmd_index[j - 1];
+		cmd_index[j] = cmdtp;
+	}
+
+	return cmd_index;
+}
+
+bool find_cmd_indexed(void)
+{
+	return cmd_index != NULL;
+}
+
+/* find_cmd_tbl() on a sorted index, matching abbreviations the same way */
+static cmd_tbl_t *find_cmd_sorted(const char *cmd, cmd_tbl_t **index,
+				  int table_len)
+{
+	cmd_tbl_t **end = index + table_len;
+	cmd_tbl_t **lo = index, **hi = end, **mid;
+	const char *p;
+	int len;
+
+	if (!cmd)
+		return NULL;
+	len = ((p = strchr(cmd, '.')) == NULL) ? strlen(cmd) : (p - cmd);
+
+	/* Find the first entry whose name does not sort before the command */
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (strncmp((*mid)->name, cmd, len) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == end || strncmp((*lo)->name, cmd, len))
+		return NULL;	/* not found */
+	if (strlen((*lo)->name) == len)
+		return *lo;	/* full match, which sorts first */
+	if (lo + 1 != end && !strncmp(lo[1]->name, cmd, len))
+		return NULL;	/* ambiguous command */
+
+	return *lo;		/* exactly one match */
+}
+#endif
+
 cmd_tbl_t *find_cmd(const char *cmd)
 {
 	cmd_tbl_t *start = ll_entry_start(cmd_tbl_t, cmd);
 	const int len = ll_entry_count(cmd_tbl_t, cmd);
+
+#ifdef CONFIG_CMDLINE
+	cmd_tbl_t **index = cmd_tbl_index(start, len);
+
+	if (index)
+		return find_cmd_sorted(cmd, index, len);
+#endif
 	return find_cmd_tbl(cmd, start, len);
 }
 
@@ -438,8 +519,6 @@ int cmd_get_data_size(char* arg, int default_size)
 #endif
 
 #if defined(CONFIG_NEEDS_MANUAL_RELOC)
-DECLARE_GLOBAL_DATA_PTR;
-
 void fixup_cmdtable(cmd_tbl_t *cmdtp, int size)
 {
 	int	i;
@@ -494,9 +573,11 @@ void fixup_cmdtable(cmd_tbl_t *cmdtp, int size)
  */
 static int cmd_call(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
+	ulong start = bootstage_event_start();
 	int result;
 
 	result = (cmdtp->cmd)(cmdtp, flag, argc, argv);
+	bootstage_event_add(BOOTSTAGE_EVENT_CMD, cmdtp->name, start);
 	if (result)
 		debug("Command failed, result=%d\n", result);
 	return result;
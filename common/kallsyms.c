@@ -12,13 +12,14 @@ extern const char system_map[] __attribute__((weak));
 
 /* Given an address, return a pointer to the symbol name and store
  * the base address in caddr.  So if the symbol map had an entry:
- *		03fb9b7c_spi_cs_deactivate
+ *		03fb9b7c spi_cs_deactivate
  * Then the following call:
  *		unsigned long base;
  *		const char *sym = symbol_lookup(0x03fb9b80, &base);
  * Would end up setting the variables like so:
  *		base = 0x03fb9b7c;
- *		sym = "_spi_cs_deactivate";
+ *		sym = "spi_cs_deactivate";
+ * The addresses are the ones U-Boot was linked at.
  */
 const char *symbol_lookup(unsigned long addr, unsigned long *caddr)
 {
@@ -29,10 +30,14 @@ const char *symbol_lookup(unsigned long addr, unsigned long *caddr)
 	sym = system_map;
 	csym = NULL;
 	*caddr = 0;
+	if (!sym)
+		return NULL;
 
 	while (*sym) {
 		sym_addr = simple_strtoul(sym, &esym, 16);
 		sym = esym;
+		if (*sym == ' ')
+			sym++;
 		if (sym_addr > addr)
 			break;
 		*caddr = sym_addr;
@@ -42,3 +47,27 @@ const char *symbol_lookup(unsigned long addr, unsigned long *caddr)
 
 	return csym;
 }
+
+/* Return the address a symbol was linked at, or 0 if it is not found */
+unsigned long symbol_address(const char *name)
+{
+	const char *sym;
+	char *esym;
+	unsigned long sym_addr;
+
+	sym = system_map;
+	if (!sym)
+		return 0;
+
+	while (*sym) {
+		sym_addr = simple_strtoul(sym, &esym, 16);
+		sym = esym;
+		if (*sym == ' ')
+			sym++;
+		if (!strcmp(sym, name))
+			return sym_addr;
+		sym += strlen(sym) + 1;
+	}
+
+	return 0;
+}
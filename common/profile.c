@@ -0,0 +1,266 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Sampling profiler
+ *
+ * Each sample is a stack of addresses, innermost first. Stacks are kept in
+ * an open-addressed hash table, so a sample is a hash, a compare and an
+ * increment unless the stack has not been seen before.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <profile.h>
+#include <linux/sizes.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Frames further than this above the interrupted stack pointer are bogus */
+#define PROFILE_STACK_LIMIT	SZ_1M
+
+/* Slots to look at before giving up on a sample */
+#define PROFILE_MAX_PROBES	16
+
+/**
+ * struct profile_stack - One stack seen while sampling
+ *
+ * @count:	Number of samples with this stack, 0 if the slot is free
+ * @depth:	Number of addresses in @pc
+ * @pc:		Interrupted PC followed by the return addresses
+ */
+struct profile_stack {
+	uint count;
+	uint depth;
+	ulong pc[CONFIG_PROFILE_DEPTH];
+};
+
+static struct profile_stack *table;
+static struct profile_stats stats;
+
+static uint hash_stack(const ulong *pc, uint depth)
+{
+	ulong hash = depth;
+	uint i;
+
+	for (i = 0; i < depth; i++)
+		hash = (hash ^ pc[i]) * 0x9e3779b1;
+
+	return (hash >> 8) % CONFIG_PROFILE_ENTRIES;
+}
+
+static uint walk_stack(ulong *pc, ulong fp, ulong sp)
+{
+	uint depth = 1;
+	ulong *frame;
+
+	/* Each frame holds the caller's frame pointer, then the return address */
+	while (depth < CONFIG_PROFILE_DEPTH) {
+		if (fp < sp || fp - sp >= PROFILE_STACK_LIMIT ||
+		    fp & (sizeof(ulong) - 1))
+			break;
+		frame = (ulong *)fp;
+		if (!frame[1])
+			break;
+		pc[depth++] = frame[1];
+		if (frame[0] <= fp)
+			break;
+		fp = frame[0];
+	}
+
+	return depth;
+}
+
+void profile_sample(ulong pc, ulong fp, ulong sp)
+{
+	ulong stack[CONFIG_PROFILE_DEPTH];
+	struct profile_stack *entry;
+	uint depth, slot, i;
+
+	if (!table)
+		return;
+	stack[0] = pc;
+	depth = walk_stack(stack, fp, sp);
+	stats.samples++;
+
+	slot = hash_stack(stack, depth);
+	for (i = 0; i < PROFILE_MAX_PROBES; i++) {
+		entry = &table[slot];
+		if (!entry->count) {
+			memcpy(entry->pc, stack, depth * sizeof(ulong));
+			entry->depth = depth;
+			/* Only show a stack once it is filled in */
+			barrier();
+			entry->count = 1;
+			stats.stacks++;
+			return;
+		}
+		if (entry->depth == depth &&
+		    !memcmp(entry->pc, stack, depth * sizeof(ulong))) {
+			entry->count++;
+			return;
+		}
+		if (++slot == CONFIG_PROFILE_ENTRIES)
+			slot = 0;
+	}
+	stats.lost++;
+}
+
+int profile_start(uint hz)
+{
+	int ret;
+
+	if (stats.hz)
+		return -EBUSY;
+	if (!hz)
+		return -EINVAL;
+	if (!table) {
+		table = calloc(CONFIG_PROFILE_ENTRIES, sizeof(*table));
+		if (!table)
+			return -ENOMEM;
+	}
+	ret = arch_profile_start(hz);
+	if (ret)
+		return ret;
+	stats.hz = hz;
+
+	return 0;
+}
+
+void profile_stop(void)
+{
+	if (!stats.hz)
+		return;
+	arch_profile_stop();
+	stats.hz = 0;
+}
+
+void profile_reset(void)
+{
+	uint hz = stats.hz;
+
+	profile_stop();
+	if (table)
+		memset(table, '\0', CONFIG_PROFILE_ENTRIES * sizeof(*table));
+	memset(&stats, '\0', sizeof(stats));
+	if (hz)
+		profile_start(hz);
+}
+
+void profile_get_stats(struct profile_stats *statsp)
+{
+	*statsp = stats;
+}
+
+/*
+ * Work out how far U-Boot is from where it was linked, since the symbol
+ * table holds link addresses. This also covers sandbox, which the host may
+ * load anywhere.
+ */
+static ulong link_offset(void)
+{
+	ulong addr = 0;
+
+	if (IS_ENABLED(CONFIG_KALLSYMS))
+		addr = symbol_address("profile_sample");
+	if (addr)
+		return (ulong)profile_sample - addr;
+
+	return gd->reloc_off;
+}
+
+static void print_addr(ulong addr, ulong offset)
+{
+	const char *name = NULL;
+	ulong base;
+
+	if (IS_ENABLED(CONFIG_KALLSYMS))
+		name = symbol_lookup(addr - offset, &base);
+	if (name)
+		printf("%s", name);
+	else
+		printf("%lx", addr - offset);
+}
+
+void profile_show_folded(void)
+{
+	struct profile_stack *entry;
+	ulong offset = link_offset();
+	int i, d;
+
+	if (!table)
+		return;
+	for (i = 0; i < CONFIG_PROFILE_ENTRIES; i++) {
+		entry = &table[i];
+		if (!entry->count)
+			continue;
+		for (d = entry->depth - 1; d >= 0; d--) {
+			/* A return address is just after the call */
+			print_addr(entry->pc[d] - (d ? 1 : 0), offset);
+			if (d)
+				putc(';');
+		}
+		printf(" %u\n", entry->count);
+	}
+}
+
+struct profile_func {
+	ulong addr;
+	uint count;
+};
+
+static int profile_func_cmp(const void *a, const void *b)
+{
+	const struct profile_func *fa = a, *fb = b;
+
+	return fb->count - fa->count;
+}
+
+void profile_show_top(int count)
+{
+	struct profile_func *funcs;
+	struct profile_stack *entry;
+	ulong offset = link_offset();
+	ulong addr, base;
+	int max = stats.stacks;
+	int num = 0;
+	int i, j;
+
+	if (!table || !max)
+		return;
+	funcs = calloc(max, sizeof(*funcs));
+	if (!funcs) {
+		printf("No memory for %d functions\n", max);
+		return;
+	}
+
+	/* Add up the samples by the function they were taken in */
+	for (i = 0; i < CONFIG_PROFILE_ENTRIES; i++) {
+		entry = &table[i];
+		if (!entry->count)
+			continue;
+		addr = entry->pc[0];
+		if (IS_ENABLED(CONFIG_KALLSYMS) &&
+		    symbol_lookup(addr - offset, &base))
+			addr = base + offset;
+		for (j = 0; j < num && funcs[j].addr != addr; j++)
+			;
+		if (j == num) {
+			/* New stacks may be added while the profiler runs */
+			if (num == max)
+				continue;
+			funcs[num++].addr = addr;
+		}
+		funcs[j].count += entry->count;
+	}
+	qsort(funcs, num, sizeof(*funcs), profile_func_cmp);
+
+	printf("Samples  Percent  Function\n");
+	for (i = 0; i < num && i < count; i++) {
+		uint permille = (u64)funcs[i].count * 1000 / stats.samples;
+
+		printf("%7u  %5u.%u%%  ", funcs[i].count, permille / 10,
+		       permille % 10);
+		print_addr(funcs[i].addr, offset);
+		printf("\n");
+	}
+	free(funcs);
+}
@@ -5,4 +5,6 @@
  * Licensed under the GPL-2 or later.
  */
 
-const char const system_map[] = SYSTEM_MAP;
+const char system_map[] =
+#include <generated/system_map.h>
+;
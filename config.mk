@@ -62,6 +62,11 @@ ifdef FTRACE
 PLATFORM_CPPFLAGS += -finstrument-functions -DFTRACE
 endif
 
+# The profiler follows frame pointers to find the callers
+ifeq ($(CONFIG_$(SPL_)PROFILE),y)
+PLATFORM_CPPFLAGS += -fno-omit-frame-pointer
+endif
+
 #########################################################################
 
 RELFLAGS := $(PLATFORM_RELFLAGS)
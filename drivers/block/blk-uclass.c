@@ -625,4 +625,5 @@ UCLASS_DRIVER(blk) = {
 	.id		= UCLASS_BLK,
 	.name		= "blk",
 	.per_device_platdata_auto_alloc_size = sizeof(struct blk_desc),
+	.flags		= DM_UC_FLAG_LAZY_BIND_ALL,
 };
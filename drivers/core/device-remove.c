@@ -13,6 +13,7 @@
 #include <malloc.h>
 #include <dm/device.h>
 #include <dm/device-internal.h>
+#include <dm/lazy.h>
 #include <dm/uclass.h>
 #include <dm/uclass-internal.h>
 #include <dm/util.h>
@@ -82,6 +83,7 @@ int device_unbind(struct udevice *dev)
 	ret = device_chld_unbind(dev, NULL);
 	if (ret)
 		return ret;
+	dm_lazy_forget(dev);
 
 	if (dev->flags & DM_FLAG_ALLOC_PDATA) {
 		free(dev->platdata);
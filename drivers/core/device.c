@@ -16,6 +16,7 @@
 #include <malloc.h>
 #include <dm/device.h>
 #include <dm/device-internal.h>
+#include <dm/lazy.h>
 #include <dm/lists.h>
 #include <dm/of_access.h>
 #include <dm/pinctrl.h>
@@ -303,7 +304,7 @@ static void *alloc_priv(int size, uint flags)
 	return priv;
 }
 
-int device_probe(struct udevice *dev)
+static int device_do_probe(struct udevice *dev)
 {
 	struct power_domain pd;
 	const struct driver *drv;
@@ -311,11 +312,8 @@ int device_probe(struct udevice *dev)
 	int ret;
 	int seq;
 
-	if (!dev)
-		return -EINVAL;
-
-	if (dev->flags & DM_FLAG_ACTIVATED)
-		return 0;
+	/* The driver may look for its children, so make sure they exist */
+	dm_lazy_bind_children(dev);
 
 	drv = dev->driver;
 	assert(drv);
@@ -441,6 +439,24 @@ fail:
 	return ret;
 }
 
+int device_probe(struct udevice *dev)
+{
+	ulong start;
+	int ret;
+
+	if (!dev)
+		return -EINVAL;
+
+	if (dev->flags & DM_FLAG_ACTIVATED)
+		return 0;
+
+	start = bootstage_event_start();
+	ret = device_do_probe(dev);
+	bootstage_event_add(BOOTSTAGE_EVENT_PROBE, dev->driver->name, start);
+
+	return ret;
+}
+
 void *dev_get_platdata(struct udevice *dev)
 {
 	if (!dev) {
@@ -613,6 +629,7 @@ static struct udevice *_device_find_global_by_ofnode(struct udevice *parent,
 
 int device_find_global_by_ofnode(ofnode ofnode, struct udevice **devp)
 {
+	dm_lazy_bind_node(ofnode);
 	*devp = _device_find_global_by_ofnode(gd->dm_root, ofnode);
 
 	return *devp ? 0 : -ENOENT;
@@ -622,6 +639,7 @@ int device_get_global_by_ofnode(ofnode ofnode, struct udevice **devp)
 {
 	struct udevice *dev;
 
+	dm_lazy_bind_node(ofnode);
 	dev = _device_find_global_by_ofnode(gd->dm_root, ofnode);
 	return device_get_device_tail(dev, dev ? 0 : -ENOENT, devp);
 }
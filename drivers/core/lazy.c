@@ -0,0 +1,268 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Deferred binding of device tree nodes
+ *
+ * Each deferred node is kept with the device it would be bound to and a
+ * bitmap of the uclasses it may lead to: its own and those of the enabled
+ * nodes below it which have a driver. Binding a bus defers its children in
+ * turn, so a lookup in a uclass binds, level by level, only the nodes on
+ * the paths to the members of that uclass.
+ *
+ * The state is in BSS, so nothing is deferred before relocation.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <dm/device.h>
+#include <dm/device-internal.h>
+#include <dm/lazy.h>
+#include <dm/lists.h>
+#include <dm/read.h>
+#include <dm/uclass.h>
+#include <dm/util.h>
+#include <linux/list.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#define DM_LAZY_ID_WORDS	DIV_ROUND_UP(UCLASS_COUNT, 32)
+
+struct dm_lazy_node {
+	struct list_head sibling;
+	struct udevice *parent;
+	ofnode node;
+	u32 ids[DM_LAZY_ID_WORDS];
+};
+
+/* Deferred nodes in device tree order */
+static LIST_HEAD(dm_lazy_list);
+/* Number of deferred nodes which may lead to each uclass */
+static u16 dm_lazy_count[UCLASS_COUNT];
+static bool dm_lazy_enabled;
+/* Set while binding deferred nodes, which must not start another round */
+static bool dm_lazy_busy;
+
+static bool dm_lazy_active(void)
+{
+	return (gd->flags & GD_FLG_RELOC) && !list_empty(&dm_lazy_list);
+}
+
+void dm_set_lazy_bind(bool enable)
+{
+	if (gd->flags & GD_FLG_RELOC)
+		dm_lazy_enabled = enable;
+}
+
+/* Find the uclass of the driver that would be bound to a node */
+static int dm_lazy_node_uclass(ofnode node)
+{
+	const char *compat_list, *compat;
+	const struct udevice_id *of_id;
+	struct driver *drv;
+	int len, i;
+
+	compat_list = ofnode_get_property(node, "compatible", &len);
+	if (!compat_list)
+		return -ENOENT;
+	for (i = 0; i < len; i += strlen(compat) + 1) {
+		compat = compat_list + i;
+		drv = lists_driver_lookup_compat(compat, &of_id);
+		if (drv)
+			return drv->id;
+	}
+
+	return -ENOENT;
+}
+
+static void dm_lazy_add_ids(u32 *ids, ofnode node)
+{
+	ofnode subnode;
+	int id;
+
+	id = dm_lazy_node_uclass(node);
+	if (id >= 0 && id < UCLASS_COUNT)
+		ids[id / 32] |= 1U << (id % 32);
+
+	ofnode_for_each_subnode(subnode, node) {
+		if (ofnode_is_available(subnode))
+			dm_lazy_add_ids(ids, subnode);
+	}
+}
+
+bool dm_lazy_defer(struct udevice *parent, ofnode node, bool pre_reloc_only)
+{
+	struct dm_lazy_node *lazy;
+	int id;
+
+	if (pre_reloc_only || !dm_lazy_enabled || !(gd->flags & GD_FLG_RELOC))
+		return false;
+
+	/* Nodes without a driver are not bound, so need not be deferred */
+	if (dm_lazy_node_uclass(node) < 0)
+		return false;
+
+	lazy = calloc(1, sizeof(*lazy));
+	if (!lazy)
+		return false;
+	lazy->parent = parent;
+	lazy->node = node;
+	dm_lazy_add_ids(lazy->ids, node);
+	for (id = 0; id < UCLASS_COUNT; id++) {
+		if (lazy->ids[id / 32] & (1U << (id % 32)))
+			dm_lazy_count[id]++;
+	}
+	list_add_tail(&lazy->sibling, &dm_lazy_list);
+
+	return true;
+}
+
+static void dm_lazy_drop(struct dm_lazy_node *lazy)
+{
+	int id;
+
+	for (id = 0; id < UCLASS_COUNT; id++) {
+		if (lazy->ids[id / 32] & (1U << (id % 32)))
+			dm_lazy_count[id]--;
+	}
+	list_del(&lazy->sibling);
+	free(lazy);
+}
+
+static void dm_lazy_bind(struct dm_lazy_node *lazy)
+{
+	struct udevice *parent = lazy->parent;
+	ofnode node = lazy->node;
+	bool busy = dm_lazy_busy;
+	int ret;
+
+	/* Drop the entry first, so that it is not found again while binding */
+	dm_lazy_drop(lazy);
+	dm_lazy_busy = true;
+	ret = lists_bind_fdt(parent, node, NULL);
+	dm_lazy_busy = busy;
+	if (ret)
+		dm_warn("Cannot bind deferred node '%s' (err=%d)\n",
+			ofnode_get_name(node), ret);
+}
+
+void dm_lazy_bind_all(void)
+{
+	if (!dm_lazy_active() || dm_lazy_busy)
+		return;
+
+	/* Binding a bus adds its children to the end of the list */
+	while (!list_empty(&dm_lazy_list))
+		dm_lazy_bind(list_first_entry(&dm_lazy_list,
+					      struct dm_lazy_node, sibling));
+}
+
+void dm_lazy_bind_uclass(enum uclass_id id)
+{
+	struct uclass_driver *uc_drv;
+	struct dm_lazy_node *lazy;
+
+	if (!dm_lazy_active() || dm_lazy_busy || id < 0 || id >= UCLASS_COUNT)
+		return;
+
+	uc_drv = lists_uclass_lookup(id);
+	if (uc_drv && (uc_drv->flags & DM_UC_FLAG_LAZY_BIND_ALL)) {
+		dm_lazy_bind_all();
+		return;
+	}
+
+	while (dm_lazy_count[id]) {
+		list_for_each_entry(lazy, &dm_lazy_list, sibling) {
+			if (lazy->ids[id / 32] & (1U << (id % 32)))
+				break;
+		}
+		if (&lazy->sibling == &dm_lazy_list)
+			break;
+		dm_lazy_bind(lazy);
+	}
+}
+
+static struct dm_lazy_node *dm_lazy_find_node(ofnode node)
+{
+	struct dm_lazy_node *lazy;
+
+	list_for_each_entry(lazy, &dm_lazy_list, sibling) {
+		if (ofnode_equal(lazy->node, node))
+			return lazy;
+	}
+
+	return NULL;
+}
+
+void dm_lazy_bind_node(ofnode node)
+{
+	ofnode root = dev_ofnode(gd->dm_root);
+	struct dm_lazy_node *lazy;
+	ofnode anc;
+
+	if (!dm_lazy_active() || dm_lazy_busy || !ofnode_valid(node))
+		return;
+
+	/*
+	 * Bind the deferred node nearest the root on the path to @node. Its
+	 * children are deferred in turn, so repeat until @node is bound or
+	 * there is nothing left on the path.
+	 */
+	do {
+		lazy = NULL;
+		for (anc = node; ofnode_valid(anc) && !ofnode_equal(anc, root);
+		     anc = ofnode_get_parent(anc)) {
+			struct dm_lazy_node *found = dm_lazy_find_node(anc);
+
+			if (found)
+				lazy = found;
+		}
+		if (lazy)
+			dm_lazy_bind(lazy);
+	} while (lazy);
+}
+
+void dm_lazy_bind_phandle(uint phandle)
+{
+	if (dm_lazy_active() && !dm_lazy_busy)
+		dm_lazy_bind_node(ofnode_get_by_phandle(phandle));
+}
+
+void dm_lazy_bind_children(struct udevice *dev)
+{
+	struct dm_lazy_node *lazy, *next;
+
+	if (!dm_lazy_active() || dm_lazy_busy ||
+	    (dev->uclass->uc_drv->flags & DM_UC_FLAG_LAZY_CHILDREN))
+		return;
+
+	/* Children deferred while binding these are not bound here */
+	list_for_each_entry_safe(lazy, next, &dm_lazy_list, sibling) {
+		if (lazy->parent == dev)
+			dm_lazy_bind(lazy);
+	}
+}
+
+void dm_lazy_forget(struct udevice *dev)
+{
+	struct dm_lazy_node *lazy, *next;
+
+	if (!dm_lazy_active())
+		return;
+
+	list_for_each_entry_safe(lazy, next, &dm_lazy_list, sibling) {
+		if (!dev || lazy->parent == dev)
+			dm_lazy_drop(lazy);
+	}
+}
+
+int dm_lazy_pending(void)
+{
+	struct dm_lazy_node *lazy;
+	int count = 0;
+
+	if (!dm_lazy_active())
+		return 0;
+	list_for_each_entry(lazy, &dm_lazy_list, sibling)
+		count++;
+
+	return count;
+}
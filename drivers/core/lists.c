@@ -15,7 +15,140 @@
 #include <dm/uclass.h>
 #include <dm/util.h>
 #include <fdtdec.h>
+#include <malloc.h>
 #include <linux/compiler.h>
+#include <linux/log2.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#if CONFIG_IS_ENABLED(DM_DRIVER_INDEX)
+/*
+ * Hash tables over the driver linker lists, built on the first lookup after
+ * relocation and kept from then on, since the lists never change. Before
+ * relocation BSS is not usable and the lists are scanned instead. Where
+ * several drivers share a key, the table holds the first one in the linker
+ * list, which is the one the scan would find.
+ */
+struct lists_compat_slot {
+	u32 hash;
+	struct driver *drv;		/* NULL if the slot is free */
+	const struct udevice_id *of_id;
+};
+
+static struct lists_index {
+	bool built;
+	uint compat_mask;		/* Number of slots - 1 */
+	struct lists_compat_slot *compat;
+	uint name_mask;
+	struct driver **name;
+	struct uclass_driver *uclass[UCLASS_COUNT];
+} lists_index;
+
+/* FNV-1a */
+static u32 lists_hash(const char *str)
+{
+	u32 hash = 2166136261U;
+
+	while (*str)
+		hash = (hash ^ (u8)*str++) * 16777619;
+
+	return hash;
+}
+
+static void lists_index_add_compat(struct driver *drv,
+				   const struct udevice_id *of_id)
+{
+	u32 hash = lists_hash(of_id->compatible);
+	struct lists_compat_slot *slot;
+	uint i;
+
+	for (i = hash & lists_index.compat_mask;;
+	     i = (i + 1) & lists_index.compat_mask) {
+		slot = &lists_index.compat[i];
+		if (!slot->drv)
+			break;
+		if (slot->hash == hash &&
+		    !strcmp(slot->of_id->compatible, of_id->compatible))
+			return;
+	}
+	slot->hash = hash;
+	slot->drv = drv;
+	slot->of_id = of_id;
+}
+
+static void lists_index_add_name(struct driver *drv)
+{
+	uint i;
+
+	for (i = lists_hash(drv->name) & lists_index.name_mask;
+	     lists_index.name[i]; i = (i + 1) & lists_index.name_mask) {
+		if (!strcmp(lists_index.name[i]->name, drv->name))
+			return;
+	}
+	lists_index.name[i] = drv;
+}
+
+static void lists_index_build(void)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	struct uclass_driver *uclass =
+		ll_entry_start(struct uclass_driver, uclass);
+	const int n_uclass = ll_entry_count(struct uclass_driver, uclass);
+	const struct udevice_id *of_id;
+	struct uclass_driver *uc;
+	struct driver *entry;
+	uint n_compat = 0;
+
+	lists_index.built = true;
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (of_id = entry->of_match; of_id && of_id->compatible;
+		     of_id++)
+			n_compat++;
+	}
+
+	/* Keep the tables at most half full so that probe runs stay short */
+	lists_index.compat_mask = roundup_pow_of_two(2 * n_compat + 1) - 1;
+	lists_index.name_mask = roundup_pow_of_two(2 * n_ents + 1) - 1;
+	lists_index.compat = calloc(lists_index.compat_mask + 1,
+				    sizeof(*lists_index.compat));
+	lists_index.name = calloc(lists_index.name_mask + 1,
+				  sizeof(*lists_index.name));
+	if (!lists_index.compat || !lists_index.name) {
+		dm_warn("No memory for driver index, scanning instead\n");
+		free(lists_index.compat);
+		free(lists_index.name);
+		lists_index.compat = NULL;
+		lists_index.name = NULL;
+		return;
+	}
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (of_id = entry->of_match; of_id && of_id->compatible;
+		     of_id++)
+			lists_index_add_compat(entry, of_id);
+		lists_index_add_name(entry);
+	}
+	for (uc = uclass; uc != uclass + n_uclass; uc++) {
+		if (uc->id >= 0 && uc->id < UCLASS_COUNT &&
+		    !lists_index.uclass[uc->id])
+			lists_index.uclass[uc->id] = uc;
+	}
+	debug("Driver index: %d drivers, %u compatible strings\n", n_ents,
+	      n_compat);
+}
+
+/* Get the index, or NULL if the linker lists must be scanned */
+static struct lists_index *lists_get_index(void)
+{
+	if (!(gd->flags & GD_FLG_RELOC))
+		return NULL;
+	if (!lists_index.built)
+		lists_index_build();
+
+	return lists_index.compat ? &lists_index : NULL;
+}
+#endif
 
 struct driver *lists_driver_lookup_name(const char *name)
 {
@@ -23,6 +156,20 @@ struct driver *lists_driver_lookup_name(const char *name)
 		ll_entry_start(struct driver, driver);
 	const int n_ents = ll_entry_count(struct driver, driver);
 	struct driver *entry;
+#if CONFIG_IS_ENABLED(DM_DRIVER_INDEX)
+	struct lists_index *index = lists_get_index();
+	uint i;
+
+	if (index) {
+		for (i = lists_hash(name) & index->name_mask; index->name[i];
+		     i = (i + 1) & index->name_mask) {
+			if (!strcmp(name, index->name[i]->name))
+				return index->name[i];
+		}
+
+		return NULL;
+	}
+#endif
 
 	for (entry = drv; entry != drv + n_ents; entry++) {
 		if (!strcmp(name, entry->name))
@@ -39,6 +186,12 @@ struct uclass_driver *lists_uclass_lookup(enum uclass_id id)
 		ll_entry_start(struct uclass_driver, uclass);
 	const int n_ents = ll_entry_count(struct uclass_driver, uclass);
 	struct uclass_driver *entry;
+#if CONFIG_IS_ENABLED(DM_DRIVER_INDEX)
+	struct lists_index *index = lists_get_index();
+
+	if (index)
+		return id >= 0 && id < UCLASS_COUNT ? index->uclass[id] : NULL;
+#endif
 
 	for (entry = uclass; entry != uclass + n_ents; entry++) {
 		if (entry->id == id)
@@ -122,10 +275,44 @@ static int driver_check_compatible(const struct udevice_id *of_match,
 	return -ENOENT;
 }
 
-int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp)
+struct driver *lists_driver_lookup_compat(const char *compat,
+					  const struct udevice_id **of_idp)
 {
 	struct driver *driver = ll_entry_start(struct driver, driver);
 	const int n_ents = ll_entry_count(struct driver, driver);
+	struct driver *entry;
+#if CONFIG_IS_ENABLED(DM_DRIVER_INDEX)
+	struct lists_index *index = lists_get_index();
+	struct lists_compat_slot *slot;
+	u32 hash;
+	uint i;
+
+	if (index) {
+		hash = lists_hash(compat);
+		for (i = hash & index->compat_mask; index->compat[i].drv;
+		     i = (i + 1) & index->compat_mask) {
+			slot = &index->compat[i];
+			if (slot->hash == hash &&
+			    !strcmp(slot->of_id->compatible, compat)) {
+				*of_idp = slot->of_id;
+				return slot->drv;
+			}
+		}
+
+		return NULL;
+	}
+#endif
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		if (!driver_check_compatible(entry->of_match, of_idp, compat))
+			return entry;
+	}
+
+	return NULL;
+}
+
+int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp)
+{
 	const struct udevice_id *id;
 	struct driver *entry;
 	struct udevice *dev;
@@ -162,13 +349,8 @@ int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp)
 		pr_debug("   - attempt to match compatible string '%s'\n",
 			 compat);
 
-		for (entry = driver; entry != driver + n_ents; entry++) {
-			ret = driver_check_compatible(entry->of_match, &id,
-						      compat);
-			if (!ret)
-				break;
-		}
-		if (entry == driver + n_ents)
+		entry = lists_driver_lookup_compat(compat, &id);
+		if (!entry)
 			continue;
 
 		pr_debug("   - found match at '%s'\n", entry->name);
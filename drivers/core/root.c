@@ -13,6 +13,7 @@
 #include <linux/libfdt.h>
 #include <dm/device.h>
 #include <dm/device-internal.h>
+#include <dm/lazy.h>
 #include <dm/lists.h>
 #include <dm/of.h>
 #include <dm/of_access.h>
@@ -158,6 +159,8 @@ int dm_init(bool of_live)
 		return -EINVAL;
 	}
 	INIT_LIST_HEAD(&DM_UCLASS_ROOT_NON_CONST);
+	/* Any deferred nodes belong to the devices of the previous tree */
+	dm_lazy_forget(NULL);
 
 #if defined(CONFIG_NEEDS_MANUAL_RELOC)
 	fix_drivers();
@@ -229,6 +232,8 @@ static int dm_scan_fdt_live(struct udevice *parent,
 			pr_debug("   - ignoring disabled device\n");
 			continue;
 		}
+		if (dm_lazy_defer(parent, np_to_ofnode(np), pre_reloc_only))
+			continue;
 		err = lists_bind_fdt(parent, np_to_ofnode(np), NULL);
 		if (err && !ret) {
 			ret = err;
@@ -283,6 +288,9 @@ static int dm_scan_fdt_node(struct udevice *parent, const void *blob,
 			pr_debug("   - ignoring disabled device\n");
 			continue;
 		}
+		if (dm_lazy_defer(parent, offset_to_ofnode(offset),
+				  pre_reloc_only))
+			continue;
 		err = lists_bind_fdt(parent, offset_to_ofnode(offset), NULL);
 		if (err && !ret) {
 			ret = err;
@@ -390,6 +398,9 @@ int dm_init_and_scan(bool pre_reloc_only)
 	}
 
 	if (CONFIG_IS_ENABLED(OF_CONTROL) && !CONFIG_IS_ENABLED(OF_PLATDATA)) {
+		if (CONFIG_IS_ENABLED(DM_LAZY_BIND) && !pre_reloc_only)
+			dm_set_lazy_bind(fdtdec_get_config_bool(gd->fdt_blob,
+							"u-boot,dm-lazy-bind"));
 		ret = dm_extended_scan_fdt(gd->fdt_blob, pre_reloc_only);
 		if (ret) {
 			debug("dm_extended_scan_dt() failed: %d\n", ret);
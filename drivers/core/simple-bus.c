@@ -48,6 +48,7 @@ UCLASS_DRIVER(simple_bus) = {
 	.name		= "simple_bus",
 	.post_bind	= simple_bus_post_bind,
 	.per_device_platdata_auto_alloc_size = sizeof(struct simple_bus_plat),
+	.flags		= DM_UC_FLAG_LAZY_CHILDREN,
 };
 
 static const struct udevice_id generic_simple_bus_ids[] = {
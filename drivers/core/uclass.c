@@ -12,6 +12,7 @@
 #include <malloc.h>
 #include <dm/device.h>
 #include <dm/device-internal.h>
+#include <dm/lazy.h>
 #include <dm/lists.h>
 #include <dm/uclass.h>
 #include <dm/uclass-internal.h>
@@ -135,7 +136,8 @@ int uclass_destroy(struct uclass *uc)
 	return 0;
 }
 
-int uclass_get(enum uclass_id id, struct uclass **ucp)
+/* Get a uclass without binding any of its deferred device tree nodes */
+static int uclass_get_bound(enum uclass_id id, struct uclass **ucp)
 {
 	struct uclass *uc;
 
@@ -148,6 +150,13 @@ int uclass_get(enum uclass_id id, struct uclass **ucp)
 	return 0;
 }
 
+int uclass_get(enum uclass_id id, struct uclass **ucp)
+{
+	dm_lazy_bind_uclass(id);
+
+	return uclass_get_bound(id, ucp);
+}
+
 const char *uclass_get_name(enum uclass_id id)
 {
 	struct uclass *uc;
@@ -308,7 +317,8 @@ int uclass_find_device_by_of_offset(enum uclass_id id, int node,
 	*devp = NULL;
 	if (node < 0)
 		return -ENODEV;
-	ret = uclass_get(id, &uc);
+	dm_lazy_bind_node(offset_to_ofnode(node));
+	ret = uclass_get_bound(id, &uc);
 	if (ret)
 		return ret;
 
@@ -333,7 +343,8 @@ int uclass_find_device_by_ofnode(enum uclass_id id, ofnode node,
 	*devp = NULL;
 	if (!ofnode_valid(node))
 		return -ENODEV;
-	ret = uclass_get(id, &uc);
+	dm_lazy_bind_node(node);
+	ret = uclass_get_bound(id, &uc);
 	if (ret)
 		return ret;
 
@@ -368,7 +379,8 @@ static int uclass_find_device_by_phandle(enum uclass_id id,
 	find_phandle = dev_read_u32_default(parent, name, -1);
 	if (find_phandle <= 0)
 		return -ENOENT;
-	ret = uclass_get(id, &uc);
+	dm_lazy_bind_phandle(find_phandle);
+	ret = uclass_get_bound(id, &uc);
 	if (ret)
 		return ret;
 
@@ -495,7 +507,8 @@ int uclass_get_device_by_phandle_id(enum uclass_id id, uint phandle_id,
 	int ret;
 
 	*devp = NULL;
-	ret = uclass_get(id, &uc);
+	dm_lazy_bind_phandle(phandle_id);
+	ret = uclass_get_bound(id, &uc);
 	if (ret)
 		return ret;
 
@@ -328,7 +328,8 @@ void mmc_do_preinit(void)
 #ifdef CONFIG_FSL_ESDHC_ADAPTER_IDENT
 		mmc_set_preinit(m, 1);
 #endif
-		if (m->preinit)
+		/* A card may already be part-way through an early start */
+		if (m->preinit && !m->init_in_progress)
 			mmc_start_init(m);
 	}
 }
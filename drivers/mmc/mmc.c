@@ -3031,16 +3031,10 @@ void mmc_set_preinit(struct mmc *mmc, int preinit)
 }
 
 #if CONFIG_IS_ENABLED(DM_MMC)
-static int mmc_probe(bd_t *bis)
+void mmc_probe_seq(void)
 {
-	int ret;
+	__maybe_unused struct udevice *dev;
 	__maybe_unused int i;
-	struct uclass *uc;
-	struct udevice *dev;
-
-	ret = uclass_get(UCLASS_MMC, &uc);
-	if (ret)
-		return ret;
 
 	/*
 	 * Try to add them in sequence order. Really with driver model we
@@ -3050,11 +3044,23 @@ static int mmc_probe(bd_t *bis)
 #ifndef CONFIG_HB_QUICK_BOOT
 /*if defined QUICK_BOOT only detect mmc0*/
 	for (i = 0; ; i++) {
-		ret = uclass_get_device_by_seq(UCLASS_MMC, i, &dev);
-		if (ret == -ENODEV)
+		if (uclass_get_device_by_seq(UCLASS_MMC, i, &dev) == -ENODEV)
 			break;
 	}
 #endif
+}
+
+static int mmc_probe(bd_t *bis)
+{
+	int ret;
+	struct uclass *uc;
+	struct udevice *dev;
+
+	ret = uclass_get(UCLASS_MMC, &uc);
+	if (ret)
+		return ret;
+
+	mmc_probe_seq();
 	uclass_foreach_dev(dev, uc) {
 		ret = device_probe(dev);
 		if (ret && ret != (-EOPNOTSUPP))
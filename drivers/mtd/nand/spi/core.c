@@ -24,6 +24,7 @@
 #include <errno.h>
 #include <spi.h>
 #include <spi-mem.h>
+#include <task.h>
 #include <linux/mtd/spinand.h>
 #endif
 
@@ -429,6 +430,7 @@ static int spinand_wait(struct spinand_device *spinand, u8 *s)
 
 		if (!(status & STATUS_BUSY))
 			goto out;
+		task_yield();
 	} while (get_timer(start) < stop);
 
 	/*
@@ -240,14 +240,19 @@ struct eqos_dma_regs {
 #define EQOS_DESCRIPTOR_SIZE	(EQOS_DESCRIPTOR_WORDS * 4)
 /* We assume ARCH_DMA_MINALIGN >= 16; 16 is the EQOS HW minimum */
 #define EQOS_DESCRIPTOR_ALIGN	ARCH_DMA_MINALIGN
-#define EQOS_DESCRIPTORS_TX	4
-#define EQOS_DESCRIPTORS_RX	4
-#define EQOS_DESCRIPTORS_NUM	(EQOS_DESCRIPTORS_TX + EQOS_DESCRIPTORS_RX)
-#define EQOS_DESCRIPTORS_SIZE	ALIGN(EQOS_DESCRIPTORS_NUM * \
-				      EQOS_DESCRIPTOR_SIZE, ARCH_DMA_MINALIGN)
+#define EQOS_DESCRIPTORS_SIZE(num)	ALIGN((num) * EQOS_DESCRIPTOR_SIZE, \
+					      ARCH_DMA_MINALIGN)
+/* The ring length registers are 10 bits wide */
+#define EQOS_DESCRIPTORS_MAX	1024
+/*
+ * Used RX descriptors are handed back to the hardware a cache line at a
+ * time, so that flushing them never discards a descriptor the hardware has
+ * written in the same line, and the tail pointer is written once per batch.
+ */
+#define EQOS_RX_REFILL_BATCH	(ARCH_DMA_MINALIGN > EQOS_DESCRIPTOR_SIZE ? \
+				 ARCH_DMA_MINALIGN / EQOS_DESCRIPTOR_SIZE : 1)
 #define EQOS_BUFFER_ALIGN	ARCH_DMA_MINALIGN
 #define EQOS_MAX_PACKET_SIZE	ALIGN(1568, ARCH_DMA_MINALIGN)
-#define EQOS_RX_BUFFER_SIZE	(EQOS_DESCRIPTORS_RX * EQOS_MAX_PACKET_SIZE)
 
 /*
  * Warn if the cache-line size is larger than the descriptor size. In such
@@ -301,10 +306,11 @@ struct eqos_priv {
     void *descs;
     struct eqos_desc *tx_descs;
     struct eqos_desc *rx_descs;
+    int tx_desc_num, rx_desc_num;
     int tx_desc_idx, rx_desc_idx;
+    int rx_refill_idx;
     void *tx_dma_buf;
     void *rx_dma_buf;
-    void *rx_pkt;
     bool started;
     bool reg_access_ok;
     unsigned is_88e6321;
@@ -334,10 +340,10 @@ struct eqos_priv {
 static void *eqos_alloc_descs(unsigned int num)
 {
 #ifdef CONFIG_SYS_NONCACHED_MEMORY
-    return (void *)noncached_alloc(EQOS_DESCRIPTORS_SIZE,
+    return (void *)noncached_alloc(EQOS_DESCRIPTORS_SIZE(num),
                                    EQOS_DESCRIPTOR_ALIGN);
 #else
-    return memalign(EQOS_DESCRIPTOR_ALIGN, EQOS_DESCRIPTORS_SIZE);
+    return memalign(EQOS_DESCRIPTOR_ALIGN, EQOS_DESCRIPTORS_SIZE(num));
 #endif
 }
 
@@ -368,19 +374,31 @@ static void eqos_flush_desc(void *desc)
 #endif
 }
 
-/*static void eqos_inval_buffer(void *buf, size_t size)
+static void eqos_flush_descs(void *desc, unsigned int num)
+{
+#ifndef CONFIG_SYS_NONCACHED_MEMORY
+    flush_cache((unsigned long)desc, num * EQOS_DESCRIPTOR_SIZE);
+#endif
+}
+
+static void eqos_inval_buffer(void *buf, size_t size)
 {
     unsigned long start = (unsigned long)buf & ~(ARCH_DMA_MINALIGN - 1);
-    unsigned long end = ALIGN(start + size, ARCH_DMA_MINALIGN);
+    unsigned long end = ALIGN((unsigned long)buf + size, ARCH_DMA_MINALIGN);
 
     invalidate_dcache_range(start, end);
-}*/
+}
 
 static void eqos_flush_buffer(void *buf, size_t size)
 {
     flush_cache((unsigned long)buf, size);
 }
 
+static void *eqos_rx_buf(struct eqos_priv *eqos, int idx)
+{
+    return eqos->rx_dma_buf + idx * EQOS_MAX_PACKET_SIZE;
+}
+
 static int eqos_mdio_wait_idle(struct eqos_priv *eqos)
 {
     return wait_for_bit_le32(&eqos->mac_regs->mdio_address,
@@ -791,6 +809,7 @@ static int eqos_start(struct udevice *dev)
 
     eqos->tx_desc_idx = 0;
     eqos->rx_desc_idx = 0;
+    eqos->rx_refill_idx = 0;
 
 	val = readl(&eqos->mac_regs->unused_0e0[(0xf8 - 0x0e0) / 4]);
 	val |= 0x3;
@@ -1068,23 +1087,27 @@ static int eqos_start(struct udevice *dev)
 
     /* Set up descriptors */
 
-    memset(eqos->descs, 0, EQOS_DESCRIPTORS_SIZE);
-    for (i = 0; i < EQOS_DESCRIPTORS_RX; i++) {
+    memset(eqos->descs, 0,
+           EQOS_DESCRIPTORS_SIZE(eqos->tx_desc_num + eqos->rx_desc_num));
+    for (i = 0; i < eqos->rx_desc_num; i++) {
         struct eqos_desc *rx_desc = &(eqos->rx_descs[i]);
-        rx_desc->des0 = (u32)(ulong)(eqos->rx_dma_buf +
-                                     (i * EQOS_MAX_PACKET_SIZE));
+        rx_desc->des0 = (u32)(ulong)eqos_rx_buf(eqos, i);
         rx_desc->des3 |= EQOS_DESC3_OWN | EQOS_DESC3_BUF1V;
     }
-    flush_cache((unsigned long)eqos->descs, EQOS_DESCRIPTORS_SIZE);
+    flush_cache((unsigned long)eqos->descs,
+                EQOS_DESCRIPTORS_SIZE(eqos->tx_desc_num + eqos->rx_desc_num));
+    /* No dirty line may be written back over a packet the DMA has stored */
+    eqos_flush_buffer(eqos->rx_dma_buf,
+                      eqos->rx_desc_num * EQOS_MAX_PACKET_SIZE);
 
     writel(0, &eqos->dma_regs->ch0_txdesc_list_haddress);
     writel((ulong)eqos->tx_descs, &eqos->dma_regs->ch0_txdesc_list_address);
-    writel(EQOS_DESCRIPTORS_TX - 1,
+    writel(eqos->tx_desc_num - 1,
            &eqos->dma_regs->ch0_txdesc_ring_length);
 
     writel(0, &eqos->dma_regs->ch0_rxdesc_list_haddress);
     writel((ulong)eqos->rx_descs, &eqos->dma_regs->ch0_rxdesc_list_address);
-    writel(EQOS_DESCRIPTORS_RX - 1,
+    writel(eqos->rx_desc_num - 1,
            &eqos->dma_regs->ch0_rxdesc_ring_length);
 
     /* Enable everything */
@@ -1104,7 +1127,7 @@ static int eqos_start(struct udevice *dev)
      * that's not distinguishable from none of the descriptors being
      * available.
      */
-    last_rx_desc = (ulong) & (eqos->rx_descs[(EQOS_DESCRIPTORS_RX - 1)]);
+    last_rx_desc = (ulong) & (eqos->rx_descs[(eqos->rx_desc_num - 1)]);
     writel(last_rx_desc, &eqos->dma_regs->ch0_rxdesc_tail_pointer);
 
     eqos->started = true;
@@ -1183,19 +1206,29 @@ int eqos_send(struct udevice *dev, void *packet, int length)
 {
     struct eqos_priv *eqos = dev_get_priv(dev);
     struct eqos_desc *tx_desc;
+    void *buf = packet;
     int i;
 
     debug("%s(dev=%p, packet=%p, length=%d):\n", __func__, dev, packet,
           length);
 
-    memcpy(eqos->tx_dma_buf, packet, length);
-    eqos_flush_buffer(eqos->tx_dma_buf, length);
+    /*
+     * We wait for the hardware to finish with the packet before returning,
+     * so it can be sent straight from the caller's buffer. Only a buffer
+     * the DMA cannot be pointed at is copied first.
+     */
+    if (!IS_ALIGNED((ulong)packet, EQOS_BUFFER_ALIGN) ||
+        upper_32_bits((ulong)packet + length)) {
+        memcpy(eqos->tx_dma_buf, packet, length);
+        buf = eqos->tx_dma_buf;
+    }
+    eqos_flush_buffer(buf, length);
 
     tx_desc = &(eqos->tx_descs[eqos->tx_desc_idx]);
     eqos->tx_desc_idx++;
-    eqos->tx_desc_idx %= EQOS_DESCRIPTORS_TX;
+    eqos->tx_desc_idx %= eqos->tx_desc_num;
 
-    tx_desc->des0 = (ulong)eqos->tx_dma_buf;
+    tx_desc->des0 = (u32)(ulong)buf;
     tx_desc->des1 = 0;
     tx_desc->des2 = length;
     /*
@@ -1229,55 +1262,80 @@ int eqos_recv(struct udevice *dev, int flags, uchar **packetp)
     debug("%s(dev=%p, flags=%x):\n", __func__, dev, flags);
 
     rx_desc = &(eqos->rx_descs[eqos->rx_desc_idx]);
+    eqos_inval_desc(rx_desc);
     if (rx_desc->des3 & EQOS_DESC3_OWN) {
         debug("%s: RX packet not available\n", __func__);
         return -EAGAIN;
     }
 
-    *packetp = eqos->rx_dma_buf +
-               (eqos->rx_desc_idx * EQOS_MAX_PACKET_SIZE);
+    /* The packet is handed up in place, from the buffer the DMA wrote */
+    *packetp = eqos_rx_buf(eqos, eqos->rx_desc_idx);
     length = rx_desc->des3 & 0x7fff;
     debug("%s: *packetp=%p, length=%d\n", __func__, *packetp, length);
 
-    /* after loading ethernet data to RAM with DMA, flush all cache
-    to ensure the consistency of RAM and dcache */
-    flush_dcache_all();
+    eqos_inval_buffer(*packetp, length);
 
     return length;
 }
 
+/*
+ * Give the RX descriptors the stack has finished with back to the hardware.
+ * This is only called once rx_desc_idx reaches a multiple of
+ * EQOS_RX_REFILL_BATCH, so the descriptors are contiguous and fill whole
+ * cache lines.
+ */
+static void eqos_rx_refill(struct eqos_priv *eqos)
+{
+    struct eqos_desc *first = &(eqos->rx_descs[eqos->rx_refill_idx]);
+    struct eqos_desc *rx_desc = NULL;
+    unsigned int count = 0;
+    void *buf;
+
+    while (eqos->rx_refill_idx != eqos->rx_desc_idx) {
+        rx_desc = &(eqos->rx_descs[eqos->rx_refill_idx]);
+        buf = eqos_rx_buf(eqos, eqos->rx_refill_idx);
+        /* The stack may have written to the packet, e.g. to reply */
+        eqos_flush_buffer(buf, EQOS_MAX_PACKET_SIZE);
+
+        rx_desc->des0 = (u32)(ulong)buf;
+        rx_desc->des1 = 0;
+        rx_desc->des2 = 0;
+        /*
+         * Make sure that if HW sees the _OWN write below, it will see all
+         * the writes to the rest of the descriptor too.
+         */
+        mb();
+        rx_desc->des3 = EQOS_DESC3_OWN | EQOS_DESC3_BUF1V;
+
+        eqos->rx_refill_idx++;
+        eqos->rx_refill_idx %= eqos->rx_desc_num;
+        count++;
+    }
+    if (!rx_desc)
+        return;
+
+    eqos_flush_descs(first, count);
+    writel((ulong)rx_desc, &eqos->dma_regs->ch0_rxdesc_tail_pointer);
+}
+
 int eqos_free_pkt(struct udevice *dev, uchar *packet, int length)
 {
     struct eqos_priv *eqos = dev_get_priv(dev);
     uchar *packet_expected;
-    struct eqos_desc *rx_desc;
 
     debug("%s(packet=%p, length=%d)\n", __func__, packet, length);
 
-    packet_expected = eqos->rx_dma_buf +
-                      (eqos->rx_desc_idx * EQOS_MAX_PACKET_SIZE);
+    packet_expected = eqos_rx_buf(eqos, eqos->rx_desc_idx);
     if (packet != packet_expected) {
         debug("%s: Unexpected packet (expected %p)\n", __func__,
               packet_expected);
         return -EINVAL;
     }
 
-    rx_desc = &(eqos->rx_descs[eqos->rx_desc_idx]);
-    rx_desc->des0 = (u32)(ulong)packet;
-    rx_desc->des1 = 0;
-    rx_desc->des2 = 0;
-    /*
-     * Make sure that if HW sees the _OWN write below, it will see all the
-     * writes to the rest of the descriptor too.
-     */
-    mb();
-    rx_desc->des3 |= EQOS_DESC3_OWN | EQOS_DESC3_BUF1V;
-    eqos_flush_desc(rx_desc);
-
-    writel((ulong)rx_desc, &eqos->dma_regs->ch0_rxdesc_tail_pointer);
-
     eqos->rx_desc_idx++;
-    eqos->rx_desc_idx %= EQOS_DESCRIPTORS_RX;
+    eqos->rx_desc_idx %= eqos->rx_desc_num;
+    if (!(eqos->rx_desc_idx % EQOS_RX_REFILL_BATCH))
+        eqos_rx_refill(eqos);
 
     return 0;
 }
@@ -1289,15 +1347,14 @@ static int eqos_probe_resources_core(struct udevice *dev)
 
     debug("%s(dev=%p):\n", __func__, dev);
 
-    eqos->descs = eqos_alloc_descs(EQOS_DESCRIPTORS_TX +
-                                   EQOS_DESCRIPTORS_RX);
+    eqos->descs = eqos_alloc_descs(eqos->tx_desc_num + eqos->rx_desc_num);
     if (!eqos->descs) {
         debug("%s: eqos_alloc_descs() failed\n", __func__);
         ret = -ENOMEM;
         goto err;
     }
     eqos->tx_descs = (struct eqos_desc *)eqos->descs;
-    eqos->rx_descs = (eqos->tx_descs + EQOS_DESCRIPTORS_TX);
+    eqos->rx_descs = (eqos->tx_descs + eqos->tx_desc_num);
     debug("%s: tx_descs=%p, rx_descs=%p\n", __func__, eqos->tx_descs,
           eqos->rx_descs);
 
@@ -1309,7 +1366,8 @@ static int eqos_probe_resources_core(struct udevice *dev)
     }
     debug("%s: rx_dma_buf=%p\n", __func__, eqos->rx_dma_buf);
 
-    eqos->rx_dma_buf = memalign(EQOS_BUFFER_ALIGN, EQOS_RX_BUFFER_SIZE);
+    eqos->rx_dma_buf = memalign(EQOS_BUFFER_ALIGN,
+                                eqos->rx_desc_num * EQOS_MAX_PACKET_SIZE);
     if (!eqos->rx_dma_buf) {
         debug("%s: memalign(rx_dma_buf) failed\n", __func__);
         ret = -ENOMEM;
@@ -1317,19 +1375,9 @@ static int eqos_probe_resources_core(struct udevice *dev)
     }
     debug("%s: tx_dma_buf=%p\n", __func__, eqos->tx_dma_buf);
 
-    eqos->rx_pkt = malloc(EQOS_MAX_PACKET_SIZE);
-    if (!eqos->rx_pkt) {
-        debug("%s: malloc(rx_pkt) failed\n", __func__);
-        ret = -ENOMEM;
-        goto err_free_rx_dma_buf;
-    }
-    debug("%s: rx_pkt=%p\n", __func__, eqos->rx_pkt);
-
     debug("%s: OK\n", __func__);
     return 0;
 
-err_free_rx_dma_buf:
-    free(eqos->rx_dma_buf);
 err_free_tx_dma_buf:
     free(eqos->tx_dma_buf);
 err_free_descs:
@@ -1346,7 +1394,6 @@ static int eqos_remove_resources_core(struct udevice *dev)
 
     debug("%s(dev=%p):\n", __func__, dev);
 
-    free(eqos->rx_pkt);
     free(eqos->rx_dma_buf);
     free(eqos->tx_dma_buf);
     eqos_free_descs(eqos->descs);
@@ -1380,17 +1427,114 @@ static int eqos_ofdata_to_platdata(struct udevice *dev)
     } else {
 		eqos->interface = 0;
     }
+
+    eqos->tx_desc_num = dev_read_u32_default(dev, "hobot,tx-descriptors",
+                                             CONFIG_HB_ETH_GMAC_TX_DESCRIPTORS);
+    eqos->tx_desc_num = clamp(eqos->tx_desc_num, 2, EQOS_DESCRIPTORS_MAX);
+    /*
+     * The RX ring follows the TX ring, so keep it starting on a cache line
+     * of its own, or refilling the first batch would flush TX descriptors
+     */
+    eqos->tx_desc_num = roundup(eqos->tx_desc_num, EQOS_RX_REFILL_BATCH);
+
+    /*
+     * RX descriptors are refilled in whole batches, and the hardware must
+     * still have some to use while one batch waits to be refilled
+     */
+    eqos->rx_desc_num = dev_read_u32_default(dev, "hobot,rx-descriptors",
+                                             CONFIG_HB_ETH_GMAC_RX_DESCRIPTORS);
+    eqos->rx_desc_num = clamp(eqos->rx_desc_num, 2 * EQOS_RX_REFILL_BATCH,
+                              EQOS_DESCRIPTORS_MAX);
+    eqos->rx_desc_num = rounddown(eqos->rx_desc_num, EQOS_RX_REFILL_BATCH);
+    debug("%s: %d TX, %d RX descriptors\n", __func__, eqos->tx_desc_num,
+          eqos->rx_desc_num);
+
     return 0;
 }
 
+/* How long the PHY is held in reset */
+#define HB_PHY_RESET_MS 100
+
+/* Set when hb_eth_phy_reset_start() has already put the PHY into reset */
+static bool hb_phy_reset_started;
+static ulong hb_phy_reset_start;
+
+#if defined(CONFIG_TARGET_XJ3)
+/*
+ * Get the PHY reset and interrupt GPIOs of the SoM. Returns false for SoMs
+ * whose PHY is reset through GPIO_EPHY_CLK instead.
+ */
+static bool hb_phy_reset_pins(int *rst_pin, int *rst_pin_act, int *intb_pin,
+                              const char **name)
+{
+    switch (hb_som_type_get()) {
+    case SOM_TYPE_X3SDB:
+    case SOM_TYPE_X3SDBV4:
+    case SOM_TYPE_X3E:
+        *rst_pin = 20;
+        *rst_pin_act = 0;
+        *intb_pin = 21;
+        *name = "x3 sdb";
+        return true;
+    case SOM_TYPE_X3PI:
+    case SOM_TYPE_X3PIV2:
+        *rst_pin = 20;
+        *rst_pin_act = 0;
+        *intb_pin = 120;
+        *name = "x3pi";
+        return true;
+    case SOM_TYPE_X3PIV2_1:
+        *rst_pin = 61;
+        *rst_pin_act = 0;
+        *intb_pin = 120;
+        *name = "x3pi";
+        return true;
+    case SOM_TYPE_X3CM:
+        /* EPHY_CLK resets, QSPI_CSN1 is the interrupt */
+        *rst_pin = 38;
+        *rst_pin_act = 1;
+        *intb_pin = 120;
+        *name = "x3cm";
+        return true;
+    default:
+        return false;
+    }
+}
+#endif
+
+/*
+ * Put the PHY into reset ahead of the driver being probed, so that the
+ * probe only waits for whatever is left of HB_PHY_RESET_MS
+ */
+void hb_eth_phy_reset_start(void)
+{
+#if defined(CONFIG_TARGET_XJ3)
+    int rst_pin, rst_pin_act, intb_pin;
+    const char *name;
+
+    if (!hb_phy_reset_pins(&rst_pin, &rst_pin_act, &intb_pin, &name))
+        return;
+    set_pin_output_value(rst_pin, rst_pin_act);
+    hb_phy_reset_start = get_timer(0);
+    hb_phy_reset_started = true;
+#endif
+}
+
 static void hb_reset_phy(int rst_pin, int rst_pin_act, int intb_pin)
 {
     unsigned int reg_val;
     unsigned int offset = 0;
+    ulong elapsed = 0;
 
-    set_pin_output_value(rst_pin, rst_pin_act);
+    /* Only wait for what is left if the reset was started early */
+    if (hb_phy_reset_started)
+        elapsed = get_timer(hb_phy_reset_start);
+    else
+        set_pin_output_value(rst_pin, rst_pin_act);
+    hb_phy_reset_started = false;
 
-    mdelay(100);
+    if (elapsed < HB_PHY_RESET_MS)
+        mdelay(HB_PHY_RESET_MS - elapsed);
 
     // set reset gpio 
     set_pin_output_value(rst_pin, rst_pin_act ^ 1);
@@ -1416,6 +1560,9 @@ static int eqos_probe(struct udevice *dev)
 	unsigned long mclk;
 #if defined(CONFIG_TARGET_X2_FPGA) || defined(CONFIG_TARGET_X2)
     struct hb_info_hdr* boot_info;
+#elif defined(CONFIG_TARGET_XJ3)
+    int rst_pin, rst_pin_act, intb_pin;
+    const char *name;
 #endif
 
     debug("%s(dev=%p):\n", __func__, dev);
@@ -1443,28 +1590,9 @@ static int eqos_probe(struct udevice *dev)
         reg_val &= ~(0x03);
         writel(reg_val, reg_addr);
     }
-    if (hb_som_type_get() == SOM_TYPE_X3SDB
-        || hb_som_type_get() == SOM_TYPE_X3SDBV4
-        || hb_som_type_get() == SOM_TYPE_X3E) {
-        // reset gpio 20
-        // intb gpio 21
-        hb_reset_phy(20, 0, 21);
-        pr_err("x3 sdb reset eth phy done\n");
-    }else if (hb_som_type_get() == SOM_TYPE_X3PI || hb_som_type_get() == SOM_TYPE_X3PIV2) {
-        // reset gpio 20
-        // intb gpio 120
-        hb_reset_phy(20, 0, 120);
-        pr_err("x3pi reset eth phy done\n");
-    }else if (hb_som_type_get() == SOM_TYPE_X3PIV2_1) {
-        // reset gpio 20
-        // intb gpio 120
-        hb_reset_phy(61, 0, 120);
-        pr_err("x3pi reset eth phy done\n");
-    } else if (hb_som_type_get() == SOM_TYPE_X3CM) {
-        // reset gpio 38(EPHY_CLK)
-        // intb gpio 120(QSPI_CSN1)
-        hb_reset_phy(38, 1, 120);
-        pr_err("x3cm reset eth phy done\n");
+    if (hb_phy_reset_pins(&rst_pin, &rst_pin_act, &intb_pin, &name)) {
+        hb_reset_phy(rst_pin, rst_pin_act, intb_pin);
+        pr_err("%s reset eth phy done\n", name);
     } else {
         /* GPIO_EPHY_CLK as reset gpio*/
         reg_val = readl(GPIO_EPHY_CLK);
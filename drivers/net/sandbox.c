@@ -10,6 +10,7 @@
 #include <dm.h>
 #include <malloc.h>
 #include <net.h>
+#include <asm/eth.h>
 #include <asm/test.h>
 
 DECLARE_GLOBAL_DATA_PTR;
@@ -21,16 +22,28 @@ DECLARE_GLOBAL_DATA_PTR;
  * fake_host_ipaddr: IP address of mocked machine
  * recv_packet_buffer: buffer of the packet returned as received
  * recv_packet_length: length of the packet returned as received
+ * recv_queue: packets queued by sandbox_eth_recv_packet(), each
+ *	       PKTSIZE_ALIGN bytes
+ * recv_queue_length: length of each queued packet
+ * recv_queue_head: index of the next queued packet to return
+ * recv_queue_count: number of queued packets
  */
 struct eth_sandbox_priv {
 	uchar fake_host_hwaddr[ARP_HLEN];
 	struct in_addr fake_host_ipaddr;
 	uchar *recv_packet_buffer;
 	int recv_packet_length;
+	uchar *recv_queue;
+	int recv_queue_length[SANDBOX_ETH_RECV_QUEUE];
+	int recv_queue_head;
+	int recv_queue_count;
 };
 
 static bool disabled[8] = {false};
 static bool skip_timeout;
+static sandbox_eth_tx_hand_f *tx_handler[8];
+static int recv_queue_depth[8];
+static uint recv_dropped[8];
 
 /*
  * sandbox_eth_disable_response()
@@ -46,13 +59,90 @@ void sandbox_eth_disable_response(int index, bool disable)
 /*
  * sandbox_eth_skip_timeout()
  *
- * When the first packet read is attempted, fast-forward time
+ * When a packet read next finds nothing to receive, fast-forward time
  */
 void sandbox_eth_skip_timeout(void)
 {
 	skip_timeout = true;
 }
 
+/*
+ * sandbox_eth_set_tx_handler()
+ *
+ * index - The alias index (also DM seq number)
+ * handler - Called with every sent packet before the mock responses, NULL
+ *	     to remove it
+ */
+void sandbox_eth_set_tx_handler(int index, sandbox_eth_tx_hand_f *handler)
+{
+	tx_handler[index] = handler;
+}
+
+/*
+ * sandbox_eth_set_recv_queue()
+ *
+ * Limit the number of packets which can wait to be received, as the RX
+ * descriptor ring of a real controller does, and reset the count of packets
+ * dropped because the queue was full
+ *
+ * index - The alias index (also DM seq number)
+ * depth - Maximum number of queued packets, 0 for SANDBOX_ETH_RECV_QUEUE
+ */
+void sandbox_eth_set_recv_queue(int index, int depth)
+{
+	recv_queue_depth[index] = min(depth, SANDBOX_ETH_RECV_QUEUE);
+	recv_dropped[index] = 0;
+}
+
+/*
+ * sandbox_eth_recv_dropped()
+ *
+ * index - The alias index (also DM seq number)
+ * returns the number of packets sandbox_eth_recv_packet() could not queue
+ */
+uint sandbox_eth_recv_dropped(int index)
+{
+	return recv_dropped[index];
+}
+
+/*
+ * sandbox_eth_recv_packet()
+ *
+ * Queue a packet to be returned as received after any mock response
+ *
+ * dev - The sandbox Ethernet device
+ * packet - Packet, starting with the Ethernet header
+ * length - Length of the packet
+ */
+int sandbox_eth_recv_packet(struct udevice *dev, const void *packet,
+			    int length)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	int depth = recv_queue_depth[dev->seq] ?: SANDBOX_ETH_RECV_QUEUE;
+	int slot;
+
+	if (length > PKTSIZE_ALIGN)
+		return -E2BIG;
+	if (priv->recv_queue_count >= depth) {
+		recv_dropped[dev->seq]++;
+		return -ENOSPC;
+	}
+	if (!priv->recv_queue) {
+		priv->recv_queue = malloc(SANDBOX_ETH_RECV_QUEUE *
+					  PKTSIZE_ALIGN);
+		if (!priv->recv_queue)
+			return -ENOMEM;
+	}
+
+	slot = (priv->recv_queue_head + priv->recv_queue_count) %
+		SANDBOX_ETH_RECV_QUEUE;
+	memcpy(priv->recv_queue + slot * PKTSIZE_ALIGN, packet, length);
+	priv->recv_queue_length[slot] = length;
+	priv->recv_queue_count++;
+
+	return 0;
+}
+
 static int sb_eth_start(struct udevice *dev)
 {
 	struct eth_sandbox_priv *priv = dev_get_priv(dev);
@@ -60,6 +150,8 @@ static int sb_eth_start(struct udevice *dev)
 	debug("eth_sandbox: Start\n");
 
 	priv->recv_packet_buffer = net_rx_packets[0];
+	priv->recv_queue_head = 0;
+	priv->recv_queue_count = 0;
 
 	return 0;
 }
@@ -75,6 +167,10 @@ static int sb_eth_send(struct udevice *dev, void *packet, int length)
 	    disabled[dev->seq])
 		return 0;
 
+	if (dev->seq >= 0 && dev->seq < ARRAY_SIZE(tx_handler) &&
+	    tx_handler[dev->seq] && tx_handler[dev->seq](dev, packet, length))
+		return 0;
+
 	if (ntohs(eth->et_protlen) == PROT_ARP) {
 		struct arp_hdr *arp = packet + ETHER_HDR_SIZE;
 
@@ -154,11 +250,6 @@ static int sb_eth_recv(struct udevice *dev, int flags, uchar **packetp)
 {
 	struct eth_sandbox_priv *priv = dev_get_priv(dev);
 
-	if (skip_timeout) {
-		sandbox_timer_add_offset(11000UL);
-		skip_timeout = false;
-	}
-
 	if (priv->recv_packet_length) {
 		int lcl_recv_packet_length = priv->recv_packet_length;
 
@@ -168,6 +259,39 @@ static int sb_eth_recv(struct udevice *dev, int flags, uchar **packetp)
 		*packetp = priv->recv_packet_buffer;
 		return lcl_recv_packet_length;
 	}
+
+	if (priv->recv_queue_count) {
+		int slot = priv->recv_queue_head;
+
+		debug("eth_sandbox: received queued packet %d\n",
+		      priv->recv_queue_length[slot]);
+		*packetp = priv->recv_queue + slot * PKTSIZE_ALIGN;
+		return priv->recv_queue_length[slot];
+	}
+
+	if (skip_timeout) {
+		sandbox_timer_add_offset(11000UL);
+		skip_timeout = false;
+	}
+	return 0;
+}
+
+static int sb_eth_free_pkt(struct udevice *dev, uchar *packet, int length)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+
+	/*
+	 * Queued packets are only released here so that a response queued
+	 * while the packet is processed cannot overwrite it
+	 */
+	if (length > 0 && priv->recv_queue_count &&
+	    packet == priv->recv_queue +
+		      priv->recv_queue_head * PKTSIZE_ALIGN) {
+		priv->recv_queue_head = (priv->recv_queue_head + 1) %
+			SANDBOX_ETH_RECV_QUEUE;
+		priv->recv_queue_count--;
+	}
+
 	return 0;
 }
 
@@ -189,12 +313,18 @@ static const struct eth_ops sb_eth_ops = {
 	.start			= sb_eth_start,
 	.send			= sb_eth_send,
 	.recv			= sb_eth_recv,
+	.free_pkt		= sb_eth_free_pkt,
 	.stop			= sb_eth_stop,
 	.write_hwaddr		= sb_eth_write_hwaddr,
 };
 
 static int sb_eth_remove(struct udevice *dev)
 {
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+
+	free(priv->recv_queue);
+	priv->recv_queue = NULL;
+
 	return 0;
 }
 
@@ -10,6 +10,7 @@
 #include <common.h>
 #include <command.h>
 #include <environment.h>
+#include <env_index.h>
 #include <linux/stddef.h>
 #include <search.h>
 #include <errno.h>
@@ -109,6 +110,7 @@ int set_default_vars(int nvars, char * const vars[], int flags)
 int env_import(const char *buf, int check)
 {
 	env_t *ep = (env_t *)buf;
+	int ret;
 
 	if (check) {
 		uint32_t crc;
@@ -121,8 +123,15 @@ int env_import(const char *buf, int check)
 		}
 	}
 
-	if (himport_r(&env_htab, (char *)ep->data, ENV_SIZE, '\0', 0, 0,
-			0, NULL)) {
+#if CONFIG_IS_ENABLED(ENV_INDEX)
+	/* An indexed environment goes straight into the hash table */
+	if (env_index_is_valid((char *)ep->data, ENV_SIZE))
+		ret = himport_index_r(&env_htab, (char *)ep->data, ENV_SIZE, 0);
+	else
+#endif
+		ret = himport_r(&env_htab, (char *)ep->data, ENV_SIZE, '\0', 0,
+				0, 0, NULL);
+	if (ret) {
 		gd->flags |= GD_FLG_ENV_READY;
 		return 0;
 	}
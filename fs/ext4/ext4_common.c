@@ -19,6 +19,7 @@
  */
 
 #include <common.h>
+#include <div64.h>
 #include <ext_common.h>
 #include <ext4fs.h>
 #include <malloc.h>
@@ -954,6 +955,238 @@ int ext4fs_filename_unlink(char *filename)
 	return -1;
 }
 
+static inline void ext4fs_bg_set_free_blocks(struct ext2_block_group *bg,
+					     const struct ext_filesystem *fs,
+					     uint32_t free_blocks)
+{
+	bg->free_blocks = cpu_to_le16(free_blocks & 0xffff);
+	if (fs->gdsize == 64)
+		bg->free_blocks_high = cpu_to_le16(free_blocks >> 16);
+}
+
+/* Group holding @blknr, and the bit of @blknr in its block bitmap */
+static uint32_t ext4fs_blk_to_group(uint64_t blknr, uint32_t *bit)
+{
+	uint64_t rel = blknr - le32_to_cpu(ext4fs_root->sblock.first_data_block);
+
+	*bit = do_div(rel, le32_to_cpu(ext4fs_root->sblock.blocks_per_group));
+
+	return rel;
+}
+
+static uint64_t ext4fs_group_first_blk(uint32_t bg_idx)
+{
+	return le32_to_cpu(ext4fs_root->sblock.first_data_block) +
+		(uint64_t)bg_idx *
+		le32_to_cpu(ext4fs_root->sblock.blocks_per_group);
+}
+
+/* Number of blocks in a group, the last one may be short */
+static uint32_t ext4fs_group_nblocks(uint32_t bg_idx)
+{
+	uint32_t blk_per_grp =
+		le32_to_cpu(ext4fs_root->sblock.blocks_per_group);
+	uint64_t left = le32_to_cpu(ext4fs_root->sblock.total_blocks) -
+		ext4fs_group_first_blk(bg_idx);
+
+	return min_t(uint64_t, left, blk_per_grp);
+}
+
+static bool ext4fs_bg_has_super(uint32_t bg_idx)
+{
+	static const uint32_t bases[] = { 3, 5, 7 };
+	struct ext_filesystem *fs = get_fs();
+	uint32_t n;
+	int i;
+
+	if (bg_idx <= 1 || !(le32_to_cpu(fs->sb->feature_ro_compat) &
+			     EXT4_FEATURE_RO_COMPAT_SPARSE_SUPER))
+		return true;
+	if (!(bg_idx & 1))
+		return false;
+
+	/* Backups live in the groups that are powers of 3, 5 and 7 */
+	for (i = 0; i < ARRAY_SIZE(bases); i++) {
+		for (n = bases[i]; n < bg_idx; n *= bases[i])
+			;
+		if (n == bg_idx)
+			return true;
+	}
+
+	return false;
+}
+
+static void ext4fs_bmap_set_range(unsigned char *bmap, uint32_t bit,
+				  uint32_t end)
+{
+	for (; bit < end; bit++)
+		bmap[bit >> 3] |= 1 << (bit & 7);
+}
+
+/*
+ * Build the block bitmap of a group flagged EXT4_BG_BLOCK_UNINIT, whose
+ * on-disk bitmap is not valid: only the superblock backup, the descriptor
+ * tables and the bitmaps and inode tables placed in the group are in use.
+ */
+static void ext4fs_init_block_bitmap(uint32_t bg_idx)
+{
+	struct ext_filesystem *fs = get_fs();
+	unsigned char *bmap = fs->blk_bmaps[bg_idx];
+	struct ext2_block_group *bgd;
+	uint64_t first = ext4fs_group_first_blk(bg_idx);
+	uint32_t nblocks = ext4fs_group_nblocks(bg_idx);
+	uint32_t itable_blocks = ext4fs_div_roundup(
+		le32_to_cpu(ext4fs_root->sblock.inodes_per_group) *
+		fs->inodesz, fs->blksz);
+	uint64_t blk[3];
+	uint32_t i, j, len;
+
+	memset(bmap, 0, fs->blksz);
+	if (ext4fs_bg_has_super(bg_idx))
+		ext4fs_bmap_set_range(bmap, 0, 1 + fs->no_blk_pergdt +
+			le16_to_cpu(fs->sb->reserved_gdt_blocks));
+
+	/* With flex_bg, any group may keep its metadata in this one */
+	for (i = 0; i < fs->no_blkgrp; i++) {
+		bgd = ext4fs_get_group_descriptor(fs, i);
+		blk[0] = ext4fs_bg_get_block_id(bgd, fs);
+		blk[1] = ext4fs_bg_get_inode_id(bgd, fs);
+		blk[2] = ext4fs_bg_get_inode_table_id(bgd, fs);
+		for (j = 0; j < ARRAY_SIZE(blk); j++) {
+			len = j == 2 ? itable_blocks : 1;
+			if (blk[j] < first || blk[j] + len > first + nblocks)
+				continue;
+			ext4fs_bmap_set_range(bmap, blk[j] - first,
+					      blk[j] - first + len);
+		}
+	}
+
+	/* Bits past the end of a short last group are always set */
+	ext4fs_bmap_set_range(bmap, nblocks, fs->blksz * 8);
+
+	bgd = ext4fs_get_group_descriptor(fs, bg_idx);
+	ext4fs_bg_set_flags(bgd, ext4fs_bg_get_flags(bgd) &
+			    ~EXT4_BG_BLOCK_UNINIT);
+}
+
+/*
+ * ext4fs_alloc_blocks() - Allocate a run of contiguous blocks
+ *
+ * Looks for free blocks from @goal onwards, wrapping around the end of the
+ * filesystem. Up to @count blocks are taken from the first free run found,
+ * never crossing a group boundary.
+ *
+ * Returns the first block allocated and sets @count to the length of the
+ * run, or returns 0 if the filesystem is full.
+ */
+uint64_t ext4fs_alloc_blocks(uint64_t goal, uint32_t *count)
+{
+	struct ext_filesystem *fs = get_fs();
+	struct ext2_block_group *bgd;
+	unsigned char *bmap;
+	uint32_t bg_idx, bit, nblocks, len, tries;
+	bool logged;
+
+	if (goal < le32_to_cpu(ext4fs_root->sblock.first_data_block) ||
+	    goal >= le32_to_cpu(ext4fs_root->sblock.total_blocks))
+		goal = le32_to_cpu(ext4fs_root->sblock.first_data_block);
+	bg_idx = ext4fs_blk_to_group(goal, &bit);
+
+	/* One extra pass over the goal group for blocks before @goal */
+	for (tries = 0; tries <= fs->no_blkgrp; tries++) {
+		bgd = ext4fs_get_group_descriptor(fs, bg_idx);
+		if (!ext4fs_bg_get_free_blocks(bgd, fs))
+			goto next;
+
+		bmap = fs->blk_bmaps[bg_idx];
+		nblocks = ext4fs_group_nblocks(bg_idx);
+		/*
+		 * An uninitialised bitmap does not mark the group's metadata,
+		 * so it must be built before looking for free blocks in it
+		 */
+		logged = false;
+		if (ext4fs_bg_get_flags(bgd) & EXT4_BG_BLOCK_UNINIT) {
+			if (ext4fs_log_journal((char *)bmap,
+					       ext4fs_bg_get_block_id(bgd, fs)))
+				return 0;
+			ext4fs_init_block_bitmap(bg_idx);
+			logged = true;
+		}
+		while (bit < nblocks) {
+			if (!(bit & 7) && bmap[bit >> 3] == 0xff)
+				bit += 8;
+			else if (bmap[bit >> 3] & (1 << (bit & 7)))
+				bit++;
+			else
+				break;
+		}
+		if (bit >= nblocks)
+			goto next;
+
+		for (len = 1; len < *count && bit + len < nblocks; len++) {
+			if (bmap[(bit + len) >> 3] & (1 << ((bit + len) & 7)))
+				break;
+		}
+
+		/* Keep the original bitmap for the journal */
+		if (!logged && ext4fs_log_journal((char *)bmap,
+						  ext4fs_bg_get_block_id(bgd, fs)))
+			return 0;
+
+		ext4fs_bmap_set_range(bmap, bit, bit + len);
+		ext4fs_bg_set_free_blocks(bgd, fs,
+				ext4fs_bg_get_free_blocks(bgd, fs) - len);
+		ext4fs_sb_set_free_blocks(fs->sb,
+				ext4fs_sb_get_free_blocks(fs->sb) - len);
+
+		*count = len;
+		return ext4fs_group_first_blk(bg_idx) + bit;
+next:
+		bg_idx = (bg_idx + 1) % fs->no_blkgrp;
+		bit = 0;
+	}
+
+	return 0;
+}
+
+/* Release @count blocks starting at @start */
+int ext4fs_free_blocks(uint64_t start, uint32_t count)
+{
+	struct ext_filesystem *fs = get_fs();
+	uint32_t blk_per_grp =
+		le32_to_cpu(ext4fs_root->sblock.blocks_per_group);
+	struct ext2_block_group *bgd;
+	unsigned char *bmap;
+	uint32_t bg_idx, bit, end, freed;
+
+	while (count) {
+		bg_idx = ext4fs_blk_to_group(start, &bit);
+		if (bg_idx >= fs->no_blkgrp)
+			return -EINVAL;
+		end = min(bit + count, blk_per_grp);
+		bgd = ext4fs_get_group_descriptor(fs, bg_idx);
+		bmap = fs->blk_bmaps[bg_idx];
+		if (ext4fs_log_journal((char *)bmap,
+				       ext4fs_bg_get_block_id(bgd, fs)))
+			return -ENOSPC;
+
+		start += end - bit;
+		count -= end - bit;
+		for (freed = 0; bit < end; bit++) {
+			if (bmap[bit >> 3] & (1 << (bit & 7))) {
+				bmap[bit >> 3] &= ~(1 << (bit & 7));
+				freed++;
+			}
+		}
+		ext4fs_bg_set_free_blocks(bgd, fs,
+				ext4fs_bg_get_free_blocks(bgd, fs) + freed);
+		ext4fs_sb_set_free_blocks(fs->sb,
+				ext4fs_sb_get_free_blocks(fs->sb) + freed);
+	}
+
+	return 0;
+}
+
 uint32_t ext4fs_get_new_blk_no(void)
 {
 	short i;
@@ -964,8 +1197,7 @@ uint32_t ext4fs_get_new_blk_no(void)
 	unsigned int blk_per_grp = le32_to_cpu(ext4fs_root->sblock.blocks_per_group);
 	struct ext_filesystem *fs = get_fs();
 	char *journal_buffer = zalloc(fs->blksz);
-	char *zero_buffer = zalloc(fs->blksz);
-	if (!journal_buffer || !zero_buffer)
+	if (!journal_buffer)
 		goto fail;
 
 	if (fs->first_pass_bbmap == 0) {
@@ -976,14 +1208,8 @@ uint32_t ext4fs_get_new_blk_no(void)
 				uint16_t bg_flags = ext4fs_bg_get_flags(bgd);
 				uint64_t b_bitmap_blk =
 					ext4fs_bg_get_block_id(bgd, fs);
-				if (bg_flags & EXT4_BG_BLOCK_UNINIT) {
-					memcpy(fs->blk_bmaps[i], zero_buffer,
-					       fs->blksz);
-					put_ext4(b_bitmap_blk * fs->blksz,
-						 fs->blk_bmaps[i], fs->blksz);
-					bg_flags &= ~EXT4_BG_BLOCK_UNINIT;
-					ext4fs_bg_set_flags(bgd, bg_flags);
-				}
+				if (bg_flags & EXT4_BG_BLOCK_UNINIT)
+					ext4fs_init_block_bitmap(i);
 				fs->curr_blkno =
 				    _get_new_blk_no(fs->blk_bmaps[i]);
 				if (fs->curr_blkno == -1)
@@ -1040,13 +1266,8 @@ restart:
 
 		uint16_t bg_flags = ext4fs_bg_get_flags(bgd);
 		uint64_t b_bitmap_blk = ext4fs_bg_get_block_id(bgd, fs);
-		if (bg_flags & EXT4_BG_BLOCK_UNINIT) {
-			memcpy(fs->blk_bmaps[bg_idx], zero_buffer, fs->blksz);
-			put_ext4(b_bitmap_blk * fs->blksz,
-				 zero_buffer, fs->blksz);
-			bg_flags &= ~EXT4_BG_BLOCK_UNINIT;
-			ext4fs_bg_set_flags(bgd, bg_flags);
-		}
+		if (bg_flags & EXT4_BG_BLOCK_UNINIT)
+			ext4fs_init_block_bitmap(bg_idx);
 
 		if (ext4fs_set_block_bmap(fs->curr_blkno, fs->blk_bmaps[bg_idx],
 				   bg_idx) != 0) {
@@ -1073,12 +1294,10 @@ restart:
 	}
 success:
 	free(journal_buffer);
-	free(zero_buffer);
 
 	return fs->curr_blkno;
 fail:
 	free(journal_buffer);
-	free(zero_buffer);
 
 	return -1;
 }
@@ -2003,77 +2222,71 @@ void ext4fs_close(void)
 	ext4fs_reinit_global();
 }
 
-int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
-				struct ext2fs_node **fnode, int *ftype)
+/*
+ * Parse the directory entries held in @block, which contains @len bytes of
+ * directory @diro. Looks up @name if it is given, otherwise lists every
+ * entry.
+ *
+ * Returns 1 if @name was found, 0 if not (or when listing), -1 on error.
+ */
+int ext4fs_scan_dir_block(struct ext2fs_node *diro, const char *block,
+			  unsigned int len, const char *name,
+			  struct ext2fs_node **fnode, int *ftype)
 {
 	unsigned int fpos = 0;
 	int status;
-	loff_t actread;
-	struct ext2fs_node *diro = (struct ext2fs_node *) dir;
 
-#ifdef DEBUG
-	if (name != NULL)
-		printf("Iterate dir %s\n", name);
-#endif /* of DEBUG */
-	if (!diro->inode_read) {
-		status = ext4fs_read_inode(diro->data, diro->ino, &diro->inode);
-		if (status == 0)
-			return 0;
-	}
-	/* Search the file.  */
-	while (fpos < le32_to_cpu(diro->inode.size)) {
-		struct ext2_dirent dirent;
-
-		status = ext4fs_read_file(diro, fpos,
-					   sizeof(struct ext2_dirent),
-					   (char *)&dirent, &actread);
-		if (status < 0)
-			return 0;
+	while (fpos + sizeof(struct ext2_dirent) <= len) {
+		const struct ext2_dirent *dirent =
+			(const struct ext2_dirent *)(block + fpos);
+		unsigned int direntlen = le16_to_cpu(dirent->direntlen);
 
-		if (dirent.direntlen == 0) {
-			printf("Failed to iterate over directory %s\n", name);
-			return 0;
+		if (direntlen < sizeof(struct ext2_dirent) ||
+		    fpos + direntlen > len ||
+		    sizeof(struct ext2_dirent) + dirent->namelen > direntlen) {
+			printf("Corrupted entry in directory inode %d\n",
+			       diro->ino);
+			return -1;
 		}
 
-		if (dirent.namelen != 0) {
-			char filename[dirent.namelen + 1];
+		if (dirent->namelen != 0 && dirent->inode != 0) {
+			char filename[dirent->namelen + 1];
 			struct ext2fs_node *fdiro;
 			int type = FILETYPE_UNKNOWN;
 
-			status = ext4fs_read_file(diro,
-						  fpos +
-						  sizeof(struct ext2_dirent),
-						  dirent.namelen, filename,
-						  &actread);
-			if (status < 0)
-				return 0;
+			memcpy(filename, dirent + 1, dirent->namelen);
+			filename[dirent->namelen] = '\0';
+
+			/* Only allocate a node for the entry we care about */
+			if (name && strcmp(filename, name)) {
+				fpos += direntlen;
+				continue;
+			}
 
 			fdiro = zalloc(sizeof(struct ext2fs_node));
 			if (!fdiro)
-				return 0;
+				return -1;
 
 			fdiro->data = diro->data;
-			fdiro->ino = le32_to_cpu(dirent.inode);
+			fdiro->ino = le32_to_cpu(dirent->inode);
 
-			filename[dirent.namelen] = '\0';
-
-			if (dirent.filetype != FILETYPE_UNKNOWN) {
+			if (dirent->filetype != FILETYPE_UNKNOWN) {
 				fdiro->inode_read = 0;
 
-				if (dirent.filetype == FILETYPE_DIRECTORY)
+				if (dirent->filetype == FILETYPE_DIRECTORY)
 					type = FILETYPE_DIRECTORY;
-				else if (dirent.filetype == FILETYPE_SYMLINK)
+				else if (dirent->filetype == FILETYPE_SYMLINK)
 					type = FILETYPE_SYMLINK;
-				else if (dirent.filetype == FILETYPE_REG)
+				else if (dirent->filetype == FILETYPE_REG)
 					type = FILETYPE_REG;
 			} else {
 				status = ext4fs_read_inode(diro->data,
 							   le32_to_cpu
-							   (dirent.inode),
+							   (dirent->inode),
 							   &fdiro->inode);
 				if (status == 0) {
 					free(fdiro);
-					return 0;
+					return -1;
 				}
 				fdiro->inode_read = 1;
 
@@ -2094,50 +2307,114 @@ int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 #ifdef DEBUG
 			printf("iterate >%s<\n", filename);
 #endif /* of DEBUG */
-			if ((name != NULL) && (fnode != NULL)
-			    && (ftype != NULL)) {
-				if (strcmp(filename, name) == 0) {
-					*ftype = type;
-					*fnode = fdiro;
-					return 1;
-				}
-			} else {
-				if (fdiro->inode_read == 0) {
-					status = ext4fs_read_inode(diro->data,
-								 le32_to_cpu(
-								 dirent.inode),
-								 &fdiro->inode);
-					if (status == 0) {
-						free(fdiro);
-						return 0;
-					}
-					fdiro->inode_read = 1;
-				}
-				switch (type) {
-				case FILETYPE_DIRECTORY:
-					printf("<DIR> ");
-					break;
-				case FILETYPE_SYMLINK:
-					printf("<SYM> ");
-					break;
-				case FILETYPE_REG:
-					printf("      ");
-					break;
-				default:
-					printf("< ? > ");
-					break;
+			if (name) {
+				*ftype = type;
+				*fnode = fdiro;
+				return 1;
+			}
+
+			if (fdiro->inode_read == 0) {
+				status = ext4fs_read_inode(diro->data,
+							   le32_to_cpu(
+							   dirent->inode),
+							   &fdiro->inode);
+				if (status == 0) {
+					free(fdiro);
+					return -1;
 				}
-				printf("%10u %s\n",
-				       le32_to_cpu(fdiro->inode.size),
-					filename);
+				fdiro->inode_read = 1;
+			}
+			switch (type) {
+			case FILETYPE_DIRECTORY:
+				printf("<DIR> ");
+				break;
+			case FILETYPE_SYMLINK:
+				printf("<SYM> ");
+				break;
+			case FILETYPE_REG:
+				printf("      ");
+				break;
+			default:
+				printf("< ? > ");
+				break;
 			}
+			printf("%10u %s\n",
+			       le32_to_cpu(fdiro->inode.size),
+				filename);
 			free(fdiro);
 		}
-		fpos += le16_to_cpu(dirent.direntlen);
+		fpos += direntlen;
 	}
+
 	return 0;
 }
 
+int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
+				struct ext2fs_node **fnode, int *ftype)
+{
+	unsigned int fpos = 0;
+	unsigned int blocksize, dirsize, len;
+	int status;
+	loff_t actread;
+	char *block;
+	struct ext2fs_node *diro = (struct ext2fs_node *) dir;
+
+#ifdef DEBUG
+	if (name != NULL)
+		printf("Iterate dir %s\n", name);
+#endif /* of DEBUG */
+	if (!diro->inode_read) {
+		status = ext4fs_read_inode(diro->data, diro->ino, &diro->inode);
+		if (status == 0)
+			return 0;
+	}
+
+	/* Lookups only; listing passes no name */
+	if (name == NULL || fnode == NULL || ftype == NULL) {
+		name = NULL;
+	} else {
+		if (ext4fs_dcache_lookup(diro, name, fnode, ftype))
+			return 1;
+
+		status = ext4fs_htree_lookup(diro, name, fnode, ftype);
+		if (status >= 0)
+			goto found;
+		/* No usable index, fall back to a linear scan */
+	}
+
+	blocksize = EXT2_BLOCK_SIZE(diro->data);
+	dirsize = le32_to_cpu(diro->inode.size);
+	block = memalign(ARCH_DMA_MINALIGN, blocksize);
+	if (!block)
+		return 0;
+
+	/* Search the file, one directory block at a time.  */
+	status = 0;
+	while (fpos < dirsize) {
+		len = min(blocksize, dirsize - fpos);
+		if (ext4fs_read_file(diro, fpos, len, block, &actread) < 0 ||
+		    actread != len) {
+			status = -1;
+			break;
+		}
+
+		status = ext4fs_scan_dir_block(diro, block, len, name, fnode,
+					       ftype);
+		if (status)
+			break;
+		fpos += len;
+	}
+	free(block);
+
+found:
+	if (status != 1)
+		return 0;
+
+	ext4fs_dcache_add(diro, name, (*fnode)->ino, *ftype);
+
+	return 1;
+}
+
 static char *ext4fs_read_symlink(struct ext2fs_node *node)
 {
 	char *symlink;
@@ -2372,6 +2649,7 @@ int ext4fs_mount(unsigned part_length)
 	if (status == 0)
 		goto fail;
 
+	ext4fs_dcache_validate(&data->sblock);
 	ext4fs_root = data;
 
 	return 1;
@@ -55,6 +55,50 @@ int ext4fs_find_file(const char *path, struct ext2fs_node *rootnode,
 			struct ext2fs_node **foundnode, int expecttype);
 int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 			struct ext2fs_node **fnode, int *ftype);
+int ext4fs_scan_dir_block(struct ext2fs_node *diro, const char *block,
+			  unsigned int len, const char *name,
+			  struct ext2fs_node **fnode, int *ftype);
+
+#ifdef CONFIG_EXT4_DIR_INDEX
+int ext4fs_htree_lookup(struct ext2fs_node *dir, const char *name,
+			struct ext2fs_node **fnode, int *ftype);
+#else
+static inline int ext4fs_htree_lookup(struct ext2fs_node *dir,
+				      const char *name,
+				      struct ext2fs_node **fnode, int *ftype)
+{
+	return -1;
+}
+#endif
+
+#ifdef CONFIG_EXT4_DENTRY_CACHE
+int ext4fs_dcache_lookup(struct ext2fs_node *dir, const char *name,
+			 struct ext2fs_node **fnode, int *ftype);
+void ext4fs_dcache_add(struct ext2fs_node *dir, const char *name, int ino,
+		       int type);
+void ext4fs_dcache_validate(const struct ext2_sblock *sblock);
+void ext4fs_dcache_flush(void);
+#else
+static inline int ext4fs_dcache_lookup(struct ext2fs_node *dir,
+				       const char *name,
+				       struct ext2fs_node **fnode, int *ftype)
+{
+	return 0;
+}
+
+static inline void ext4fs_dcache_add(struct ext2fs_node *dir,
+				     const char *name, int ino, int type)
+{
+}
+
+static inline void ext4fs_dcache_validate(const struct ext2_sblock *sblock)
+{
+}
+
+static inline void ext4fs_dcache_flush(void)
+{
+}
+#endif
 
 #if defined(CONFIG_EXT4_WRITE)
 uint32_t ext4fs_div_roundup(uint32_t size, uint32_t n);
@@ -62,6 +106,8 @@ uint16_t ext4fs_checksum_update(unsigned int i);
 int ext4fs_get_parent_inode_num(const char *dirname, char *dname, int flags);
 int ext4fs_update_parent_dentry(char *filename, int file_type);
 uint32_t ext4fs_get_new_blk_no(void);
+uint64_t ext4fs_alloc_blocks(uint64_t goal, uint32_t *count);
+int ext4fs_free_blocks(uint64_t start, uint32_t count);
 int ext4fs_get_new_inode_no(void);
 void ext4fs_reset_block_bmap(long int blockno, unsigned char *buffer,
 					int index);
@@ -0,0 +1,103 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Directory entry cache for ext4 path lookups
+ *
+ * Every fs command probes and mounts the filesystem afresh, so resolving
+ * the same path twice (e.g. "size" followed by "load") walks all of its
+ * directories twice. This direct-mapped cache keeps the result of recent
+ * (directory, name) lookups across mounts of the same filesystem. It is
+ * dropped when a different device, partition or superblock is mounted and
+ * whenever the filesystem is written.
+ */
+
+#include <common.h>
+#include <ext_common.h>
+#include <ext4fs.h>
+#include <malloc.h>
+#include "ext4_common.h"
+
+#define EXT4_DCACHE_NAME_LEN	44
+
+struct ext4_dcache_entry {
+	int parent;		/* inode of the directory, 0 if unused */
+	int ino;
+	int type;
+	char name[EXT4_DCACHE_NAME_LEN];
+};
+
+static struct ext4_dcache_entry ext4_dcache[CONFIG_EXT4_DENTRY_CACHE_SIZE];
+
+/* The filesystem the cached entries belong to */
+static struct {
+	struct blk_desc *dev_desc;
+	lbaint_t part_offset;
+	struct ext2_sblock sblock;
+} ext4_dcache_fs;
+
+static struct ext4_dcache_entry *ext4fs_dcache_slot(int parent,
+						    const char *name)
+{
+	u32 hash = parent * 0x9e3779b1;
+
+	while (*name)
+		hash = (hash ^ (u8)*name++) * 0x01000193;
+
+	return &ext4_dcache[hash % CONFIG_EXT4_DENTRY_CACHE_SIZE];
+}
+
+int ext4fs_dcache_lookup(struct ext2fs_node *dir, const char *name,
+			 struct ext2fs_node **fnode, int *ftype)
+{
+	struct ext4_dcache_entry *entry = ext4fs_dcache_slot(dir->ino, name);
+	struct ext2fs_node *fdiro;
+
+	if (entry->parent != dir->ino || strcmp(entry->name, name))
+		return 0;
+
+	fdiro = zalloc(sizeof(struct ext2fs_node));
+	if (!fdiro)
+		return 0;
+
+	fdiro->data = dir->data;
+	fdiro->ino = entry->ino;
+	*fnode = fdiro;
+	*ftype = entry->type;
+
+	return 1;
+}
+
+void ext4fs_dcache_add(struct ext2fs_node *dir, const char *name, int ino,
+		       int type)
+{
+	struct ext4_dcache_entry *entry;
+
+	if (strlen(name) >= EXT4_DCACHE_NAME_LEN)
+		return;
+
+	entry = ext4fs_dcache_slot(dir->ino, name);
+	entry->parent = dir->ino;
+	entry->ino = ino;
+	entry->type = type;
+	strcpy(entry->name, name);
+}
+
+void ext4fs_dcache_flush(void)
+{
+	memset(ext4_dcache, 0, sizeof(ext4_dcache));
+	memset(&ext4_dcache_fs, 0, sizeof(ext4_dcache_fs));
+}
+
+void ext4fs_dcache_validate(const struct ext2_sblock *sblock)
+{
+	struct ext_filesystem *fs = get_fs();
+
+	if (ext4_dcache_fs.dev_desc == fs->dev_desc &&
+	    ext4_dcache_fs.part_offset == part_offset &&
+	    !memcmp(&ext4_dcache_fs.sblock, sblock, sizeof(*sblock)))
+		return;
+
+	ext4fs_dcache_flush();
+	ext4_dcache_fs.dev_desc = fs->dev_desc;
+	ext4_dcache_fs.part_offset = part_offset;
+	memcpy(&ext4_dcache_fs.sblock, sblock, sizeof(*sblock));
+}
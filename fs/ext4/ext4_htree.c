@@ -0,0 +1,371 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Hashed directory (htree) lookups for ext4
+ *
+ * Directories with the EXT4_INDEX_FL flag carry a hash tree in their first
+ * blocks, which maps the hash of a name to the single leaf block that can
+ * hold it. Walking it turns a lookup in a directory with many thousands of
+ * entries into a handful of block reads instead of a scan of every block.
+ *
+ * The hash functions are taken from the Linux kernel (fs/ext4/hash.c):
+ * Copyright (C) 2002 by Theodore Ts'o
+ */
+
+#include <common.h>
+#include <ext_common.h>
+#include <ext4fs.h>
+#include <malloc.h>
+#include <memalign.h>
+#include "ext4_common.h"
+
+#define EXT4_FEATURE_COMPAT_DIR_INDEX	0x0020
+#define EXT2_FLAGS_UNSIGNED_HASH	0x0002
+
+#define DX_HASH_LEGACY			0
+#define DX_HASH_HALF_MD4		1
+#define DX_HASH_TEA			2
+#define DX_HASH_LEGACY_UNSIGNED		3
+#define DX_HASH_HALF_MD4_UNSIGNED	4
+#define DX_HASH_TEA_UNSIGNED		5
+
+#define EXT4_HTREE_LEVEL		3
+#define EXT4_HTREE_EOF_32BIT		0x7fffffff
+
+/* Follows the fake "." and ".." entries of the first directory block */
+struct dx_root_info {
+	__le32 reserved_zero;
+	u8 hash_version;
+	u8 info_length;
+	u8 indirect_levels;
+	u8 unused_flags;
+};
+
+struct dx_entry {
+	__le32 hash;
+	__le32 block;
+};
+
+/* Overlays the hash of the first dx_entry of each index node */
+struct dx_countlimit {
+	__le16 limit;
+	__le16 count;
+};
+
+/* Offset of the root info and of the entries in non-root index nodes */
+#define DX_ROOT_INFO_OFFSET	24
+#define DX_NODE_OFFSET		8
+
+#define DELTA 0x9E3779B9
+
+static void TEA_transform(u32 buf[4], const u32 in[])
+{
+	u32 sum = 0;
+	u32 b0 = buf[0], b1 = buf[1];
+	u32 a = in[0], b = in[1], c = in[2], d = in[3];
+	int n = 16;
+
+	do {
+		sum += DELTA;
+		b0 += ((b1 << 4) + a) ^ (b1 + sum) ^ ((b1 >> 5) + b);
+		b1 += ((b0 << 4) + c) ^ (b0 + sum) ^ ((b0 >> 5) + d);
+	} while (--n);
+
+	buf[0] += b0;
+	buf[1] += b1;
+}
+
+/* F, G and H are basic MD4 functions: selection, majority, parity */
+#define F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define G(x, y, z) (((x) & (y)) + (((x) ^ (y)) & (z)))
+#define H(x, y, z) ((x) ^ (y) ^ (z))
+
+#define MD4_ROUND(f, a, b, c, d, x, s)	\
+	(a += f(b, c, d) + x, a = ((a) << (s)) | ((a) >> (32 - (s))))
+#define K1 0
+#define K2 013240474631UL
+#define K3 015666365641UL
+
+static void half_md4_transform(u32 buf[4], const u32 in[8])
+{
+	u32 a = buf[0], b = buf[1], c = buf[2], d = buf[3];
+
+	/* Round 1 */
+	MD4_ROUND(F, a, b, c, d, in[0] + K1,  3);
+	MD4_ROUND(F, d, a, b, c, in[1] + K1,  7);
+	MD4_ROUND(F, c, d, a, b, in[2] + K1, 11);
+	MD4_ROUND(F, b, c, d, a, in[3] + K1, 19);
+	MD4_ROUND(F, a, b, c, d, in[4] + K1,  3);
+	MD4_ROUND(F, d, a, b, c, in[5] + K1,  7);
+	MD4_ROUND(F, c, d, a, b, in[6] + K1, 11);
+	MD4_ROUND(F, b, c, d, a, in[7] + K1, 19);
+
+	/* Round 2 */
+	MD4_ROUND(G, a, b, c, d, in[1] + K2,  3);
+	MD4_ROUND(G, d, a, b, c, in[3] + K2,  5);
+	MD4_ROUND(G, c, d, a, b, in[5] + K2,  9);
+	MD4_ROUND(G, b, c, d, a, in[7] + K2, 13);
+	MD4_ROUND(G, a, b, c, d, in[0] + K2,  3);
+	MD4_ROUND(G, d, a, b, c, in[2] + K2,  5);
+	MD4_ROUND(G, c, d, a, b, in[4] + K2,  9);
+	MD4_ROUND(G, b, c, d, a, in[6] + K2, 13);
+
+	/* Round 3 */
+	MD4_ROUND(H, a, b, c, d, in[3] + K3,  3);
+	MD4_ROUND(H, d, a, b, c, in[7] + K3,  9);
+	MD4_ROUND(H, c, d, a, b, in[2] + K3, 11);
+	MD4_ROUND(H, b, c, d, a, in[6] + K3, 15);
+	MD4_ROUND(H, a, b, c, d, in[1] + K3,  3);
+	MD4_ROUND(H, d, a, b, c, in[5] + K3,  9);
+	MD4_ROUND(H, c, d, a, b, in[0] + K3, 11);
+	MD4_ROUND(H, b, c, d, a, in[4] + K3, 15);
+
+	buf[0] += a;
+	buf[1] += b;
+	buf[2] += c;
+	buf[3] += d;
+}
+
+/* The old legacy hash */
+static u32 dx_hack_hash(const char *name, int len, bool is_unsigned)
+{
+	u32 hash, hash0 = 0x12a3fe2d, hash1 = 0x37abe8f9;
+	int c;
+
+	while (len--) {
+		c = is_unsigned ? (int)(unsigned char)*name :
+				  (int)(signed char)*name;
+		name++;
+		hash = hash1 + (hash0 ^ (c * 7152373));
+
+		if (hash & 0x80000000)
+			hash -= 0x7fffffff;
+		hash1 = hash0;
+		hash0 = hash;
+	}
+
+	return hash0 << 1;
+}
+
+static void str2hashbuf(const char *msg, int len, u32 *buf, int num,
+			bool is_unsigned)
+{
+	u32 pad, val;
+	int i, c;
+
+	pad = (u32)len | ((u32)len << 8);
+	pad |= pad << 16;
+
+	val = pad;
+	if (len > num * 4)
+		len = num * 4;
+	for (i = 0; i < len; i++) {
+		c = is_unsigned ? (int)(unsigned char)msg[i] :
+				  (int)(signed char)msg[i];
+		val = c + (val << 8);
+		if ((i % 4) == 3) {
+			*buf++ = val;
+			val = pad;
+			num--;
+		}
+	}
+	if (--num >= 0)
+		*buf++ = val;
+	while (--num >= 0)
+		*buf++ = pad;
+}
+
+static int ext4fs_dirhash(const char *name, int len, int version,
+			  const __le32 *seed, u32 *hashp)
+{
+	u32 hash, in[8], buf[4];
+	bool is_unsigned = false;
+	int i;
+
+	/* Initialize the default seed for the hash checksum functions */
+	buf[0] = 0x67452301;
+	buf[1] = 0xefcdab89;
+	buf[2] = 0x98badcfe;
+	buf[3] = 0x10325476;
+
+	/* Use the filesystem seed unless it is all zeroes */
+	for (i = 0; i < 4; i++) {
+		if (seed[i]) {
+			for (i = 0; i < 4; i++)
+				buf[i] = le32_to_cpu(seed[i]);
+			break;
+		}
+	}
+
+	switch (version) {
+	case DX_HASH_LEGACY_UNSIGNED:
+		is_unsigned = true;
+		/* fall through */
+	case DX_HASH_LEGACY:
+		hash = dx_hack_hash(name, len, is_unsigned);
+		break;
+	case DX_HASH_HALF_MD4_UNSIGNED:
+		is_unsigned = true;
+		/* fall through */
+	case DX_HASH_HALF_MD4:
+		while (len > 0) {
+			str2hashbuf(name, len, in, 8, is_unsigned);
+			half_md4_transform(buf, in);
+			len -= 32;
+			name += 32;
+		}
+		hash = buf[1];
+		break;
+	case DX_HASH_TEA_UNSIGNED:
+		is_unsigned = true;
+		/* fall through */
+	case DX_HASH_TEA:
+		while (len > 0) {
+			str2hashbuf(name, len, in, 4, is_unsigned);
+			TEA_transform(buf, in);
+			len -= 16;
+			name += 16;
+		}
+		hash = buf[0];
+		break;
+	default:
+		debug("%s: unknown hash version %d\n", __func__, version);
+		return -1;
+	}
+
+	hash = hash & ~1;
+	if (hash == (EXT4_HTREE_EOF_32BIT << 1))
+		hash = (EXT4_HTREE_EOF_32BIT - 1) << 1;
+	*hashp = hash;
+
+	return 0;
+}
+
+static int ext4fs_htree_read_block(struct ext2fs_node *dir, u32 block,
+				   char *buf)
+{
+	unsigned int blocksize = EXT2_BLOCK_SIZE(dir->data);
+	loff_t pos = (loff_t)block * blocksize;
+	loff_t actread;
+
+	if (pos + blocksize > le32_to_cpu(dir->inode.size))
+		return -1;
+	if (ext4fs_read_file(dir, pos, blocksize, buf, &actread) < 0 ||
+	    actread != blocksize)
+		return -1;
+
+	return 0;
+}
+
+/* Find the last entry whose hash is not above @hash */
+static struct dx_entry *dx_search(struct dx_entry *entries, u32 count,
+				  u32 hash)
+{
+	struct dx_entry *p = entries + 1, *q = entries + count - 1, *m;
+
+	while (p <= q) {
+		m = p + (q - p) / 2;
+		if (le32_to_cpu(m->hash) > hash)
+			q = m - 1;
+		else
+			p = m + 1;
+	}
+
+	return p - 1;
+}
+
+/*
+ * ext4fs_htree_lookup() - Look up @name through the hash index of @dir
+ *
+ * Returns 1 if found (with @fnode and @ftype set), 0 if the name is not in
+ * the directory, or -1 if the directory has no usable index and must be
+ * scanned linearly.
+ */
+int ext4fs_htree_lookup(struct ext2fs_node *dir, const char *name,
+			struct ext2fs_node **fnode, int *ftype)
+{
+	struct ext2_sblock *sb = &dir->data->sblock;
+	unsigned int blocksize = EXT2_BLOCK_SIZE(dir->data);
+	struct dx_root_info *info;
+	struct dx_countlimit *cl;
+	struct dx_entry *entries, *at;
+	u32 hash, count, limit, block, level, levels, idx;
+	char *node, *leaf;
+	int version, status = -1;
+
+	if (!(le32_to_cpu(sb->feature_compatibility) &
+	      EXT4_FEATURE_COMPAT_DIR_INDEX) ||
+	    !(le32_to_cpu(dir->inode.flags) & EXT4_INDEX_FL))
+		return -1;
+
+	node = memalign(ARCH_DMA_MINALIGN, blocksize);
+	leaf = memalign(ARCH_DMA_MINALIGN, blocksize);
+	if (!node || !leaf)
+		goto out;
+
+	if (ext4fs_htree_read_block(dir, 0, node))
+		goto out;
+
+	info = (struct dx_root_info *)(node + DX_ROOT_INFO_OFFSET);
+	if (info->reserved_zero || info->info_length < sizeof(*info) ||
+	    info->indirect_levels >= EXT4_HTREE_LEVEL)
+		goto out;
+
+	version = info->hash_version;
+	if (version <= DX_HASH_TEA &&
+	    (le32_to_cpu(sb->flags) & EXT2_FLAGS_UNSIGNED_HASH))
+		version += DX_HASH_LEGACY_UNSIGNED;
+	if (ext4fs_dirhash(name, strlen(name), version, sb->hash_seed, &hash))
+		goto out;
+
+	levels = info->indirect_levels;
+	entries = (struct dx_entry *)((char *)info + info->info_length);
+	for (level = 0; ; level++) {
+		cl = (struct dx_countlimit *)entries;
+		count = le16_to_cpu(cl->count);
+		limit = le16_to_cpu(cl->limit);
+		if (!count || count > limit ||
+		    (char *)(entries + limit) > node + blocksize)
+			goto out;
+
+		at = dx_search(entries, count, hash);
+		block = le32_to_cpu(at->block) & 0x0fffffff;
+		if (level == levels)
+			break;
+
+		if (ext4fs_htree_read_block(dir, block, node))
+			goto out;
+		entries = (struct dx_entry *)(node + DX_NODE_OFFSET);
+	}
+
+	idx = at - entries;
+	for (;;) {
+		if (ext4fs_htree_read_block(dir, block, leaf)) {
+			status = -1;
+			break;
+		}
+
+		status = ext4fs_scan_dir_block(dir, leaf, blocksize, name,
+					       fnode, ftype);
+		if (status)
+			break;
+
+		/*
+		 * On hash collisions the entries continue in the next leaf,
+		 * which is flagged by the next index entry having the same
+		 * hash. Past the end of a non-root node, let the caller scan.
+		 */
+		if (++idx >= count) {
+			status = levels ? -1 : 0;
+			break;
+		}
+		if ((le32_to_cpu(entries[idx].hash) & ~1) != hash)
+			break;
+		block = le32_to_cpu(entries[idx].block) & 0x0fffffff;
+	}
+
+out:
+	free(leaf);
+	free(node);
+
+	return status;
+}
@@ -25,8 +25,16 @@
 #include <memalign.h>
 #include <linux/stat.h>
 #include <div64.h>
+#include <linux/sizes.h>
 #include "ext4_common.h"
 
+/* Upper bound on the groups whose bitmaps are moved in one request */
+#define EXT4_BITMAPS_IO_MAX	256
+/* Longest initialized extent */
+#define EXT4_EXT_INIT_MAX_LEN	(1 << 15)
+/* Upper bound on the bytes of file data written in one request */
+#define EXT4_WRITE_BATCH_MAX	SZ_1G
+
 static inline void ext4fs_sb_free_inodes_inc(struct ext2_sblock *sb)
 {
 	sb->free_inodes = cpu_to_le32(le32_to_cpu(sb->free_inodes) + 1);
@@ -63,6 +71,64 @@ static inline void ext4fs_bg_free_blocks_inc
 		bg->free_blocks_high = cpu_to_le16(free_blocks >> 16);
 }
 
+/*
+ * Read or write the block (or inode) bitmaps of all groups. They are kept
+ * in a single buffer, and with flex_bg the bitmaps of consecutive groups
+ * are also consecutive on disk, so each such run is one device request.
+ */
+static int ext4fs_bitmaps_io(unsigned char **bmaps, bool inode_bmaps,
+			     bool write)
+{
+	struct ext_filesystem *fs = get_fs();
+	struct ext2_block_group *bgd;
+	uint64_t blk;
+	uint32_t i, n;
+
+	for (i = 0; i < fs->no_blkgrp; i += n) {
+		bgd = ext4fs_get_group_descriptor(fs, i);
+		blk = inode_bmaps ? ext4fs_bg_get_inode_id(bgd, fs) :
+				    ext4fs_bg_get_block_id(bgd, fs);
+		for (n = 1; i + n < fs->no_blkgrp &&
+		     n < EXT4_BITMAPS_IO_MAX; n++) {
+			bgd = ext4fs_get_group_descriptor(fs, i + n);
+			if ((inode_bmaps ? ext4fs_bg_get_inode_id(bgd, fs) :
+					   ext4fs_bg_get_block_id(bgd, fs)) !=
+			    blk + n)
+				break;
+		}
+
+		if (write) {
+			put_ext4(blk * fs->blksz, bmaps[i], n * fs->blksz);
+		} else if (!ext4fs_devread(blk * fs->sect_perblk, 0,
+					   n * fs->blksz, (char *)bmaps[i])) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* Allocate the bitmaps of all groups as one buffer */
+static unsigned char **ext4fs_alloc_bitmaps(void)
+{
+	struct ext_filesystem *fs = get_fs();
+	unsigned char **bmaps;
+	uint32_t i;
+
+	bmaps = zalloc(fs->no_blkgrp * sizeof(unsigned char *));
+	if (!bmaps)
+		return NULL;
+	bmaps[0] = zalloc(fs->no_blkgrp * fs->blksz);
+	if (!bmaps[0]) {
+		free(bmaps);
+		return NULL;
+	}
+	for (i = 1; i < fs->no_blkgrp; i++)
+		bmaps[i] = bmaps[0] + i * fs->blksz;
+
+	return bmaps;
+}
+
 static void ext4fs_update(void)
 {
 	short i;
@@ -74,22 +140,13 @@ static void ext4fs_update(void)
 	put_ext4((uint64_t)(SUPERBLOCK_SIZE),
 		 (struct ext2_sblock *)fs->sb, (uint32_t)SUPERBLOCK_SIZE);
 
-	/* update block bitmaps */
+	/* update block and inode bitmaps */
 	for (i = 0; i < fs->no_blkgrp; i++) {
 		bgd = ext4fs_get_group_descriptor(fs, i);
 		bgd->bg_checksum = cpu_to_le16(ext4fs_checksum_update(i));
-		uint64_t b_bitmap_blk = ext4fs_bg_get_block_id(bgd, fs);
-		put_ext4(b_bitmap_blk * fs->blksz,
-			 fs->blk_bmaps[i], fs->blksz);
-	}
-
-	/* update inode bitmaps */
-	for (i = 0; i < fs->no_blkgrp; i++) {
-		bgd = ext4fs_get_group_descriptor(fs, i);
-		uint64_t i_bitmap_blk = ext4fs_bg_get_inode_id(bgd, fs);
-		put_ext4(i_bitmap_blk * fs->blksz,
-			 fs->inode_bmaps[i], fs->blksz);
 	}
+	ext4fs_bitmaps_io(fs->blk_bmaps, false, true);
+	ext4fs_bitmaps_io(fs->inode_bmaps, true, true);
 
 	/* update the block group descriptor table */
 	put_ext4((uint64_t)((uint64_t)fs->gdtable_blkno * (uint64_t)fs->blksz),
@@ -431,6 +488,66 @@ fail:
 	free(journal_buffer);
 }
 
+static uint64_t ext4fs_ext_pblk(const struct ext4_extent *ext)
+{
+	return ((uint64_t)le16_to_cpu(ext->ee_start_hi) << 32) +
+		le32_to_cpu(ext->ee_start_lo);
+}
+
+static uint64_t ext4fs_idx_pblk(const struct ext4_extent_idx *idx)
+{
+	return ((uint64_t)le16_to_cpu(idx->ei_leaf_hi) << 32) +
+		le32_to_cpu(idx->ei_leaf_lo);
+}
+
+/* Release the blocks mapped by an extent tree node and its index blocks */
+static int ext4fs_free_extent_tree(struct ext4_extent_header *eh)
+{
+	struct ext4_extent *ext = (struct ext4_extent *)(eh + 1);
+	struct ext4_extent_idx *idx = (struct ext4_extent_idx *)(eh + 1);
+	struct ext_filesystem *fs = get_fs();
+	char *buf;
+	uint32_t len;
+	int i, ret = 0;
+
+	if (le16_to_cpu(eh->eh_magic) != EXT4_EXT_MAGIC)
+		return -EINVAL;
+
+	if (!eh->eh_depth) {
+		for (i = 0; i < le16_to_cpu(eh->eh_entries); i++) {
+			len = le16_to_cpu(ext[i].ee_len);
+			/* longer extents are uninitialized ones */
+			if (len > EXT4_EXT_INIT_MAX_LEN)
+				len -= EXT4_EXT_INIT_MAX_LEN;
+			ret = ext4fs_free_blocks(ext4fs_ext_pblk(&ext[i]), len);
+			if (ret)
+				return ret;
+		}
+
+		return 0;
+	}
+
+	buf = zalloc(fs->blksz);
+	if (!buf)
+		return -ENOMEM;
+
+	for (i = 0; i < le16_to_cpu(eh->eh_entries); i++) {
+		if (!ext4fs_devread(ext4fs_idx_pblk(&idx[i]) * fs->sect_perblk,
+				    0, fs->blksz, buf)) {
+			ret = -EIO;
+			break;
+		}
+		ret = ext4fs_free_extent_tree((struct ext4_extent_header *)buf);
+		if (!ret)
+			ret = ext4fs_free_blocks(ext4fs_idx_pblk(&idx[i]), 1);
+		if (ret)
+			break;
+	}
+	free(buf);
+
+	return ret;
+}
+
 static int ext4fs_delete_file(int inodeno)
 {
 	struct ext2_inode inode;
@@ -466,11 +583,14 @@ static int ext4fs_delete_file(int inodeno)
 		no_blocks++;
 
 	if (le32_to_cpu(inode.flags) & EXT4_EXTENTS_FL) {
-		/* FIXME delete extent index blocks, i.e. eh_depth >= 1 */
 		struct ext4_extent_header *eh =
 			(struct ext4_extent_header *)
 				inode.b.blocks.dir_blocks;
 		debug("del: dep=%d entries=%d\n", eh->eh_depth, eh->eh_entries);
+		/* release data and index blocks a whole extent at a time */
+		if (ext4fs_free_extent_tree(eh))
+			goto fail;
+		no_blocks = 0;
 	} else {
 		delete_single_indirect_block(&inode);
 		delete_double_indirect_block(&inode);
@@ -584,7 +704,6 @@ fail:
 
 int ext4fs_init(void)
 {
-	short status;
 	int i;
 	uint32_t real_free_blocks = 0;
 	struct ext_filesystem *fs = get_fs();
@@ -618,45 +737,18 @@ int ext4fs_init(void)
 	}
 
 	/* load all the available bitmap block of the partition */
-	fs->blk_bmaps = zalloc(fs->no_blkgrp * sizeof(char *));
+	fs->blk_bmaps = ext4fs_alloc_bitmaps();
 	if (!fs->blk_bmaps)
 		goto fail;
-	for (i = 0; i < fs->no_blkgrp; i++) {
-		fs->blk_bmaps[i] = zalloc(fs->blksz);
-		if (!fs->blk_bmaps[i])
-			goto fail;
-	}
-
-	for (i = 0; i < fs->no_blkgrp; i++) {
-		struct ext2_block_group *bgd =
-			ext4fs_get_group_descriptor(fs, i);
-		status = ext4fs_devread(ext4fs_bg_get_block_id(bgd, fs) *
-				   fs->sect_perblk, 0,
-				   fs->blksz, (char *)fs->blk_bmaps[i]);
-		if (status == 0)
-			goto fail;
-	}
+	if (ext4fs_bitmaps_io(fs->blk_bmaps, false, false))
+		goto fail;
 
 	/* load all the available inode bitmap of the partition */
-	fs->inode_bmaps = zalloc(fs->no_blkgrp * sizeof(unsigned char *));
+	fs->inode_bmaps = ext4fs_alloc_bitmaps();
 	if (!fs->inode_bmaps)
 		goto fail;
-	for (i = 0; i < fs->no_blkgrp; i++) {
-		fs->inode_bmaps[i] = zalloc(fs->blksz);
-		if (!fs->inode_bmaps[i])
-			goto fail;
-	}
-
-	for (i = 0; i < fs->no_blkgrp; i++) {
-		struct ext2_block_group *bgd =
-			ext4fs_get_group_descriptor(fs, i);
-		status = ext4fs_devread(ext4fs_bg_get_inode_id(bgd, fs) *
-					fs->sect_perblk,
-					0, fs->blksz,
-					(char *)fs->inode_bmaps[i]);
-		if (status == 0)
-			goto fail;
-	}
+	if (ext4fs_bitmaps_io(fs->inode_bmaps, true, false))
+		goto fail;
 
 	/*
 	 * check filesystem consistency with free blocks of file system
@@ -682,7 +774,6 @@ fail:
 
 void ext4fs_deinit(void)
 {
-	int i;
 	struct ext2_inode inode_journal;
 	struct journal_superblock_t *jsb;
 	uint32_t blknr;
@@ -716,20 +807,15 @@ void ext4fs_deinit(void)
 	free(fs->sb);
 	fs->sb = NULL;
 
+	/* the bitmaps of all groups share one buffer */
 	if (fs->blk_bmaps) {
-		for (i = 0; i < fs->no_blkgrp; i++) {
-			free(fs->blk_bmaps[i]);
-			fs->blk_bmaps[i] = NULL;
-		}
+		free(fs->blk_bmaps[0]);
 		free(fs->blk_bmaps);
 		fs->blk_bmaps = NULL;
 	}
 
 	if (fs->inode_bmaps) {
-		for (i = 0; i < fs->no_blkgrp; i++) {
-			free(fs->inode_bmaps[i]);
-			fs->inode_bmaps[i] = NULL;
-		}
+		free(fs->inode_bmaps[0]);
 		free(fs->inode_bmaps);
 		fs->inode_bmaps = NULL;
 	}
@@ -830,6 +916,181 @@ static int ext4fs_write_file(struct ext2_inode *file_inode,
 	return len;
 }
 
+/*
+ * Allocate @nblocks blocks for a file as few runs of contiguous blocks as
+ * possible, starting near @goal. The runs are returned as an array of
+ * extents in @extp, to be freed by the caller.
+ */
+static int ext4fs_alloc_extents(uint64_t goal, uint32_t nblocks,
+				struct ext4_extent **extp, unsigned int *nr)
+{
+	struct ext4_extent *ext = NULL, *tmp, *last;
+	unsigned int n = 0, max = 0;
+	uint32_t lblk = 0, len;
+	uint64_t start;
+
+	while (lblk < nblocks) {
+		len = min_t(uint32_t, nblocks - lblk, EXT4_EXT_INIT_MAX_LEN);
+		start = ext4fs_alloc_blocks(goal, &len);
+		if (!start) {
+			printf("no block left to assign\n");
+			goto fail;
+		}
+
+		/* Runs carry on across group boundaries when flex_bg is on */
+		last = n ? &ext[n - 1] : NULL;
+		if (last && ext4fs_ext_pblk(last) + le16_to_cpu(last->ee_len) ==
+		    start && le16_to_cpu(last->ee_len) + len <=
+		    EXT4_EXT_INIT_MAX_LEN) {
+			last->ee_len = cpu_to_le16(le16_to_cpu(last->ee_len) +
+						   len);
+		} else {
+			if (n == max) {
+				max += 64;
+				tmp = realloc(ext, max * sizeof(*ext));
+				if (!tmp)
+					goto fail;
+				ext = tmp;
+			}
+			ext[n].ee_block = cpu_to_le32(lblk);
+			ext[n].ee_len = cpu_to_le16(len);
+			ext[n].ee_start_hi = cpu_to_le16(start >> 32);
+			ext[n].ee_start_lo = cpu_to_le32(start & 0xffffffff);
+			n++;
+		}
+		lblk += len;
+		goal = start + len;
+	}
+
+	*extp = ext;
+	*nr = n;
+
+	return 0;
+fail:
+	free(ext);
+
+	return -1;
+}
+
+/*
+ * Store the extents of a file in its inode, spilling them to leaf blocks
+ * under a one-level index when they do not fit. @nblocks is increased by
+ * the number of leaf blocks allocated.
+ *
+ * Returns -EFBIG, leaving the inode untouched, if there are too many
+ * extents for a one-level tree.
+ */
+static int ext4fs_build_extent_tree(struct ext2_inode *file_inode,
+				    struct ext4_extent *ext, unsigned int nr,
+				    uint64_t goal, unsigned int *nblocks)
+{
+	struct ext_filesystem *fs = get_fs();
+	struct ext4_extent_header *eh =
+		(struct ext4_extent_header *)file_inode->b.blocks.dir_blocks;
+	struct ext4_extent_idx *idx = (struct ext4_extent_idx *)(eh + 1);
+	struct ext4_extent_header *leaf;
+	unsigned int in_inode = (sizeof(file_inode->b) - sizeof(*eh)) /
+				sizeof(*ext);
+	unsigned int per_leaf = (fs->blksz - sizeof(*eh)) / sizeof(*ext);
+	unsigned int leaves, i, n;
+	uint32_t len;
+	uint64_t blk;
+
+	leaves = DIV_ROUND_UP(nr, per_leaf);
+	if (leaves > in_inode) {
+		debug("%s: too many extents (%u)\n", __func__, nr);
+		return -EFBIG;
+	}
+
+	file_inode->flags = cpu_to_le32(le32_to_cpu(file_inode->flags) |
+					EXT4_EXTENTS_FL);
+	memset(eh, 0, sizeof(file_inode->b));
+	eh->eh_magic = cpu_to_le16(EXT4_EXT_MAGIC);
+	eh->eh_max = cpu_to_le16(in_inode);
+
+	if (nr <= in_inode) {
+		memcpy(eh + 1, ext, nr * sizeof(*ext));
+		eh->eh_entries = cpu_to_le16(nr);
+		return 0;
+	}
+
+	leaf = zalloc(fs->blksz);
+	if (!leaf)
+		return -ENOMEM;
+
+	for (i = 0; i < leaves; i++, ext += n, nr -= n) {
+		len = 1;
+		blk = ext4fs_alloc_blocks(goal, &len);
+		if (!blk) {
+			printf("no block left to assign\n");
+			free(leaf);
+			return -1;
+		}
+		(*nblocks)++;
+
+		n = min(nr, per_leaf);
+		memset(leaf, 0, fs->blksz);
+		leaf->eh_magic = cpu_to_le16(EXT4_EXT_MAGIC);
+		leaf->eh_entries = cpu_to_le16(n);
+		leaf->eh_max = cpu_to_le16(per_leaf);
+		memcpy(leaf + 1, ext, n * sizeof(*ext));
+		put_ext4(blk * fs->blksz, leaf, fs->blksz);
+
+		idx[i].ei_block = ext->ee_block;
+		idx[i].ei_leaf_hi = cpu_to_le16(blk >> 32);
+		idx[i].ei_leaf_lo = cpu_to_le32(blk & 0xffffffff);
+	}
+	free(leaf);
+
+	eh->eh_entries = cpu_to_le16(leaves);
+	eh->eh_depth = cpu_to_le16(1);
+
+	return 0;
+}
+
+/*
+ * Write @size bytes of file data to the blocks described by @ext. Extents
+ * that are physically contiguous are merged into one device request.
+ */
+static int ext4fs_write_extents(struct ext4_extent *ext, unsigned int nr,
+				const char *buf, uint64_t size)
+{
+	struct ext_filesystem *fs = get_fs();
+	uint64_t start, off, bytes, full;
+	uint32_t len, max = EXT4_WRITE_BATCH_MAX / fs->blksz;
+	unsigned int i, j;
+	char *tail;
+
+	for (i = 0; i < nr; i = j) {
+		start = ext4fs_ext_pblk(&ext[i]);
+		len = le16_to_cpu(ext[i].ee_len);
+		for (j = i + 1; j < nr; j++) {
+			if (ext4fs_ext_pblk(&ext[j]) != start + len ||
+			    len + le16_to_cpu(ext[j].ee_len) > max)
+				break;
+			len += le16_to_cpu(ext[j].ee_len);
+		}
+
+		off = (uint64_t)le32_to_cpu(ext[i].ee_block) * fs->blksz;
+		bytes = min((uint64_t)len * fs->blksz, size - off);
+		full = bytes & ~(uint64_t)(fs->blksz - 1);
+		if (full)
+			put_ext4(start * fs->blksz, (char *)buf + off, full);
+
+		/* The last block is padded with zeroes */
+		if (bytes > full) {
+			tail = zalloc(fs->blksz);
+			if (!tail)
+				return -1;
+			memcpy(tail, buf + off + full, bytes - full);
+			put_ext4(start * fs->blksz + full, tail, fs->blksz);
+			free(tail);
+		}
+	}
+
+	return 0;
+}
+
 int ext4fs_write(const char *fname, unsigned char *buffer,
 					unsigned long sizebytes)
 {
@@ -853,9 +1114,16 @@ int ext4fs_write(const char *fname, unsigned char *buffer,
 	unsigned int ibmap_idx;
 	struct ext2_block_group *bgd = NULL;
 	struct ext_filesystem *fs = get_fs();
+	struct ext4_extent *extents = NULL;
+	unsigned int nr_extents = 0, i;
+	uint64_t goal;
+	bool use_extents;
 	ALLOC_CACHE_ALIGN_BUFFER(char, filename, 256);
 	memset(filename, 0x00, 256);
 
+	/* Cached lookups may not survive the update */
+	ext4fs_dcache_flush();
+
 	g_parent_inode = zalloc(fs->inodesz);
 	if (!g_parent_inode)
 		goto fail;
@@ -865,6 +1133,8 @@ int ext4fs_write(const char *fname, unsigned char *buffer,
 		return -1;
 	}
 	inodes_per_block = fs->blksz / fs->inodesz;
+	use_extents = le32_to_cpu(fs->sb->feature_incompat) &
+		EXT4_FEATURE_INCOMPAT_EXTENTS;
 	parent_inodeno = ext4fs_get_parent_inode_num(fname, filename, F_FILE);
 	if (parent_inodeno == -1)
 		goto fail;
@@ -896,7 +1166,7 @@ int ext4fs_write(const char *fname, unsigned char *buffer,
 	}
 	blocks_remaining = blks_reqd_for_file;
 	/* test for available space in partition */
-	if (le32_to_cpu(fs->sb->free_blocks) < blks_reqd_for_file) {
+	if (ext4fs_sb_get_free_blocks(fs->sb) < blks_reqd_for_file) {
 		printf("Not enough space on partition !!!\n");
 		goto fail;
 	}
@@ -917,12 +1187,41 @@ int ext4fs_write(const char *fname, unsigned char *buffer,
 	file_inode->ctime = cpu_to_le32(timestamp);
 	file_inode->nlinks = cpu_to_le16(1);
 	file_inode->size = cpu_to_le32(sizebytes);
+	file_inode->size_high = cpu_to_le32((uint64_t)sizebytes >> 32);
+	if ((uint64_t)sizebytes > INT_MAX)
+		fs->sb->feature_ro_compat =
+			cpu_to_le32(le32_to_cpu(fs->sb->feature_ro_compat) |
+				    EXT4_FEATURE_RO_COMPAT_LARGE_FILE);
 
 	/* Allocate data blocks */
-	ext4fs_allocate_blocks(file_inode, blocks_remaining,
-			       &blks_reqd_for_file);
-	file_inode->blockcnt = cpu_to_le32((blks_reqd_for_file * fs->blksz) >>
-		fs->dev_desc->log2blksz);
+	if (use_extents) {
+		/* start looking in the group of the new inode */
+		goal = le32_to_cpu(sblock->first_data_block) +
+			(uint64_t)((inodeno - 1) /
+				   le32_to_cpu(sblock->inodes_per_group)) *
+			le32_to_cpu(sblock->blocks_per_group);
+		if (ext4fs_alloc_extents(goal, blocks_remaining, &extents,
+					 &nr_extents))
+			goto fail;
+		if (nr_extents)
+			goal = ext4fs_ext_pblk(&extents[nr_extents - 1]);
+		ret = ext4fs_build_extent_tree(file_inode, extents, nr_extents,
+					       goal, &blks_reqd_for_file);
+		if (ret == -EFBIG) {
+			/* free space is too fragmented, map blocks instead */
+			for (i = 0; i < nr_extents; i++)
+				ext4fs_free_blocks(ext4fs_ext_pblk(&extents[i]),
+					le16_to_cpu(extents[i].ee_len));
+			use_extents = false;
+		} else if (ret) {
+			goto fail;
+		}
+	}
+	if (!use_extents)
+		ext4fs_allocate_blocks(file_inode, blocks_remaining,
+				       &blks_reqd_for_file);
+	file_inode->blockcnt = cpu_to_le32(((uint64_t)blks_reqd_for_file *
+		fs->blksz) >> fs->dev_desc->log2blksz);
 
 	temp_ptr = zalloc(fs->blksz);
 	if (!temp_ptr)
@@ -943,7 +1242,13 @@ int ext4fs_write(const char *fname, unsigned char *buffer,
 	if (ext4fs_put_metadata(temp_ptr, itable_blkno))
 		goto fail;
 	/* copy the file content into data blocks */
-	if (ext4fs_write_file(file_inode, 0, sizebytes, (char *)buffer) == -1) {
+	if (use_extents)
+		ret = ext4fs_write_extents(extents, nr_extents,
+					   (char *)buffer, sizebytes);
+	else
+		ret = ext4fs_write_file(file_inode, 0, sizebytes,
+					(char *)buffer);
+	if (ret == -1) {
 		printf("Error in copying content\n");
 		/* FIXME: Deallocate data blocks */
 		goto fail;
@@ -985,6 +1290,7 @@ int ext4fs_write(const char *fname, unsigned char *buffer,
 	free(inode_buffer);
 	free(g_parent_inode);
 	free(temp_ptr);
+	free(extents);
 	g_parent_inode = NULL;
 
 	return 0;
@@ -993,6 +1299,7 @@ fail:
 	free(inode_buffer);
 	free(g_parent_inode);
 	free(temp_ptr);
+	free(extents);
 	g_parent_inode = NULL;
 
 	return -1;
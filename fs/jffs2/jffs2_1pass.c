@@ -92,13 +92,12 @@
  * - implemented fragment sorting to ensure that the newest data is copied
  *   if there are multiple copies of fragments for a certain file offset.
  *
- * The fragment sorting feature must be enabled by CONFIG_SYS_JFFS2_SORT_FRAGMENTS.
- * Sorting is done while adding fragments to the lists, which is more or less a
- * bubble sort. This takes a lot of time, and is most probably not an issue if
- * the boot filesystem is always mounted readonly.
- *
- * You should define it if the boot filesystem is mounted writable, and updates
- * to the boot files are done by copying files to that filesystem.
+ * After the scan the nodes are hashed by inode number (parent inode for
+ * directory entries) and every hash bucket is sorted by version. Lookups only
+ * visit the nodes of the inode or directory they are interested in, and the
+ * data fragments are always copied oldest first, so the newest data wins if
+ * there are multiple copies of fragments for a certain file offset. This makes
+ * CONFIG_SYS_JFFS2_SORT_FRAGMENTS unnecessary.
  *
  *
  * There's a big issue left: endianess is completely ignored in this code. Duh!
@@ -548,7 +547,7 @@ add_node(struct b_list *list)
 }
 
 static struct b_node *
-insert_node(struct b_list *list, u32 offset)
+insert_node(struct b_list *list, u32 offset, u32 ino, u32 version)
 {
 	struct b_node *new;
 
@@ -558,6 +557,10 @@ insert_node(struct b_list *list, u32 offset)
 	}
 	new->offset = offset;
 	new->next = NULL;
+	new->ino = ino;
+	new->version = version;
+	new->nhash = 0;
+	new->datacrc = CRC_UNKNOWN;
 
 	if (list->listTail != NULL)
 		list->listTail->next = new;
@@ -568,74 +571,123 @@ insert_node(struct b_list *list, u32 offset)
 	return new;
 }
 
-#ifdef CONFIG_SYS_JFFS2_SORT_FRAGMENTS
-/* Sort data entries with the latest version last, so that if there
- * is overlapping data the latest version will be used.
- */
-static int compare_inodes(struct b_node *new, struct b_node *old)
+static u32 name_hash(const u8 *name, u32 len)
 {
-	/*
-	 * Only read in the version info from flash, not the entire inode.
-	 * This can make a big difference to speed if flash is slow.
-	 */
-	u32 new_version;
-	u32 old_version;
-	get_fl_mem(new->offset + offsetof(struct jffs2_raw_inode, version),
-		   sizeof(new_version), &new_version);
-	get_fl_mem(old->offset + offsetof(struct jffs2_raw_inode, version),
-		   sizeof(old_version), &old_version);
-
-	return new_version > old_version;
+	u32 hash = 0x811c9dc5;
+
+	while (len--)
+		hash = (hash ^ *name++) * 0x01000193;
+
+	return hash;
 }
 
-/* Sort directory entries so all entries in the same directory
- * with the same name are grouped together, with the latest version
- * last. This makes it easy to eliminate all but the latest version
- * by marking the previous version dead by setting the inode to 0.
+/*
+ * Sort a bucket chain by ino, name hash (dirents only), version and flash
+ * offset. All versions of a dirent end up next to each other.
  */
-static int compare_dirents(struct b_node *new, struct b_node *old)
+static int node_before(struct b_node *a, struct b_node *b)
 {
-	/*
-	 * Using NULL as the buffer for NOR flash prevents the entire node
-	 * being read. This makes most comparisons much quicker as only one
-	 * or two entries from the node will be used most of the time.
-	 */
-	struct jffs2_raw_dirent *jNew = get_node_mem(new->offset, NULL);
-	struct jffs2_raw_dirent *jOld = get_node_mem(old->offset, NULL);
-	int cmp;
-	int ret;
-
-	if (jNew->pino != jOld->pino) {
-		/* ascending sort by pino */
-		ret = jNew->pino > jOld->pino;
-	} else if (jNew->nsize != jOld->nsize) {
-		/*
-		 * pino is the same, so use ascending sort by nsize,
-		 * so we don't do strncmp unless we really must.
-		 */
-		ret = jNew->nsize > jOld->nsize;
-	} else {
-		/*
-		 * length is also the same, so use ascending sort by name
-		 */
-		cmp = strncmp((char *)jNew->name, (char *)jOld->name,
-			jNew->nsize);
-		if (cmp != 0) {
-			ret = cmp > 0;
+	if (a->ino != b->ino)
+		return a->ino < b->ino;
+	if (a->nhash != b->nhash)
+		return a->nhash < b->nhash;
+	if (a->version != b->version)
+		return a->version < b->version;
+	return a->offset <= b->offset;
+}
+
+static struct b_node *sort_bucket(struct b_node *list)
+{
+	struct b_node *a, *b, *fast, *head, **tail;
+
+	if (!list || !list->hnext)
+		return list;
+
+	/* split in two halves */
+	a = list;
+	fast = list->hnext;
+	while (fast && fast->hnext) {
+		a = a->hnext;
+		fast = fast->hnext->hnext;
+	}
+	b = a->hnext;
+	a->hnext = NULL;
+
+	a = sort_bucket(list);
+	b = sort_bucket(b);
+
+	tail = &head;
+	while (a && b) {
+		if (node_before(a, b)) {
+			*tail = a;
+			a = a->hnext;
 		} else {
-			/*
-			 * we have duplicate names in this directory,
-			 * so use ascending sort by version
-			 */
-			ret = jNew->version > jOld->version;
+			*tail = b;
+			b = b->hnext;
 		}
+		tail = &(*tail)->hnext;
 	}
-	put_fl_mem(jNew, NULL);
-	put_fl_mem(jOld, NULL);
+	*tail = a ? a : b;
 
-	return ret;
+	return head;
+}
+
+static int build_index(struct b_list *list)
+{
+	struct mem_block *mb;
+	struct b_node *b;
+	u32 size = 16;
+	u32 i;
+
+	/* aim for about two nodes per bucket */
+	while (size < list->listCount / 2)
+		size <<= 1;
+
+	free(list->listIndex);
+	list->listIndex = malloc(size * sizeof(*list->listIndex));
+	if (!list->listIndex) {
+		putstr("build_index: malloc failed\n");
+		return -1;
+	}
+	memset(list->listIndex, 0, size * sizeof(*list->listIndex));
+	list->listIndexMask = size - 1;
+
+	for (mb = list->listMemBase; mb; mb = mb->next) {
+		for (i = 0; i < mb->index; i++) {
+			b = &mb->nodes[i];
+			b->hnext = list->listIndex[b->ino & list->listIndexMask];
+			list->listIndex[b->ino & list->listIndexMask] = b;
+		}
+	}
+
+	for (i = 0; i < size; i++)
+		list->listIndex[i] = sort_bucket(list->listIndex[i]);
+
+	return 0;
+}
+
+/* Return the oldest node with the given ino, the others follow in ->hnext */
+static struct b_node *find_nodes(struct b_list *list, u32 ino)
+{
+	struct b_node *b;
+
+	b = list->listIndex[ino & list->listIndexMask];
+	while (b && b->ino < ino)
+		b = b->hnext;
+
+	return b && b->ino == ino ? b : NULL;
+}
+
+/* Return the newest node with the given ino */
+static struct b_node *find_newest_node(struct b_list *list, u32 ino)
+{
+	struct b_node *b = find_nodes(list, ino);
+
+	while (b && b->hnext && b->hnext->ino == ino)
+		b = b->hnext;
+
+	return b;
 }
-#endif
 
 void
 jffs2_free_cache(struct part_info *part)
@@ -646,8 +698,11 @@ jffs2_free_cache(struct part_info *part)
 		pL = (struct b_lists *)part->jffs2_priv;
 		free_nodes(&pL->frag);
 		free_nodes(&pL->dir);
+		free(pL->frag.listIndex);
+		free(pL->dir.listIndex);
 		free(pL->readbuf);
 		free(pL);
+		part->jffs2_priv = NULL;
 	}
 }
 
@@ -662,10 +717,6 @@ jffs_init_1pass_list(struct part_info *part)
 		pL = (struct b_lists *)part->jffs2_priv;
 
 		memset(pL, 0, sizeof(*pL));
-#ifdef CONFIG_SYS_JFFS2_SORT_FRAGMENTS
-		pL->dir.listCompare = compare_dirents;
-		pL->frag.listCompare = compare_inodes;
-#endif
 	}
 	return 0;
 }
@@ -677,12 +728,10 @@ jffs2_1pass_read_inode(struct b_lists *pL, u32 inode, char *dest)
 	struct b_node *b;
 	struct jffs2_raw_inode *jNode;
 	u32 totalSize = 0;
-	u32 latestVersion = 0;
 	uchar *lDest;
 	uchar *src;
 	int i;
-	u32 counter = 0;
-#ifdef CONFIG_SYS_JFFS2_SORT_FRAGMENTS
+
 	/* Find file size before loading any data, so fragments that
 	 * start past the end of file can be ignored. A fragment
 	 * that is partially in the file is loaded, so extra data may
@@ -690,16 +739,11 @@ jffs2_1pass_read_inode(struct b_lists *pL, u32 inode, char *dest)
 	 * This shouldn't cause trouble when loading kernel images, so
 	 * we will live with it.
 	 */
-	for (b = pL->frag.listHead; b != NULL; b = b->next) {
+	b = find_newest_node(&pL->frag, inode);
+	if (b) {
 		jNode = (struct jffs2_raw_inode *) get_fl_mem(b->offset,
 			sizeof(struct jffs2_raw_inode), pL->readbuf);
-		if ((inode == jNode->ino)) {
-			/* get actual file length from the newest node */
-			if (jNode->version >= latestVersion) {
-				totalSize = jNode->isize;
-				latestVersion = jNode->version;
-			}
-		}
+		totalSize = jNode->isize;
 		put_fl_mem(jNode, pL->readbuf);
 	}
 	/*
@@ -708,109 +752,58 @@ jffs2_1pass_read_inode(struct b_lists *pL, u32 inode, char *dest)
 	 */
 	if (!dest)
 		return totalSize;
-#endif
-
-	for (b = pL->frag.listHead; b != NULL; b = b->next) {
-		/*
-		 * Copy just the node and not the data at this point,
-		 * since we don't yet know if we need this data.
-		 */
-		jNode = (struct jffs2_raw_inode *)get_fl_mem(b->offset,
-				sizeof(struct jffs2_raw_inode),
-				pL->readbuf);
-		if (inode == jNode->ino) {
-#if 0
-			putLabeledWord("\r\n\r\nread_inode: totlen = ", jNode->totlen);
-			putLabeledWord("read_inode: inode = ", jNode->ino);
-			putLabeledWord("read_inode: version = ", jNode->version);
-			putLabeledWord("read_inode: isize = ", jNode->isize);
-			putLabeledWord("read_inode: offset = ", jNode->offset);
-			putLabeledWord("read_inode: csize = ", jNode->csize);
-			putLabeledWord("read_inode: dsize = ", jNode->dsize);
-			putLabeledWord("read_inode: compr = ", jNode->compr);
-			putLabeledWord("read_inode: usercompr = ", jNode->usercompr);
-			putLabeledWord("read_inode: flags = ", jNode->flags);
-#endif
 
-#ifndef CONFIG_SYS_JFFS2_SORT_FRAGMENTS
-			/* get actual file length from the newest node */
-			if (jNode->version >= latestVersion) {
-				totalSize = jNode->isize;
-				latestVersion = jNode->version;
-			}
-#endif
-
-			if(dest) {
-				/*
-				 * Now that the inode has been checked,
-				 * read the entire inode, including data.
-				 */
-				put_fl_mem(jNode, pL->readbuf);
-				jNode = (struct jffs2_raw_inode *)
-					get_node_mem(b->offset, pL->readbuf);
-				src = ((uchar *)jNode) +
-					sizeof(struct jffs2_raw_inode);
-				/* ignore data behind latest known EOF */
-				if (jNode->offset > totalSize) {
-					put_fl_mem(jNode, pL->readbuf);
-					continue;
-				}
-				if (b->datacrc == CRC_UNKNOWN)
-					b->datacrc = data_crc(jNode) ?
-						CRC_OK : CRC_BAD;
-				if (b->datacrc == CRC_BAD) {
-					put_fl_mem(jNode, pL->readbuf);
-					continue;
-				}
+	/* fragments come oldest first, so newer data overwrites older */
+	for (b = find_nodes(&pL->frag, inode); b && b->ino == inode;
+	     b = b->hnext) {
+		jNode = (struct jffs2_raw_inode *)get_node_mem(b->offset,
+							       pL->readbuf);
+		src = ((uchar *)jNode) + sizeof(struct jffs2_raw_inode);
+		/* ignore data behind latest known EOF */
+		if (jNode->offset > totalSize) {
+			put_fl_mem(jNode, pL->readbuf);
+			continue;
+		}
+		if (b->datacrc == CRC_UNKNOWN)
+			b->datacrc = data_crc(jNode) ? CRC_OK : CRC_BAD;
+		if (b->datacrc == CRC_BAD) {
+			put_fl_mem(jNode, pL->readbuf);
+			continue;
+		}
 
-				lDest = (uchar *) (dest + jNode->offset);
-#if 0
-				putLabeledWord("read_inode: src = ", src);
-				putLabeledWord("read_inode: dest = ", lDest);
-#endif
-				switch (jNode->compr) {
-				case JFFS2_COMPR_NONE:
-					ldr_memcpy(lDest, src, jNode->dsize);
-					break;
-				case JFFS2_COMPR_ZERO:
-					for (i = 0; i < jNode->dsize; i++)
-						*(lDest++) = 0;
-					break;
-				case JFFS2_COMPR_RTIME:
-					rtime_decompress(src, lDest, jNode->csize, jNode->dsize);
-					break;
-				case JFFS2_COMPR_DYNRUBIN:
-					/* this is slow but it works */
-					dynrubin_decompress(src, lDest, jNode->csize, jNode->dsize);
-					break;
-				case JFFS2_COMPR_ZLIB:
-					zlib_decompress(src, lDest, jNode->csize, jNode->dsize);
-					break;
+		lDest = (uchar *) (dest + jNode->offset);
+		switch (jNode->compr) {
+		case JFFS2_COMPR_NONE:
+			ldr_memcpy(lDest, src, jNode->dsize);
+			break;
+		case JFFS2_COMPR_ZERO:
+			for (i = 0; i < jNode->dsize; i++)
+				*(lDest++) = 0;
+			break;
+		case JFFS2_COMPR_RTIME:
+			rtime_decompress(src, lDest, jNode->csize, jNode->dsize);
+			break;
+		case JFFS2_COMPR_DYNRUBIN:
+			/* this is slow but it works */
+			dynrubin_decompress(src, lDest, jNode->csize, jNode->dsize);
+			break;
+		case JFFS2_COMPR_ZLIB:
+			zlib_decompress(src, lDest, jNode->csize, jNode->dsize);
+			break;
 #if defined(CONFIG_JFFS2_LZO)
-				case JFFS2_COMPR_LZO:
-					lzo_decompress(src, lDest, jNode->csize, jNode->dsize);
-					break;
-#endif
-				default:
-					/* unknown */
-					putLabeledWord("UNKNOWN COMPRESSION METHOD = ", jNode->compr);
-					put_fl_mem(jNode, pL->readbuf);
-					return -1;
-					break;
-				}
-			}
-
-#if 0
-			putLabeledWord("read_inode: totalSize = ", totalSize);
+		case JFFS2_COMPR_LZO:
+			lzo_decompress(src, lDest, jNode->csize, jNode->dsize);
+			break;
 #endif
+		default:
+			/* unknown */
+			putLabeledWord("UNKNOWN COMPRESSION METHOD = ", jNode->compr);
+			put_fl_mem(jNode, pL->readbuf);
+			return -1;
 		}
-		counter++;
 		put_fl_mem(jNode, pL->readbuf);
 	}
 
-#if 0
-	putLabeledWord("read_inode: returning = ", totalSize);
-#endif
 	return totalSize;
 }
 
@@ -821,25 +814,23 @@ jffs2_1pass_find_inode(struct b_lists * pL, const char *name, u32 pino)
 	struct b_node *b;
 	struct jffs2_raw_dirent *jDir;
 	int len;
-	u32 counter;
+	u32 hash;
 	u32 version = 0;
 	u32 inode = 0;
 
 	/* name is assumed slash free */
 	len = strlen(name);
+	hash = name_hash((const u8 *)name, len);
 
-	counter = 0;
-	/* we need to search all and return the inode with the highest version */
-	for(b = pL->dir.listHead; b; b = b->next, counter++) {
+	/* versions of a dirent come oldest first, the last match wins */
+	for (b = find_nodes(&pL->dir, pino); b && b->ino == pino;
+	     b = b->hnext) {
+		if (b->nhash != hash)
+			continue;
 		jDir = (struct jffs2_raw_dirent *) get_node_mem(b->offset,
 								pL->readbuf);
-		if ((pino == jDir->pino) && (len == jDir->nsize) &&
+		if ((len == jDir->nsize) &&
 		    (!strncmp((char *)jDir->name, name, len))) {	/* a match */
-			if (jDir->version < version) {
-				put_fl_mem(jDir, pL->readbuf);
-				continue;
-			}
-
 			if (jDir->version == version && inode != 0) {
 				/* I'm pretty sure this isn't legal */
 				putstr(" ** ERROR ** ");
@@ -849,15 +840,6 @@ jffs2_1pass_find_inode(struct b_lists * pL, const char *name, u32 pino)
 			inode = jDir->ino;
 			version = jDir->version;
 		}
-#if 0
-		putstr("\r\nfind_inode:p&l ->");
-		putnstr(jDir->name, jDir->nsize);
-		putstr("\r\n");
-		putLabeledWord("pino = ", jDir->pino);
-		putLabeledWord("nsize = ", jDir->nsize);
-		putLabeledWord("b = ", (u32) b);
-		putLabeledWord("counter = ", counter);
-#endif
 		put_fl_mem(jDir, pL->readbuf);
 	}
 	return inode;
@@ -944,82 +926,65 @@ static inline u32 dump_inode(struct b_lists * pL, struct jffs2_raw_dirent *d, st
 	return 0;
 }
 
+/* is there a newer dirent than b with the same name in the same directory? */
+static int
+jffs2_1pass_dirent_replaced(struct b_node *b, struct jffs2_raw_dirent *jDir)
+{
+	struct b_node *b2;
+	struct jffs2_raw_dirent *jDirNext;
+	int match = 0;
+
+	for (b2 = b->hnext; b2 && b2->ino == b->ino &&
+	     b2->nhash == b->nhash && !match; b2 = b2->hnext) {
+		jDirNext = (struct jffs2_raw_dirent *)
+			get_node_mem(b2->offset, NULL);
+		match = jDirNext->nsize == jDir->nsize &&
+			strncmp((char *)jDirNext->name, (char *)jDir->name,
+				jDir->nsize) == 0;
+		put_fl_mem(jDirNext, NULL);
+	}
+	return match;
+}
+
 /* list inodes with the given pino */
 static u32
 jffs2_1pass_list_inodes(struct b_lists * pL, u32 pino)
 {
 	struct b_node *b;
+	struct b_node *b2;
 	struct jffs2_raw_dirent *jDir;
+	struct jffs2_raw_inode *i;
 
-	for (b = pL->dir.listHead; b; b = b->next) {
+	for (b = find_nodes(&pL->dir, pino); b && b->ino == pino;
+	     b = b->hnext) {
 		jDir = (struct jffs2_raw_dirent *) get_node_mem(b->offset,
 								pL->readbuf);
-		if (pino == jDir->pino) {
-			u32 i_version = 0;
-			struct jffs2_raw_inode *jNode, *i = NULL;
-			struct b_node *b2;
-
-#ifdef CONFIG_SYS_JFFS2_SORT_FRAGMENTS
-			/* Check for more recent versions of this file */
-			int match;
-			do {
-				struct b_node *next = b->next;
-				struct jffs2_raw_dirent *jDirNext;
-				if (!next)
-					break;
-				jDirNext = (struct jffs2_raw_dirent *)
-					get_node_mem(next->offset, NULL);
-				match = jDirNext->pino == jDir->pino &&
-					jDirNext->nsize == jDir->nsize &&
-					strncmp((char *)jDirNext->name,
-						(char *)jDir->name,
-						jDir->nsize) == 0;
-				if (match) {
-					/* Use next. It is more recent */
-					b = next;
-					/* Update buffer with the new info */
-					*jDir = *jDirNext;
-				}
-				put_fl_mem(jDirNext, NULL);
-			} while (match);
-#endif
-			if (jDir->ino == 0) {
-				/* Deleted file */
-				put_fl_mem(jDir, pL->readbuf);
-				continue;
-			}
-
-			for (b2 = pL->frag.listHead; b2; b2 = b2->next) {
-				jNode = (struct jffs2_raw_inode *)
-					get_fl_mem(b2->offset, sizeof(*jNode),
-						   NULL);
-				if (jNode->ino == jDir->ino &&
-				    jNode->version >= i_version) {
-					i_version = jNode->version;
-					if (i)
-						put_fl_mem(i, NULL);
-
-					if (jDir->type == DT_LNK)
-						i = get_node_mem(b2->offset,
-								 NULL);
-					else
-						i = get_fl_mem(b2->offset,
-							       sizeof(*i),
-							       NULL);
-				}
-				put_fl_mem(jNode, NULL);
-			}
+		/* Deleted file, or a more recent version of it follows */
+		if (jDir->ino == 0 || jffs2_1pass_dirent_replaced(b, jDir)) {
+			put_fl_mem(jDir, pL->readbuf);
+			continue;
+		}
 
-			dump_inode(pL, jDir, i);
-			put_fl_mem(i, NULL);
+		i = NULL;
+		b2 = find_newest_node(&pL->frag, jDir->ino);
+		if (b2) {
+			if (jDir->type == DT_LNK)
+				i = get_node_mem(b2->offset, NULL);
+			else
+				i = get_fl_mem(b2->offset, sizeof(*i), NULL);
 		}
+
+		dump_inode(pL, jDir, i);
+		put_fl_mem(i, NULL);
 		put_fl_mem(jDir, pL->readbuf);
 	}
 	return pino;
 }
 
+/* dir, if not NULL, returns the inode of the directory holding fname */
 static u32
-jffs2_1pass_search_inode(struct b_lists * pL, const char *fname, u32 pino)
+jffs2_1pass_search_inode(struct b_lists * pL, const char *fname, u32 pino,
+			 u32 *dir)
 {
 	int i;
 	char tmp[256];
@@ -1063,6 +1028,8 @@ jffs2_1pass_search_inode(struct b_lists * pL, const char *fname, u32 pino)
 			return 0;
 		}
 	}
+	if (dir)
+		*dir = pino;
 	/* this is for the bare filename, directories have already been mapped */
 	if (!(pino = jffs2_1pass_find_inode(pL, tmp, pino))) {
 		putstr("find_inode failed for name=");
@@ -1074,8 +1041,9 @@ jffs2_1pass_search_inode(struct b_lists * pL, const char *fname, u32 pino)
 
 }
 
+/* follow ino if it is a symlink, dir is the directory it was found in */
 static u32
-jffs2_1pass_resolve_inode(struct b_lists * pL, u32 ino)
+jffs2_1pass_resolve_inode(struct b_lists * pL, u32 ino, u32 dir)
 {
 	struct b_node *b;
 	struct b_node *b2;
@@ -1090,7 +1058,7 @@ jffs2_1pass_resolve_inode(struct b_lists * pL, u32 ino)
 	unsigned char *src;
 
 	/* we need to search all and return the inode with the highest version */
-	for(b = pL->dir.listHead; b; b = b->next) {
+	for (b = find_nodes(&pL->dir, dir); b && b->ino == dir; b = b->hnext) {
 		jDir = (struct jffs2_raw_dirent *) get_node_mem(b->offset,
 								pL->readbuf);
 		if (ino == jDir->ino) {
@@ -1119,27 +1087,16 @@ jffs2_1pass_resolve_inode(struct b_lists * pL, u32 ino)
 		return jDirFoundIno;
 
 	/* it's a soft link so we follow it again. */
-	b2 = pL->frag.listHead;
-	while (b2) {
-		jNode = (struct jffs2_raw_inode *) get_node_mem(b2->offset,
-								pL->readbuf);
-		if (jNode->ino == jDirFoundIno) {
-			src = (unsigned char *)jNode + sizeof(struct jffs2_raw_inode);
+	b2 = find_newest_node(&pL->frag, jDirFoundIno);
+	if (!b2)
+		return 0;
+	jNode = (struct jffs2_raw_inode *) get_node_mem(b2->offset,
+							pL->readbuf);
+	src = (unsigned char *)jNode + sizeof(struct jffs2_raw_inode);
+	strncpy(tmp, (char *)src, jNode->dsize);
+	tmp[jNode->dsize] = '\0';
+	put_fl_mem(jNode, pL->readbuf);
 
-#if 0
-			putLabeledWord("\t\t dsize = ", jNode->dsize);
-			putstr("\t\t target = ");
-			putnstr(src, jNode->dsize);
-			putstr("\r\n");
-#endif
-			strncpy(tmp, (char *)src, jNode->dsize);
-			tmp[jNode->dsize] = '\0';
-			put_fl_mem(jNode, pL->readbuf);
-			break;
-		}
-		b2 = b2->next;
-		put_fl_mem(jNode, pL->readbuf);
-	}
 	/* ok so the name of the new file to find is in tmp */
 	/* if it starts with a slash it is root based else shared dirs */
 	if (tmp[0] == '/')
@@ -1147,7 +1104,7 @@ jffs2_1pass_resolve_inode(struct b_lists * pL, u32 ino)
 	else
 		pino = jDirFoundPino;
 
-	return jffs2_1pass_search_inode(pL, tmp, pino);
+	return jffs2_1pass_search_inode(pL, tmp, pino, NULL);
 }
 
 static u32
@@ -1265,8 +1222,14 @@ static int jffs2_sum_process_sum_data(struct part_info *part, uint32_t offset,
 {
 	void *sp;
 	int i, pass;
-	void *ret;
+	struct b_node *b;
 
+	/*
+	 * The first pass only checks that every record is understood, so an
+	 * unusable summary leaves nothing behind before the sector gets
+	 * scanned. The records carry everything the index needs, so the
+	 * nodes themselves are not read here.
+	 */
 	for (pass = 0; pass < 2; pass++) {
 		sp = summary->sum;
 
@@ -1275,53 +1238,60 @@ static int jffs2_sum_process_sum_data(struct part_info *part, uint32_t offset,
 			dbg_summary("processing summary index %d\n", i);
 
 			switch (sum_get_unaligned16(&spu->nodetype)) {
-				case JFFS2_NODETYPE_INODE: {
-				struct jffs2_sum_inode_flash *spi;
-					if (pass) {
-						spi = sp;
-
-						ret = insert_node(&pL->frag,
-							(u32)part->offset +
-							offset +
-							sum_get_unaligned32(
-								&spi->offset));
-						if (ret == NULL)
-							return -1;
-					}
-
-					sp += JFFS2_SUMMARY_INODE_SIZE;
-
-					break;
+			case JFFS2_NODETYPE_INODE: {
+				struct jffs2_sum_inode_flash *spi = sp;
+
+				if (pass) {
+					b = insert_node(&pL->frag,
+						(u32)part->offset + offset +
+						sum_get_unaligned32(
+							&spi->offset),
+						sum_get_unaligned32(
+							&spi->inode),
+						sum_get_unaligned32(
+							&spi->version));
+					if (b == NULL)
+						return -1;
 				}
-				case JFFS2_NODETYPE_DIRENT: {
-					struct jffs2_sum_dirent_flash *spd;
-					spd = sp;
-					if (pass) {
-						ret = insert_node(&pL->dir,
-							(u32) part->offset +
-							offset +
-							sum_get_unaligned32(
-								&spd->offset));
-						if (ret == NULL)
-							return -1;
-					}
-
-					sp += JFFS2_SUMMARY_DIRENT_SIZE(
-							spd->nsize);
 
-					break;
-				}
-				default : {
-					uint16_t nodetype = sum_get_unaligned16(
-								&spu->nodetype);
-					printf("Unsupported node type %x found"
-							" in summary!\n",
-							nodetype);
-					if ((nodetype & JFFS2_COMPAT_MASK) ==
-							JFFS2_FEATURE_INCOMPAT)
-						return -EIO;
-					return -EBADMSG;
+				sp += JFFS2_SUMMARY_INODE_SIZE;
+
+				break;
+			}
+			case JFFS2_NODETYPE_DIRENT: {
+				struct jffs2_sum_dirent_flash *spd = sp;
+
+				if (pass) {
+					b = insert_node(&pL->dir,
+						(u32)part->offset + offset +
+						sum_get_unaligned32(
+							&spd->offset),
+						sum_get_unaligned32(
+							&spd->pino),
+						sum_get_unaligned32(
+							&spd->version));
+					if (b == NULL)
+						return -1;
+					b->nhash = name_hash(spd->name,
+							     spd->nsize);
 				}
+
+				sp += JFFS2_SUMMARY_DIRENT_SIZE(
+						spd->nsize);
+
+				break;
+			}
+			default : {
+				uint16_t nodetype = sum_get_unaligned16(
+							&spu->nodetype);
+				printf("Unsupported node type %x found"
+						" in summary!\n",
+						nodetype);
+				if ((nodetype & JFFS2_COMPAT_MASK) ==
+						JFFS2_FEATURE_INCOMPAT)
+					return -EIO;
+				return -EBADMSG;
+			}
 			}
 		}
 	}
@@ -1471,6 +1441,8 @@ jffs2_1pass_build_lists(struct part_info * part)
 {
 	struct b_lists *pL;
 	struct jffs2_unknown_node *node;
+	struct jffs2_raw_dirent *dirent;
+	struct b_node *b;
 	u32 nr_sectors;
 	u32 i;
 	u32 counter4 = 0;
@@ -1479,6 +1451,10 @@ jffs2_1pass_build_lists(struct part_info * part)
 	u32 max_totlen = 0;
 	u32 buf_size;
 	char *buf;
+	char *sumbuf = NULL;
+#ifdef CONFIG_JFFS2_SUMMARY
+	u32 sumbuf_size = 0;
+#endif
 
 	nr_sectors = lldiv(part->size, part->sector_size);
 	/* turn off the lcd.  Refreshing the lcd adds 50% overhead to the */
@@ -1521,21 +1497,32 @@ jffs2_1pass_build_lists(struct part_info * part)
 				buf_len, buf_len, buf + buf_size - buf_len);
 
 		sm = (void *)buf + buf_size - sizeof(*sm);
-		if (sm->magic == JFFS2_SUM_MAGIC) {
+		if (sm->magic == JFFS2_SUM_MAGIC &&
+		    sm->offset < part->sector_size &&
+		    part->sector_size - sm->offset >=
+				JFFS2_SUMMARY_FRAME_SIZE) {
 			sumlen = part->sector_size - sm->offset;
 			sumptr = buf + buf_size - sumlen;
 
 			/* Now, make sure the summary itself is available */
 			if (sumlen > buf_size) {
-				/* Need to kmalloc for this. */
-				sumptr = malloc(sumlen);
-				if (!sumptr) {
+				/*
+				 * Summaries are about the same size in every
+				 * sector, keep the buffer for the next one.
+				 */
+				if (sumlen > sumbuf_size) {
+					free(sumbuf);
+					sumbuf_size = sumlen;
+					sumbuf = malloc(sumbuf_size);
+				}
+				if (!sumbuf) {
 					putstr("Can't get memory for summary "
 							"node!\n");
 					free(buf);
 					jffs2_free_cache(part);
 					return 0;
 				}
+				sumptr = sumbuf;
 				memcpy(sumptr + sumlen - buf_len, buf +
 						buf_size - buf_len, buf_len);
 			}
@@ -1553,10 +1540,9 @@ jffs2_1pass_build_lists(struct part_info * part)
 			ret = jffs2_sum_scan_sumnode(part, sector_ofs, sumptr,
 					sumlen, pL);
 
-			if (buf_size && sumlen > buf_size)
-				free(sumptr);
 			if (ret < 0) {
 				free(buf);
+				free(sumbuf);
 				jffs2_free_cache(part);
 				return 0;
 			}
@@ -1695,8 +1681,12 @@ jffs2_1pass_build_lists(struct part_info * part)
 					break;
 
 				if (insert_node(&pL->frag, (u32) part->offset +
-						ofs) == NULL) {
+						ofs, ((struct jffs2_raw_inode *)
+						      node)->ino,
+						((struct jffs2_raw_inode *)
+						 node)->version) == NULL) {
 					free(buf);
+					free(sumbuf);
 					jffs2_free_cache(part);
 					return 0;
 				}
@@ -1729,12 +1719,18 @@ jffs2_1pass_build_lists(struct part_info * part)
 					break;
 				if (! (counterN%100))
 					puts ("\b\b.  ");
-				if (insert_node(&pL->dir, (u32) part->offset +
-						ofs) == NULL) {
+				dirent = (struct jffs2_raw_dirent *)node;
+				b = insert_node(&pL->dir, (u32) part->offset +
+						ofs, dirent->pino,
+						dirent->version);
+				if (b == NULL) {
 					free(buf);
+					free(sumbuf);
 					jffs2_free_cache(part);
 					return 0;
 				}
+				b->nhash = name_hash(dirent->name,
+						     dirent->nsize);
 				if (max_totlen < node->totlen)
 					max_totlen = node->totlen;
 				counterN++;
@@ -1776,13 +1772,11 @@ jffs2_1pass_build_lists(struct part_info * part)
 	}
 
 	free(buf);
-#if defined(CONFIG_SYS_JFFS2_SORT_FRAGMENTS)
-	/*
-	 * Sort the lists.
-	 */
-	sort_list(&pL->frag);
-	sort_list(&pL->dir);
-#endif
+	free(sumbuf);
+	if (build_index(&pL->frag) || build_index(&pL->dir)) {
+		jffs2_free_cache(part);
+		return 0;
+	}
 	putstr("\b\b done.\r\n");		/* close off the dots */
 
 	/* We don't care if malloc failed - then each read operation will
@@ -1895,17 +1889,18 @@ jffs2_1pass_load(char *dest, struct part_info * part, const char *fname)
 	struct b_lists *pl;
 	long ret = 1;
 	u32 inode;
+	u32 dir;
 
 	if (! (pl  = jffs2_get_list(part, "load")))
 		return 0;
 
-	if (! (inode = jffs2_1pass_search_inode(pl, fname, 1))) {
+	if (! (inode = jffs2_1pass_search_inode(pl, fname, 1, &dir))) {
 		putstr("load: Failed to find inode\r\n");
 		return 0;
 	}
 
 	/* Resolve symlinks */
-	if (! (inode = jffs2_1pass_resolve_inode(pl, inode))) {
+	if (! (inode = jffs2_1pass_resolve_inode(pl, inode, dir))) {
 		putstr("load: Failed to resolve inode structure\r\n");
 		return 0;
 	}
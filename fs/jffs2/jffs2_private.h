@@ -7,19 +7,26 @@
 struct b_node {
 	u32 offset;
 	struct b_node *next;
+	struct b_node *hnext;	/* next node in the same index bucket */
+	u32 ino;		/* inode, or parent inode for dirents */
+	u32 version;
+	u32 nhash;		/* dirents: hash of the name */
 	enum { CRC_UNKNOWN = 0, CRC_OK, CRC_BAD } datacrc;
 };
 
 struct b_list {
 	struct b_node *listTail;
 	struct b_node *listHead;
-#ifdef CONFIG_SYS_JFFS2_SORT_FRAGMENTS
-	struct b_node *listLast;
-	int (*listCompare)(struct b_node *new, struct b_node *node);
-	u32 listLoops;
-#endif
 	u32 listCount;
 	struct mem_block *listMemBase;
+	/*
+	 * Nodes hashed by their ino field. Every bucket is sorted by ino,
+	 * name hash and version, so the nodes of one inode (or the dirents of
+	 * one directory) are adjacent, and so are all versions of a dirent,
+	 * newest last.
+	 */
+	struct b_node **listIndex;
+	u32 listIndexMask;
 };
 
 struct b_lists {
@@ -98,8 +105,4 @@ data_crc(struct jffs2_raw_inode *node)
 	}
 }
 
-#if defined(CONFIG_SYS_JFFS2_SORT_FRAGMENTS)
-/* External merge sort. */
-int sort_list(struct b_list *list);
-#endif
 #endif /* jffs2_private.h */
@@ -0,0 +1,970 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * SquashFS filesystem implementation for U-Boot
+ *
+ * Read-only support for SquashFS 4.0 images through the generic fs layer
+ * (ls, load, size, exists). Decompressed metadata and fragment blocks are
+ * kept in small LRU caches for the lifetime of a mount, and consecutive
+ * data blocks of a file are fetched with a single device read before being
+ * decompressed one by one.
+ */
+
+#include <common.h>
+#include <div64.h>
+#include <errno.h>
+#include <fs_internal.h>
+#include <malloc.h>
+#include <squashfs.h>
+#include <asm/unaligned.h>
+#include <linux/sizes.h>
+
+#include "sqfs_filesystem.h"
+
+static struct squashfs_ctxt ctxt;
+
+static int sqfs_disk_read(u64 pos, u32 len, void *buf)
+{
+	struct blk_desc *dev = ctxt.cur_dev;
+
+	if (pos + len > ctxt.bytes_used)
+		return -EINVAL;
+
+	if (!fs_devread(dev, &ctxt.cur_part_info, pos >> dev->log2blksz,
+			pos & (dev->blksz - 1), len, buf))
+		return -EIO;
+
+	return 0;
+}
+
+/*
+ * Return the decompressed metadata block whose header lives at @pos,
+ * reading it from disk only if it is not cached yet.
+ */
+static int sqfs_md_get(u64 pos, struct sqfs_md_block **blkp)
+{
+	struct sqfs_md_block *blk, *victim;
+	unsigned long out_len;
+	u32 len, size;
+	u16 hdr;
+	int i, ret;
+
+	if (!ctxt.md_cache) {
+		ctxt.md_cache = calloc(CONFIG_SQUASHFS_METADATA_CACHE,
+				       sizeof(*ctxt.md_cache));
+		ctxt.md_raw = malloc(SQFS_METADATA_HEADER_SIZE +
+				     SQFS_METADATA_BLOCK_SIZE);
+		if (!ctxt.md_cache || !ctxt.md_raw)
+			return -ENOMEM;
+		for (i = 0; i < CONFIG_SQUASHFS_METADATA_CACHE; i++)
+			ctxt.md_cache[i].pos = ~0ULL;
+	}
+
+	victim = &ctxt.md_cache[0];
+	for (i = 0; i < CONFIG_SQUASHFS_METADATA_CACHE; i++) {
+		blk = &ctxt.md_cache[i];
+		if (blk->pos == pos) {
+			blk->lru = ++ctxt.lru_clock;
+			*blkp = blk;
+			return 0;
+		}
+		if (blk->lru < victim->lru)
+			victim = blk;
+	}
+
+	/* Fetch header and payload with one read, metadata is contiguous */
+	if (pos >= ctxt.bytes_used)
+		return -EINVAL;
+	len = min_t(u64, SQFS_METADATA_HEADER_SIZE + SQFS_METADATA_BLOCK_SIZE,
+		    ctxt.bytes_used - pos);
+	if (len <= SQFS_METADATA_HEADER_SIZE)
+		return -EINVAL;
+	ret = sqfs_disk_read(pos, len, ctxt.md_raw);
+	if (ret)
+		return ret;
+
+	hdr = get_unaligned_le16(ctxt.md_raw);
+	size = SQFS_METADATA_SIZE(hdr);
+	if (!size || size > len - SQFS_METADATA_HEADER_SIZE)
+		return -EINVAL;
+
+	victim->pos = ~0ULL;
+	if (SQFS_METADATA_IS_COMPRESSED(hdr)) {
+		out_len = SQFS_METADATA_BLOCK_SIZE;
+		ret = sqfs_decompress(&ctxt, victim->data, &out_len,
+				      ctxt.md_raw + SQFS_METADATA_HEADER_SIZE,
+				      size);
+		if (ret || !out_len) {
+			printf("%s: metadata block at %llu is corrupted\n",
+			       __func__, pos);
+			return -EIO;
+		}
+	} else {
+		memcpy(victim->data, ctxt.md_raw + SQFS_METADATA_HEADER_SIZE,
+		       size);
+		out_len = size;
+	}
+
+	victim->pos = pos;
+	victim->next = pos + SQFS_METADATA_HEADER_SIZE + size;
+	victim->size = out_len;
+	victim->lru = ++ctxt.lru_clock;
+	*blkp = victim;
+
+	return 0;
+}
+
+/* Copy @len bytes at @cur out of a metadata block chain and advance @cur */
+static int sqfs_md_read(struct sqfs_md_cursor *cur, void *buf, u32 len)
+{
+	struct sqfs_md_block *blk;
+	u32 chunk;
+	int ret;
+
+	while (len) {
+		ret = sqfs_md_get(cur->block, &blk);
+		if (ret)
+			return ret;
+
+		if (cur->offset >= blk->size) {
+			cur->offset -= blk->size;
+			cur->block = blk->next;
+			continue;
+		}
+
+		chunk = min(len, blk->size - cur->offset);
+		memcpy(buf, blk->data + cur->offset, chunk);
+		buf += chunk;
+		cur->offset += chunk;
+		len -= chunk;
+	}
+
+	return 0;
+}
+
+static bool sqfs_is_dir(const struct sqfs_inode *inode)
+{
+	return inode->type == SQFS_DIR_TYPE || inode->type == SQFS_LDIR_TYPE;
+}
+
+static bool sqfs_is_reg(const struct sqfs_inode *inode)
+{
+	return inode->type == SQFS_REG_TYPE || inode->type == SQFS_LREG_TYPE;
+}
+
+static bool sqfs_is_symlink(const struct sqfs_inode *inode)
+{
+	return inode->type == SQFS_SYMLINK_TYPE ||
+	       inode->type == SQFS_LSYMLINK_TYPE;
+}
+
+static int sqfs_read_inode(u64 ref, struct sqfs_inode *inode)
+{
+	struct squashfs_base_inode base;
+	struct sqfs_md_cursor cur;
+	int ret;
+
+	cur.block = le64_to_cpu(ctxt.sblk.inode_table_start) +
+		    SQFS_INODE_BLOCK(ref);
+	cur.offset = SQFS_INODE_OFFSET(ref);
+
+	ret = sqfs_md_read(&cur, &base, sizeof(base));
+	if (ret)
+		return ret;
+
+	memset(inode, 0, sizeof(*inode));
+	inode->type = le16_to_cpu(base.inode_type);
+	inode->mode = le16_to_cpu(base.mode);
+	inode->mtime = le32_to_cpu(base.mtime);
+	inode->inode_number = le32_to_cpu(base.inode_number);
+	inode->frag_index = SQFS_INVALID_FRAG;
+
+	switch (inode->type) {
+	case SQFS_DIR_TYPE: {
+		struct squashfs_dir_inode dir;
+
+		ret = sqfs_md_read(&cur, &dir, sizeof(dir));
+		inode->file_size = le16_to_cpu(dir.file_size);
+		inode->dir_block = le32_to_cpu(dir.start_block);
+		inode->dir_offset = le16_to_cpu(dir.offset);
+		break;
+	}
+	case SQFS_LDIR_TYPE: {
+		struct squashfs_ldir_inode ldir;
+
+		ret = sqfs_md_read(&cur, &ldir, sizeof(ldir));
+		inode->file_size = le32_to_cpu(ldir.file_size);
+		inode->dir_block = le32_to_cpu(ldir.start_block);
+		inode->dir_offset = le16_to_cpu(ldir.offset);
+		inode->dir_i_count = le16_to_cpu(ldir.i_count);
+		break;
+	}
+	case SQFS_REG_TYPE: {
+		struct squashfs_reg_inode reg;
+
+		ret = sqfs_md_read(&cur, &reg, sizeof(reg));
+		inode->file_size = le32_to_cpu(reg.file_size);
+		inode->start_block = le32_to_cpu(reg.start_block);
+		inode->frag_index = le32_to_cpu(reg.fragment);
+		inode->frag_offset = le32_to_cpu(reg.offset);
+		break;
+	}
+	case SQFS_LREG_TYPE: {
+		struct squashfs_lreg_inode lreg;
+
+		ret = sqfs_md_read(&cur, &lreg, sizeof(lreg));
+		inode->file_size = le64_to_cpu(lreg.file_size);
+		inode->start_block = le64_to_cpu(lreg.start_block);
+		inode->frag_index = le32_to_cpu(lreg.fragment);
+		inode->frag_offset = le32_to_cpu(lreg.offset);
+		break;
+	}
+	case SQFS_SYMLINK_TYPE:
+	case SQFS_LSYMLINK_TYPE: {
+		struct squashfs_symlink_inode symlink;
+
+		ret = sqfs_md_read(&cur, &symlink, sizeof(symlink));
+		inode->file_size = le32_to_cpu(symlink.symlink_size);
+		break;
+	}
+	case SQFS_BLKDEV_TYPE:
+	case SQFS_CHRDEV_TYPE:
+	case SQFS_FIFO_TYPE:
+	case SQFS_SOCKET_TYPE:
+	case SQFS_LBLKDEV_TYPE:
+	case SQFS_LCHRDEV_TYPE:
+	case SQFS_LFIFO_TYPE:
+	case SQFS_LSOCKET_TYPE:
+		break;
+	default:
+		printf("%s: unknown inode type %u\n", __func__, inode->type);
+		return -EINVAL;
+	}
+
+	inode->extra = cur;
+
+	return ret;
+}
+
+static int sqfs_read_symlink(const struct sqfs_inode *inode, char **targetp)
+{
+	struct sqfs_md_cursor cur = inode->extra;
+	char *target;
+	int ret;
+
+	if (!inode->file_size || inode->file_size > SQFS_METADATA_BLOCK_SIZE)
+		return -EINVAL;
+
+	target = malloc(inode->file_size + 1);
+	if (!target)
+		return -ENOMEM;
+
+	ret = sqfs_md_read(&cur, target, inode->file_size);
+	if (ret) {
+		free(target);
+		return ret;
+	}
+	target[inode->file_size] = '\0';
+	*targetp = target;
+
+	return 0;
+}
+
+static void sqfs_dir_open(const struct sqfs_inode *dir,
+			  struct squashfs_dir_stream *dirs)
+{
+	dirs->cur.block = le64_to_cpu(ctxt.sblk.directory_table_start) +
+			  dir->dir_block;
+	dirs->cur.offset = dir->dir_offset;
+	dirs->remaining = dir->file_size > SQFS_DIR_EMPTY_SIZE ?
+			  dir->file_size - SQFS_DIR_EMPTY_SIZE : 0;
+	dirs->entries_left = 0;
+}
+
+/*
+ * Extended directories carry an index of the first name in each metadata
+ * block of the listing. Use it to skip straight to the block that may hold
+ * @name instead of parsing the listing from its start.
+ */
+static int sqfs_dir_seek_index(const struct sqfs_inode *dir, const char *name,
+			       struct squashfs_dir_stream *dirs)
+{
+	struct sqfs_md_cursor cur = dir->extra;
+	struct squashfs_dir_index index;
+	char index_name[SQFS_MAX_NAME_LEN + 1];
+	u32 length = 0, block = dir->dir_block;
+	u32 i, size;
+	int ret;
+
+	for (i = 0; i < dir->dir_i_count; i++) {
+		ret = sqfs_md_read(&cur, &index, sizeof(index));
+		if (ret)
+			return ret;
+
+		size = le32_to_cpu(index.size) + 1;
+		if (size > SQFS_MAX_NAME_LEN)
+			return -EINVAL;
+		ret = sqfs_md_read(&cur, index_name, size);
+		if (ret)
+			return ret;
+		index_name[size] = '\0';
+
+		if (strcmp(index_name, name) > 0)
+			break;
+
+		length = le32_to_cpu(index.index);
+		block = le32_to_cpu(index.start_block);
+	}
+
+	if (length > dirs->remaining)
+		return -EINVAL;
+
+	dirs->cur.block = le64_to_cpu(ctxt.sblk.directory_table_start) + block;
+	dirs->cur.offset = (dir->dir_offset + length) % SQFS_METADATA_BLOCK_SIZE;
+	dirs->remaining -= length;
+
+	return 0;
+}
+
+/*
+ * Parse the next entry of a directory listing.
+ *
+ * @return 1 if an entry was returned, 0 at the end of the listing or a
+ * negative error code
+ */
+static int sqfs_dir_next(struct squashfs_dir_stream *dirs, char *name,
+			 u64 *ref, u16 *type)
+{
+	struct squashfs_directory_entry entry;
+	u32 size;
+	int ret;
+
+	if (!dirs->entries_left) {
+		struct squashfs_directory_header hdr;
+
+		if (dirs->remaining < sizeof(hdr))
+			return 0;
+		ret = sqfs_md_read(&dirs->cur, &hdr, sizeof(hdr));
+		if (ret)
+			return ret;
+		dirs->remaining -= sizeof(hdr);
+		dirs->entries_left = le32_to_cpu(hdr.count) + 1;
+		dirs->header_start = le32_to_cpu(hdr.start);
+		if (dirs->entries_left > SQFS_DIR_HEADER_MAX_COUNT)
+			return -EINVAL;
+	}
+
+	if (dirs->remaining < sizeof(entry))
+		return -EINVAL;
+	ret = sqfs_md_read(&dirs->cur, &entry, sizeof(entry));
+	if (ret)
+		return ret;
+	dirs->remaining -= sizeof(entry);
+
+	size = le16_to_cpu(entry.name_size) + 1;
+	if (size > SQFS_MAX_NAME_LEN || size > dirs->remaining)
+		return -EINVAL;
+	ret = sqfs_md_read(&dirs->cur, name, size);
+	if (ret)
+		return ret;
+	name[size] = '\0';
+	dirs->remaining -= size;
+	dirs->entries_left--;
+
+	*ref = SQFS_MKREF(dirs->header_start, le16_to_cpu(entry.offset));
+	*type = le16_to_cpu(entry.type);
+
+	return 1;
+}
+
+static int sqfs_dir_lookup(const struct sqfs_inode *dir, const char *name,
+			   u64 *ref)
+{
+	struct squashfs_dir_stream dirs;
+	char entry_name[SQFS_MAX_NAME_LEN + 1];
+	u16 type;
+	int ret;
+
+	sqfs_dir_open(dir, &dirs);
+	if (dir->dir_i_count) {
+		ret = sqfs_dir_seek_index(dir, name, &dirs);
+		if (ret)
+			return ret;
+	}
+
+	while ((ret = sqfs_dir_next(&dirs, entry_name, ref, &type)) > 0) {
+		if (!strcmp(entry_name, name))
+			return 0;
+	}
+
+	return ret ? ret : -ENOENT;
+}
+
+/*
+ * Resolve @path relative to the directory on top of @stack, pushing the
+ * inode reference of each component. Symbolic links are followed for
+ * intermediate components, and for the last one if @follow is set.
+ */
+static int sqfs_walk(u64 *stack, int *depth, const char *path, int links,
+		     bool follow)
+{
+	char name[SQFS_MAX_NAME_LEN + 1];
+	struct sqfs_inode inode;
+	const char *end;
+	char *target;
+	u64 ref;
+	int ret, len;
+
+	if (*path == '/')
+		*depth = 1;
+
+	while (*path) {
+		while (*path == '/')
+			path++;
+		if (!*path)
+			break;
+
+		end = strchr(path, '/');
+		if (!end)
+			end = path + strlen(path);
+		len = end - path;
+		if (len > SQFS_MAX_NAME_LEN)
+			return -ENAMETOOLONG;
+		memcpy(name, path, len);
+		name[len] = '\0';
+		path = end;
+
+		if (!strcmp(name, "."))
+			continue;
+		if (!strcmp(name, "..")) {
+			if (*depth > 1)
+				(*depth)--;
+			continue;
+		}
+
+		ret = sqfs_read_inode(stack[*depth - 1], &inode);
+		if (ret)
+			return ret;
+		if (!sqfs_is_dir(&inode))
+			return -ENOTDIR;
+
+		ret = sqfs_dir_lookup(&inode, name, &ref);
+		if (ret)
+			return ret;
+
+		ret = sqfs_read_inode(ref, &inode);
+		if (ret)
+			return ret;
+
+		if (sqfs_is_symlink(&inode) && (follow || *path)) {
+			if (!links)
+				return -ELOOP;
+			ret = sqfs_read_symlink(&inode, &target);
+			if (ret)
+				return ret;
+			ret = sqfs_walk(stack, depth, target, links - 1, true);
+			free(target);
+			if (ret)
+				return ret;
+			continue;
+		}
+
+		if (*depth >= SQFS_MAX_PATH_DEPTH)
+			return -ENAMETOOLONG;
+		stack[(*depth)++] = ref;
+	}
+
+	return 0;
+}
+
+static int sqfs_lookup(const char *path, bool follow, struct sqfs_inode *inode)
+{
+	u64 stack[SQFS_MAX_PATH_DEPTH];
+	int depth = 1;
+	int ret;
+
+	stack[0] = le64_to_cpu(ctxt.sblk.root_inode);
+	ret = sqfs_walk(stack, &depth, path, SQFS_MAX_SYMLINK_FOLLOW, follow);
+	if (ret)
+		return ret;
+
+	return sqfs_read_inode(stack[depth - 1], inode);
+}
+
+static int sqfs_alloc_data_bufs(void)
+{
+	if (ctxt.read_buf)
+		return 0;
+
+	ctxt.read_buf_size = max_t(u32, ctxt.block_size,
+				   CONFIG_SQUASHFS_READAHEAD_SIZE);
+	ctxt.read_buf = malloc(ctxt.read_buf_size);
+	ctxt.block_buf = malloc(ctxt.block_size);
+	if (!ctxt.read_buf || !ctxt.block_buf)
+		return -ENOMEM;
+
+	return 0;
+}
+
+/* Return the decompressed fragment block @index, caching it */
+static int sqfs_frag_get(u32 index, struct sqfs_frag_block **fragp)
+{
+	struct squashfs_fragment_entry entry;
+	struct sqfs_frag_block *frag, *victim;
+	struct sqfs_md_cursor cur;
+	u32 nfrags = le32_to_cpu(ctxt.sblk.fragments);
+	unsigned long out_len;
+	u32 size, disk_size;
+	u64 start;
+	int i, ret;
+
+	if (index >= nfrags)
+		return -EINVAL;
+
+	if (!ctxt.frag_table) {
+		u32 len = DIV_ROUND_UP(nfrags, SQFS_FRAG_ENTRIES_PER_BLOCK) *
+			  sizeof(*ctxt.frag_table);
+
+		ctxt.frag_table = malloc(len);
+		if (!ctxt.frag_table)
+			return -ENOMEM;
+		ret = sqfs_disk_read(le64_to_cpu(ctxt.sblk.fragment_table_start),
+				     len, ctxt.frag_table);
+		if (ret) {
+			free(ctxt.frag_table);
+			ctxt.frag_table = NULL;
+			return ret;
+		}
+	}
+
+	cur.block = le64_to_cpu(ctxt.frag_table[index /
+						SQFS_FRAG_ENTRIES_PER_BLOCK]);
+	cur.offset = (index % SQFS_FRAG_ENTRIES_PER_BLOCK) * sizeof(entry);
+	ret = sqfs_md_read(&cur, &entry, sizeof(entry));
+	if (ret)
+		return ret;
+
+	start = le64_to_cpu(entry.start);
+	size = le32_to_cpu(entry.size);
+	disk_size = SQFS_DATA_BLOCK_SIZE(size);
+	if (!disk_size || disk_size > ctxt.block_size)
+		return -EINVAL;
+
+	victim = &ctxt.frag_cache[0];
+	for (i = 0; i < CONFIG_SQUASHFS_FRAGMENT_CACHE; i++) {
+		frag = &ctxt.frag_cache[i];
+		if (frag->data && frag->start == start) {
+			frag->lru = ++ctxt.lru_clock;
+			*fragp = frag;
+			return 0;
+		}
+		if (frag->lru < victim->lru)
+			victim = frag;
+	}
+
+	ret = sqfs_alloc_data_bufs();
+	if (ret)
+		return ret;
+	if (!victim->data) {
+		victim->data = malloc(ctxt.block_size);
+		if (!victim->data)
+			return -ENOMEM;
+	}
+
+	victim->start = ~0ULL;
+	if (SQFS_DATA_IS_COMPRESSED(size)) {
+		ret = sqfs_disk_read(start, disk_size, ctxt.read_buf);
+		if (ret)
+			return ret;
+		out_len = ctxt.block_size;
+		ret = sqfs_decompress(&ctxt, victim->data, &out_len,
+				      ctxt.read_buf, disk_size);
+		if (ret) {
+			printf("%s: fragment %u is corrupted\n", __func__,
+			       index);
+			return ret;
+		}
+	} else {
+		ret = sqfs_disk_read(start, disk_size, victim->data);
+		if (ret)
+			return ret;
+		out_len = disk_size;
+	}
+
+	victim->start = start;
+	victim->size = out_len;
+	victim->lru = ++ctxt.lru_clock;
+	*fragp = victim;
+
+	return 0;
+}
+
+/*
+ * Produce bytes [@from, @to) of a data block stored at @src into @dst.
+ * Blocks that are wanted whole are decompressed straight into @dst.
+ */
+static int sqfs_unpack_block(void *dst, void *src, u32 size, u64 blk_start,
+			     u32 blk_len, u64 from, u64 to)
+{
+	unsigned long out_len;
+	int ret;
+
+	if (!SQFS_DATA_IS_COMPRESSED(size)) {
+		if (SQFS_DATA_BLOCK_SIZE(size) < to - blk_start)
+			return -EINVAL;
+		memcpy(dst, src + (from - blk_start), to - from);
+		return 0;
+	}
+
+	if (from == blk_start && to == blk_start + blk_len) {
+		out_len = blk_len;
+		ret = sqfs_decompress(&ctxt, dst, &out_len, src,
+				      SQFS_DATA_BLOCK_SIZE(size));
+	} else {
+		out_len = ctxt.block_size;
+		ret = sqfs_decompress(&ctxt, ctxt.block_buf, &out_len, src,
+				      SQFS_DATA_BLOCK_SIZE(size));
+		if (!ret && out_len >= to - blk_start)
+			memcpy(dst, ctxt.block_buf + (from - blk_start),
+			       to - from);
+	}
+	if (ret || out_len < to - blk_start) {
+		printf("%s: data block at offset %llu is corrupted\n",
+		       __func__, blk_start);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+/* Read bytes [@offset, @offset + @len) of a regular file into @buf */
+static int sqfs_read_data(const struct sqfs_inode *inode, void *buf,
+			  u64 offset, u64 len)
+{
+	u32 bs = ctxt.block_size;
+	bool has_frag = inode->frag_index != SQFS_INVALID_FRAG;
+	u64 end = offset + len;
+	u64 pos, blk_start, from, to, run;
+	u32 nblocks, first, last, i, j, k, size;
+	__le32 *list = NULL;
+	int ret;
+
+	nblocks = has_frag ? inode->file_size >> ctxt.block_log :
+			     DIV_ROUND_UP_ULL(inode->file_size, bs);
+	first = offset >> ctxt.block_log;
+	last = min_t(u64, DIV_ROUND_UP_ULL(end, bs), nblocks);
+
+	ret = sqfs_alloc_data_bufs();
+	if (ret)
+		return ret;
+
+	if (first < last) {
+		struct sqfs_md_cursor cur = inode->extra;
+
+		list = malloc(last * sizeof(*list));
+		if (!list)
+			return -ENOMEM;
+		ret = sqfs_md_read(&cur, list, last * sizeof(*list));
+		if (ret)
+			goto out;
+
+		pos = inode->start_block;
+		for (i = 0; i < first; i++)
+			pos += SQFS_DATA_BLOCK_SIZE(le32_to_cpu(list[i]));
+
+		for (i = first; i < last; i = j) {
+			size = le32_to_cpu(list[i]);
+			blk_start = (u64)i << ctxt.block_log;
+			from = max(offset, blk_start);
+			to = min(end, blk_start + bs);
+			j = i + 1;
+
+			if (SQFS_DATA_BLOCK_SIZE(size) > bs) {
+				ret = -EINVAL;
+				goto out;
+			}
+
+			/* Sparse block */
+			if (!SQFS_DATA_BLOCK_SIZE(size)) {
+				memset(buf + (from - offset), 0, to - from);
+				continue;
+			}
+
+			/*
+			 * Runs of stored blocks that are wanted whole go
+			 * straight to the destination buffer.
+			 */
+			if (!SQFS_DATA_IS_COMPRESSED(size) && from == blk_start &&
+			    SQFS_DATA_BLOCK_SIZE(size) == to - from) {
+				run = to - from;
+				while (j < last && run < SZ_1G) {
+					size = le32_to_cpu(list[j]);
+					blk_start = (u64)j << ctxt.block_log;
+					if (SQFS_DATA_IS_COMPRESSED(size) ||
+					    SQFS_DATA_BLOCK_SIZE(size) !=
+					    min(end, blk_start + bs) - blk_start)
+						break;
+					run += SQFS_DATA_BLOCK_SIZE(size);
+					j++;
+				}
+				ret = sqfs_disk_read(pos, run,
+						     buf + (from - offset));
+				if (ret)
+					goto out;
+				pos += run;
+				continue;
+			}
+
+			/*
+			 * Read ahead as many following blocks as fit in the
+			 * staging buffer, then unpack them one by one.
+			 */
+			run = SQFS_DATA_BLOCK_SIZE(size);
+			while (j < last) {
+				size = SQFS_DATA_BLOCK_SIZE(le32_to_cpu(list[j]));
+				if (!size || size > bs ||
+				    run + size > ctxt.read_buf_size)
+					break;
+				run += size;
+				j++;
+			}
+			ret = sqfs_disk_read(pos, run, ctxt.read_buf);
+			if (ret)
+				goto out;
+
+			run = 0;
+			for (k = i; k < j; k++) {
+				size = le32_to_cpu(list[k]);
+				blk_start = (u64)k << ctxt.block_log;
+				from = max(offset, blk_start);
+				to = min(end, blk_start + bs);
+				ret = sqfs_unpack_block(buf + (from - offset),
+							ctxt.read_buf + run,
+							size, blk_start,
+							min_t(u64, bs,
+							      inode->file_size -
+							      blk_start),
+							from, to);
+				if (ret)
+					goto out;
+				run += SQFS_DATA_BLOCK_SIZE(size);
+			}
+			pos += run;
+		}
+		free(list);
+	}
+
+	/* Tail end packed into a fragment block */
+	blk_start = (u64)nblocks << ctxt.block_log;
+	if (has_frag && end > blk_start) {
+		struct sqfs_frag_block *frag;
+
+		ret = sqfs_frag_get(inode->frag_index, &frag);
+		if (ret)
+			return ret;
+
+		from = max(offset, blk_start);
+		if (inode->frag_offset + (end - blk_start) > frag->size)
+			return -EINVAL;
+		memcpy(buf + (from - offset),
+		       frag->data + inode->frag_offset + (from - blk_start),
+		       end - from);
+	}
+
+	return 0;
+
+out:
+	free(list);
+	return ret;
+}
+
+int sqfs_probe(struct blk_desc *fs_dev_desc, disk_partition_t *fs_partition)
+{
+	struct squashfs_super_block *sblk = &ctxt.sblk;
+	u64 part_bytes;
+
+	memset(&ctxt, 0, sizeof(ctxt));
+	ctxt.cur_dev = fs_dev_desc;
+	ctxt.cur_part_info = *fs_partition;
+	part_bytes = (u64)fs_partition->size << fs_dev_desc->log2blksz;
+	ctxt.bytes_used = part_bytes;
+
+	if (sqfs_disk_read(0, sizeof(*sblk), sblk))
+		goto err;
+
+	if (le32_to_cpu(sblk->s_magic) != SQFS_MAGIC_NUMBER)
+		goto err;
+
+	if (le16_to_cpu(sblk->s_major) != SQFS_MAJOR_VERSION) {
+		printf("%s: unsupported SquashFS version %u.%u\n", __func__,
+		       le16_to_cpu(sblk->s_major), le16_to_cpu(sblk->s_minor));
+		goto err;
+	}
+
+	ctxt.block_size = le32_to_cpu(sblk->block_size);
+	ctxt.block_log = le16_to_cpu(sblk->block_log);
+	if (ctxt.block_log < 12 || ctxt.block_log > 20 ||
+	    ctxt.block_size != 1 << ctxt.block_log) {
+		printf("%s: invalid block size %u\n", __func__,
+		       ctxt.block_size);
+		goto err;
+	}
+
+	ctxt.bytes_used = le64_to_cpu(sblk->bytes_used);
+	if (ctxt.bytes_used > part_bytes) {
+		printf("%s: filesystem larger than partition\n", __func__);
+		goto err;
+	}
+
+	ctxt.comp = le16_to_cpu(sblk->compression);
+	if (sqfs_decompressor_init(&ctxt))
+		goto err;
+
+	return 0;
+
+err:
+	ctxt.cur_dev = NULL;
+	return -EINVAL;
+}
+
+int sqfs_opendir(const char *filename, struct fs_dir_stream **dirsp)
+{
+	struct squashfs_dir_stream *dirs;
+	struct sqfs_inode inode;
+	int ret;
+
+	ret = sqfs_lookup(filename, true, &inode);
+	if (ret)
+		return ret;
+	if (!sqfs_is_dir(&inode))
+		return -ENOTDIR;
+
+	dirs = calloc(1, sizeof(*dirs));
+	if (!dirs)
+		return -ENOMEM;
+
+	sqfs_dir_open(&inode, dirs);
+	*dirsp = &dirs->fs_dirs;
+
+	return 0;
+}
+
+int sqfs_readdir(struct fs_dir_stream *fs_dirs, struct fs_dirent **dentp)
+{
+	struct squashfs_dir_stream *dirs = (struct squashfs_dir_stream *)fs_dirs;
+	char name[SQFS_MAX_NAME_LEN + 1];
+	struct sqfs_inode inode;
+	u64 ref;
+	u16 type;
+	int ret;
+
+	ret = sqfs_dir_next(dirs, name, &ref, &type);
+	if (ret <= 0)
+		return ret ? ret : -ENOENT;
+
+	memset(&dirs->dentp, 0, sizeof(dirs->dentp));
+	strlcpy(dirs->dentp.name, name, sizeof(dirs->dentp.name));
+
+	switch (type) {
+	case SQFS_DIR_TYPE:
+	case SQFS_LDIR_TYPE:
+		dirs->dentp.type = FS_DT_DIR;
+		break;
+	case SQFS_SYMLINK_TYPE:
+	case SQFS_LSYMLINK_TYPE:
+		dirs->dentp.type = FS_DT_LNK;
+		break;
+	default:
+		dirs->dentp.type = FS_DT_REG;
+		break;
+	}
+
+	if (dirs->dentp.type != FS_DT_DIR) {
+		ret = sqfs_read_inode(ref, &inode);
+		if (ret)
+			return ret;
+		dirs->dentp.size = inode.file_size;
+	}
+
+	*dentp = &dirs->dentp;
+
+	return 0;
+}
+
+void sqfs_closedir(struct fs_dir_stream *dirs)
+{
+	free(dirs);
+}
+
+int sqfs_exists(const char *filename)
+{
+	struct sqfs_inode inode;
+
+	return !sqfs_lookup(filename, true, &inode);
+}
+
+int sqfs_size(const char *filename, loff_t *size)
+{
+	struct sqfs_inode inode;
+	int ret;
+
+	ret = sqfs_lookup(filename, true, &inode);
+	if (ret)
+		return ret;
+	if (!sqfs_is_reg(&inode))
+		return -EISDIR;
+
+	*size = inode.file_size;
+
+	return 0;
+}
+
+int sqfs_read(const char *filename, void *buf, loff_t offset, loff_t len,
+	      loff_t *actread)
+{
+	struct sqfs_inode inode;
+	int ret;
+
+	*actread = 0;
+
+	ret = sqfs_lookup(filename, true, &inode);
+	if (ret) {
+		printf("** File not found %s **\n", filename);
+		return ret;
+	}
+	if (!sqfs_is_reg(&inode)) {
+		printf("** %s is not a regular file **\n", filename);
+		return -EISDIR;
+	}
+
+	if (offset > inode.file_size) {
+		printf("** Offset %lld exceeds file size %llu **\n", offset,
+		       inode.file_size);
+		return -EINVAL;
+	}
+	if (!len || len > inode.file_size - offset)
+		len = inode.file_size - offset;
+	if (!len)
+		return 0;
+
+	ret = sqfs_read_data(&inode, buf, offset, len);
+	if (ret)
+		return ret;
+
+	*actread = len;
+
+	return 0;
+}
+
+void sqfs_close(void)
+{
+	int i;
+
+	free(ctxt.md_cache);
+	free(ctxt.md_raw);
+	for (i = 0; i < CONFIG_SQUASHFS_FRAGMENT_CACHE; i++)
+		free(ctxt.frag_cache[i].data);
+	free(ctxt.frag_table);
+	free(ctxt.read_buf);
+	free(ctxt.block_buf);
+	memset(&ctxt, 0, sizeof(ctxt));
+}
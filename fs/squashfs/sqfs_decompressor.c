@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * SquashFS filesystem implementation for U-Boot
+ *
+ * Block decompression, dispatched on the superblock compression id.
+ */
+
+#include <common.h>
+#include <errno.h>
+#include <linux/lzo.h>
+#ifdef CONFIG_LZMA
+#include <lzma/LzmaTypes.h>
+#include <lzma/LzmaDec.h>
+#include <lzma/LzmaTools.h>
+#endif
+
+#include "sqfs_filesystem.h"
+
+static const char *sqfs_comp_name(u16 comp)
+{
+	switch (comp) {
+	case SQFS_COMP_ZLIB:
+		return "gzip";
+	case SQFS_COMP_LZMA:
+		return "lzma";
+	case SQFS_COMP_LZO:
+		return "lzo";
+	case SQFS_COMP_XZ:
+		return "xz";
+	case SQFS_COMP_LZ4:
+		return "lz4";
+	case SQFS_COMP_ZSTD:
+		return "zstd";
+	default:
+		return "unknown";
+	}
+}
+
+int sqfs_decompressor_init(struct squashfs_ctxt *ctxt)
+{
+	switch (ctxt->comp) {
+#ifdef CONFIG_GZIP
+	case SQFS_COMP_ZLIB:
+#endif
+#ifdef CONFIG_LZMA
+	case SQFS_COMP_LZMA:
+#endif
+#ifdef CONFIG_LZO
+	case SQFS_COMP_LZO:
+#endif
+#ifdef CONFIG_LZ4
+	case SQFS_COMP_LZ4:
+#endif
+		return 0;
+	default:
+		printf("%s: %s compression is not supported\n", __func__,
+		       sqfs_comp_name(ctxt->comp));
+		return -EPROTONOSUPPORT;
+	}
+}
+
+int sqfs_decompress(struct squashfs_ctxt *ctxt, void *dest,
+		    unsigned long *dest_len, void *src, u32 src_len)
+{
+	int ret;
+
+	switch (ctxt->comp) {
+#ifdef CONFIG_GZIP
+	case SQFS_COMP_ZLIB: {
+		unsigned long len = src_len;
+
+		/* Skip the two byte zlib header, the adler32 is ignored */
+		ret = zunzip(dest, *dest_len, src, &len, 1, 2);
+		if (ret)
+			return -EIO;
+		*dest_len = len;
+		break;
+	}
+#endif
+#ifdef CONFIG_LZMA
+	case SQFS_COMP_LZMA: {
+		SizeT len = *dest_len;
+
+		ret = lzmaBuffToBuffDecompress(dest, &len, src, src_len);
+		if (ret != SZ_OK)
+			return -EIO;
+		*dest_len = len;
+		break;
+	}
+#endif
+#ifdef CONFIG_LZO
+	case SQFS_COMP_LZO: {
+		size_t len = *dest_len;
+
+		ret = lzo1x_decompress_safe(src, src_len, dest, &len);
+		if (ret != LZO_E_OK)
+			return -EIO;
+		*dest_len = len;
+		break;
+	}
+#endif
+#ifdef CONFIG_LZ4
+	case SQFS_COMP_LZ4: {
+		size_t len = *dest_len;
+
+		ret = ulz4_block(src, src_len, dest, &len);
+		if (ret)
+			return -EIO;
+		*dest_len = len;
+		break;
+	}
+#endif
+	default:
+		return -EPROTONOSUPPORT;
+	}
+
+	return 0;
+}
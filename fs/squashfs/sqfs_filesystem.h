@@ -0,0 +1,255 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * SquashFS filesystem implementation for U-Boot
+ *
+ * On-disk layout of a SquashFS 4.0 image and private driver state.
+ */
+
+#ifndef __SQFS_FILESYSTEM_H__
+#define __SQFS_FILESYSTEM_H__
+
+#include <common.h>
+#include <fs.h>
+#include <part.h>
+#include <linux/types.h>
+
+#define SQFS_MAGIC_NUMBER		0x73717368
+#define SQFS_MAJOR_VERSION		4
+
+#define SQFS_METADATA_BLOCK_SIZE	8192
+/* A metadata block is preceded by a 16-bit little-endian length header */
+#define SQFS_METADATA_HEADER_SIZE	2
+#define SQFS_METADATA_SIZE(hdr)		((hdr) & 0x7fff)
+#define SQFS_METADATA_IS_COMPRESSED(hdr) (!((hdr) & 0x8000))
+
+/* Data block and fragment sizes carry an "uncompressed" flag in bit 24 */
+#define SQFS_DATA_BLOCK_SIZE(x)		((x) & ~(1 << 24))
+#define SQFS_DATA_IS_COMPRESSED(x)	(!((x) & (1 << 24)))
+
+/* Inode references: metadata block offset << 16 | offset in block */
+#define SQFS_INODE_BLOCK(ref)		((u32)((ref) >> 16))
+#define SQFS_INODE_OFFSET(ref)		((u32)((ref) & 0xffff))
+#define SQFS_MKREF(block, offset)	(((u64)(block) << 16) | (offset))
+
+#define SQFS_INVALID_FRAG		0xffffffff
+#define SQFS_DIR_HEADER_MAX_COUNT	256
+#define SQFS_MAX_NAME_LEN		256
+/* Directory file_size accounts for the "." and ".." entries */
+#define SQFS_DIR_EMPTY_SIZE		3
+
+/* Limits on path resolution */
+#define SQFS_MAX_PATH_DEPTH		64
+#define SQFS_MAX_SYMLINK_FOLLOW		8
+
+enum sqfs_compression {
+	SQFS_COMP_ZLIB = 1,
+	SQFS_COMP_LZMA = 2,
+	SQFS_COMP_LZO = 3,
+	SQFS_COMP_XZ = 4,
+	SQFS_COMP_LZ4 = 5,
+	SQFS_COMP_ZSTD = 6,
+};
+
+enum sqfs_inode_type {
+	SQFS_DIR_TYPE = 1,
+	SQFS_REG_TYPE = 2,
+	SQFS_SYMLINK_TYPE = 3,
+	SQFS_BLKDEV_TYPE = 4,
+	SQFS_CHRDEV_TYPE = 5,
+	SQFS_FIFO_TYPE = 6,
+	SQFS_SOCKET_TYPE = 7,
+	SQFS_LDIR_TYPE = 8,
+	SQFS_LREG_TYPE = 9,
+	SQFS_LSYMLINK_TYPE = 10,
+	SQFS_LBLKDEV_TYPE = 11,
+	SQFS_LCHRDEV_TYPE = 12,
+	SQFS_LFIFO_TYPE = 13,
+	SQFS_LSOCKET_TYPE = 14,
+};
+
+struct squashfs_super_block {
+	__le32 s_magic;
+	__le32 inodes;
+	__le32 mkfs_time;
+	__le32 block_size;
+	__le32 fragments;
+	__le16 compression;
+	__le16 block_log;
+	__le16 flags;
+	__le16 no_ids;
+	__le16 s_major;
+	__le16 s_minor;
+	__le64 root_inode;
+	__le64 bytes_used;
+	__le64 id_table_start;
+	__le64 xattr_id_table_start;
+	__le64 inode_table_start;
+	__le64 directory_table_start;
+	__le64 fragment_table_start;
+	__le64 export_table_start;
+};
+
+struct squashfs_base_inode {
+	__le16 inode_type;
+	__le16 mode;
+	__le16 uid;
+	__le16 guid;
+	__le32 mtime;
+	__le32 inode_number;
+};
+
+struct squashfs_dir_inode {
+	__le32 start_block;
+	__le32 nlink;
+	__le16 file_size;
+	__le16 offset;
+	__le32 parent_inode;
+};
+
+struct squashfs_ldir_inode {
+	__le32 nlink;
+	__le32 file_size;
+	__le32 start_block;
+	__le32 parent_inode;
+	__le16 i_count;
+	__le16 offset;
+	__le32 xattr;
+	/* followed by i_count struct squashfs_dir_index */
+};
+
+struct squashfs_dir_index {
+	__le32 index;
+	__le32 start_block;
+	__le32 size;
+	/* followed by size + 1 bytes of name */
+};
+
+struct squashfs_reg_inode {
+	__le32 start_block;
+	__le32 fragment;
+	__le32 offset;
+	__le32 file_size;
+	/* followed by the block list */
+};
+
+struct squashfs_lreg_inode {
+	__le64 start_block;
+	__le64 file_size;
+	__le64 sparse;
+	__le32 nlink;
+	__le32 fragment;
+	__le32 offset;
+	__le32 xattr;
+	/* followed by the block list */
+};
+
+struct squashfs_symlink_inode {
+	__le32 nlink;
+	__le32 symlink_size;
+	/* followed by symlink_size bytes of target */
+};
+
+struct squashfs_directory_header {
+	__le32 count;
+	__le32 start;
+	__le32 inode_number;
+};
+
+struct squashfs_directory_entry {
+	__le16 offset;
+	__le16 inode_offset;
+	__le16 type;
+	__le16 name_size;
+	/* followed by name_size + 1 bytes of name */
+};
+
+struct squashfs_fragment_entry {
+	__le64 start;
+	__le32 size;
+	__le32 unused;
+};
+
+#define SQFS_FRAG_ENTRIES_PER_BLOCK \
+	(SQFS_METADATA_BLOCK_SIZE / sizeof(struct squashfs_fragment_entry))
+
+/* Position inside a chain of metadata blocks */
+struct sqfs_md_cursor {
+	u64 block;	/* absolute byte offset of the block header */
+	u32 offset;	/* offset within the uncompressed block */
+};
+
+/* Decompressed metadata block, see sqfs_md_get() */
+struct sqfs_md_block {
+	u64 pos;	/* absolute byte offset of the header, ~0 if unused */
+	u64 next;	/* absolute byte offset of the following block */
+	u32 size;	/* uncompressed length */
+	u32 lru;
+	u8 data[SQFS_METADATA_BLOCK_SIZE];
+};
+
+/* Decompressed fragment block, see sqfs_frag_get() */
+struct sqfs_frag_block {
+	u64 start;	/* absolute byte offset on disk, ~0 if unused */
+	u32 size;	/* uncompressed length */
+	u32 lru;
+	void *data;	/* block_size bytes */
+};
+
+/* In-memory view of an inode, regardless of its basic/extended form */
+struct sqfs_inode {
+	u16 type;
+	u16 mode;
+	u32 mtime;
+	u32 inode_number;
+	u64 file_size;
+	/* regular files */
+	u64 start_block;
+	u32 frag_index;
+	u32 frag_offset;
+	/* directories */
+	u32 dir_block;
+	u16 dir_offset;
+	u16 dir_i_count;
+	/* block list, symlink target or directory index follows here */
+	struct sqfs_md_cursor extra;
+};
+
+struct squashfs_dir_stream {
+	struct fs_dir_stream fs_dirs;
+	struct fs_dirent dentp;
+	struct sqfs_md_cursor cur;
+	u32 remaining;		/* listing bytes left to parse */
+	u32 entries_left;	/* entries left under the current header */
+	u32 header_start;	/* inode block of the current header */
+};
+
+struct squashfs_ctxt {
+	struct blk_desc *cur_dev;
+	disk_partition_t cur_part_info;
+	struct squashfs_super_block sblk;
+	u16 comp;
+	u32 block_size;
+	u16 block_log;
+	u64 bytes_used;
+
+	/* Metadata block cache, allocated on first use */
+	struct sqfs_md_block *md_cache;
+	u8 *md_raw;		/* one on-disk metadata block */
+	/* Fragment block cache, entries allocated on first use */
+	struct sqfs_frag_block frag_cache[CONFIG_SQUASHFS_FRAGMENT_CACHE];
+	/* Fragment table index, loaded on first fragment access */
+	__le64 *frag_table;
+	u32 lru_clock;
+
+	/* Staging buffers for data block reads */
+	void *read_buf;		/* compressed data, readahead window */
+	u32 read_buf_size;
+	void *block_buf;	/* one decompressed data block */
+};
+
+/* sqfs_decompressor.c */
+int sqfs_decompressor_init(struct squashfs_ctxt *ctxt);
+int sqfs_decompress(struct squashfs_ctxt *ctxt, void *dest,
+		    unsigned long *dest_len, void *src, u32 src_len);
+
+#endif /* __SQFS_FILESYSTEM_H__ */
@@ -74,6 +74,9 @@ typedef struct global_data {
 	const void *fdt_blob;		/* Our device tree, NULL if none */
 	void *new_fdt;			/* Relocated FDT */
 	unsigned long fdt_size;		/* Space reserved for relocated FDT */
+#ifdef CONFIG_OF_LIBFDT_CACHE
+	struct fdt_cache *fdt_cache;	/* Lookup cache for fdt_blob */
+#endif
 #ifdef CONFIG_OF_LIVE
 	struct device_node *of_root;
 #endif
@@ -0,0 +1,114 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Verification of dm-verity hash trees described by AVB hashtree descriptors
+ */
+
+#ifndef _AVB_HASHTREE_H
+#define _AVB_HASHTREE_H
+
+#include <blk.h>
+#include <part.h>
+
+#define AVB_HASHTREE_MAX_SALT		64
+#define AVB_HASHTREE_MAX_DIGEST		32
+#define AVB_HASHTREE_MAX_LEVELS		16
+
+/**
+ * struct avb_hashtree - where a partition's hash tree is and how it is built
+ *
+ * @algo:		hash algorithm, "sha1" or "sha256"
+ * @image_size:		bytes of data covered by the tree
+ * @tree_offset:	offset of the tree in the partition
+ * @tree_size:		size of the tree
+ * @data_block_size:	size of each data block hashed in the lowest level
+ * @hash_block_size:	size of each block of hashes in the upper levels
+ * @salt_len:		length of @salt
+ * @root_digest_len:	length of @root_digest
+ * @salt:		prepended to every block before it is hashed
+ * @root_digest:	hash of the top level of the tree
+ */
+struct avb_hashtree {
+	char algo[8];
+	u64 image_size;
+	u64 tree_offset;
+	u64 tree_size;
+	u32 data_block_size;
+	u32 hash_block_size;
+	u32 salt_len;
+	u32 root_digest_len;
+	u8 salt[AVB_HASHTREE_MAX_SALT];
+	u8 root_digest[AVB_HASHTREE_MAX_DIGEST];
+};
+
+/**
+ * struct avb_hashtree_stats - what avb_hashtree_verify() did
+ *
+ * @bytes:	bytes read from the partition, data and tree
+ * @levels:	number of levels in the tree
+ * @time_ms:	time taken, in milliseconds
+ */
+struct avb_hashtree_stats {
+	u64 bytes;
+	int levels;
+	ulong time_ms;
+};
+
+/**
+ * avb_hashtree_from_vbmeta() - get the hash tree from a vbmeta image
+ *
+ * The caller is responsible for checking the signature of @vbmeta first.
+ *
+ * @vbmeta:	vbmeta image
+ * @size:	size of @vbmeta
+ * @name:	partition name in the descriptor, NULL to take the first one
+ * @tree:	returns the hash tree description
+ * @return 0 if OK, -ENOENT if there is no descriptor, -EINVAL if @vbmeta
+ * is malformed
+ */
+int avb_hashtree_from_vbmeta(const u8 *vbmeta, u64 size, const char *name,
+			     struct avb_hashtree *tree);
+
+/**
+ * avb_hashtree_from_footer() - get the hash tree from a partition's footer
+ *
+ * Reads the vbmeta image that an AVB footer at the end of the partition
+ * points to and takes the hashtree descriptor for @name from it. The vbmeta
+ * signature is not checked, so this only tells whether the partition is
+ * consistent with its own footer.
+ *
+ * @desc:	block device
+ * @info:	partition on @desc
+ * @name:	partition name in the descriptor, NULL to take the first one
+ * @tree:	returns the hash tree description
+ * @return 0 if OK, -ENOENT if there is no footer or descriptor, -ve on error
+ */
+int avb_hashtree_from_footer(struct blk_desc *desc, disk_partition_t *info,
+			     const char *name, struct avb_hashtree *tree);
+
+/**
+ * avb_hashtree_verify() - check a partition against its hash tree
+ *
+ * Each level of the tree is checked against the level above it, the top
+ * one against the root digest, and the partition data is streamed in
+ * large reads and checked against the lowest level.
+ *
+ * @desc:	block device
+ * @info:	partition on @desc
+ * @tree:	hash tree description
+ * @stats:	returns statistics, may be NULL
+ * @return 0 if the partition matches, -EBADMSG if it does not, -ve on error
+ */
+int avb_hashtree_verify(struct blk_desc *desc, disk_partition_t *info,
+			const struct avb_hashtree *tree,
+			struct avb_hashtree_stats *stats);
+
+/**
+ * avb_hashtree_print_stats() - show how fast a partition was checked
+ *
+ * @name:	partition name
+ * @stats:	as returned by avb_hashtree_verify()
+ */
+void avb_hashtree_print_stats(const char *name,
+			      const struct avb_hashtree_stats *stats);
+
+#endif /* _AVB_HASHTREE_H */
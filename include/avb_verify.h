@@ -9,6 +9,7 @@
 #define _AVB_VERIFY_H
 
 #include <../lib/libavb/libavb.h>
+#include <avb_hashtree.h>
 #include <mmc.h>
 #include <spi_flash.h>
 #include <ubi_uboot.h>
@@ -32,6 +33,10 @@ struct AvbOpsData {
 	int dev;
 	enum if_type if_type;
 	enum avb_boot_state boot_state;
+	/* Partition already in memory, see avb_ops_set_preload() */
+	char preload_part[PART_NAME_LEN];
+	void *preload_addr;
+	size_t preload_size;
 };
 
 struct mmc_part {
@@ -56,6 +61,11 @@ AvbOps *avb_ops_alloc(const char *intf, int boot_device);
 
 void avb_ops_free(AvbOps *ops);
 
+int avb_ops_set_preload(AvbOps *ops, const char *partition, void *addr,
+			size_t size);
+int avb_verify_hashtree(AvbOps *ops, const char *partition,
+			struct avb_hashtree_stats *stats);
+
 char *avb_set_state(AvbOps *ops, enum avb_boot_state boot_state);
 char *avb_set_enforce_verity(const char *cmdline);
 char *avb_set_ignore_corruption(const char *cmdline);
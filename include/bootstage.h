@@ -227,8 +227,20 @@ void show_boot_progress(int val);
 #if !defined(USE_HOSTCC)
 #if CONFIG_IS_ENABLED(BOOTSTAGE)
 #define ENABLE_BOOTSTAGE
+#if CONFIG_IS_ENABLED(BOOTSTAGE_PROFILE)
+#define ENABLE_BOOTSTAGE_PROFILE
 #endif
 #endif
+#endif
+
+/* Kinds of event recorded by the boot profiler */
+enum bootstage_event_type {
+	BOOTSTAGE_EVENT_INITCALL,	/* Named by its pre-relocation address */
+	BOOTSTAGE_EVENT_PROBE,		/* Named by the driver name */
+	BOOTSTAGE_EVENT_CMD,		/* Named by the command name */
+
+	BOOTSTAGE_EVENT_TYPE_COUNT,
+};
 
 #ifdef ENABLE_BOOTSTAGE
 
@@ -425,6 +437,74 @@ static inline int bootstage_init(bool first)
 
 #endif /* ENABLE_BOOTSTAGE */
 
+#ifdef ENABLE_BOOTSTAGE_PROFILE
+/**
+ * bootstage_event_start() - Get the start time of a profile event
+ *
+ * @return current time in microseconds, to pass to bootstage_event_add()
+ */
+static inline ulong bootstage_event_start(void)
+{
+	return timer_get_boot_us();
+}
+
+/**
+ * bootstage_event_add() - Record a profile event which has just finished
+ *
+ * The event goes into a ring, replacing the oldest if it is full. Nothing is
+ * recorded before bootstage_init() is called.
+ *
+ * @type:	Kind of event
+ * @name:	Name of the event, which must be a string in the U-Boot image,
+ *		or for BOOTSTAGE_EVENT_INITCALL the address of the function
+ *		before relocation
+ * @start_us:	Value returned by bootstage_event_start()
+ */
+void bootstage_event_add(enum bootstage_event_type type, const void *name,
+			 ulong start_us);
+
+/**
+ * bootstage_event_save() - Take a copy of the recorded profile events
+ *
+ * This is for tests which record events of their own. The copy can be put
+ * back with bootstage_event_restore() so that the boot's events are kept.
+ *
+ * @return the copy, or NULL if out of memory or bootstage is not set up
+ */
+void *bootstage_event_save(void);
+
+/**
+ * bootstage_event_restore() - Put back events copied by bootstage_event_save()
+ *
+ * Events recorded since the copy was taken are dropped. The copy is freed.
+ *
+ * @save:	Value returned by bootstage_event_save(), may be NULL
+ */
+void bootstage_event_restore(void *save);
+
+/**
+ * bootstage_event_export() - Write the profile as a JSON timeline
+ *
+ * This writes the events and bootstage marks in the Trace Event Format used
+ * by chrome://tracing, truncated to fit in @buf if needed.
+ *
+ * @buf:	Buffer for the nul-terminated JSON (may be NULL if @size is 0)
+ * @size:	Size of @buf
+ * @return length of the full JSON, not including the terminator
+ */
+int bootstage_event_export(char *buf, int size);
+#else
+static inline ulong bootstage_event_start(void)
+{
+	return 0;
+}
+
+static inline void bootstage_event_add(enum bootstage_event_type type,
+				       const void *name, ulong start_us)
+{
+}
+#endif
+
 /* Helper macro for adding a bootstage to a line of code */
 #define BOOTSTAGE_MARKER()	\
 		bootstage_mark_code(__FILE__, __func__, __LINE__)
@@ -20,6 +20,13 @@ int set_local_var(const char *s, int flg_export);
 void unset_local_var(const char *name);
 char *get_local_var(const char *s);
 
+#ifdef CONFIG_HUSH_CACHE
+/* Drop the parsed scripts which are not running */
+void hush_cache_flush(void);
+#else
+static inline void hush_cache_flush(void) {}
+#endif
+
 #if defined(CONFIG_HUSH_INIT_VAR)
 extern int hush_init_var (void);
 #endif
@@ -55,6 +55,15 @@ int _do_help (cmd_tbl_t *cmd_start, int cmd_items, cmd_tbl_t * cmdtp, int
 cmd_tbl_t *find_cmd(const char *cmd);
 cmd_tbl_t *find_cmd_tbl (const char *cmd, cmd_tbl_t *table, int table_len);
 
+/**
+ * find_cmd_indexed() - Check whether find_cmd() searches a sorted index
+ *
+ * The index is built on the first find_cmd() after relocation.
+ *
+ * @return true if find_cmd() uses the index, false if it scans the list
+ */
+bool find_cmd_indexed(void);
+
 extern int cmd_usage(const cmd_tbl_t *cmdtp);
 
 #ifdef CONFIG_AUTO_COMPLETE
@@ -255,6 +255,7 @@ void	jumptable_init(void);
 
 /* common/kallsysm.c */
 const char *symbol_lookup(unsigned long addr, unsigned long *caddr);
+unsigned long symbol_address(const char *name);
 
 /* common/memsize.c */
 long	get_ram_size  (long *, long);
@@ -479,6 +480,7 @@ int gzwrite(unsigned char *src, int len,
 
 /* lib/lz4_wrapper.c */
 int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn);
+int ulz4_block(const void *src, size_t srcn, void *dst, size_t *dstn);
 
 /* lib/qsort.c */
 void qsort(void *base, size_t nmemb, size_t size,
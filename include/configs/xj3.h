@@ -19,6 +19,10 @@
 #endif /* COUNTER_FREQUENCY */
 
 #define CONFIG_ARMV8_SWITCH_TO_EL1
+
+/* Generic Interrupt Controller, used by the profiler */
+#define GICD_BASE		0x90001000
+#define GICC_BASE		0x90002000
 #define CONFIG_SYS_NONCACHED_MEMORY		(1 << 20)
 
 #ifdef CONFIG_PARALLEL_CPU_CORE_ONE
@@ -170,6 +174,14 @@
 	func(MMC, mmc, 2)
 
 #define CONFIG_BOOTCOMMAND HB_SET_WDT "run distro_bootcmd"
+#elif defined(CONFIG_CMD_BOOTIMG)
+/* Only read the part of the boot partition the image header accounts for */
+#define CONFIG_BOOTCOMMAND HB_SET_WDT "bootimg load mmc 0 %s " \
+	__stringify(BOOTIMG_ADDR)";bootm "__stringify(BOOTIMG_ADDR)";"
+/* Secure boot verifies the image where it was loaded, not a second copy */
+#define BOOTCOMMAND_AVB_VERIFY HB_SET_WDT "bootimg load mmc 0 %s " \
+	__stringify(BOOTIMG_ADDR)";avb_verify ${fileaddr} ${filesize};" \
+	"bootm "__stringify(BOOTIMG_ADDR)";"
 #else
 #define CONFIG_BOOTCOMMAND HB_SET_WDT "part size mmc 0 %s bootimagesize;"\
 	"part start mmc 0 %s bootimageblk;mmc read "__stringify(BOOTIMG_ADDR) \
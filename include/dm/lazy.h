@@ -0,0 +1,132 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Deferred binding of device tree nodes
+ *
+ * With CONFIG_DM_LAZY_BIND, and "u-boot,dm-lazy-bind" in the /config node,
+ * a scan of the device tree after relocation records each node it would
+ * bind instead of binding it. A node is bound when something looks for it:
+ *
+ * - a lookup by node or phandle binds that node and the buses above it
+ * - any other lookup in a uclass binds the nodes of that uclass, with the
+ *   buses above them
+ * - probing a device binds its children, unless its uclass has
+ *   DM_UC_FLAG_LAZY_CHILDREN
+ * - a lookup in a uclass with DM_UC_FLAG_LAZY_BIND_ALL binds everything
+ */
+
+#ifndef _DM_LAZY_H_
+#define _DM_LAZY_H_
+
+#include <dm/ofnode.h>
+#include <dm/uclass-id.h>
+
+struct udevice;
+
+#if CONFIG_IS_ENABLED(DM_LAZY_BIND)
+/**
+ * dm_set_lazy_bind() - Choose whether scans after relocation defer binding
+ *
+ * @enable:	true to defer binding, false to bind straight away
+ */
+void dm_set_lazy_bind(bool enable);
+
+/**
+ * dm_lazy_defer() - Record a node to be bound when it is needed
+ *
+ * @parent:	Device the node would be bound to
+ * @node:	Node to bind
+ * @pre_reloc_only: true if this is a pre-relocation scan
+ * @return true if the node was recorded, false if it should be bound now
+ */
+bool dm_lazy_defer(struct udevice *parent, ofnode node, bool pre_reloc_only);
+
+/**
+ * dm_lazy_bind_uclass() - Bind the deferred nodes of a uclass
+ *
+ * The buses above the nodes are bound too, so that the nodes can be.
+ *
+ * @id:		uclass to bind
+ */
+void dm_lazy_bind_uclass(enum uclass_id id);
+
+/**
+ * dm_lazy_bind_node() - Bind a deferred node and the buses above it
+ *
+ * @node:	Node to bind
+ */
+void dm_lazy_bind_node(ofnode node);
+
+/**
+ * dm_lazy_bind_phandle() - Bind the node with a phandle and the buses above it
+ *
+ * @phandle:	Phandle of the node to bind
+ */
+void dm_lazy_bind_phandle(uint phandle);
+
+/**
+ * dm_lazy_bind_children() - Bind the deferred children of a device
+ *
+ * This is called when the device is probed.
+ *
+ * @dev:	Parent device
+ */
+void dm_lazy_bind_children(struct udevice *dev);
+
+/** dm_lazy_bind_all() - Bind all deferred nodes */
+void dm_lazy_bind_all(void);
+
+/**
+ * dm_lazy_forget() - Drop the deferred children of a device being unbound
+ *
+ * @dev:	Parent device, or NULL to drop every deferred node
+ */
+void dm_lazy_forget(struct udevice *dev);
+
+/**
+ * dm_lazy_pending() - Count the deferred nodes
+ *
+ * @return number of nodes waiting to be bound
+ */
+int dm_lazy_pending(void);
+#else
+static inline void dm_set_lazy_bind(bool enable)
+{
+}
+
+static inline bool dm_lazy_defer(struct udevice *parent, ofnode node,
+				 bool pre_reloc_only)
+{
+	return false;
+}
+
+static inline void dm_lazy_bind_uclass(enum uclass_id id)
+{
+}
+
+static inline void dm_lazy_bind_node(ofnode node)
+{
+}
+
+static inline void dm_lazy_bind_phandle(uint phandle)
+{
+}
+
+static inline void dm_lazy_bind_children(struct udevice *dev)
+{
+}
+
+static inline void dm_lazy_bind_all(void)
+{
+}
+
+static inline void dm_lazy_forget(struct udevice *dev)
+{
+}
+
+static inline int dm_lazy_pending(void)
+{
+	return 0;
+}
+#endif
+
+#endif
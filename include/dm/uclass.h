@@ -44,6 +44,15 @@ struct udevice;
 /* Members of this uclass sequence themselves with aliases */
 #define DM_UC_FLAG_SEQ_ALIAS			(1 << 0)
 
+/*
+ * With CONFIG_DM_LAZY_BIND, looking up a member of this uclass binds every
+ * deferred device tree node, since members are created by other devices
+ */
+#define DM_UC_FLAG_LAZY_BIND_ALL		(1 << 1)
+
+/* Probing a member of this uclass does not bind its deferred children */
+#define DM_UC_FLAG_LAZY_CHILDREN		(1 << 2)
+
 /**
  * struct uclass_driver - Driver for the uclass
  *
@@ -0,0 +1,142 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Indexed binary environment
+ *
+ * A text environment is parsed, unescaped and hashed one variable at a time
+ * each time it is imported. An indexed environment holds the same variables
+ * with the hash table slot for each already worked out, so that importing it
+ * is a copy of the strings followed by filling in the table. It is written
+ * by mkenvimage -i in place of the text, inside the usual CRC-protected
+ * environment, and looks like an empty environment to anything which only
+ * understands text.
+ *
+ * The layout is a struct env_index_header, then one struct env_index_entry
+ * for each variable in the order they were given, then the strings. All
+ * numbers are in the byte order of the target.
+ *
+ * The slots are only valid for a table of the size given in the header; if
+ * the size does not match the one hcreate_r() makes for the environment,
+ * the variables are entered one by one instead.
+ */
+
+#ifndef __ENV_INDEX_H
+#define __ENV_INDEX_H
+
+/* A text environment never starts with NUL unless it is empty */
+#define ENV_INDEX_MAGIC		"\0EIX"
+#define ENV_INDEX_MAGIC_LEN	4
+
+/**
+ * struct env_index_header - Start of an indexed environment
+ *
+ * @magic:	ENV_INDEX_MAGIC
+ * @size:	Number of slots in the hash table
+ * @count:	Number of variables
+ * @pool_size:	Number of bytes of strings after the entries
+ */
+struct env_index_header {
+	char magic[ENV_INDEX_MAGIC_LEN];
+	uint32_t size;
+	uint32_t count;
+	uint32_t pool_size;
+};
+
+/**
+ * struct env_index_entry - One variable in an indexed environment
+ *
+ * @idx:	Slot in the hash table, from 1 to @size
+ * @hval:	First hash value of the key, as kept in the slot
+ * @key:	Offset of the key in the strings
+ * @data:	Offset of the value in the strings
+ */
+struct env_index_entry {
+	uint32_t idx;
+	uint32_t hval;
+	uint32_t key;
+	uint32_t data;
+};
+
+/*
+ * The functions below are the ones used by the hash table, so that
+ * mkenvimage lays out the table exactly as hsearch_r() would.
+ */
+
+/* Round the number of entries up to the prime used as the table size */
+static inline unsigned int env_index_table_size(unsigned int nel)
+{
+	unsigned int div;
+
+	nel |= 1;
+	for (;; nel += 2) {
+		for (div = 3; div * div < nel && nel % div; div += 2)
+			;
+		if (nel % div)
+			return nel;
+	}
+}
+
+/* First hash function: never zero, since slot 0 is not used */
+static inline unsigned int env_index_hash(const char *key, unsigned int len,
+					  unsigned int size)
+{
+	unsigned int hval = len;
+	unsigned int count = len;
+
+	while (count-- > 0) {
+		hval <<= 4;
+		hval += (unsigned char)key[count];
+	}
+	hval %= size;
+
+	return hval ? hval : 1;
+}
+
+/* Second hash function, giving the step when probing, as in [Knuth] */
+static inline unsigned int env_index_step(unsigned int hval, unsigned int size)
+{
+	return 1 + hval % (size - 2);
+}
+
+/* Next slot to probe; since the size is prime this visits every slot */
+static inline unsigned int env_index_next(unsigned int idx, unsigned int step,
+					  unsigned int size)
+{
+	return idx <= step ? size + idx - step : idx - step;
+}
+
+/**
+ * env_index_is_valid() - Check whether a buffer holds an indexed environment
+ *
+ * This only checks the magic number; himport_index_r() checks the rest.
+ *
+ * @env:	Environment data, which need not be aligned
+ * @size:	Size of the data
+ * @return true if it starts with an index header
+ */
+static inline bool env_index_is_valid(const char *env, size_t size)
+{
+	return size >= sizeof(struct env_index_header) &&
+	       !memcmp(env, ENV_INDEX_MAGIC, ENV_INDEX_MAGIC_LEN);
+}
+
+/**
+ * env_index_build() - Write an indexed environment
+ *
+ * Later settings of a variable replace earlier ones and "name=" removes it,
+ * as when importing the text. Unused space in @buf is left alone.
+ *
+ * @buf:	Buffer for the indexed environment
+ * @size:	Size of @buf
+ * @env:	Text environment, "name=value" strings separated by NUL and
+ *		ending with an empty string or at @env_size
+ * @env_size:	Size of @env
+ * @nel:	Number of entries the target's hash table is created with,
+ *		before rounding up to a prime
+ * @big_endian:	true to write the numbers big-endian, else little-endian
+ * @return number of bytes written, or -ve error (-ENOSPC if @buf is too
+ *	small, -ENOMEM if out of memory or the table is too small)
+ */
+int env_index_build(char *buf, size_t size, const char *env, size_t env_size,
+		    unsigned int nel, bool big_endian);
+
+#endif
@@ -0,0 +1,129 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Lookup cache for the control device tree
+ *
+ * Finding a node by phandle or by path in a flat tree means walking the
+ * blob. With CONFIG_OF_LIBFDT_CACHE, libfdt asks this cache first when the
+ * blob is gd->fdt_blob. Before the full malloc() is ready the cache holds a
+ * small fixed number of phandles and path prefixes; after that the phandles
+ * are held in an array built with two passes over the blob, one to size it
+ * and one to fill it in.
+ *
+ * The cache is dropped whenever the blob moves or its structure changes
+ * size, which every libfdt setter that adds or removes data does. Nodes do
+ * not move when a property or name is changed in place, and each hit is
+ * checked against the blob before it is used. For a path that means
+ * checking the name of every node along it.
+ */
+
+#ifndef __FDT_CACHE_H
+#define __FDT_CACHE_H
+
+/**
+ * struct fdt_cache_stats - Lookup counts since the last fdt_cache_reset()
+ *
+ * @phandle_lookups:	Number of lookups by phandle
+ * @phandle_hits:	Number of those answered by the cache
+ * @path_lookups:	Number of lookups by absolute path
+ * @path_hits:		Number of those which started from a cached prefix
+ * @builds:		Number of times the phandle array was built
+ * @invalidations:	Number of times the cache was dropped
+ */
+struct fdt_cache_stats {
+	ulong phandle_lookups;
+	ulong phandle_hits;
+	ulong path_lookups;
+	ulong path_hits;
+	ulong builds;
+	ulong invalidations;
+};
+
+#if CONFIG_IS_ENABLED(OF_LIBFDT_CACHE)
+/**
+ * fdt_cache_find_phandle() - Look up a phandle in the cache
+ *
+ * @fdt:	Device tree blob
+ * @phandle:	Phandle to find
+ * @offsetp:	Returns the offset of the node with that phandle
+ * @return true if found, false if the blob must be searched
+ */
+bool fdt_cache_find_phandle(const void *fdt, uint32_t phandle, int *offsetp);
+
+/**
+ * fdt_cache_add_phandle() - Record the result of searching for a phandle
+ *
+ * @fdt:	Device tree blob
+ * @phandle:	Phandle that was searched for
+ * @offset:	Offset of the node with that phandle
+ */
+void fdt_cache_add_phandle(const void *fdt, uint32_t phandle, int offset);
+
+/**
+ * fdt_cache_find_path() - Find the longest cached prefix of a path
+ *
+ * @fdt:	Device tree blob
+ * @path:	Absolute path to look up
+ * @namelen:	Length of @path
+ * @lenp:	Returns the length of the prefix found, 0 if none
+ * @return offset of the node at the end of the prefix, 0 if none
+ */
+int fdt_cache_find_path(const void *fdt, const char *path, int namelen,
+			int *lenp);
+
+/**
+ * fdt_cache_add_path() - Record the node found for a prefix of a path
+ *
+ * @fdt:	Device tree blob
+ * @path:	Absolute path
+ * @len:	Length of the prefix which leads to @offset
+ * @parent:	Offset of the parent of the node, 0 for the root
+ * @offset:	Offset of the node
+ */
+void fdt_cache_add_path(const void *fdt, const char *path, int len,
+			int parent, int offset);
+
+/**
+ * fdt_cache_get_stats() - Get the lookup counts
+ *
+ * @stats:	Returns the counts
+ */
+void fdt_cache_get_stats(struct fdt_cache_stats *stats);
+
+/** fdt_cache_reset() - Drop the cache and clear the lookup counts */
+void fdt_cache_reset(void);
+#else
+static inline bool fdt_cache_find_phandle(const void *fdt, uint32_t phandle,
+					  int *offsetp)
+{
+	return false;
+}
+
+static inline void fdt_cache_add_phandle(const void *fdt, uint32_t phandle,
+					 int offset)
+{
+}
+
+static inline int fdt_cache_find_path(const void *fdt, const char *path,
+				      int namelen, int *lenp)
+{
+	*lenp = 0;
+
+	return 0;
+}
+
+static inline void fdt_cache_add_path(const void *fdt, const char *path,
+				      int len, int parent, int offset)
+{
+}
+
+static inline void fdt_cache_get_stats(struct fdt_cache_stats *stats)
+{
+	memset(stats, '\0', sizeof(*stats));
+}
+
+static inline void fdt_cache_reset(void)
+{
+}
+#endif
+
+#endif
@@ -36,6 +36,7 @@ struct fdt_region;
 
 #define IMAGE_ENABLE_IGNORE	0
 #define IMAGE_INDENT_STRING	""
+#define IMAGE_ENABLE_ECDSA	1
 
 #else
 
@@ -49,6 +50,7 @@ struct fdt_region;
 
 #define IMAGE_ENABLE_FIT	CONFIG_IS_ENABLED(FIT)
 #define IMAGE_ENABLE_OF_LIBFDT	CONFIG_IS_ENABLED(OF_LIBFDT)
+#define IMAGE_ENABLE_ECDSA	CONFIG_IS_ENABLED(ECDSA)
 
 #endif /* USE_HOSTCC */
 
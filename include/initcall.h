@@ -10,4 +10,89 @@ typedef int (*init_fnc_t)(void);
 
 int initcall_run_list(const init_fnc_t init_sequence[]);
 
+enum initcall_async_state {
+	INITCALL_ASYNC_UNUSED,		/* @func is not in the sequence */
+	INITCALL_ASYNC_IN_ORDER,	/* @after is not before @func */
+	INITCALL_ASYNC_WAITING,		/* waiting for @after to run */
+	INITCALL_ASYNC_STARTED,		/* @start has run */
+	INITCALL_ASYNC_DONE,		/* @join has run */
+};
+
+/**
+ * struct initcall_async - An initcall which can be started early
+ *
+ * Some initcalls spend most of their time waiting for hardware. If the work
+ * can be split in two, @start is called as soon as the initcall it depends
+ * on has run, the sequence carries on, and @join is called where @func
+ * would have run. @start runs ahead of every initcall between @after and
+ * @func, so @after must be the last of those that @start relies on, in any
+ * way: clocks, pinmux, power, board set-up, or output that must come first.
+ * @start must also not touch anything those initcalls use.
+ *
+ * @name:	Name for reports, normally that of @func
+ * @func:	Initcall in the sequence which this replaces
+ * @start:	Starts the work of @func
+ * @join:	Waits for the work to finish and does the rest of @func
+ * @after:	Initcall which @start depends on. It must come before @func in
+ *		the sequence; if it is another async initcall, @start runs
+ *		after that one's @join.
+ *
+ * The rest is filled in by initcall_run_list_async():
+ *
+ * @state:	What has happened so far
+ * @start_us:	Time when @start was called
+ * @started_us:	Time when @start returned
+ * @join_us:	Time when @join was called
+ * @done_us:	Time when @join returned
+ */
+struct initcall_async {
+	const char *name;
+	init_fnc_t func;
+	init_fnc_t start;
+	init_fnc_t join;
+	init_fnc_t after;
+
+	enum initcall_async_state state;
+	ulong start_us;
+	ulong started_us;
+	ulong join_us;
+	ulong done_us;
+};
+
+#define INITCALL_ASYNC(_func, _start, _join, _after) { \
+	.name = #_func, \
+	.func = _func, \
+	.start = _start, \
+	.join = _join, \
+	.after = _after, \
+}
+
+/**
+ * initcall_run_list_async() - Run a sequence, starting some initcalls early
+ *
+ * This works as initcall_run_list() except for the initcalls in @async.
+ * Any of those whose @after does not come before it in the sequence is
+ * run in order instead, with a warning; those not in the sequence are
+ * ignored.
+ *
+ * @init_sequence:	Initcalls to run, ending with NULL
+ * @async:		Initcalls to start early
+ * @count:		Number of entries in @async
+ * @return 0 if OK, -1 if an initcall, @start or @join failed
+ */
+int initcall_run_list_async(const init_fnc_t init_sequence[],
+			    struct initcall_async async[], int count);
+
+/**
+ * initcall_async_report() - Show how much of each async initcall was hidden
+ *
+ * For each entry this prints how long @start and @join took, which is time
+ * on the critical path of the sequence, and how long the initcalls run in
+ * between took, which is time the work of @func overlapped with them.
+ *
+ * @async:	Initcalls passed to initcall_run_list_async()
+ * @count:	Number of entries in @async
+ */
+void initcall_async_report(const struct initcall_async async[], int count);
+
 #endif
@@ -8,6 +8,7 @@
 
 #include <linux/errno.h>
 #include <linux/io.h>
+#include <task.h>
 #include <time.h>
 
 /**
@@ -35,6 +36,7 @@
 			(val) = op(addr); \
 			break; \
 		} \
+		task_yield(); \
 	} \
 	(cond) ? 0 : -ETIMEDOUT; \
 })
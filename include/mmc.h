@@ -758,6 +758,14 @@ void mmc_destroy(struct mmc *mmc);
  */
 int mmc_unbind(struct udevice *dev);
 int mmc_initialize(struct bd_info *bis);
+
+/**
+ * mmc_probe_seq() - Probe the MMC controllers which have a sequence number
+ *
+ * The controllers are probed in sequence order, so that they are numbered
+ * the same as by mmc_initialize(), which calls this first.
+ */
+void mmc_probe_seq(void);
 int mmc_init_device(int num);
 int mmc_init(struct mmc *mmc);
 int mmc_send_tuning(struct mmc *mmc, u32 opcode, int *cmd_error);
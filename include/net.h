@@ -352,6 +352,7 @@ struct vlan_ethernet_hdr {
 #define PROT_PPP_SES	0x8864		/* PPPoE session messages	*/
 
 #define IPPROTO_ICMP	 1	/* Internet Control Message Protocol	*/
+#define IPPROTO_TCP	 6	/* Transmission Control Protocol	*/
 #define IPPROTO_UDP	17	/* User Datagram Protocol		*/
 
 /*
@@ -537,7 +538,7 @@ extern int		net_restart_wrap;	/* Tried all network devices */
 
 enum proto_t {
 	BOOTP, RARP, ARP, TFTPGET, DHCP, PING, DNS, NFS, CDP, NETCONS, SNTP,
-	TFTPSRV, TFTPPUT, LINKLOCAL, FASTBOOT, WOL
+	TFTPSRV, TFTPPUT, LINKLOCAL, FASTBOOT, WOL, WGET
 };
 
 extern char	net_boot_file_name[1024];/* Boot File name */
@@ -674,6 +675,21 @@ static inline void net_send_packet(uchar *pkt, int len)
 int net_send_udp_packet(uchar *ether, struct in_addr dest, int dport,
 			int sport, int payload_len);
 
+/**
+ * Transmit "net_tx_packet" as an IP packet, performing ARP request if needed
+ *  (ether will be populated)
+ *
+ * The caller puts the protocol header and data after the Ethernet and IP
+ * headers, i.e. at net_tx_packet + net_eth_hdr_size() + IP_HDR_SIZE.
+ *
+ * @param ether Raw packet buffer
+ * @param dest IP address to send the datagram to
+ * @param proto IP protocol (IPPROTO_...)
+ * @param payload_len Length of data after the IP header
+ */
+int net_send_ip_packet(uchar *ether, struct in_addr dest, int proto,
+		       int payload_len);
+
 /* Processes a received packet */
 void net_process_received_packet(uchar *in_packet, int len);
 
@@ -0,0 +1,126 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Minimal TCP client
+ *
+ * One connection at a time, opened by us. Received data is handed to the
+ * protocol as it arrives in order; out-of-order segments are dropped and
+ * answered with a duplicate ACK so that the server retransmits quickly.
+ */
+
+#ifndef __TCP_H__
+#define __TCP_H__
+
+struct ip_hdr;
+
+struct tcp_hdr {
+	u16		tcp_src;	/* Source port			*/
+	u16		tcp_dst;	/* Destination port		*/
+	u32		tcp_seq;	/* Sequence number		*/
+	u32		tcp_ack;	/* Acknowledgement number	*/
+	u8		tcp_hlen;	/* Header length in words << 4	*/
+	u8		tcp_flags;	/* TCP_FIN etc.			*/
+	u16		tcp_win;	/* Receive window		*/
+	u16		tcp_xsum;	/* Checksum			*/
+	u16		tcp_urg;	/* Urgent pointer		*/
+} __attribute__((packed));
+
+#define TCP_HDR_SIZE		(sizeof(struct tcp_hdr))
+
+#define TCP_FIN			0x01
+#define TCP_SYN			0x02
+#define TCP_RST			0x04
+#define TCP_PSH			0x08
+#define TCP_ACK			0x10
+
+/* Largest segment which fits in an Ethernet frame */
+#define TCP_MSS			(1500 - IP_HDR_SIZE - TCP_HDR_SIZE)
+
+enum tcp_event {
+	TCP_EV_CONNECTED,	/* Handshake complete, data may be sent */
+	TCP_EV_FIN,		/* The server has sent all its data */
+	TCP_EV_CLOSED,		/* Both sides have closed the connection */
+	TCP_EV_RESET,		/* The server reset the connection */
+	TCP_EV_TIMEOUT,		/* The server stopped answering */
+};
+
+/**
+ * tcp_rx_f - handler for data received on a TCP connection
+ *
+ * Each byte of the stream is passed exactly once, in order.
+ *
+ * @data:	Received data
+ * @len:	Number of bytes
+ * @return 0 to carry on, -ve to reset the connection
+ */
+typedef int tcp_rx_f(const uchar *data, unsigned int len);
+
+/**
+ * tcp_event_f - handler for changes in the state of a TCP connection
+ *
+ * @event:	What happened
+ */
+typedef void tcp_event_f(enum tcp_event event);
+
+/* Counters for the current connection, see tcp_get_stats() */
+struct tcp_stats {
+	ulong segs_in;		/* Segments received */
+	ulong segs_out;		/* Segments sent, including ACKs */
+	ulong retransmits;	/* Segments we sent again */
+	ulong ooo_dropped;	/* Segments dropped as they came out of order */
+	u64 bytes_in;		/* Bytes of data received in order */
+};
+
+/**
+ * tcp_connect() - Open a connection to a server
+ *
+ * This must be called from a net_loop() start function. The connection
+ * takes over the net_loop() timeout handler until it is closed.
+ *
+ * @dest:	IP address of the server
+ * @dport:	Port of the server
+ * @rx:		Called with the data received
+ * @event:	Called when the state of the connection changes
+ * @return 0 if ok, -ve on error
+ */
+int tcp_connect(struct in_addr dest, int dport, tcp_rx_f *rx,
+		tcp_event_f *event);
+
+/**
+ * tcp_send() - Queue data to be sent on the connection
+ *
+ * The data is copied; it is sent as the window allows.
+ *
+ * @data:	Data to send
+ * @len:	Number of bytes
+ * @return 0 if ok, -ENOSPC if the transmit buffer is full, -ENOTCONN if
+ * the connection is not open
+ */
+int tcp_send(const void *data, unsigned int len);
+
+/**
+ * tcp_close() - Close our side of the connection
+ *
+ * A FIN is sent once all queued data has been sent. TCP_EV_CLOSED follows
+ * when the server has closed its side too.
+ */
+void tcp_close(void);
+
+/** tcp_abort() - Reset the connection straight away */
+void tcp_abort(void);
+
+/**
+ * tcp_receive() - Process a received TCP segment
+ *
+ * @ip:		IP header of the packet
+ * @len:	Length of the packet from the start of the IP header
+ */
+void tcp_receive(struct ip_hdr *ip, int len);
+
+/**
+ * tcp_get_stats() - Get the counters for the last connection
+ *
+ * @stats:	Returns the counters
+ */
+void tcp_get_stats(struct tcp_stats *stats);
+
+#endif /* __TCP_H__ */
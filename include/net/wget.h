@@ -0,0 +1,38 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * HTTP download over TCP
+ */
+
+#ifndef __WGET_H__
+#define __WGET_H__
+
+/**
+ * wget_sink_f - handler for the body of an HTTP response
+ *
+ * The body is passed in order, exactly once.
+ *
+ * @offset:	Offset of @data in the body
+ * @data:	Part of the body
+ * @len:	Number of bytes
+ * @priv:	Value passed to wget_set_sink()
+ * @return 0 to carry on, -ve to abort the download
+ */
+typedef int wget_sink_f(ulong offset, const uchar *data, unsigned int len,
+			void *priv);
+
+/* wget.c */
+void wget_start(void);	/* Begin HTTP GET */
+
+/**
+ * wget_set_sink() - Send the next download to a handler instead of memory
+ *
+ * This applies to the next transfer only; after it the body goes to
+ * load_addr again. It lets the caller e.g. write the file to flash while
+ * it is downloaded.
+ *
+ * @sink:	Handler for the body, NULL to store it at load_addr
+ * @priv:	Value to pass to @sink
+ */
+void wget_set_sink(wget_sink_f *sink, void *priv);
+
+#endif /* __WGET_H__ */
@@ -351,4 +351,59 @@ int os_setjmp(ulong *jmp, int size);
  */
 void os_longjmp(ulong *jmp, int ret);
 
+/**
+ * os_profile_start() - Call a function periodically with the registers
+ *
+ * This uses the host's profiling timer, which counts the CPU time used, so
+ * time spent waiting for input is not sampled. Only x86 and ARM64 hosts are
+ * supported.
+ *
+ * @hz: Number of calls per second of CPU time
+ * @func: Function to call from the signal handler, with the interrupted
+ *	program counter, frame pointer and stack pointer
+ * @return 0 if OK, -ve error code on failure
+ */
+int os_profile_start(unsigned int hz,
+		     void (*func)(unsigned long pc, unsigned long fp,
+				  unsigned long sp));
+
+/**
+ * os_profile_stop() - Stop the calls started by os_profile_start()
+ */
+void os_profile_stop(void);
+
+/**
+ * os_context_create() - Create a context for switching between stacks
+ *
+ * A context holds the registers of a stack of calls which is not running.
+ * With @func NULL this only allocates space in which os_context_switch()
+ * can save the caller's context. Otherwise the context, when switched to,
+ * calls @func on @stack; @func must never return.
+ *
+ * @func: Function to call, or NULL
+ * @stack: Memory to use as the stack
+ * @size: Size of @stack in bytes
+ * @return the context, or NULL if out of memory
+ */
+void *os_context_create(void (*func)(void), void *stack, size_t size);
+
+/**
+ * os_context_switch() - Save the current context and switch to another
+ *
+ * This returns when something switches back to @from.
+ *
+ * @from: Context to save the caller's registers in
+ * @to: Context to switch to
+ */
+void os_context_switch(void *from, void *to);
+
+/**
+ * os_context_free() - Free a context made by os_context_create()
+ *
+ * This does not free the stack, which belongs to the caller.
+ *
+ * @ctx: Context to free
+ */
+void os_context_free(void *ctx);
+
 #endif
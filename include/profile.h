@@ -0,0 +1,120 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Sampling profiler
+ *
+ * A periodic interrupt (a signal on sandbox) records the interrupted PC and
+ * the return addresses found by following the frame pointers. Identical
+ * stacks are counted in a hash table, which can be printed as folded stacks
+ * for flamegraph.pl or as a flat list of the busiest functions.
+ */
+
+#ifndef __PROFILE_H
+#define __PROFILE_H
+
+/**
+ * struct profile_stats - Counts kept by the profiler
+ *
+ * @samples:	Number of samples recorded
+ * @lost:	Number of samples dropped because the table was full
+ * @stacks:	Number of different stacks in the table
+ * @hz:		Sampling rate, or 0 if the profiler is stopped
+ */
+struct profile_stats {
+	uint samples;
+	uint lost;
+	uint stacks;
+	uint hz;
+};
+
+/**
+ * profile_start() - Start sampling
+ *
+ * The table is allocated the first time this is called. Samples are added
+ * to any already recorded.
+ *
+ * @hz:		Number of samples a second
+ * @return 0 if OK, -EBUSY if already running, -ENOMEM if there is no room
+ *	for the table, other -ve error from the arch code
+ */
+int profile_start(uint hz);
+
+/**
+ * profile_stop() - Stop sampling
+ *
+ * This does nothing if the profiler is not running. It must be called
+ * before booting an OS.
+ */
+void profile_stop(void);
+
+/**
+ * profile_reset() - Drop all samples
+ */
+void profile_reset(void);
+
+/**
+ * profile_get_stats() - Get the profiler's counts
+ *
+ * @stats:	Returns the counts
+ */
+void profile_get_stats(struct profile_stats *stats);
+
+/**
+ * profile_show_folded() - Print each stack and its count
+ *
+ * Each line lists the functions from the outermost to the innermost,
+ * separated by ';', then the number of samples. This is the format read
+ * by flamegraph.pl. Functions are named from the built-in symbol table if
+ * there is one, else given as their address before relocation.
+ */
+void profile_show_folded(void);
+
+/**
+ * profile_show_top() - Print the functions with the most samples
+ *
+ * @count:	Maximum number of functions to print
+ */
+void profile_show_top(int count);
+
+/**
+ * profile_sample() - Record a sample
+ *
+ * This is called from the arch's timer interrupt. Frames are followed
+ * while they are above @sp, within 1MB of it and going up the stack.
+ *
+ * @pc:		Interrupted program counter
+ * @fp:		Interrupted frame pointer
+ * @sp:		Interrupted stack pointer, or any address below the frames
+ */
+void profile_sample(ulong pc, ulong fp, ulong sp);
+
+/**
+ * arch_profile_start() - Start calling profile_sample() periodically
+ *
+ * @hz:		Number of calls a second
+ * @return 0 if OK, -ve on error
+ */
+int arch_profile_start(uint hz);
+
+/**
+ * arch_profile_stop() - Stop calling profile_sample()
+ */
+void arch_profile_stop(void);
+
+struct pt_regs;
+
+/**
+ * arch_profile_irq() - Handle an interrupt while the profiler runs
+ *
+ * This is for architectures where the profiler's interrupt comes through
+ * the CPU's IRQ exception rather than a host signal. The caller has already
+ * acknowledged the interrupt, and must handle it itself if this returns
+ * false.
+ *
+ * @regs:	Registers saved by the exception
+ * @iar:	Value read from the GIC's interrupt acknowledge register
+ * @return true if the interrupt was the profiler's, or spurious, and needs
+ *	nothing more
+ */
+bool arch_profile_irq(struct pt_regs *regs, u32 iar);
+
+#endif
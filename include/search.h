@@ -61,6 +61,12 @@ struct hsearch_data {
  */
 	int (*change_ok)(const ENTRY *__item, const char *newval, enum env_op,
 		int flag);
+/*
+ * Strings of the entries imported by himport_index_r(), which are freed
+ * together rather than one by one.
+ */
+	char *pool;
+	size_t pool_size;
 };
 
 /* Create a new hash table which will contain at most "__nel" elements.  */
@@ -102,6 +108,13 @@ extern int himport_r(struct hsearch_data *__htab,
 		     int __flag, int __crlf_is_lf, int nvars,
 		     char * const vars[]);
 
+/*
+ * Import an indexed environment (see env_index.h), replacing the contents
+ * of the table. Returns 1 on success, 0 on error like himport_r().
+ */
+extern int himport_index_r(struct hsearch_data *__htab,
+			   const char *__env, size_t __size, int __flag);
+
 /* Walk the whole table calling the callback on each element */
 extern int hwalk_r(struct hsearch_data *__htab, int (*callback)(ENTRY *));
 
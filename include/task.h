@@ -0,0 +1,94 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Cooperative tasks, for overlapping waits on separate devices
+ */
+
+#ifndef __TASK_H
+#define __TASK_H
+
+struct task;
+
+#if CONFIG_IS_ENABLED(TASK)
+/**
+ * task_create() - Create a task and make it ready to run
+ *
+ * The task does not run until the caller yields, which it does whenever it
+ * waits in udelay() or one of the polling helpers built on it. Tasks run in
+ * the order they were created, each until it yields, returns or waits.
+ *
+ * There is no locking: a task must not use a device, or any other state,
+ * which another task or the caller may use before the task is joined.
+ * Tasks may create and join tasks of their own.
+ *
+ * @name:	Name of the task, for messages
+ * @func:	Function to run in the task
+ * @arg:	Argument to pass to @func
+ * @taskp:	Returns the task
+ * @return 0 if OK, -ENOMEM if out of memory
+ */
+int task_create(const char *name, int (*func)(void *arg), void *arg,
+		struct task **taskp);
+
+/**
+ * task_join() - Wait for a task to finish and free it
+ *
+ * Other tasks run while this waits.
+ *
+ * @task:	Task to wait for, which must not be the caller
+ * @return the value returned by the task's function
+ */
+int task_join(struct task *task);
+
+/**
+ * task_yield() - Let the next ready task run
+ *
+ * This returns when every other task has had a turn, at once if there are
+ * none.
+ */
+void task_yield(void);
+
+/**
+ * task_delay() - Wait for a time while other tasks run
+ *
+ * This is called by udelay().
+ *
+ * @usec:	Time to wait in microseconds
+ * @return true if it waited, false if there are no tasks, in which case the
+ *	caller must wait itself
+ */
+bool task_delay(ulong usec);
+
+/**
+ * task_name() - Get the name of the running task
+ *
+ * @return the name, "main" if no task is running
+ */
+const char *task_name(void);
+#else
+static inline int task_create(const char *name, int (*func)(void *arg),
+			      void *arg, struct task **taskp)
+{
+	return -ENOSYS;
+}
+
+static inline int task_join(struct task *task)
+{
+	return -ENOSYS;
+}
+
+static inline void task_yield(void)
+{
+}
+
+static inline bool task_delay(ulong usec)
+{
+	return false;
+}
+
+static inline const char *task_name(void)
+{
+	return "main";
+}
+#endif
+
+#endif
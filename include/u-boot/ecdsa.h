@@ -0,0 +1,102 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * ECDSA signatures for FIT images
+ */
+
+#ifndef _ECDSA_H
+#define _ECDSA_H
+
+#include <errno.h>
+#include <image.h>
+
+/* Size of a P-256 coordinate or scalar; a signature is r then s */
+#define P256_BYTES		(256 / 8)
+#define ECDSA256_BYTES		P256_BYTES
+
+struct image_sign_info;
+
+#if IMAGE_ENABLE_SIGN
+/**
+ * ecdsa_sign() - calculate and return signature for given input data
+ *
+ * The private key is read from <keydir>/<keyname>.pem and the signature
+ * is stored as r followed by s, each big-endian.
+ *
+ * @info:	Specifies key and FIT information
+ * @region:	List of regions to sign
+ * @region_count:	Number of regions
+ * @sigp:	Set to an allocated buffer holding the signature
+ * @sig_len:	Set to length of the calculated signature
+ *
+ * @return: 0, on success, -ENOENT if the key file is missing, other -ve
+ * value on error
+ */
+int ecdsa_sign(struct image_sign_info *info,
+	       const struct image_region region[],
+	       int region_count, uint8_t **sigp, uint *sig_len);
+
+/**
+ * ecdsa_add_verify_data() - Add verification information to FDT
+ *
+ * Add the public key to a key node in the FDT, as the properties
+ * 'ecdsa,curve', 'ecdsa,x-point' and 'ecdsa,y-point'.
+ *
+ * @info:	Specifies key and FIT information
+ * @keydest:	Destination FDT blob for public key data
+ * @return: 0, on success, -ENOSPC if the keydest FDT blob ran out of space,
+ *		other -ve value on error
+ */
+int ecdsa_add_verify_data(struct image_sign_info *info, void *keydest);
+#else
+static inline int ecdsa_sign(struct image_sign_info *info,
+		const struct image_region region[], int region_count,
+		uint8_t **sigp, uint *sig_len)
+{
+	return -ENXIO;
+}
+
+static inline int ecdsa_add_verify_data(struct image_sign_info *info,
+					void *keydest)
+{
+	return -ENXIO;
+}
+#endif
+
+#if IMAGE_ENABLE_VERIFY
+/**
+ * ecdsa_verify() - Verify a signature against some data
+ *
+ * @info:	Specifies key and FIT information
+ * @region:	List of regions to verify
+ * @region_count:	Number of regions
+ * @sig:	Signature, r followed by s
+ * @sig_len:	Number of bytes in signature
+ * @return 0 if verified, -ve on error
+ */
+int ecdsa_verify(struct image_sign_info *info,
+		 const struct image_region region[], int region_count,
+		 uint8_t *sig, uint sig_len);
+#else
+static inline int ecdsa_verify(struct image_sign_info *info,
+		const struct image_region region[], int region_count,
+		uint8_t *sig, uint sig_len)
+{
+	return -ENXIO;
+}
+#endif
+
+/**
+ * p256_ecdsa_verify() - Check an ECDSA signature on the P-256 curve
+ *
+ * @qx:		Public key x coordinate, big-endian, P256_BYTES long
+ * @qy:		Public key y coordinate, big-endian, P256_BYTES long
+ * @hash:	Hash of the signed data
+ * @hash_len:	Length of @hash; only the first P256_BYTES are used
+ * @sig:	Signature, r then s, each big-endian and P256_BYTES long
+ * @return 0 if the signature is good, -EINVAL if the key or signature is
+ * not valid, -EACCES if the signature does not match
+ */
+int p256_ecdsa_verify(const uint8_t *qx, const uint8_t *qy,
+		      const uint8_t *hash, int hash_len, const uint8_t *sig);
+
+#endif
@@ -156,6 +156,43 @@ tole(0xb40bbe37L), tole(0xc30c8ea1L), tole(0x5a05df1bL), tole(0x2d02ef8dL)
 };
 #endif
 
+#if defined(CONFIG_CRC32_SLICE8) && __BYTE_ORDER == __LITTLE_ENDIAN
+#define CRC32_SLICE8
+
+#if defined(USE_HOSTCC) || \
+	(defined(CONFIG_EFI_LOADER) && !defined(CONFIG_SPL_BUILD))
+#define __crc_table8_data __efi_runtime_data
+#else
+/* .bss holds the appended device tree until relocation, so keep out of it */
+#define __crc_table8_data __section(.data)
+#endif
+
+/* crc_table8[k][n] is the CRC of byte n followed by k + 1 zero bytes */
+static int __efi_runtime_data crc_table8_empty = 1;
+static uint32_t __crc_table8_data crc_table8[7][256];
+
+/*
+  Derive the tables from crc_table: one more zero byte is one more step of
+  the byte-wise CRC with a zero input byte.
+*/
+static void __efi_runtime make_crc_table8(void)
+{
+  uint32_t c;
+  int n, k;
+
+  for (n = 0; n < 256; n++)
+  {
+    c = crc_table[n];
+    for (k = 0; k < 7; k++)
+    {
+      c = crc_table[c & 255] ^ (c >> 8);
+      crc_table8[k][n] = c;
+    }
+  }
+  crc_table8_empty = 0;
+}
+#endif
+
 #if 0
 /* =========================================================================
  * This function can be used by asm versions of crc32()
@@ -200,6 +237,21 @@ uint32_t __efi_runtime crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
 	 b = (uint32_t *)p;
     }
 
+#ifdef CRC32_SLICE8
+    /* Eight bytes per step, looking each one up in its own table */
+    if (crc_table8_empty)
+      make_crc_table8();
+    for (; len >= 8; len -= 8) {
+	 uint32_t lo = *b++ ^ crc;
+	 uint32_t hi = *b++;
+
+	 crc = crc_table8[6][lo & 255] ^ crc_table8[5][(lo >> 8) & 255] ^
+	       crc_table8[4][(lo >> 16) & 255] ^ crc_table8[3][lo >> 24] ^
+	       crc_table8[2][hi & 255] ^ crc_table8[1][(hi >> 8) & 255] ^
+	       crc_table8[0][(hi >> 16) & 255] ^ tab[hi >> 24];
+    }
+#endif
+
     rem_len = len & 3;
     len = len >> 2;
     for (--b; len; --len) {
@@ -0,0 +1,309 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * ECDSA signing of FIT images with OpenSSL's libcrypto
+ *
+ * Keys are PEM files holding a P-256 private key, e.g. as made by
+ * 'openssl ecparam -name prime256v1 -genkey -noout -out <keyname>.pem'.
+ */
+
+#include "mkimage.h"
+#include <stdio.h>
+#include <string.h>
+#include <image.h>
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/ecdsa.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/objects.h>
+#include <openssl/pem.h>
+#include <u-boot/ecdsa.h>
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000L || \
+	(defined(LIBRESSL_VERSION_NUMBER) && LIBRESSL_VERSION_NUMBER < 0x02070000fL)
+static void ECDSA_SIG_get0(const ECDSA_SIG *sig, const BIGNUM **pr,
+			   const BIGNUM **ps)
+{
+	if (pr != NULL)
+		*pr = sig->r;
+	if (ps != NULL)
+		*ps = sig->s;
+}
+
+#define EVP_MD_CTX_new		EVP_MD_CTX_create
+#define EVP_MD_CTX_free		EVP_MD_CTX_destroy
+#endif
+
+static int ecdsa_err(const char *msg)
+{
+	unsigned long sslErr = ERR_get_error();
+
+	fprintf(stderr, "%s", msg);
+	fprintf(stderr, ": %s\n",
+		ERR_error_string(sslErr, 0));
+
+	return -1;
+}
+
+/**
+ * ecdsa_pem_get_key() - read a P-256 key from a .pem file
+ *
+ * @keydir:	Directory containing the key
+ * @name:	Name of key file (will have a .pem extension)
+ * @keyp:	Returns key, or NULL on failure
+ * @return 0 if ok, -ENOENT if there is no key file, other -ve on error
+ */
+static int ecdsa_pem_get_key(const char *keydir, const char *name,
+			     EVP_PKEY **keyp)
+{
+	char path[1024];
+	EVP_PKEY *key;
+	EC_KEY *ec;
+	FILE *f;
+	int ok;
+
+	*keyp = NULL;
+	snprintf(path, sizeof(path), "%s/%s.pem", keydir, name);
+	f = fopen(path, "r");
+	if (!f) {
+		fprintf(stderr, "Couldn't open ECDSA private key: '%s': %s\n",
+			path, strerror(errno));
+		return -ENOENT;
+	}
+
+	key = PEM_read_PrivateKey(f, NULL, NULL, path);
+	fclose(f);
+	if (!key) {
+		ecdsa_err("Failure reading private key");
+		return -EPROTO;
+	}
+
+	ec = EVP_PKEY_get1_EC_KEY(key);
+	ok = ec && EC_GROUP_get_curve_name(EC_KEY_get0_group(ec)) ==
+		   NID_X9_62_prime256v1;
+	EC_KEY_free(ec);
+	if (!ok) {
+		fprintf(stderr, "'%s' is not a prime256v1 key\n", path);
+		EVP_PKEY_free(key);
+		return -EINVAL;
+	}
+	*keyp = key;
+
+	return 0;
+}
+
+/* Write a bignum as a big-endian number of exactly @len bytes */
+static int ecdsa_bn_to_bin(const BIGNUM *num, uint8_t *buf, int len)
+{
+	int size = BN_num_bytes(num);
+
+	if (size > len)
+		return -EINVAL;
+	memset(buf, '\0', len - size);
+	BN_bn2bin(num, buf + len - size);
+
+	return 0;
+}
+
+static int ecdsa_sign_with_key(EVP_PKEY *key,
+			       struct checksum_algo *checksum_algo,
+			       const struct image_region region[],
+			       int region_count, uint8_t **sigp,
+			       uint *sig_size)
+{
+	const unsigned char *der_ptr;
+	const BIGNUM *r, *s;
+	EVP_MD_CTX *context;
+	ECDSA_SIG *ecsig;
+	uint8_t *der, *sig;
+	size_t der_len;
+	int ret = 0;
+	int i;
+
+	context = EVP_MD_CTX_new();
+	if (!context)
+		return ecdsa_err("EVP context creation failed");
+	if (!EVP_DigestSignInit(context, NULL, checksum_algo->calculate_sign(),
+				NULL, key)) {
+		ret = ecdsa_err("Signer setup failed");
+		goto err_ctx;
+	}
+
+	for (i = 0; i < region_count; i++) {
+		if (!EVP_DigestSignUpdate(context, region[i].data,
+					  region[i].size)) {
+			ret = ecdsa_err("Signing data failed");
+			goto err_ctx;
+		}
+	}
+
+	if (!EVP_DigestSignFinal(context, NULL, &der_len)) {
+		ret = ecdsa_err("Could not obtain signature size");
+		goto err_ctx;
+	}
+	der = malloc(der_len);
+	if (!der) {
+		ret = -ENOMEM;
+		goto err_ctx;
+	}
+	if (!EVP_DigestSignFinal(context, der, &der_len)) {
+		ret = ecdsa_err("Could not obtain signature");
+		goto err_der;
+	}
+
+	/* The FIT holds r and s as plain numbers rather than DER */
+	der_ptr = der;
+	ecsig = d2i_ECDSA_SIG(NULL, &der_ptr, der_len);
+	if (!ecsig) {
+		ret = ecdsa_err("Could not decode signature");
+		goto err_der;
+	}
+	ECDSA_SIG_get0(ecsig, &r, &s);
+
+	sig = malloc(2 * P256_BYTES);
+	if (!sig) {
+		ret = -ENOMEM;
+		goto err_sig;
+	}
+	if (ecdsa_bn_to_bin(r, sig, P256_BYTES) ||
+	    ecdsa_bn_to_bin(s, sig + P256_BYTES, P256_BYTES)) {
+		fprintf(stderr, "Signature is too large\n");
+		free(sig);
+		ret = -EINVAL;
+		goto err_sig;
+	}
+
+	debug("Got signature: %d bytes\n", 2 * P256_BYTES);
+	*sigp = sig;
+	*sig_size = 2 * P256_BYTES;
+
+err_sig:
+	ECDSA_SIG_free(ecsig);
+err_der:
+	free(der);
+err_ctx:
+	EVP_MD_CTX_free(context);
+
+	return ret;
+}
+
+int ecdsa_sign(struct image_sign_info *info,
+	       const struct image_region region[], int region_count,
+	       uint8_t **sigp, uint *sig_len)
+{
+	EVP_PKEY *key;
+	int ret;
+
+	if (info->engine_id) {
+		fprintf(stderr, "Signing engines are not supported for ECDSA\n");
+		return -ENOTSUP;
+	}
+
+	ret = ecdsa_pem_get_key(info->keydir, info->keyname, &key);
+	if (ret)
+		return ret;
+	ret = ecdsa_sign_with_key(key, info->checksum, region, region_count,
+				  sigp, sig_len);
+	EVP_PKEY_free(key);
+
+	return ret;
+}
+
+int ecdsa_add_verify_data(struct image_sign_info *info, void *keydest)
+{
+	uint8_t x_point[P256_BYTES], y_point[P256_BYTES];
+	const EC_POINT *point;
+	const EC_GROUP *group;
+	BIGNUM *x, *y;
+	int parent, node;
+	EVP_PKEY *key;
+	char name[100];
+	EC_KEY *ec;
+	int ret;
+
+	debug("%s: Getting verification data\n", __func__);
+	if (info->engine_id) {
+		fprintf(stderr, "Signing engines are not supported for ECDSA\n");
+		return -ENOTSUP;
+	}
+	ret = ecdsa_pem_get_key(info->keydir, info->keyname, &key);
+	if (ret)
+		return ret;
+
+	ec = EVP_PKEY_get1_EC_KEY(key);
+	group = EC_KEY_get0_group(ec);
+	point = EC_KEY_get0_public_key(ec);
+	x = BN_new();
+	y = BN_new();
+	if (!x || !y || !point ||
+	    !EC_POINT_get_affine_coordinates_GFp(group, point, x, y, NULL) ||
+	    ecdsa_bn_to_bin(x, x_point, P256_BYTES) ||
+	    ecdsa_bn_to_bin(y, y_point, P256_BYTES)) {
+		ret = ecdsa_err("Couldn't get public key");
+		goto err_point;
+	}
+
+	parent = fdt_subnode_offset(keydest, 0, FIT_SIG_NODENAME);
+	if (parent == -FDT_ERR_NOTFOUND) {
+		parent = fdt_add_subnode(keydest, 0, FIT_SIG_NODENAME);
+		if (parent < 0) {
+			ret = parent;
+			if (ret != -FDT_ERR_NOSPACE) {
+				fprintf(stderr, "Couldn't create signature node: %s\n",
+					fdt_strerror(parent));
+			}
+		}
+	}
+	if (ret)
+		goto done;
+
+	/* Either create or overwrite the named key node */
+	snprintf(name, sizeof(name), "key-%s", info->keyname);
+	node = fdt_subnode_offset(keydest, parent, name);
+	if (node == -FDT_ERR_NOTFOUND) {
+		node = fdt_add_subnode(keydest, parent, name);
+		if (node < 0) {
+			ret = node;
+			if (ret != -FDT_ERR_NOSPACE) {
+				fprintf(stderr, "Could not create key subnode: %s\n",
+					fdt_strerror(node));
+			}
+		}
+	} else if (node < 0) {
+		fprintf(stderr, "Cannot select keys parent: %s\n",
+			fdt_strerror(node));
+		ret = node;
+	}
+
+	if (!ret) {
+		ret = fdt_setprop_string(keydest, node, "key-name-hint",
+					 info->keyname);
+	}
+	if (!ret)
+		ret = fdt_setprop_string(keydest, node, "ecdsa,curve",
+					 "prime256v1");
+	if (!ret)
+		ret = fdt_setprop(keydest, node, "ecdsa,x-point", x_point,
+				  sizeof(x_point));
+	if (!ret)
+		ret = fdt_setprop(keydest, node, "ecdsa,y-point", y_point,
+				  sizeof(y_point));
+	if (!ret) {
+		ret = fdt_setprop_string(keydest, node, FIT_ALGO_PROP,
+					 info->name);
+	}
+	if (!ret && info->require_keys) {
+		ret = fdt_setprop_string(keydest, node, "required",
+					 info->require_keys);
+	}
+done:
+	if (ret)
+		ret = ret == -FDT_ERR_NOSPACE ? -ENOSPC : -EIO;
+err_point:
+	BN_free(x);
+	BN_free(y);
+	EC_KEY_free(ec);
+	EVP_PKEY_free(key);
+
+	return ret;
+}
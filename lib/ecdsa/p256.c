@@ -0,0 +1,583 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * ECDSA signature verification on the NIST P-256 curve
+ *
+ * Field and scalar arithmetic is done in montgomery form, and points are
+ * kept in Jacobian coordinates so that only the final result needs an
+ * inversion. Everything handled here is public (the key, the signature and
+ * the hash), so the code does not try to take the same time whatever the
+ * data.
+ */
+
+#ifndef USE_HOSTCC
+#include <common.h>
+#include <linux/errno.h>
+#else
+#include "mkimage.h"
+#endif
+#include <u-boot/ecdsa.h>
+
+/*
+ * Numbers are little-endian arrays of limbs. Limbs are 64 bits wide where
+ * the compiler can multiply two of them into a 128-bit result.
+ */
+#ifdef __SIZEOF_INT128__
+typedef uint64_t bn_limb;
+typedef unsigned __int128 bn_dlimb;
+#else
+typedef uint32_t bn_limb;
+typedef uint64_t bn_dlimb;
+#endif
+
+#define BN_LIMB_BITS	(sizeof(bn_limb) * 8)
+#define P256_LIMBS	(256 / BN_LIMB_BITS)
+
+static const uint8_t p256_p[P256_BYTES] = {
+	0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x01,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+};
+
+static const uint8_t p256_n[P256_BYTES] = {
+	0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xbc, 0xe6, 0xfa, 0xad, 0xa7, 0x17, 0x9e, 0x84,
+	0xf3, 0xb9, 0xca, 0xc2, 0xfc, 0x63, 0x25, 0x51,
+};
+
+static const uint8_t p256_b[P256_BYTES] = {
+	0x5a, 0xc6, 0x35, 0xd8, 0xaa, 0x3a, 0x93, 0xe7,
+	0xb3, 0xeb, 0xbd, 0x55, 0x76, 0x98, 0x86, 0xbc,
+	0x65, 0x1d, 0x06, 0xb0, 0xcc, 0x53, 0xb0, 0xf6,
+	0x3b, 0xce, 0x3c, 0x3e, 0x27, 0xd2, 0x60, 0x4b,
+};
+
+static const uint8_t p256_gx[P256_BYTES] = {
+	0x6b, 0x17, 0xd1, 0xf2, 0xe1, 0x2c, 0x42, 0x47,
+	0xf8, 0xbc, 0xe6, 0xe5, 0x63, 0xa4, 0x40, 0xf2,
+	0x77, 0x03, 0x7d, 0x81, 0x2d, 0xeb, 0x33, 0xa0,
+	0xf4, 0xa1, 0x39, 0x45, 0xd8, 0x98, 0xc2, 0x96,
+};
+
+static const uint8_t p256_gy[P256_BYTES] = {
+	0x4f, 0xe3, 0x42, 0xe2, 0xfe, 0x1a, 0x7f, 0x9b,
+	0x8e, 0xe7, 0xeb, 0x4a, 0x7c, 0x0f, 0x9e, 0x16,
+	0x2b, 0xce, 0x33, 0x57, 0x6b, 0x31, 0x5e, 0xce,
+	0xcb, 0xb6, 0x40, 0x68, 0x37, 0xbf, 0x51, 0xf5,
+};
+
+/* R^2 mod p and R^2 mod n, for R = 2^256 */
+static const uint8_t p256_rr_p[P256_BYTES] = {
+	0x00, 0x00, 0x00, 0x04, 0xff, 0xff, 0xff, 0xfd,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xfe,
+	0xff, 0xff, 0xff, 0xfb, 0xff, 0xff, 0xff, 0xff,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03,
+};
+
+static const uint8_t p256_rr_n[P256_BYTES] = {
+	0x66, 0xe1, 0x2d, 0x94, 0xf3, 0xd9, 0x56, 0x20,
+	0x28, 0x45, 0xb2, 0x39, 0x2b, 0x6b, 0xec, 0x59,
+	0x46, 0x99, 0x79, 0x9c, 0x49, 0xbd, 0x6f, 0xa6,
+	0x83, 0x24, 0x4c, 0x95, 0xbe, 0x79, 0xee, 0xa2,
+};
+
+/* A modulus (p or n), with what montgomery arithmetic needs to use it */
+struct p256_mod {
+	bn_limb m[P256_LIMBS];
+	bn_limb rr[P256_LIMBS];		/* R^2 mod m */
+	bn_limb n0inv;			/* -1 / m[0] mod 2^BN_LIMB_BITS */
+};
+
+/* A point in Jacobian coordinates, in montgomery form; z == 0 at infinity */
+struct p256_point {
+	bn_limb x[P256_LIMBS];
+	bn_limb y[P256_LIMBS];
+	bn_limb z[P256_LIMBS];
+};
+
+struct p256_curve {
+	struct p256_mod p;
+	struct p256_mod n;
+	bn_limb b[P256_LIMBS];		/* montgomery form */
+	bn_limb one[P256_LIMBS];	/* R mod p, i.e. 1 in montgomery form */
+	struct p256_point g;
+};
+
+static void bn_from_be(bn_limb *dst, const uint8_t *src)
+{
+	uint i;
+
+	memset(dst, '\0', P256_LIMBS * sizeof(bn_limb));
+	for (i = 0; i < P256_BYTES; i++)
+		dst[i / sizeof(bn_limb)] |= (bn_limb)src[P256_BYTES - 1 - i] <<
+					    (i % sizeof(bn_limb) * 8);
+}
+
+static bool bn_is_zero(const bn_limb *a)
+{
+	bn_limb acc = 0;
+	uint i;
+
+	for (i = 0; i < P256_LIMBS; i++)
+		acc |= a[i];
+
+	return !acc;
+}
+
+/* Returns true if a < b */
+static bool bn_less(const bn_limb *a, const bn_limb *b)
+{
+	int i;
+
+	for (i = P256_LIMBS - 1; i >= 0; i--) {
+		if (a[i] != b[i])
+			return a[i] < b[i];
+	}
+
+	return false;
+}
+
+/* r = t - m if t (with @carry above its top limb) is not less than m */
+static void mod_reduce_once(const struct p256_mod *mod, bn_limb *r,
+			    const bn_limb *t, bn_limb carry)
+{
+	bn_limb d[P256_LIMBS];
+	bn_limb borrow = 0;
+	bn_limb mask;
+	bn_dlimb diff;
+	uint i;
+
+	for (i = 0; i < P256_LIMBS; i++) {
+		diff = (bn_dlimb)t[i] - mod->m[i] - borrow;
+		d[i] = (bn_limb)diff;
+		borrow = (bn_limb)(diff >> BN_LIMB_BITS) & 1;
+	}
+
+	mask = -(carry | (borrow ^ 1));
+	for (i = 0; i < P256_LIMBS; i++)
+		r[i] = (d[i] & mask) | (t[i] & ~mask);
+}
+
+static void mod_add(const struct p256_mod *mod, bn_limb *r,
+		    const bn_limb *a, const bn_limb *b)
+{
+	bn_limb t[P256_LIMBS];
+	bn_dlimb acc = 0;
+	uint i;
+
+	for (i = 0; i < P256_LIMBS; i++) {
+		acc = (bn_dlimb)a[i] + b[i] + (acc >> BN_LIMB_BITS);
+		t[i] = (bn_limb)acc;
+	}
+	mod_reduce_once(mod, r, t, (bn_limb)(acc >> BN_LIMB_BITS));
+}
+
+static void mod_sub(const struct p256_mod *mod, bn_limb *r,
+		    const bn_limb *a, const bn_limb *b)
+{
+	bn_limb borrow = 0;
+	bn_limb mask;
+	bn_dlimb acc;
+	uint i;
+
+	for (i = 0; i < P256_LIMBS; i++) {
+		acc = (bn_dlimb)a[i] - b[i] - borrow;
+		r[i] = (bn_limb)acc;
+		borrow = (bn_limb)(acc >> BN_LIMB_BITS) & 1;
+	}
+
+	/* Add the modulus back if it went below zero */
+	mask = -borrow;
+	acc = 0;
+	for (i = 0; i < P256_LIMBS; i++) {
+		acc = (bn_dlimb)r[i] + (mod->m[i] & mask) +
+		      (acc >> BN_LIMB_BITS);
+		r[i] = (bn_limb)acc;
+	}
+}
+
+/* r = a * b / R mod m; @r may be the same as @a or @b */
+static void mod_mul(const struct p256_mod *mod, bn_limb *r,
+		    const bn_limb *a, const bn_limb *b)
+{
+	bn_limb t[P256_LIMBS + 1];
+	bn_limb carry, top, m;
+	bn_dlimb acc;
+	uint i, j;
+
+	memset(t, '\0', sizeof(t));
+	top = 0;
+	for (i = 0; i < P256_LIMBS; i++) {
+		carry = 0;
+		for (j = 0; j < P256_LIMBS; j++) {
+			acc = (bn_dlimb)a[j] * b[i] + t[j] + carry;
+			t[j] = (bn_limb)acc;
+			carry = (bn_limb)(acc >> BN_LIMB_BITS);
+		}
+		acc = (bn_dlimb)t[P256_LIMBS] + carry;
+		t[P256_LIMBS] = (bn_limb)acc;
+		top = (bn_limb)(acc >> BN_LIMB_BITS);
+
+		m = t[0] * mod->n0inv;
+		acc = (bn_dlimb)m * mod->m[0] + t[0];
+		carry = (bn_limb)(acc >> BN_LIMB_BITS);
+		for (j = 1; j < P256_LIMBS; j++) {
+			acc = (bn_dlimb)m * mod->m[j] + t[j] + carry;
+			t[j - 1] = (bn_limb)acc;
+			carry = (bn_limb)(acc >> BN_LIMB_BITS);
+		}
+		acc = (bn_dlimb)t[P256_LIMBS] + carry;
+		t[P256_LIMBS - 1] = (bn_limb)acc;
+		t[P256_LIMBS] = top + (bn_limb)(acc >> BN_LIMB_BITS);
+	}
+
+	mod_reduce_once(mod, r, t, t[P256_LIMBS]);
+}
+
+/* r = 1 / a mod m, both in montgomery form, by Fermat: a^(m - 2) */
+static void mod_inv(const struct p256_mod *mod, bn_limb *r, const bn_limb *a)
+{
+	bn_limb e[P256_LIMBS];
+	bn_limb acc[P256_LIMBS];
+	bool started = false;
+	int i;
+
+	memcpy(e, mod->m, sizeof(e));
+	e[0] -= 2;	/* m is odd and much larger than 2, so no borrow */
+
+	for (i = 256 - 1; i >= 0; i--) {
+		if (started)
+			mod_mul(mod, acc, acc, acc);
+		if (e[i / BN_LIMB_BITS] & ((bn_limb)1 << (i % BN_LIMB_BITS))) {
+			if (started)
+				mod_mul(mod, acc, acc, a);
+			else
+				memcpy(acc, a, sizeof(acc));
+			started = true;
+		}
+	}
+	memcpy(r, acc, sizeof(acc));
+}
+
+static bn_limb mod_n0inv(bn_limb m0)
+{
+	bn_limb x = m0;		/* correct to 3 bits, as m0 is odd */
+	int i;
+
+	for (i = 0; i < 5; i++)
+		x *= 2 - m0 * x;
+
+	return -x;
+}
+
+static void mod_init(struct p256_mod *mod, const uint8_t *m,
+		     const uint8_t *rr)
+{
+	bn_from_be(mod->m, m);
+	bn_from_be(mod->rr, rr);
+	mod->n0inv = mod_n0inv(mod->m[0]);
+}
+
+static void p256_curve_init(struct p256_curve *c)
+{
+	bn_limb t[P256_LIMBS];
+
+	mod_init(&c->p, p256_p, p256_rr_p);
+	mod_init(&c->n, p256_n, p256_rr_n);
+
+	/* 1 * R^2 / R = R */
+	memset(t, '\0', sizeof(t));
+	t[0] = 1;
+	mod_mul(&c->p, c->one, t, c->p.rr);
+
+	bn_from_be(t, p256_b);
+	mod_mul(&c->p, c->b, t, c->p.rr);
+	bn_from_be(t, p256_gx);
+	mod_mul(&c->p, c->g.x, t, c->p.rr);
+	bn_from_be(t, p256_gy);
+	mod_mul(&c->p, c->g.y, t, c->p.rr);
+	memcpy(c->g.z, c->one, sizeof(c->one));
+}
+
+/* Doubling for a = -3, "dbl-2001-b" from the Explicit-Formulas Database */
+static void point_double(const struct p256_curve *c, struct p256_point *r,
+			 const struct p256_point *a)
+{
+	const struct p256_mod *p = &c->p;
+	bn_limb delta[P256_LIMBS], gamma[P256_LIMBS], beta[P256_LIMBS];
+	bn_limb alpha[P256_LIMBS], t1[P256_LIMBS], t2[P256_LIMBS];
+
+	mod_mul(p, delta, a->z, a->z);
+	mod_mul(p, gamma, a->y, a->y);
+	mod_mul(p, beta, a->x, gamma);
+
+	/* alpha = 3 * (x - delta) * (x + delta) */
+	mod_sub(p, t1, a->x, delta);
+	mod_add(p, t2, a->x, delta);
+	mod_mul(p, alpha, t1, t2);
+	mod_add(p, t1, alpha, alpha);
+	mod_add(p, alpha, t1, alpha);
+
+	/* z3 = (y + z)^2 - gamma - delta */
+	mod_add(p, t1, a->y, a->z);
+	mod_mul(p, t1, t1, t1);
+	mod_sub(p, t1, t1, gamma);
+	mod_sub(p, r->z, t1, delta);
+
+	/* x3 = alpha^2 - 8 * beta */
+	mod_add(p, beta, beta, beta);
+	mod_add(p, beta, beta, beta);		/* 4 * beta */
+	mod_mul(p, t1, alpha, alpha);
+	mod_sub(p, t1, t1, beta);
+	mod_sub(p, r->x, t1, beta);
+
+	/* y3 = alpha * (4 * beta - x3) - 8 * gamma^2 */
+	mod_sub(p, t1, beta, r->x);
+	mod_mul(p, t1, alpha, t1);
+	mod_mul(p, t2, gamma, gamma);
+	mod_add(p, t2, t2, t2);
+	mod_add(p, t2, t2, t2);
+	mod_add(p, t2, t2, t2);
+	mod_sub(p, r->y, t1, t2);
+}
+
+/* General addition, "add-2007-bl" from the Explicit-Formulas Database */
+static void point_add(const struct p256_curve *c, struct p256_point *r,
+		      const struct p256_point *a, const struct p256_point *b)
+{
+	const struct p256_mod *p = &c->p;
+	bn_limb z1z1[P256_LIMBS], z2z2[P256_LIMBS], u1[P256_LIMBS];
+	bn_limb u2[P256_LIMBS], s1[P256_LIMBS], s2[P256_LIMBS];
+	bn_limb h[P256_LIMBS], i[P256_LIMBS], j[P256_LIMBS];
+	bn_limb rr[P256_LIMBS], v[P256_LIMBS], t[P256_LIMBS];
+
+	if (bn_is_zero(a->z)) {
+		*r = *b;
+		return;
+	}
+	if (bn_is_zero(b->z)) {
+		*r = *a;
+		return;
+	}
+
+	mod_mul(p, z1z1, a->z, a->z);
+	mod_mul(p, z2z2, b->z, b->z);
+	mod_mul(p, u1, a->x, z2z2);
+	mod_mul(p, u2, b->x, z1z1);
+	mod_mul(p, s1, a->y, b->z);
+	mod_mul(p, s1, s1, z2z2);
+	mod_mul(p, s2, b->y, a->z);
+	mod_mul(p, s2, s2, z1z1);
+
+	mod_sub(p, h, u2, u1);
+	mod_sub(p, rr, s2, s1);
+	if (bn_is_zero(h)) {
+		if (bn_is_zero(rr))
+			point_double(c, r, a);
+		else
+			memset(r, '\0', sizeof(*r));
+		return;
+	}
+	mod_add(p, rr, rr, rr);
+
+	/* i = (2 * h)^2, j = h * i, v = u1 * i */
+	mod_add(p, i, h, h);
+	mod_mul(p, i, i, i);
+	mod_mul(p, j, h, i);
+	mod_mul(p, v, u1, i);
+
+	/* z3 = ((z1 + z2)^2 - z1z1 - z2z2) * h */
+	mod_add(p, t, a->z, b->z);
+	mod_mul(p, t, t, t);
+	mod_sub(p, t, t, z1z1);
+	mod_sub(p, t, t, z2z2);
+	mod_mul(p, r->z, t, h);
+
+	/* x3 = rr^2 - j - 2 * v */
+	mod_mul(p, t, rr, rr);
+	mod_sub(p, t, t, j);
+	mod_sub(p, t, t, v);
+	mod_sub(p, r->x, t, v);
+
+	/* y3 = rr * (v - x3) - 2 * s1 * j */
+	mod_sub(p, t, v, r->x);
+	mod_mul(p, t, rr, t);
+	mod_mul(p, s1, s1, j);
+	mod_add(p, s1, s1, s1);
+	mod_sub(p, r->y, t, s1);
+}
+
+/* Check that an affine point, in montgomery form, is on the curve */
+static bool point_on_curve(const struct p256_curve *c, const bn_limb *x,
+			   const bn_limb *y)
+{
+	const struct p256_mod *p = &c->p;
+	bn_limb lhs[P256_LIMBS], rhs[P256_LIMBS], t[P256_LIMBS];
+
+	/* y^2 = x^3 - 3x + b */
+	mod_mul(p, lhs, y, y);
+	mod_mul(p, rhs, x, x);
+	mod_mul(p, rhs, rhs, x);
+	mod_add(p, t, x, x);
+	mod_add(p, t, t, x);
+	mod_sub(p, rhs, rhs, t);
+	mod_add(p, rhs, rhs, c->b);
+
+	return !memcmp(lhs, rhs, sizeof(lhs));
+}
+
+/*
+ * The scalar multiplication uses width-5 NAF: each digit is zero or odd in
+ * -15..15 and no two of any five neighbouring digits are non-zero, so only
+ * about one bit in six needs a point addition.
+ */
+#define P256_WNAF_WIDTH		5
+#define P256_WNAF_DIGITS	(256 + 1)
+#define P256_WNAF_TABLE		(1 << (P256_WNAF_WIDTH - 2))	/* P..15P */
+
+/* Recode @scalar (less than 2^256) into wNAF; returns the digit count */
+static int scalar_to_wnaf(int8_t *naf, const bn_limb *scalar)
+{
+	bn_limb k[P256_LIMBS + 1];
+	bn_dlimb acc;
+	int len = 0;
+	int digit;
+	uint i;
+
+	memcpy(k, scalar, P256_LIMBS * sizeof(bn_limb));
+	k[P256_LIMBS] = 0;
+	while (!bn_is_zero(k) || k[P256_LIMBS]) {
+		digit = 0;
+		if (k[0] & 1) {
+			digit = k[0] & ((1 << P256_WNAF_WIDTH) - 1);
+			if (digit >= 1 << (P256_WNAF_WIDTH - 1))
+				digit -= 1 << P256_WNAF_WIDTH;
+
+			/* k -= digit, which clears the low bits of k */
+			if (digit > 0) {
+				k[0] -= digit;
+			} else {
+				acc = -digit;
+				for (i = 0; i <= P256_LIMBS; i++) {
+					acc += k[i];
+					k[i] = (bn_limb)acc;
+					acc >>= BN_LIMB_BITS;
+				}
+			}
+		}
+		naf[len++] = digit;
+
+		for (i = 0; i < P256_LIMBS; i++)
+			k[i] = k[i] >> 1 | k[i + 1] << (BN_LIMB_BITS - 1);
+		k[P256_LIMBS] >>= 1;
+	}
+
+	return len;
+}
+
+/* Fill @tab with P, 3P, 5P, ... (2 * P256_WNAF_TABLE - 1)P */
+static void point_odd_multiples(const struct p256_curve *c,
+				struct p256_point *tab,
+				const struct p256_point *pt)
+{
+	struct p256_point twice;
+	int i;
+
+	point_double(c, &twice, pt);
+	tab[0] = *pt;
+	for (i = 1; i < P256_WNAF_TABLE; i++)
+		point_add(c, &tab[i], &tab[i - 1], &twice);
+}
+
+/* acc += digit * P, where @tab holds the odd multiples of P */
+static void point_add_digit(const struct p256_curve *c,
+			    struct p256_point *acc,
+			    const struct p256_point *tab, int digit)
+{
+	static const bn_limb zero[P256_LIMBS];
+	struct p256_point t, sum;
+
+	if (digit > 0) {
+		t = tab[digit / 2];
+	} else {
+		t = tab[-digit / 2];
+		mod_sub(&c->p, t.y, zero, t.y);
+	}
+	point_add(c, &sum, acc, &t);
+	*acc = sum;
+}
+
+int p256_ecdsa_verify(const uint8_t *qx, const uint8_t *qy,
+		      const uint8_t *hash, int hash_len, const uint8_t *sig)
+{
+	struct p256_point tab_g[P256_WNAF_TABLE], tab_q[P256_WNAF_TABLE];
+	int8_t naf_g[P256_WNAF_DIGITS], naf_q[P256_WNAF_DIGITS];
+	struct p256_point q, acc;
+	struct p256_curve c;
+	bn_limb r[P256_LIMBS], s[P256_LIMBS], e[P256_LIMBS];
+	bn_limb u1[P256_LIMBS], u2[P256_LIMBS], t[P256_LIMBS];
+	uint8_t ebuf[P256_BYTES];
+	int len_g, len_q, i;
+
+	p256_curve_init(&c);
+
+	/* 0 < r, s < n */
+	bn_from_be(r, sig);
+	bn_from_be(s, sig + P256_BYTES);
+	if (bn_is_zero(r) || bn_is_zero(s) || !bn_less(r, c.n.m) ||
+	    !bn_less(s, c.n.m))
+		return -EINVAL;
+
+	/* The public key must be a point on the curve */
+	bn_from_be(q.x, qx);
+	bn_from_be(q.y, qy);
+	if (!bn_less(q.x, c.p.m) || !bn_less(q.y, c.p.m))
+		return -EINVAL;
+	mod_mul(&c.p, q.x, q.x, c.p.rr);
+	mod_mul(&c.p, q.y, q.y, c.p.rr);
+	memcpy(q.z, c.one, sizeof(c.one));
+	if (!point_on_curve(&c, q.x, q.y))
+		return -EINVAL;
+
+	/* e is the leftmost 256 bits of the hash, reduced mod n */
+	memset(ebuf, '\0', sizeof(ebuf));
+	if (hash_len > P256_BYTES)
+		hash_len = P256_BYTES;
+	memcpy(ebuf + P256_BYTES - hash_len, hash, hash_len);
+	bn_from_be(t, ebuf);
+	mod_reduce_once(&c.n, e, t, 0);
+
+	/* u1 = e / s mod n, u2 = r / s mod n */
+	mod_mul(&c.n, t, s, c.n.rr);
+	mod_inv(&c.n, t, t);			/* s^-1 * R */
+	mod_mul(&c.n, u1, e, t);
+	mod_mul(&c.n, u2, r, t);
+
+	/* acc = u1 * G + u2 * Q, sharing the doublings between the two */
+	len_g = scalar_to_wnaf(naf_g, u1);
+	len_q = scalar_to_wnaf(naf_q, u2);
+	point_odd_multiples(&c, tab_g, &c.g);
+	point_odd_multiples(&c, tab_q, &q);
+	memset(&acc, '\0', sizeof(acc));
+	for (i = (len_g > len_q ? len_g : len_q) - 1; i >= 0; i--) {
+		point_double(&c, &acc, &acc);
+		if (i < len_g && naf_g[i])
+			point_add_digit(&c, &acc, tab_g, naf_g[i]);
+		if (i < len_q && naf_q[i])
+			point_add_digit(&c, &acc, tab_q, naf_q[i]);
+	}
+	if (bn_is_zero(acc.z))
+		return -EACCES;
+
+	/* x = X / Z^2, taken out of montgomery form, then mod n */
+	mod_mul(&c.p, t, acc.z, acc.z);
+	mod_inv(&c.p, t, t);			/* Z^-2 * R */
+	mod_mul(&c.p, t, t, acc.x);		/* x * R */
+	memset(u1, '\0', sizeof(u1));
+	u1[0] = 1;
+	mod_mul(&c.p, t, t, u1);
+	mod_reduce_once(&c.n, t, t, 0);
+
+	return memcmp(t, r, sizeof(r)) ? -EACCES : 0;
+}
@@ -0,0 +1,208 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Writing an indexed binary environment
+ *
+ * This is built into mkenvimage as well as U-Boot. See include/env_index.h
+ * for the layout.
+ */
+
+#ifdef USE_HOSTCC
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#else
+#include <common.h>
+#include <malloc.h>
+#endif
+#include <env_index.h>
+
+struct env_index_var {
+	const char *key;
+	unsigned int key_len;
+	const char *value;	/* NULL if the variable has been removed */
+	unsigned int value_len;
+	uint32_t idx;
+	uint32_t hval;
+};
+
+/*
+ * Copy a value, dropping the backslash before an escaped character as
+ * himport_r() does. Returns the length of the result; nothing is written if
+ * @out is NULL.
+ */
+static unsigned int env_index_unescape(char *out, const char *in,
+				       unsigned int len)
+{
+	unsigned int i, count = 0;
+
+	for (i = 0; i < len; i++) {
+		if (in[i] == '\\' && i + 1 < len)
+			i++;
+		if (out)
+			out[count] = in[i];
+		count++;
+	}
+
+	return count;
+}
+
+static void env_index_put32(char *p, uint32_t val, bool big_endian)
+{
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		p[big_endian ? 3 - i : i] = val & 0xff;
+		val >>= 8;
+	}
+}
+
+/* Parse the text into @vars, keeping the last setting of each variable */
+static int env_index_parse(struct env_index_var *vars, const char *env,
+			   size_t env_size)
+{
+	const char *end = env + env_size;
+	const char *p, *eq, *next;
+	int count = 0;
+	int i;
+
+	for (p = env; p < end && *p; p = next) {
+		next = p + strnlen(p, end - p) + 1;
+
+		while (p < next && (*p == ' ' || *p == '\t'))
+			p++;
+		if (*p == '#' || !*p)
+			continue;
+		eq = memchr(p, '=', next - 1 - p);
+		if (eq == p)
+			return -EINVAL;
+
+		for (i = 0; i < count; i++) {
+			if (vars[i].key_len == (eq ? eq : next - 1) - p &&
+			    !memcmp(vars[i].key, p, vars[i].key_len))
+				break;
+		}
+		if (i == count) {
+			vars[count].key = p;
+			vars[count].key_len = (eq ? eq : next - 1) - p;
+			count++;
+		}
+
+		/* "name" and "name=" remove the variable */
+		if (!eq || eq + 1 == next - 1) {
+			vars[i].value = NULL;
+		} else {
+			vars[i].value = eq + 1;
+			vars[i].value_len = next - 1 - (eq + 1);
+		}
+	}
+
+	return count;
+}
+
+/* Find the slot for each variable, as hsearch_r() does with an empty table */
+static int env_index_place(struct env_index_var *vars, int count,
+			   unsigned int size)
+{
+	uint32_t *used;
+	unsigned int idx, hval, step;
+	int i;
+
+	used = calloc(size + 1, sizeof(*used));
+	if (!used)
+		return -ENOMEM;
+
+	for (i = 0; i < count; i++) {
+		if (!vars[i].value)
+			continue;
+		hval = env_index_hash(vars[i].key, vars[i].key_len, size);
+		idx = hval;
+		if (used[idx]) {
+			step = env_index_step(hval, size);
+			do {
+				idx = env_index_next(idx, step, size);
+				if (idx == hval) {
+					free(used);
+					return -ENOMEM;
+				}
+			} while (used[idx]);
+		}
+		used[idx] = hval;
+		vars[i].idx = idx;
+		vars[i].hval = hval;
+	}
+	free(used);
+
+	return 0;
+}
+
+int env_index_build(char *buf, size_t size, const char *env, size_t env_size,
+		    unsigned int nel, bool big_endian)
+{
+	struct env_index_var *vars;
+	unsigned int table_size, live = 0, pool_size = 0;
+	char *entry, *pool;
+	size_t total;
+	int count, ret, i;
+
+	/* Each variable needs at least two bytes of text */
+	vars = calloc(env_size / 2 + 1, sizeof(*vars));
+	if (!vars)
+		return -ENOMEM;
+	count = env_index_parse(vars, env, env_size);
+	if (count < 0) {
+		ret = count;
+		goto out;
+	}
+
+	table_size = env_index_table_size(nel);
+	ret = env_index_place(vars, count, table_size);
+	if (ret)
+		goto out;
+
+	for (i = 0; i < count; i++) {
+		if (!vars[i].value)
+			continue;
+		live++;
+		pool_size += vars[i].key_len + 1;
+		pool_size += env_index_unescape(NULL, vars[i].value,
+						vars[i].value_len) + 1;
+	}
+	total = sizeof(struct env_index_header) +
+		live * sizeof(struct env_index_entry) + pool_size;
+	if (total > size) {
+		ret = -ENOSPC;
+		goto out;
+	}
+
+	memcpy(buf, ENV_INDEX_MAGIC, ENV_INDEX_MAGIC_LEN);
+	env_index_put32(buf + 4, table_size, big_endian);
+	env_index_put32(buf + 8, live, big_endian);
+	env_index_put32(buf + 12, pool_size, big_endian);
+
+	entry = buf + sizeof(struct env_index_header);
+	pool = entry + live * sizeof(struct env_index_entry);
+	pool_size = 0;
+	for (i = 0; i < count; i++) {
+		if (!vars[i].value)
+			continue;
+		env_index_put32(entry, vars[i].idx, big_endian);
+		env_index_put32(entry + 4, vars[i].hval, big_endian);
+		env_index_put32(entry + 8, pool_size, big_endian);
+		memcpy(pool + pool_size, vars[i].key, vars[i].key_len);
+		pool_size += vars[i].key_len;
+		pool[pool_size++] = '\0';
+		env_index_put32(entry + 12, pool_size, big_endian);
+		pool_size += env_index_unescape(pool + pool_size,
+						vars[i].value,
+						vars[i].value_len);
+		pool[pool_size++] = '\0';
+		entry += sizeof(struct env_index_entry);
+	}
+	ret = total;
+out:
+	free(vars);
+
+	return ret;
+}
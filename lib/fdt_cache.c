@@ -0,0 +1,303 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Lookup cache for the control device tree
+ *
+ * See include/fdt_cache.h for how this is used by libfdt.
+ */
+
+#include <common.h>
+#include <fdt_cache.h>
+#include <malloc.h>
+#include <linux/libfdt.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#define FDT_CACHE_ENTRIES	CONFIG_OF_LIBFDT_CACHE_ENTRIES
+/* Do not build a phandle array with more entries than this */
+#define FDT_CACHE_MAX_PHANDLE	0x10000
+
+struct fdt_cache_phandle {
+	uint32_t phandle;	/* 0 if the entry is free */
+	int offset;
+};
+
+struct fdt_cache_path {
+	u32 hash;
+	int len;		/* 0 if the entry is free */
+	int parent;		/* Offset of the node for the shorter prefix */
+	int offset;
+};
+
+struct fdt_cache {
+	const void *blob;
+	/* Header fields which change when nodes may have moved */
+	u32 off_dt_struct;
+	u32 size_dt_struct;
+	u32 size_dt_strings;
+	bool full_malloc;	/* Allocated from the full malloc() pool */
+
+	int *phandle_map;	/* Offset for each phandle, or -1 */
+	uint32_t max_phandle;
+	bool map_failed;	/* Do not try to build the array again */
+	struct fdt_cache_phandle phandle[FDT_CACHE_ENTRIES];
+	struct fdt_cache_path path[FDT_CACHE_ENTRIES];
+
+	struct fdt_cache_stats stats;
+};
+
+static void fdt_cache_clear(struct fdt_cache *cache)
+{
+	if (cache->phandle_map)
+		free(cache->phandle_map);
+	cache->phandle_map = NULL;
+	cache->max_phandle = 0;
+	cache->map_failed = false;
+	memset(cache->phandle, '\0', sizeof(cache->phandle));
+	memset(cache->path, '\0', sizeof(cache->path));
+}
+
+/* Get the cache for a blob, or NULL if it is not cached */
+static struct fdt_cache *fdt_cache_get(const void *fdt)
+{
+	bool full_malloc = gd->flags & GD_FLG_FULL_MALLOC_INIT;
+	struct fdt_cache *cache = gd->fdt_cache;
+
+	if (!fdt || fdt != gd->fdt_blob)
+		return NULL;
+#if !CONFIG_VAL(SYS_MALLOC_F_LEN)
+	/* There is no malloc() until the full one is ready */
+	if (!full_malloc)
+		return NULL;
+#endif
+
+	/*
+	 * Anything allocated before the full malloc() is ready cannot be
+	 * freed, so just leave it behind
+	 */
+	if (!cache || cache->full_malloc != full_malloc) {
+		cache = calloc(1, sizeof(*cache));
+		if (!cache)
+			return NULL;
+		cache->full_malloc = full_malloc;
+		if (gd->fdt_cache)
+			cache->stats = gd->fdt_cache->stats;
+		gd->fdt_cache = cache;
+	}
+
+	if (cache->blob != fdt ||
+	    cache->off_dt_struct != fdt_off_dt_struct(fdt) ||
+	    cache->size_dt_struct != fdt_size_dt_struct(fdt) ||
+	    cache->size_dt_strings != fdt_size_dt_strings(fdt)) {
+		if (cache->blob)
+			cache->stats.invalidations++;
+		fdt_cache_clear(cache);
+		cache->blob = fdt;
+		cache->off_dt_struct = fdt_off_dt_struct(fdt);
+		cache->size_dt_struct = fdt_size_dt_struct(fdt);
+		cache->size_dt_strings = fdt_size_dt_strings(fdt);
+	}
+
+	return cache;
+}
+
+/*
+ * Build the phandle array with two passes over the blob: one to find the
+ * largest phandle and one to fill in the array
+ */
+static void fdt_cache_build_map(struct fdt_cache *cache)
+{
+	const void *fdt = cache->blob;
+	uint32_t phandle, max = 0;
+	int offset;
+
+	for (offset = fdt_next_node(fdt, -1, NULL); offset >= 0;
+	     offset = fdt_next_node(fdt, offset, NULL)) {
+		phandle = fdt_get_phandle(fdt, offset);
+		if (phandle > max && phandle != (uint32_t)-1)
+			max = phandle;
+	}
+	if (!max || max >= FDT_CACHE_MAX_PHANDLE)
+		goto err;
+
+	cache->phandle_map = malloc((max + 1) * sizeof(int));
+	if (!cache->phandle_map)
+		goto err;
+	memset(cache->phandle_map, 0xff, (max + 1) * sizeof(int));
+	cache->max_phandle = max;
+
+	for (offset = fdt_next_node(fdt, -1, NULL); offset >= 0;
+	     offset = fdt_next_node(fdt, offset, NULL)) {
+		phandle = fdt_get_phandle(fdt, offset);
+		if (phandle && phandle <= max &&
+		    cache->phandle_map[phandle] < 0)
+			cache->phandle_map[phandle] = offset;
+	}
+	cache->stats.builds++;
+	debug("fdt_cache: %u phandles\n", max);
+
+	return;
+err:
+	cache->map_failed = true;
+}
+
+bool fdt_cache_find_phandle(const void *fdt, uint32_t phandle, int *offsetp)
+{
+	struct fdt_cache *cache = fdt_cache_get(fdt);
+	struct fdt_cache_phandle *ent;
+	int offset = -1;
+
+	if (!cache)
+		return false;
+	cache->stats.phandle_lookups++;
+
+	if (cache->full_malloc && !cache->phandle_map && !cache->map_failed)
+		fdt_cache_build_map(cache);
+	if (cache->phandle_map) {
+		if (phandle <= cache->max_phandle)
+			offset = cache->phandle_map[phandle];
+	} else {
+		ent = &cache->phandle[phandle % FDT_CACHE_ENTRIES];
+		if (ent->phandle == phandle)
+			offset = ent->offset;
+	}
+
+	/* A property may have been changed in place */
+	if (offset < 0 || fdt_get_phandle(fdt, offset) != phandle)
+		return false;
+	cache->stats.phandle_hits++;
+	*offsetp = offset;
+
+	return true;
+}
+
+void fdt_cache_add_phandle(const void *fdt, uint32_t phandle, int offset)
+{
+	struct fdt_cache *cache = fdt_cache_get(fdt);
+	struct fdt_cache_phandle *ent;
+
+	if (!cache)
+		return;
+	if (cache->phandle_map) {
+		if (phandle <= cache->max_phandle)
+			cache->phandle_map[phandle] = offset;
+		return;
+	}
+	ent = &cache->phandle[phandle % FDT_CACHE_ENTRIES];
+	ent->phandle = phandle;
+	ent->offset = offset;
+}
+
+/* FNV-1a, continued from @hash */
+static u32 fdt_cache_hash(u32 hash, const char *s, int len)
+{
+	while (len--) {
+		hash ^= (u8)*s++;
+		hash *= 16777619;
+	}
+
+	return hash;
+}
+
+#define FDT_CACHE_HASH_INIT	2166136261U
+
+/* Check that the node at @offset is the one named by @name */
+static bool fdt_cache_name_matches(const void *fdt, int offset,
+				   const char *name, int len)
+{
+	const char *node_name;
+	int node_len;
+
+	node_name = fdt_get_name(fdt, offset, &node_len);
+	if (!node_name || node_len < len || memcmp(node_name, name, len))
+		return false;
+
+	/* A path may leave out the unit address */
+	return node_len == len ||
+	       (!memchr(name, '@', len) && node_name[len] == '@');
+}
+
+int fdt_cache_find_path(const void *fdt, const char *path, int namelen,
+			int *lenp)
+{
+	struct fdt_cache *cache = fdt_cache_get(fdt);
+	struct fdt_cache_path *ent;
+	const char *name = path;
+	int hashed = 0, offset = 0;
+	u32 hash;
+	int i;
+
+	*lenp = 0;
+	if (!cache)
+		return 0;
+	cache->stats.path_lookups++;
+
+	hash = FDT_CACHE_HASH_INIT;
+	for (i = 1; i <= namelen; i++) {
+		if (i < namelen && path[i] != '/' && path[i] != ':')
+			continue;
+		hash = fdt_cache_hash(hash, path + hashed, i - hashed);
+		hashed = i;
+		if (path[i - 1] != '/') {
+			/*
+			 * A node can be renamed in place, so the entry is only
+			 * used if its parent is the node just found for the
+			 * shorter prefix. Nodes keep their parents until the
+			 * cache is dropped, so this checks every name on the
+			 * way.
+			 */
+			ent = &cache->path[hash % FDT_CACHE_ENTRIES];
+			if (ent->len != i || ent->hash != hash ||
+			    ent->parent != offset ||
+			    !fdt_cache_name_matches(fdt, ent->offset, name + 1,
+						    path + i - name - 1))
+				break;
+			*lenp = i;
+			offset = ent->offset;
+		}
+		if (i == namelen || path[i] == ':')
+			break;
+		name = path + i;
+	}
+	if (*lenp)
+		cache->stats.path_hits++;
+
+	return offset;
+}
+
+void fdt_cache_add_path(const void *fdt, const char *path, int len,
+			int parent, int offset)
+{
+	struct fdt_cache *cache = fdt_cache_get(fdt);
+	struct fdt_cache_path *ent;
+	u32 hash;
+
+	if (!cache)
+		return;
+	hash = fdt_cache_hash(FDT_CACHE_HASH_INIT, path, len);
+	ent = &cache->path[hash % FDT_CACHE_ENTRIES];
+	ent->hash = hash;
+	ent->len = len;
+	ent->parent = parent;
+	ent->offset = offset;
+}
+
+void fdt_cache_get_stats(struct fdt_cache_stats *stats)
+{
+	struct fdt_cache *cache = gd->fdt_cache;
+
+	if (cache)
+		*stats = cache->stats;
+	else
+		memset(stats, '\0', sizeof(*stats));
+}
+
+void fdt_cache_reset(void)
+{
+	struct fdt_cache *cache = gd->fdt_cache;
+
+	if (!cache)
+		return;
+	fdt_cache_clear(cache);
+	cache->blob = NULL;
+	memset(&cache->stats, '\0', sizeof(cache->stats));
+}
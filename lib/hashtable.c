@@ -42,6 +42,7 @@
 
 #include <env_callback.h>
 #include <env_flags.h>
+#include <env_index.h>
 #include <search.h>
 #include <slre.h>
 
@@ -65,27 +66,30 @@ typedef struct _ENTRY {
 static void _hdelete(const char *key, struct hsearch_data *htab, ENTRY *ep,
 	int idx);
 
+/*
+ * Free a key or value, unless it is in the pool of strings of an indexed
+ * import, which is freed as a whole.
+ */
+static void hfree(struct hsearch_data *htab, const void *ptr)
+{
+	const char *p = ptr;
+
+	if (htab->pool && p >= htab->pool &&
+	    p < htab->pool + htab->pool_size)
+		return;
+	free((void *)ptr);
+}
+
 /*
  * hcreate()
  */
 
 /*
- * For the used double hash method the table size has to be a prime. To
- * correct the user given table size we need a prime test.  This trivial
- * algorithm is adequate because
+ * For the used double hash method the table size has to be a prime. The
+ * trivial prime test in env_index_table_size() is adequate because
  * a)  the code is (most probably) called a few times per program run and
  * b)  the number is small because the table must fit in the core
  * */
-static int isprime(unsigned int number)
-{
-	/* no even number will be passed */
-	unsigned int div = 3;
-
-	while (div * div < number && number % div != 0)
-		div += 2;
-
-	return number % div != 0;
-}
 
 /*
  * Before using the hash table we must allocate memory for it.
@@ -109,11 +113,7 @@ int hcreate_r(size_t nel, struct hsearch_data *htab)
 		return 0;
 
 	/* Change nel to the first prime number not smaller as nel. */
-	nel |= 1;		/* make odd */
-	while (!isprime(nel))
-		nel += 2;
-
-	htab->size = nel;
+	htab->size = env_index_table_size(nel);
 	htab->filled = 0;
 
 	/* allocate memory and zero out */
@@ -150,11 +150,14 @@ void hdestroy_r(struct hsearch_data *htab)
 		if (htab->table[i].used > 0) {
 			ENTRY *ep = &htab->table[i].entry;
 
-			free((void *)ep->key);
-			free(ep->data);
+			hfree(htab, ep->key);
+			hfree(htab, ep->data);
 		}
 	}
 	free(htab->table);
+	free(htab->pool);
+	htab->pool = NULL;
+	htab->pool_size = 0;
 
 	/* the sign for an existing table is an value != NULL in htable */
 	htab->table = NULL;
@@ -251,7 +254,7 @@ static inline int _compare_and_overwrite_entry(ENTRY item, ACTION action,
 				return 0;
 			}
 
-			free(htab->table[idx].entry.data);
+			hfree(htab, htab->table[idx].entry.data);
 			htab->table[idx].entry.data = strdup(item.data);
 			if (!htab->table[idx].entry.data) {
 				__set_errno(ENOMEM);
@@ -267,31 +270,63 @@ static inline int _compare_and_overwrite_entry(ENTRY item, ACTION action,
 	return -1;
 }
 
+/*
+ * Finish creating the entry in slot idx, whose key and data have been set.
+ * This is simply a helper function for hsearch_r() and himport_index_r().
+ */
+static int _hcreate_entry(struct hsearch_data *htab, unsigned int idx,
+	ENTRY **retval, int flag)
+{
+	ENTRY *ep = &htab->table[idx].entry;
+
+	++htab->filled;
+
+	/* This is a new entry, so look up a possible callback */
+	env_callback_init(ep);
+	/* Also look for flags */
+	env_flags_init(ep);
+
+	/* check for permission */
+	if (htab->change_ok != NULL &&
+	    htab->change_ok(ep, ep->data, env_op_create, flag)) {
+		debug("change_ok() rejected setting variable "
+			"%s, skipping it!\n", ep->key);
+		_hdelete(ep->key, htab, ep, idx);
+		__set_errno(EPERM);
+		*retval = NULL;
+		return 0;
+	}
+
+	/* If there is a callback, call it */
+	if (ep->callback &&
+	    ep->callback(ep->key, ep->data, env_op_create, flag)) {
+		debug("callback() rejected setting variable "
+			"%s, skipping it!\n", ep->key);
+		_hdelete(ep->key, htab, ep, idx);
+		__set_errno(EINVAL);
+		*retval = NULL;
+		return 0;
+	}
+
+	/* return new entry */
+	*retval = ep;
+	return 1;
+}
+
 int hsearch_r(ENTRY item, ACTION action, ENTRY ** retval,
 	      struct hsearch_data *htab, int flag)
 {
 	unsigned int hval;
-	unsigned int count;
 	unsigned int len = strlen(item.key);
 	unsigned int idx;
 	unsigned int first_deleted = 0;
 	int ret;
 
-	/* Compute an value for the given string. Perhaps use a better method. */
-	hval = len;
-	count = len;
-	while (count-- > 0) {
-		hval <<= 4;
-		hval += item.key[count];
-	}
-
 	/*
 	 * First hash function:
 	 * simply take the modul but prevent zero.
 	 */
-	hval %= htab->size;
-	if (hval == 0)
-		++hval;
+	hval = env_index_hash(item.key, len, htab->size);
 
 	/* The first index tried. */
 	idx = hval;
@@ -316,17 +351,14 @@ int hsearch_r(ENTRY item, ACTION action, ENTRY ** retval,
 		 * Second hash function:
 		 * as suggested in [Knuth]
 		 */
-		hval2 = 1 + hval % (htab->size - 2);
+		hval2 = env_index_step(hval, htab->size);
 
 		do {
 			/*
 			 * Because SIZE is prime this guarantees to
 			 * step through all available indices.
 			 */
-			if (idx <= hval2)
-				idx = htab->size + idx - hval2;
-			else
-				idx -= hval2;
+			idx = env_index_next(idx, hval2, htab->size);
 
 			/*
 			 * If we visited all entries leave the loop
@@ -373,39 +405,7 @@ int hsearch_r(ENTRY item, ACTION action, ENTRY ** retval,
 			return 0;
 		}
 
-		++htab->filled;
-
-		/* This is a new entry, so look up a possible callback */
-		env_callback_init(&htab->table[idx].entry);
-		/* Also look for flags */
-		env_flags_init(&htab->table[idx].entry);
-
-		/* check for permission */
-		if (htab->change_ok != NULL && htab->change_ok(
-		    &htab->table[idx].entry, item.data, env_op_create, flag)) {
-			debug("change_ok() rejected setting variable "
-				"%s, skipping it!\n", item.key);
-			_hdelete(item.key, htab, &htab->table[idx].entry, idx);
-			__set_errno(EPERM);
-			*retval = NULL;
-			return 0;
-		}
-
-		/* If there is a callback, call it */
-		if (htab->table[idx].entry.callback &&
-		    htab->table[idx].entry.callback(item.key, item.data,
-		    env_op_create, flag)) {
-			debug("callback() rejected setting variable "
-				"%s, skipping it!\n", item.key);
-			_hdelete(item.key, htab, &htab->table[idx].entry, idx);
-			__set_errno(EINVAL);
-			*retval = NULL;
-			return 0;
-		}
-
-		/* return new entry */
-		*retval = &htab->table[idx].entry;
-		return 1;
+		return _hcreate_entry(htab, idx, retval, flag);
 	}
 
 	__set_errno(ESRCH);
@@ -429,8 +429,8 @@ static void _hdelete(const char *key, struct hsearch_data *htab, ENTRY *ep,
 {
 	/* free used ENTRY */
 	debug("hdelete: DELETING key \"%s\"\n", key);
-	free((void *)ep->key);
-	free(ep->data);
+	hfree(htab, ep->key);
+	hfree(htab, ep->data);
 	ep->callback = NULL;
 	ep->flags = 0;
 	htab->table[idx].used = -1;
@@ -776,6 +776,17 @@ static int drop_var_from_set(const char *name, int nvars, char * vars[])
  * '\0' and '\n' have really been tested.
  */
 
+/* Number of entries to create the hash table with, see below */
+static int himport_nent(size_t size)
+{
+	int nent = CONFIG_ENV_MIN_ENTRIES + size / 8;
+
+	if (nent > CONFIG_ENV_MAX_ENTRIES)
+		nent = CONFIG_ENV_MAX_ENTRIES;
+
+	return nent;
+}
+
 int himport_r(struct hsearch_data *htab,
 		const char *env, size_t size, const char sep, int flag,
 		int crlf_is_lf, int nvars, char * const vars[])
@@ -831,10 +842,7 @@ int himport_r(struct hsearch_data *htab,
 	 */
 
 	if (!htab->table) {
-		int nent = CONFIG_ENV_MIN_ENTRIES + size / 8;
-
-		if (nent > CONFIG_ENV_MAX_ENTRIES)
-			nent = CONFIG_ENV_MAX_ENTRIES;
+		int nent = himport_nent(size);
 
 		debug("Create Hash Table: N=%d\n", nent);
 
@@ -962,6 +970,140 @@ end:
 	return 1;		/* everything OK */
 }
 
+#if CONFIG_IS_ENABLED(ENV_INDEX)
+/*
+ * himport_index()
+ */
+
+/*
+ * Import an indexed environment, as written by "mkenvimage -i". The slot
+ * of each variable has been worked out already, so the strings are copied
+ * in one piece and each entry is put straight into its slot. The entries
+ * still get their callbacks and flags, and are checked by change_ok(), in
+ * the same order as with himport_r().
+ *
+ * If the table already has entries (H_NOCLEAR), or is not the size the
+ * index was made for, the variables are entered with hsearch_r() instead.
+ * So is any variable whose slot does not match its key.
+ * The index is checked before the table is cleared, so that a bad one
+ * leaves the table as it was.
+ */
+
+/*
+ * Check that the slot the index gives for @key is the one hsearch_r() would
+ * find it in: the key must hash to @ent->hval, and every slot probed before
+ * @ent->idx must already hold some other key. An index that is stale,
+ * corrupted or made for another table size fails this.
+ */
+static bool _hindex_slot_ok(struct hsearch_data *htab, const char *key,
+			    const struct env_index_entry *ent)
+{
+	unsigned int hval, step, idx;
+
+	if (!ent->idx || ent->idx > htab->size || htab->table[ent->idx].used)
+		return false;
+
+	hval = env_index_hash(key, strlen(key), htab->size);
+	if (ent->hval != hval)
+		return false;
+
+	step = env_index_step(hval, htab->size);
+	for (idx = hval; idx != ent->idx;) {
+		if (!htab->table[idx].used)
+			return false;
+		if (htab->table[idx].used == hval &&
+		    !strcmp(key, htab->table[idx].entry.key))
+			return false;
+		idx = env_index_next(idx, step, htab->size);
+		if (idx == hval)
+			return false;
+	}
+
+	return true;
+}
+
+int himport_index_r(struct hsearch_data *htab, const char *env, size_t size,
+		    int flag)
+{
+	struct env_index_header hdr;
+	struct env_index_entry ent;
+	const char *entries, *pool;
+	char *strings = NULL;
+	size_t max_count;
+	uint i;
+
+	/* Test for correct arguments.  */
+	if (htab == NULL || !env_index_is_valid(env, size))
+		goto err_inval;
+
+	memcpy(&hdr, env, sizeof(hdr));
+	max_count = (size - sizeof(hdr)) / sizeof(ent);
+	if (hdr.count > max_count ||
+	    hdr.pool_size > size - sizeof(hdr) - hdr.count * sizeof(ent) ||
+	    (hdr.count && !hdr.pool_size))
+		goto err_inval;
+	entries = env + sizeof(hdr);
+	pool = entries + hdr.count * sizeof(ent);
+	if (hdr.pool_size && pool[hdr.pool_size - 1])
+		goto err_inval;
+	for (i = 0; i < hdr.count; i++) {
+		memcpy(&ent, entries + i * sizeof(ent), sizeof(ent));
+		if (ent.key >= hdr.pool_size || ent.data >= hdr.pool_size ||
+		    !pool[ent.key])
+			goto err_inval;
+	}
+
+	if ((flag & H_NOCLEAR) == 0 && htab->table) {
+		debug("Destroy Hash Table: %p table = %p\n", htab,
+		      htab->table);
+		hdestroy_r(htab);
+	}
+
+	if (!htab->table) {
+		if (hcreate_r(himport_nent(size), htab) == 0)
+			return 0;
+		if (htab->size == hdr.size && hdr.pool_size) {
+			strings = malloc(hdr.pool_size);
+			if (!strings) {
+				__set_errno(ENOMEM);
+				return 0;
+			}
+			memcpy(strings, pool, hdr.pool_size);
+			htab->pool = strings;
+			htab->pool_size = hdr.pool_size;
+		}
+	}
+	debug("INDEX: %u entries, table size %u/%u, %s\n", hdr.count,
+	      hdr.size, htab->size, strings ? "direct" : "hsearch");
+
+	for (i = 0; i < hdr.count; i++) {
+		ENTRY e, *rv;
+
+		memcpy(&ent, entries + i * sizeof(ent), sizeof(ent));
+		if (strings && _hindex_slot_ok(htab, strings + ent.key, &ent)) {
+			htab->table[ent.idx].used = ent.hval;
+			htab->table[ent.idx].entry.key = strings + ent.key;
+			htab->table[ent.idx].entry.data = strings + ent.data;
+			_hcreate_entry(htab, ent.idx, &rv, flag);
+			continue;
+		}
+
+		e.key = pool + ent.key;
+		e.data = (char *)pool + ent.data;
+		hsearch_r(e, ENTER, &rv, htab, flag);
+		if (rv == NULL)
+			printf("himport_index_r: can't insert \"%s=%s\" into hash table\n",
+			       e.key, e.data);
+	}
+
+	return 1;		/* everything OK */
+
+err_inval:
+	__set_errno(EINVAL);
+	return 0;
+}
+#endif
+
 /*
  * hwalk_r()
  */
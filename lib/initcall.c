@@ -9,31 +9,161 @@
 
 DECLARE_GLOBAL_DATA_PTR;
 
+static unsigned long initcall_reloc_ofs(void)
+{
+	unsigned long reloc_ofs = 0;
+
+	if (gd->flags & GD_FLG_RELOC)
+		reloc_ofs = gd->reloc_off;
+#ifdef CONFIG_EFI_APP
+	reloc_ofs = (unsigned long)image_base;
+#endif
+
+	return reloc_ofs;
+}
+
+static int initcall_call(const init_fnc_t init_sequence[], init_fnc_t func)
+{
+	unsigned long reloc_ofs = initcall_reloc_ofs();
+	ulong start;
+	int ret;
+
+	debug("initcall: %p", (char *)func - reloc_ofs);
+	if (gd->flags & GD_FLG_RELOC)
+		debug(" (relocated to %p)\n", (char *)func);
+	else
+		debug("\n");
+	start = bootstage_event_start();
+	ret = func();
+	bootstage_event_add(BOOTSTAGE_EVENT_INITCALL, (char *)func - reloc_ofs,
+			    start);
+	if (ret) {
+		printf("initcall sequence %p failed at call %p (err=%d)\n",
+		       init_sequence, (char *)func - reloc_ofs, ret);
+		return -1;
+	}
+
+	return 0;
+}
+
 int initcall_run_list(const init_fnc_t init_sequence[])
 {
 	const init_fnc_t *init_fnc_ptr;
 
 	for (init_fnc_ptr = init_sequence; *init_fnc_ptr; ++init_fnc_ptr) {
-		unsigned long reloc_ofs = 0;
-		int ret;
+		if (initcall_call(init_sequence, *init_fnc_ptr))
+			return -1;
+	}
+	return 0;
+}
 
-		if (gd->flags & GD_FLG_RELOC)
-			reloc_ofs = gd->reloc_off;
-#ifdef CONFIG_EFI_APP
-		reloc_ofs = (unsigned long)image_base;
-#endif
-		debug("initcall: %p", (char *)*init_fnc_ptr - reloc_ofs);
-		if (gd->flags & GD_FLG_RELOC)
-			debug(" (relocated to %p)\n", (char *)*init_fnc_ptr);
-		else
-			debug("\n");
-		ret = (*init_fnc_ptr)();
-		if (ret) {
-			printf("initcall sequence %p failed at call %p (err=%d)\n",
-			       init_sequence,
-			       (char *)*init_fnc_ptr - reloc_ofs, ret);
+#if CONFIG_IS_ENABLED(INITCALL_ASYNC)
+static int initcall_find(const init_fnc_t init_sequence[], init_fnc_t func)
+{
+	int i;
+
+	for (i = 0; init_sequence[i]; i++) {
+		if (init_sequence[i] == func)
+			return i;
+	}
+
+	return -1;
+}
+
+/* Check the constraints of each async initcall before running anything */
+static void initcall_async_check(const init_fnc_t init_sequence[],
+				 struct initcall_async async[], int count)
+{
+	struct initcall_async *job;
+	int pos, after;
+
+	for (job = async; job < async + count; job++) {
+		job->start_us = 0;
+		job->started_us = 0;
+		job->join_us = 0;
+		job->done_us = 0;
+		pos = initcall_find(init_sequence, job->func);
+		if (pos < 0) {
+			job->state = INITCALL_ASYNC_UNUSED;
+			continue;
+		}
+		after = initcall_find(init_sequence, job->after);
+		if (after < 0 || after >= pos) {
+			printf("initcall %s: must come after its dependency, running in order\n",
+			       job->name);
+			job->state = INITCALL_ASYNC_IN_ORDER;
+			continue;
+		}
+		job->state = INITCALL_ASYNC_WAITING;
+	}
+}
+
+int initcall_run_list_async(const init_fnc_t init_sequence[],
+			    struct initcall_async async[], int count)
+{
+	const init_fnc_t *init_fnc_ptr;
+	struct initcall_async *job;
+	init_fnc_t func;
+
+	initcall_async_check(init_sequence, async, count);
+	for (init_fnc_ptr = init_sequence; *init_fnc_ptr; ++init_fnc_ptr) {
+		func = *init_fnc_ptr;
+
+		/* Finish a started initcall where it would have run */
+		for (job = async; job < async + count; job++) {
+			if (job->func == func &&
+			    job->state == INITCALL_ASYNC_STARTED)
+				break;
+		}
+		if (job < async + count) {
+			job->join_us = timer_get_boot_us();
+			if (initcall_call(init_sequence, job->join))
+				return -1;
+			job->done_us = timer_get_boot_us();
+			job->state = INITCALL_ASYNC_DONE;
+		} else if (initcall_call(init_sequence, func)) {
 			return -1;
 		}
+
+		/* Start anything which was only waiting for this one */
+		for (job = async; job < async + count; job++) {
+			if (job->after != func ||
+			    job->state != INITCALL_ASYNC_WAITING)
+				continue;
+			job->start_us = timer_get_boot_us();
+			if (initcall_call(init_sequence, job->start))
+				return -1;
+			job->started_us = timer_get_boot_us();
+			job->state = INITCALL_ASYNC_STARTED;
+		}
 	}
+
 	return 0;
 }
+
+void initcall_async_report(const struct initcall_async async[], int count)
+{
+	const struct initcall_async *job;
+	ulong held = 0, hidden = 0;
+
+	printf("%-20s %10s %10s %10s %10s\n", "Async initcall", "Start us",
+	       "Starting", "Hidden", "Joining");
+	for (job = async; job < async + count; job++) {
+		if (job->state != INITCALL_ASYNC_DONE) {
+			printf("%-20s %s\n", job->name,
+			       job->state == INITCALL_ASYNC_IN_ORDER ?
+			       "ran in order" : "not run");
+			continue;
+		}
+		printf("%-20s %10lu %10lu %10lu %10lu\n", job->name,
+		       job->start_us, job->started_us - job->start_us,
+		       job->join_us - job->started_us,
+		       job->done_us - job->join_us);
+		held += job->started_us - job->start_us;
+		held += job->done_us - job->join_us;
+		hidden += job->join_us - job->started_us;
+	}
+	printf("On the critical path: %lu us, overlapped: %lu us\n", held,
+	       hidden);
+}
+#endif
@@ -169,86 +169,86 @@ static AvbSlotVerifyResult read_persistent_digest(AvbOps* ops,
 }
 
 
-static uint8_t *x3_calculate_hash(uint8_t *image_buf,
+/* Salted root hash, large enough for any salt avbtool generates */
+static uint8_t x3_hash_buf[256] __aligned(64);
+
+/*
+ * The image is only read here, never written, so that it can be hashed
+ * where it was preloaded and booted from there afterwards.
+ */
+static uint8_t *x3_calculate_hash(const uint8_t *image_buf,
 	const uint8_t *desc_salt, AvbHashDescriptor *hash_desc)
 {
 	uint64_t image_size = hash_desc->image_size;
 
 #ifndef CONFIG_HBOT_SECURE_ENGINE
-	uint64_t image_offset = 0;
+	static const uint8_t zero_pad[64];
+	AvbSHA256Ctx root_ctx;
 	AvbSHA256Ctx sha256_ctx;
 	uint32_t block_size = 32768;
 	uint32_t hash_size = 32;
-	uint8_t *digest = NULL;
-	uint32_t digest_len = 0;
-	uint32_t blk_num = image_size / block_size;
-	uint32_t blk_mod = image_size % block_size;
 	uint32_t hash_block_size = 64;
-	uint32_t digest_mod = 0;
-	uint32_t i = 0;
-
-	/* calculate hash tree */
-	if (blk_num !=0) {
-		for (i = 0; i < blk_num + 1; i++) {
-			image_offset = (uint64_t)i * (uint64_t)block_size;
+	uint64_t image_offset, len;
+	uint64_t digest_len = 0;
+
+	/*
+	 * The root hash covers the hash of each 32 KiB block, or the image
+	 * itself when it is smaller than a block, zero-padded to 64 bytes.
+	 * Feed the block hashes straight into it rather than collecting them
+	 * over the start of the image.
+	 */
+	avb_sha256_init(&root_ctx);
+	if (image_size >= block_size) {
+		for (image_offset = 0; image_offset < image_size;
+		     image_offset += block_size) {
+			len = image_size - image_offset;
+			if (len > block_size)
+				len = block_size;
 			avb_sha256_init(&sha256_ctx);
-
-			if (i < blk_num) {
-				avb_sha256_update(&sha256_ctx, image_buf + image_offset,
-					block_size);
-			} else if (blk_mod != 0) {
-				avb_sha256_update(&sha256_ctx, image_buf + image_offset,
-					blk_mod);
-			} else {
-					break;
-			}
-			digest = avb_sha256_final(&sha256_ctx);
-			memcpy(image_buf + digest_len, digest, hash_size);
-			digest_len = digest_len + hash_size;
+			avb_sha256_update(&sha256_ctx, image_buf + image_offset,
+				len);
+			avb_sha256_update(&root_ctx,
+				avb_sha256_final(&sha256_ctx), hash_size);
+			digest_len += hash_size;
 		}
 	} else {
-		digest_len = hash_desc->image_size;
+		avb_sha256_update(&root_ctx, image_buf, image_size);
+		digest_len = image_size;
 	}
 
 	/* padding */
-	digest_mod = digest_len % hash_block_size;
-	if (digest_mod != 0) {
-		memset(image_buf + digest_len, 0, digest_mod);
-		digest_len = digest_len + hash_block_size - digest_mod;
-	}
-
-	/* calculate digest: root_hash */
-	avb_sha256_init(&sha256_ctx);
-	avb_sha256_update(&sha256_ctx, image_buf, digest_len);
-	digest = avb_sha256_final(&sha256_ctx);
+	if (digest_len % hash_block_size)
+		avb_sha256_update(&root_ctx, zero_pad,
+			hash_block_size - digest_len % hash_block_size);
 
 	/* calculate digest: root_hash + salt */
 	avb_sha256_init(&sha256_ctx);
 	avb_sha256_update(&sha256_ctx, desc_salt, hash_desc->salt_len);
-	avb_sha256_update(&sha256_ctx, digest, 32);
-	digest = avb_sha256_final(&sha256_ctx);
+	avb_sha256_update(&sha256_ctx, avb_sha256_final(&root_ctx), hash_size);
+	memcpy(x3_hash_buf, avb_sha256_final(&sha256_ctx), hash_size);
 
-	return digest;
+	return x3_hash_buf;
 #else
+	uint32_t salt_len = hash_desc->salt_len;
+
 	/* disable dcache */
 	dcache_disable();
 
-	/* calculate digest: root_hash */
-	spacc_ex((uint64_t) image_buf, (uint64_t) image_buf, image_size, 0, 1,
-		CRYPTO_MODE_HASH_SHA256, 0, 0, 0, 0);
+	/* calculate digest: root_hash, right after where the salt goes */
+	spacc_ex((uint64_t) image_buf, (uint64_t) x3_hash_buf + salt_len,
+		image_size, 0, 1, CRYPTO_MODE_HASH_SHA256, 0, 0, 0, 0);
 
 	/* calculate digest: root_hash + salt */
-	memcpy(image_buf + image_salt_len, image_buf, 32);
-	memcpy(image_buf, desc_salt, image_salt_len);
+	memcpy(x3_hash_buf, desc_salt, salt_len);
 
-	spacc_ex((uint64_t) image_buf,
-		(uint64_t) image_buf, image_salt_len + 32, 0, 1,
+	spacc_ex((uint64_t) x3_hash_buf,
+		(uint64_t) x3_hash_buf, salt_len + 32, 0, 1,
 		CRYPTO_MODE_HASH_SHA256, 0, 0, 0, 0);
 
 	/* enable dcache */
 	dcache_enable();
 
-	return image_buf;
+	return x3_hash_buf;
 #endif
 }
 
@@ -376,6 +376,11 @@ static AvbSlotVerifyResult load_and_verify_hash_partition(
 	}
 
 	if (avb_strcmp((const char*)hash_desc.hash_algorithm, "sha256") == 0) {
+		if (hash_desc.salt_len > sizeof(x3_hash_buf) - 32) {
+			avb_errorv(part_name, ": Salt is too long.\n", NULL);
+			ret = AVB_SLOT_VERIFY_RESULT_ERROR_INVALID_METADATA;
+			goto out;
+		}
 		digest = x3_calculate_hash(image_buf, desc_salt, &hash_desc);
 #if 0
 		AvbSHA256Ctx sha256_ctx;
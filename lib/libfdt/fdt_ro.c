@@ -7,6 +7,7 @@
 
 #ifndef USE_HOSTCC
 #include <fdt.h>
+#include <fdt_cache.h>
 #include <linux/libfdt.h>
 #else
 #include "fdt_host.h"
@@ -179,10 +180,21 @@ int fdt_path_offset_namelen(const void *fdt, const char *path, int namelen)
 		offset = fdt_path_offset(fdt, p);
 
 		p = q;
+#ifndef USE_HOSTCC
+	} else {
+		int len;
+
+		/* Start from the longest prefix already found */
+		offset = fdt_cache_find_path(fdt, path, namelen, &len);
+		p = path + len;
+#endif
 	}
 
 	while (*p && (p < end)) {
 		const char *q;
+#ifndef USE_HOSTCC
+		int parent = offset;
+#endif
 
 		while (*p == '/')
 			p++;
@@ -197,6 +209,10 @@ int fdt_path_offset_namelen(const void *fdt, const char *path, int namelen)
 		offset = fdt_subnode_offset_namelen(fdt, offset, p, q-p);
 		if (offset < 0)
 			return offset;
+#ifndef USE_HOSTCC
+		if (*path == '/')
+			fdt_cache_add_path(fdt, path, q - path, parent, offset);
+#endif
 
 		p = q;
 	}
@@ -510,6 +526,11 @@ int fdt_node_offset_by_phandle(const void *fdt, uint32_t phandle)
 
 	FDT_CHECK_HEADER(fdt);
 
+#ifndef USE_HOSTCC
+	if (fdt_cache_find_phandle(fdt, phandle, &offset))
+		return offset;
+#endif
+
 	/* FIXME: The algorithm here is pretty horrible: we
 	 * potentially scan each property of a node in
 	 * fdt_get_phandle(), then if that didn't find what
@@ -519,8 +540,12 @@ int fdt_node_offset_by_phandle(const void *fdt, uint32_t phandle)
 	for (offset = fdt_next_node(fdt, -1, NULL);
 	     offset >= 0;
 	     offset = fdt_next_node(fdt, offset, NULL)) {
-		if (fdt_get_phandle(fdt, offset) == phandle)
+		if (fdt_get_phandle(fdt, offset) == phandle) {
+#ifndef USE_HOSTCC
+			fdt_cache_add_phandle(fdt, phandle, offset);
+#endif
 			return offset;
+		}
 	}
 
 	return offset; /* error from fdt_next_node() */
@@ -11,6 +11,7 @@
 #include <linux/errno.h>
 #include <asm/types.h>
 #include <asm/unaligned.h>
+#include <malloc.h>
 #else
 #include "fdt_host.h"
 #include "mkimage.h"
@@ -19,289 +20,558 @@
 #include <u-boot/rsa.h>
 #include <u-boot/rsa-mod-exp.h>
 
-#define UINT64_MULT32(v, multby)  (((uint64_t)(v)) * ((uint32_t)(multby)))
-
-#define get_unaligned_be32(a) fdt32_to_cpu(*(uint32_t *)a)
-#define put_unaligned_be32(a, b) (*(uint32_t *)(b) = cpu_to_fdt32(a))
+#ifndef USE_HOSTCC
+DECLARE_GLOBAL_DATA_PTR;
+#endif
 
 /* Default public exponent for backward compatibility */
 #define RSA_DEFAULT_PUBEXP	65537
 
+/*
+ * Numbers are little-endian arrays of limbs. Limbs are 64 bits wide where
+ * the compiler can multiply two of them into a 128-bit result.
+ */
+#ifdef __SIZEOF_INT128__
+typedef uint64_t bn_limb;
+typedef unsigned __int128 bn_dlimb;
+#else
+typedef uint32_t bn_limb;
+typedef uint64_t bn_dlimb;
+#endif
+
+#define BN_LIMB_BITS		(sizeof(bn_limb) * 8)
+#define RSA_MAX_LIMBS		(RSA_MAX_KEY_BITS / BN_LIMB_BITS)
+#define RSA_MAX_WINDOW		3
+
+/* Prepared keys are kept for the next signature checked with them */
+#define RSA_KEY_CACHE_SIZE	4
+
 /**
- * subtract_modulus() - subtract modulus from the given value
+ * struct rsa_key_ctx - a public key ready for exponentiation
  *
- * @key:	Key containing modulus to subtract
- * @num:	Number to subtract modulus from, as little endian word array
+ * R is 2^(len * BN_LIMB_BITS), which is 2^(# key bits) unless the key
+ * size is not a whole number of limbs.
  */
-static void subtract_modulus(const struct rsa_public_key *key, uint32_t num[])
-{
-	int64_t acc = 0;
-	uint i;
+struct rsa_key_ctx {
+	uint len;			/* len of modulus[] in limbs */
+	bn_limb n0inv;			/* -1 / modulus[0] mod 2^BN_LIMB_BITS */
+	uint64_t exponent;		/* public exponent */
+	bn_limb modulus[RSA_MAX_LIMBS];
+	bn_limb rr[RSA_MAX_LIMBS];	/* R^2 mod modulus */
+};
 
-	for (i = 0; i < key->len; i++) {
-		acc += (uint64_t)num[i] - key->modulus[i];
-		num[i] = (uint32_t)acc;
-		acc >>= 32;
-	}
-}
+/**
+ * struct rsa_key_cache - a prepared key, with what it was prepared from
+ *
+ * Keys are looked up by where their modulus is, normally in a key node of
+ * the control FDT. The properties they were prepared from are compared in
+ * full, so a key node that has since been replaced is never matched.
+ */
+struct rsa_key_cache {
+	const void *where;
+	int num_bits;
+	uint8_t modulus[RSA_MAX_KEY_BITS / 8];
+	uint8_t rr[RSA_MAX_KEY_BITS / 8];
+	struct rsa_key_ctx ctx;
+};
+
+static struct rsa_key_cache *rsa_key_cache[RSA_KEY_CACHE_SIZE];
+static int rsa_key_cache_next;
 
 /**
- * greater_equal_modulus() - check if a value is >= modulus
+ * bn_from_be() - convert a big-endian byte array to limbs
  *
- * @key:	Key containing modulus to check
- * @num:	Number to check against modulus, as little endian word array
- * @return 0 if num < modulus, 1 if num >= modulus
+ * @dst:	Little endian limb array of @len limbs
+ * @len:	Number of limbs in @dst
+ * @src:	Big endian byte array, at any alignment
+ * @src_len:	Number of bytes in @src
  */
-static int greater_equal_modulus(const struct rsa_public_key *key,
-				 uint32_t num[])
+static void bn_from_be(bn_limb *dst, uint len, const uint8_t *src,
+		       uint src_len)
 {
-	int i;
-
-	for (i = (int)key->len - 1; i >= 0; i--) {
-		if (num[i] < key->modulus[i])
-			return 0;
-		if (num[i] > key->modulus[i])
-			return 1;
-	}
+	uint i;
 
-	return 1;  /* equal */
+	memset(dst, '\0', len * sizeof(bn_limb));
+	for (i = 0; i < src_len; i++)
+		dst[i / sizeof(bn_limb)] |= (bn_limb)src[src_len - 1 - i] <<
+					    (i % sizeof(bn_limb) * 8);
 }
 
 /**
- * montgomery_mul_add_step() - Perform montgomery multiply-add step
- *
- * Operation: montgomery result[] += a * b[] / n0inv % modulus
+ * bn_to_be() - convert limbs to a big-endian byte array
  *
- * @key:	RSA key
- * @result:	Place to put result, as little endian word array
- * @a:		Multiplier
- * @b:		Multiplicand, as little endian word array
+ * @dst:	Big endian byte array, at any alignment
+ * @dst_len:	Number of bytes to write to @dst
+ * @src:	Little endian limb array
  */
-static void montgomery_mul_add_step(const struct rsa_public_key *key,
-		uint32_t result[], const uint32_t a, const uint32_t b[])
+static void bn_to_be(uint8_t *dst, uint dst_len, const bn_limb *src)
 {
-	uint64_t acc_a, acc_b;
-	uint32_t d0;
 	uint i;
 
-	acc_a = (uint64_t)a * b[0] + result[0];
-	d0 = (uint32_t)acc_a * key->n0inv;
-	acc_b = (uint64_t)d0 * key->modulus[0] + (uint32_t)acc_a;
-	for (i = 1; i < key->len; i++) {
-		acc_a = (acc_a >> 32) + (uint64_t)a * b[i] + result[i];
-		acc_b = (acc_b >> 32) + (uint64_t)d0 * key->modulus[i] +
-				(uint32_t)acc_a;
-		result[i - 1] = (uint32_t)acc_b;
-	}
-
-	acc_a = (acc_a >> 32) + (acc_b >> 32);
-
-	result[i - 1] = (uint32_t)acc_a;
-
-	if (acc_a >> 32)
-		subtract_modulus(key, result);
+	for (i = 0; i < dst_len; i++)
+		dst[dst_len - 1 - i] = src[i / sizeof(bn_limb)] >>
+				       (i % sizeof(bn_limb) * 8);
 }
 
 /**
- * montgomery_mul() - Perform montgomery mutitply
+ * bn_sub_mod_if() - subtract the modulus if a value is not less than it
  *
- * Operation: montgomery result[] = a[] * b[] / n0inv % modulus
+ * The choice is made with masks rather than a branch, so it takes the same
+ * time either way.
  *
- * @key:	RSA key
- * @result:	Place to put result, as little endian word array
- * @a:		Multiplier, as little endian word array
- * @b:		Multiplicand, as little endian word array
+ * @ctx:	Key containing the modulus
+ * @r:		Place to put result, as little endian limb array
+ * @t:		Value, as little endian limb array, less than 2 * modulus
+ * @carry:	Bit above the top limb of @t
  */
-static void montgomery_mul(const struct rsa_public_key *key,
-		uint32_t result[], uint32_t a[], const uint32_t b[])
+static void bn_sub_mod_if(const struct rsa_key_ctx *ctx, bn_limb *r,
+			  const bn_limb *t, bn_limb carry)
 {
+	bn_limb d[RSA_MAX_LIMBS];
+	bn_limb borrow = 0;
+	bn_limb mask;
+	bn_dlimb diff;
 	uint i;
 
-	for (i = 0; i < key->len; ++i)
-		result[i] = 0;
-	for (i = 0; i < key->len; ++i)
-		montgomery_mul_add_step(key, result, a[i], b);
+	for (i = 0; i < ctx->len; i++) {
+		diff = (bn_dlimb)t[i] - ctx->modulus[i] - borrow;
+		d[i] = (bn_limb)diff;
+		borrow = (bn_limb)(diff >> BN_LIMB_BITS) & 1;
+	}
+
+	/* Keep the difference unless it went below zero */
+	mask = -(carry | (borrow ^ 1));
+	for (i = 0; i < ctx->len; i++)
+		r[i] = (d[i] & mask) | (t[i] & ~mask);
 }
 
 /**
- * num_pub_exponent_bits() - Number of bits in the public exponent
+ * bn_mont_mul() - Perform montgomery multiply
  *
- * @key:	RSA key
- * @num_bits:	Storage for the number of public exponent bits
+ * Operation: montgomery result[] = a[] * b[] / R % modulus
+ *
+ * Each row of the product is reduced as soon as it is added in. If a[] and
+ * b[] are less than the modulus, so is the result. @r may be the same as
+ * @a or @b.
+ *
+ * @ctx:	RSA key
+ * @r:		Place to put result, as little endian limb array
+ * @a:		Multiplier, as little endian limb array
+ * @b:		Multiplicand, as little endian limb array
  */
-static int num_public_exponent_bits(const struct rsa_public_key *key,
-		int *num_bits)
+static void bn_mont_mul(const struct rsa_key_ctx *ctx, bn_limb *r,
+			const bn_limb *a, const bn_limb *b)
 {
-	uint64_t exponent;
-	int exponent_bits;
-	const uint max_bits = (sizeof(exponent) * 8);
+	bn_limb t[RSA_MAX_LIMBS + 2];
+	const bn_limb *n = ctx->modulus;
+	uint len = ctx->len;
+	bn_dlimb acc;
+	bn_limb m;
+	uint i, j;
+
+	memset(t, '\0', (len + 2) * sizeof(bn_limb));
+	for (i = 0; i < len; i++) {
+		/* t += a * b[i] */
+		acc = 0;
+		for (j = 0; j < len; j++) {
+			acc = (bn_dlimb)a[j] * b[i] + t[j] +
+			      (acc >> BN_LIMB_BITS);
+			t[j] = (bn_limb)acc;
+		}
+		acc = (bn_dlimb)t[len] + (acc >> BN_LIMB_BITS);
+		t[len] = (bn_limb)acc;
+		t[len + 1] = (bn_limb)(acc >> BN_LIMB_BITS);
+
+		/* t = (t + m * n) / 2^BN_LIMB_BITS, with m making it exact */
+		m = t[0] * ctx->n0inv;
+		acc = (bn_dlimb)m * n[0] + t[0];
+		for (j = 1; j < len; j++) {
+			acc = (bn_dlimb)m * n[j] + t[j] +
+			      (acc >> BN_LIMB_BITS);
+			t[j - 1] = (bn_limb)acc;
+		}
+		acc = (bn_dlimb)t[len] + (acc >> BN_LIMB_BITS);
+		t[len - 1] = (bn_limb)acc;
+		t[len] = t[len + 1] + (bn_limb)(acc >> BN_LIMB_BITS);
+	}
 
-	exponent = key->exponent;
-	exponent_bits = 0;
+	bn_sub_mod_if(ctx, r, t, t[len]);
+}
 
-	if (!exponent) {
-		*num_bits = exponent_bits;
-		return 0;
-	}
+/* Work out -1 / n0 mod 2^BN_LIMB_BITS by Newton's method */
+static bn_limb bn_n0inv(bn_limb n0)
+{
+	bn_limb x = n0;		/* correct to 3 bits, as n0 is odd */
+	int i;
 
-	for (exponent_bits = 1; exponent_bits < max_bits + 1; ++exponent_bits)
-		if (!(exponent >>= 1)) {
-			*num_bits = exponent_bits;
-			return 0;
-		}
+	for (i = 0; i < 5; i++)
+		x *= 2 - n0 * x;
 
-	return -EINVAL;
+	return -x;
 }
 
 /**
- * is_public_exponent_bit_set() - Check if a bit in the public exponent is set
+ * window_multiplies() - count multiplies for a sliding window width
  *
- * @key:	RSA key
- * @pos:	The bit position to check
+ * @exponent:	Public exponent
+ * @bits:	Number of bits in the exponent
+ * @w:		Window width
+ * @return number of montgomery multiplies needed, other than squarings
  */
-static int is_public_exponent_bit_set(const struct rsa_public_key *key,
-		int pos)
+static int window_multiplies(uint64_t exponent, int bits, int w)
 {
-	return key->exponent & (1ULL << pos);
+	int count = w > 1 ? 1 << (w - 1) : 0;	/* building the table */
+	int i = bits - 1;
+
+	while (i >= 0) {
+		if (exponent & (1ULL << i)) {
+			count++;
+			i -= w;
+		} else {
+			i--;
+		}
+	}
+
+	return count;
 }
 
 /**
- * pow_mod() - in-place public exponentiation
+ * pow_mod() - public exponentiation, using a sliding window
  *
- * @key:	RSA key
- * @inout:	Big-endian word array containing value and result
+ * The exponent is public so the time taken may depend on it; each montgomery
+ * multiply takes the same time whatever the data.
+ *
+ * @ctx:	RSA key
+ * @val:	Value to raise, as little endian limb array
+ * @result:	Place to put result, as little endian limb array
+ * @return 0 if ok, -EINVAL if the exponent is not usable
  */
-static int pow_mod(const struct rsa_public_key *key, uint32_t *inout)
+static int pow_mod(const struct rsa_key_ctx *ctx, const bn_limb *val,
+		   bn_limb *result)
 {
-	uint32_t *result, *ptr;
-	uint i;
-	int j, k;
-
-	/* Sanity check for stack size - key->len is in 32-bit words */
-	if (key->len > RSA_MAX_KEY_BITS / 32) {
-		debug("RSA key words %u exceeds maximum %d\n", key->len,
-		      RSA_MAX_KEY_BITS / 32);
+	bn_limb table[1 << (RSA_MAX_WINDOW - 1)][RSA_MAX_LIMBS];
+	bn_limb acc[RSA_MAX_LIMBS];
+	uint64_t e = ctx->exponent;
+	int bits, w, k;
+	int i, j;
+	uint win;
+
+	for (bits = 0; bits < 64 && (e >> bits); bits++)
+		;
+	if (bits < 2) {
+		debug("Public exponent is too short (%d bits, minimum 2)\n",
+		      bits);
 		return -EINVAL;
 	}
 
-	uint32_t val[key->len], acc[key->len], tmp[key->len];
-	uint32_t a_scaled[key->len];
-	result = tmp;  /* Re-use location. */
-
-	/* Convert from big endian byte array to little endian word array. */
-	for (i = 0, ptr = inout + key->len - 1; i < key->len; i++, ptr--)
-		val[i] = get_unaligned_be32(ptr);
-
-	if (0 != num_public_exponent_bits(key, &k))
+	if (!(e & 1)) {
+		debug("LSB of RSA public exponent must be set.\n");
 		return -EINVAL;
+	}
 
-	if (k < 2) {
-		debug("Public exponent is too short (%d bits, minimum 2)\n",
-		      k);
-		return -EINVAL;
+	/* Use the window needing fewest multiplies for this exponent */
+	for (w = 1, k = 2; k <= RSA_MAX_WINDOW; k++) {
+		if (window_multiplies(e, bits, k) <
+		    window_multiplies(e, bits, w))
+			w = k;
 	}
 
-	if (!is_public_exponent_bit_set(key, 0)) {
-		debug("LSB of RSA public exponent must be set.\n");
-		return -EINVAL;
+	/* table[i] = val^(2i + 1) * R mod n */
+	bn_mont_mul(ctx, table[0], val, ctx->rr);
+	if (w > 1) {
+		bn_mont_mul(ctx, acc, table[0], table[0]);
+		for (i = 1; i < 1 << (w - 1); i++)
+			bn_mont_mul(ctx, table[i], table[i - 1], acc);
 	}
 
-	/* the bit at e[k-1] is 1 by definition, so start with: C := M */
-	montgomery_mul(key, acc, val, key->rr); /* acc = a * RR / R mod n */
-	/* retain scaled version for intermediate use */
-	memcpy(a_scaled, acc, key->len * sizeof(a_scaled[0]));
+	/* The top bit is set, so the first window starts there */
+	for (i = bits - 1; i >= 0; i = j - 1) {
+		if (!(e & (1ULL << i))) {
+			bn_mont_mul(ctx, acc, acc, acc);
+			j = i;
+			continue;
+		}
 
-	for (j = k - 2; j > 0; --j) {
-		montgomery_mul(key, tmp, acc, acc); /* tmp = acc^2 / R mod n */
+		/* Take up to w bits, ending with a set bit */
+		j = i - w + 1 > 0 ? i - w + 1 : 0;
+		while (!(e & (1ULL << j)))
+			j++;
+		win = (e >> j) & ((1U << (i - j + 1)) - 1);
 
-		if (is_public_exponent_bit_set(key, j)) {
-			/* acc = tmp * val / R mod n */
-			montgomery_mul(key, acc, tmp, a_scaled);
-		} else {
-			/* e[j] == 0, copy tmp back to acc for next operation */
-			memcpy(acc, tmp, key->len * sizeof(acc[0]));
+		if (i == bits - 1) {
+			memcpy(acc, table[win >> 1], ctx->len * sizeof(bn_limb));
+			continue;
+		}
+		for (k = i; k >= j; k--)
+			bn_mont_mul(ctx, acc, acc, acc);
+
+		/*
+		 * When the last bit is a window on its own, multiplying by
+		 * the plain value also takes the result out of montgomery
+		 * form.
+		 */
+		if (!j && win == 1) {
+			bn_mont_mul(ctx, result, acc, val);
+			return 0;
 		}
+		bn_mont_mul(ctx, acc, acc, table[win >> 1]);
 	}
 
-	/* the bit at e[0] is always 1 */
-	montgomery_mul(key, tmp, acc, acc); /* tmp = acc^2 / R mod n */
-	montgomery_mul(key, acc, tmp, val); /* acc = tmp * a / R mod M */
-	memcpy(result, acc, key->len * sizeof(result[0]));
+	/* result = acc * 1 / R mod n */
+	memset(table[0], '\0', ctx->len * sizeof(bn_limb));
+	table[0][0] = 1;
+	bn_mont_mul(ctx, result, acc, table[0]);
 
-	/* Make sure result < mod; result is at most 1x mod too large. */
-	if (greater_equal_modulus(key, result))
-		subtract_modulus(key, result);
-
-	/* Convert to bigendian byte array */
-	for (i = key->len - 1, ptr = inout; (int)i >= 0; i--, ptr++)
-		put_unaligned_be32(result[i], ptr);
 	return 0;
 }
 
-static void rsa_convert_big_endian(uint32_t *dst, const uint32_t *src, int len)
+/**
+ * rsa_key_prepare() - convert a public key for exponentiation
+ *
+ * @prop:	Key properties, as found in the FDT
+ * @ctx:	Place to put the prepared key
+ */
+static void rsa_key_prepare(const struct key_prop *prop,
+			    struct rsa_key_ctx *ctx)
+{
+	uint bytes = prop->num_bits / 8;
+	bn_limb t[RSA_MAX_LIMBS];
+	bn_limb carry;
+	int i, shift;
+	uint j;
+
+	ctx->len = (prop->num_bits + BN_LIMB_BITS - 1) / BN_LIMB_BITS;
+	bn_from_be(ctx->modulus, ctx->len, prop->modulus, bytes);
+	bn_from_be(ctx->rr, ctx->len, prop->rr, bytes);
+	ctx->n0inv = bn_n0inv(ctx->modulus[0]);
+
+	/*
+	 * The FDT holds R^2 for R = 2^(# key bits). Where the limbs go
+	 * beyond that, double it modulo n to suit the larger R.
+	 */
+	shift = 2 * (ctx->len * BN_LIMB_BITS - prop->num_bits);
+	for (i = 0; i < shift; i++) {
+		carry = ctx->rr[ctx->len - 1] >> (BN_LIMB_BITS - 1);
+		for (j = ctx->len - 1; j > 0; j--)
+			t[j] = ctx->rr[j] << 1 |
+			       ctx->rr[j - 1] >> (BN_LIMB_BITS - 1);
+		t[0] = ctx->rr[0] << 1;
+		bn_sub_mod_if(ctx, ctx->rr, t, carry);
+	}
+}
+
+/* Prepared keys are only kept once U-Boot is running from its final place */
+static bool rsa_key_cache_usable(void)
+{
+#ifdef USE_HOSTCC
+	return true;
+#elif defined(CONFIG_SPL_BUILD)
+	return false;
+#else
+	return gd->flags & GD_FLG_RELOC;
+#endif
+}
+
+/**
+ * rsa_key_get() - find a prepared key, or prepare it
+ *
+ * @prop:	Key properties, as found in the FDT
+ * @local:	Place to prepare the key if it cannot be cached
+ * @return prepared key, with its exponent not yet filled in
+ */
+static struct rsa_key_ctx *rsa_key_get(const struct key_prop *prop,
+				       struct rsa_key_ctx *local)
 {
+	uint bytes = prop->num_bits / 8;
+	struct rsa_key_cache *entry;
 	int i;
 
-	for (i = 0; i < len; i++)
-		dst[i] = fdt32_to_cpu(src[len - 1 - i]);
+	if (!rsa_key_cache_usable())
+		goto uncached;
+
+	for (i = 0; i < RSA_KEY_CACHE_SIZE; i++) {
+		entry = rsa_key_cache[i];
+		if (entry && entry->where == prop->modulus &&
+		    entry->num_bits == prop->num_bits &&
+		    !memcmp(entry->modulus, prop->modulus, bytes) &&
+		    !memcmp(entry->rr, prop->rr, bytes))
+			return &entry->ctx;
+	}
+
+	entry = rsa_key_cache[rsa_key_cache_next];
+	if (!entry) {
+		entry = malloc(sizeof(*entry));
+		if (!entry)
+			goto uncached;
+		rsa_key_cache[rsa_key_cache_next] = entry;
+	}
+	rsa_key_cache_next = (rsa_key_cache_next + 1) % RSA_KEY_CACHE_SIZE;
+
+	entry->where = prop->modulus;
+	entry->num_bits = prop->num_bits;
+	memcpy(entry->modulus, prop->modulus, bytes);
+	memcpy(entry->rr, prop->rr, bytes);
+	rsa_key_prepare(prop, &entry->ctx);
+
+	return &entry->ctx;
+
+uncached:
+	rsa_key_prepare(prop, local);
+	return local;
 }
 
 int rsa_mod_exp_sw(const uint8_t *sig, uint32_t sig_len,
 		struct key_prop *prop, uint8_t *out)
 {
-	struct rsa_public_key key;
+	bn_limb val[RSA_MAX_LIMBS], result[RSA_MAX_LIMBS];
+	struct rsa_key_ctx local, *ctx;
+	uint64_t exponent;
 	int ret;
 
 	if (!prop) {
 		debug("%s: Skipping invalid prop", __func__);
 		return -EBADF;
 	}
-	key.n0inv = prop->n0inv;
-	key.len = prop->num_bits;
 
-	if (!prop->public_exponent)
-		key.exponent = RSA_DEFAULT_PUBEXP;
-	else
-		key.exponent =
-			fdt64_to_cpu(*((uint64_t *)(prop->public_exponent)));
-
-	if (!key.len || !prop->modulus || !prop->rr) {
+	if (!prop->num_bits || !prop->modulus || !prop->rr) {
 		debug("%s: Missing RSA key info", __func__);
 		return -EFAULT;
 	}
 
 	/* Sanity check for stack size */
-	if (key.len > RSA_MAX_KEY_BITS || key.len < RSA_MIN_KEY_BITS) {
+	if (prop->num_bits > RSA_MAX_KEY_BITS ||
+	    prop->num_bits < RSA_MIN_KEY_BITS || prop->num_bits % 32) {
 		debug("RSA key bits %u outside allowed range %d..%d\n",
-		      key.len, RSA_MIN_KEY_BITS, RSA_MAX_KEY_BITS);
+		      prop->num_bits, RSA_MIN_KEY_BITS, RSA_MAX_KEY_BITS);
 		return -EFAULT;
 	}
-	key.len /= sizeof(uint32_t) * 8;
-	uint32_t key1[key.len], key2[key.len];
-
-	key.modulus = key1;
-	key.rr = key2;
-	rsa_convert_big_endian(key.modulus, (uint32_t *)prop->modulus, key.len);
-	rsa_convert_big_endian(key.rr, (uint32_t *)prop->rr, key.len);
-	if (!key.modulus || !key.rr) {
-		debug("%s: Out of memory", __func__);
-		return -ENOMEM;
+
+	if (sig_len != prop->num_bits / 8) {
+		debug("Signature is of incorrect length %d\n", sig_len);
+		return -EINVAL;
 	}
 
-	uint32_t buf[sig_len / sizeof(uint32_t)];
+	if (!prop->public_exponent) {
+		exponent = RSA_DEFAULT_PUBEXP;
+	} else {
+		memcpy(&exponent, prop->public_exponent, sizeof(exponent));
+		exponent = fdt64_to_cpu(exponent);
+	}
 
-	memcpy(buf, sig, sig_len);
+	ctx = rsa_key_get(prop, &local);
+	ctx->exponent = exponent;
 
-	ret = pow_mod(&key, buf);
+	bn_from_be(val, ctx->len, sig, sig_len);
+	ret = pow_mod(ctx, val, result);
 	if (ret)
 		return ret;
-
-	memcpy(out, buf, sig_len);
+	bn_to_be(out, sig_len, result);
 
 	return 0;
 }
 
 #if defined(CONFIG_CMD_ZYNQ_RSA)
+/*
+ * zynq_pow_mod() takes its key as a struct rsa_public_key, so keeps its own
+ * 32-bit montgomery multiply.
+ */
+
+/**
+ * subtract_modulus() - subtract modulus from the given value
+ *
+ * @key:	Key containing modulus to subtract
+ * @num:	Number to subtract modulus from, as little endian word array
+ */
+static void subtract_modulus(const struct rsa_public_key *key, uint32_t num[])
+{
+	int64_t acc = 0;
+	uint i;
+
+	for (i = 0; i < key->len; i++) {
+		acc += (uint64_t)num[i] - key->modulus[i];
+		num[i] = (uint32_t)acc;
+		acc >>= 32;
+	}
+}
+
+/**
+ * greater_equal_modulus() - check if a value is >= modulus
+ *
+ * @key:	Key containing modulus to check
+ * @num:	Number to check against modulus, as little endian word array
+ * @return 0 if num < modulus, 1 if num >= modulus
+ */
+static int greater_equal_modulus(const struct rsa_public_key *key,
+				 uint32_t num[])
+{
+	int i;
+
+	for (i = (int)key->len - 1; i >= 0; i--) {
+		if (num[i] < key->modulus[i])
+			return 0;
+		if (num[i] > key->modulus[i])
+			return 1;
+	}
+
+	return 1;  /* equal */
+}
+
+/**
+ * montgomery_mul_add_step() - Perform montgomery multiply-add step
+ *
+ * Operation: montgomery result[] += a * b[] / n0inv % modulus
+ *
+ * @key:	RSA key
+ * @result:	Place to put result, as little endian word array
+ * @a:		Multiplier
+ * @b:		Multiplicand, as little endian word array
+ */
+static void montgomery_mul_add_step(const struct rsa_public_key *key,
+		uint32_t result[], const uint32_t a, const uint32_t b[])
+{
+	uint64_t acc_a, acc_b;
+	uint32_t d0;
+	uint i;
+
+	acc_a = (uint64_t)a * b[0] + result[0];
+	d0 = (uint32_t)acc_a * key->n0inv;
+	acc_b = (uint64_t)d0 * key->modulus[0] + (uint32_t)acc_a;
+	for (i = 1; i < key->len; i++) {
+		acc_a = (acc_a >> 32) + (uint64_t)a * b[i] + result[i];
+		acc_b = (acc_b >> 32) + (uint64_t)d0 * key->modulus[i] +
+				(uint32_t)acc_a;
+		result[i - 1] = (uint32_t)acc_b;
+	}
+
+	acc_a = (acc_a >> 32) + (acc_b >> 32);
+
+	result[i - 1] = (uint32_t)acc_a;
+
+	if (acc_a >> 32)
+		subtract_modulus(key, result);
+}
+
+/**
+ * montgomery_mul() - Perform montgomery mutitply
+ *
+ * Operation: montgomery result[] = a[] * b[] / n0inv % modulus
+ *
+ * @key:	RSA key
+ * @result:	Place to put result, as little endian word array
+ * @a:		Multiplier, as little endian word array
+ * @b:		Multiplicand, as little endian word array
+ */
+static void montgomery_mul(const struct rsa_public_key *key,
+		uint32_t result[], uint32_t a[], const uint32_t b[])
+{
+	uint i;
+
+	for (i = 0; i < key->len; ++i)
+		result[i] = 0;
+	for (i = 0; i < key->len; ++i)
+		montgomery_mul_add_step(key, result, a[i], b);
+}
+
 /**
  * zynq_pow_mod - in-place public exponentiation
  *
@@ -0,0 +1,180 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Cooperative tasks
+ *
+ * Each task has its own stack and runs until it yields. Switching saves the
+ * callee-saved registers with setjmp() and restores the next task's with
+ * longjmp(); sandbox uses the host's contexts instead, since its setjmp()
+ * cannot be pointed at a new stack.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <task.h>
+#include <watchdog.h>
+#include <linux/list.h>
+#ifdef CONFIG_SANDBOX
+#include <os.h>
+#else
+#include <asm/setjmp.h>
+#endif
+
+struct task {
+	const char *name;
+	int (*func)(void *arg);
+	void *arg;
+	int ret;
+	bool done;
+	void *stack;
+	struct list_head sibling;
+#ifdef CONFIG_SANDBOX
+	void *ctx;
+#else
+	jmp_buf ctx;
+#endif
+};
+
+/* The caller of the first task_create(), which runs on the normal stack */
+static struct task task_main = {
+	.name = "main",
+};
+
+static LIST_HEAD(task_list);
+static struct task *task_current = &task_main;
+
+/*
+ * udelay() reads this before relocation, when .bss still holds the appended
+ * device tree on ARM64, so keep it in .data
+ */
+static int task_count __attribute__((section(".data")));
+
+static void task_switch(struct task *to)
+{
+	struct task *from = task_current;
+
+	task_current = to;
+#ifdef CONFIG_SANDBOX
+	os_context_switch(from->ctx, to->ctx);
+#else
+	if (!setjmp(from->ctx))
+		longjmp(to->ctx, 1);
+#endif
+}
+
+static void task_entry(void)
+{
+	struct task *task = task_current;
+
+	task->ret = task->func(task->arg);
+	task->done = true;
+
+	/* A finished task is never switched back to */
+	task_yield();
+	panic("Task '%s' resumed after finishing", task->name);
+}
+
+void task_yield(void)
+{
+	struct task *next = task_current;
+
+	if (!task_count)
+		return;
+	do {
+		next = list_entry(next->sibling.next, struct task, sibling);
+		if (&next->sibling == &task_list)
+			next = list_first_entry(&task_list, struct task,
+						sibling);
+	} while (next->done && next != task_current);
+	if (next != task_current)
+		task_switch(next);
+}
+
+bool task_delay(ulong usec)
+{
+	ulong start;
+
+	if (!task_count)
+		return false;
+	start = timer_get_us();
+	do {
+		WATCHDOG_RESET();
+		task_yield();
+	} while (timer_get_us() - start < usec);
+
+	return true;
+}
+
+const char *task_name(void)
+{
+	return task_current->name;
+}
+
+int task_create(const char *name, int (*func)(void *arg), void *arg,
+		struct task **taskp)
+{
+	struct task *task;
+
+#ifdef CONFIG_SANDBOX
+	if (!task_main.ctx) {
+		task_main.ctx = os_context_create(NULL, NULL, 0);
+		if (!task_main.ctx)
+			return -ENOMEM;
+	}
+#endif
+	task = calloc(1, sizeof(*task));
+	if (!task)
+		return -ENOMEM;
+	task->stack = memalign(16, CONFIG_TASK_STACK_SIZE);
+	if (!task->stack)
+		goto err_task;
+	task->name = name;
+	task->func = func;
+	task->arg = arg;
+#ifdef CONFIG_SANDBOX
+	task->ctx = os_context_create(task_entry, task->stack,
+				      CONFIG_TASK_STACK_SIZE);
+	if (!task->ctx)
+		goto err_stack;
+#else
+	initjmp(task->ctx, task_entry, task->stack + CONFIG_TASK_STACK_SIZE);
+#endif
+	if (!task_count++)
+		list_add_tail(&task_main.sibling, &task_list);
+	list_add_tail(&task->sibling, &task_list);
+	debug("task: created '%s'\n", name);
+	*taskp = task;
+
+	return 0;
+
+#ifdef CONFIG_SANDBOX
+err_stack:
+#endif
+	free(task->stack);
+err_task:
+	free(task);
+
+	return -ENOMEM;
+}
+
+int task_join(struct task *task)
+{
+	int ret;
+
+	if (task == task_current)
+		panic("Task '%s' cannot join itself", task->name);
+	while (!task->done)
+		task_yield();
+
+	ret = task->ret;
+	list_del(&task->sibling);
+	if (!--task_count)
+		list_del(&task_main.sibling);
+#ifdef CONFIG_SANDBOX
+	os_context_free(task->ctx);
+#endif
+	free(task->stack);
+	debug("task: joined '%s', ret=%d\n", task->name, ret);
+	free(task);
+
+	return ret;
+}
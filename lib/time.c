@@ -7,6 +7,7 @@
 #include <common.h>
 #include <dm.h>
 #include <errno.h>
+#include <task.h>
 #include <timer.h>
 #include <watchdog.h>
 #include <div64.h>
@@ -163,6 +164,10 @@ void udelay(unsigned long usec)
 {
 	ulong kv;
 
+	/* Let any other tasks run while waiting */
+	if (task_delay(usec))
+		return;
+
 	do {
 		WATCHDOG_RESET();
 		kv = usec > CONFIG_WD_PERIOD ? CONFIG_WD_PERIOD : usec;
@@ -94,7 +94,9 @@
 #include <errno.h>
 #include <net.h>
 #include <net/fastboot.h>
+#include <net/tcp.h>
 #include <net/tftp.h>
+#include <net/wget.h>
 #if defined(CONFIG_LED_STATUS)
 #include <miiphy.h>
 #include <status_led.h>
@@ -354,6 +356,10 @@ static void net_init_loop(void)
 {
 	if (eth_get_dev())
 		memcpy(net_ethaddr, eth_get_ethaddr(), 6);
+#ifdef CONFIG_PROT_TCP
+	/* A connection left over from a restarted loop belongs to no one */
+	tcp_abort();
+#endif
 
 	return;
 }
@@ -367,6 +373,10 @@ static void net_clear_handlers(void)
 
 static void net_cleanup_loop(void)
 {
+#ifdef CONFIG_PROT_TCP
+	/* Reset the server so it stops sending to a finished protocol */
+	tcp_abort();
+#endif
 	net_clear_handlers();
 }
 
@@ -532,6 +542,11 @@ restart:
 		case WOL:
 			wol_start();
 			break;
+#endif
+#if defined(CONFIG_CMD_WGET)
+		case WGET:
+			wget_start();
+			break;
 #endif
 		default:
 			break;
@@ -801,6 +816,33 @@ void net_set_timeout_handler(ulong iv, thand_f *f)
 	}
 }
 
+/* Send net_tx_packet, first finding the MAC address of dest if need be */
+static int net_send_or_arp(uchar *ether, struct in_addr dest, int size)
+{
+	/* if MAC address was not discovered yet, do an ARP request */
+	if (memcmp(ether, net_null_ethaddr, 6) == 0) {
+		debug_cond(DEBUG_DEV_PKT, "sending ARP for %pI4\n", &dest);
+
+		/* save the ip and eth addr for the packet to send after arp */
+		net_arp_wait_packet_ip = dest;
+		arp_wait_packet_ethaddr = ether;
+
+		/* size of the waiting packet */
+		arp_wait_tx_packet_size = size;
+
+		/* and do the ARP request */
+		arp_wait_try = 1;
+		arp_wait_timer_start = get_timer(0);
+		arp_request();
+		return 1;	/* waiting */
+	} else {
+		debug_cond(DEBUG_DEV_PKT, "sending IP to %pI4/%pM\n",
+			   &dest, ether);
+		net_send_packet(net_tx_packet, size);
+		return 0;	/* transmitted */
+	}
+}
+
 int net_send_udp_packet(uchar *ether, struct in_addr dest, int dport, int sport,
 		int payload_len)
 {
@@ -828,28 +870,28 @@ int net_send_udp_packet(uchar *ether, struct in_addr dest, int dport, int sport,
 	net_set_udp_header(pkt, dest, dport, sport, payload_len);
 	pkt_hdr_size = eth_hdr_size + IP_UDP_HDR_SIZE;
 
-	/* if MAC address was not discovered yet, do an ARP request */
-	if (memcmp(ether, net_null_ethaddr, 6) == 0) {
-		debug_cond(DEBUG_DEV_PKT, "sending ARP for %pI4\n", &dest);
+	return net_send_or_arp(ether, dest, pkt_hdr_size + payload_len);
+}
 
-		/* save the ip and eth addr for the packet to send after arp */
-		net_arp_wait_packet_ip = dest;
-		arp_wait_packet_ethaddr = ether;
+int net_send_ip_packet(uchar *ether, struct in_addr dest, int proto,
+		       int payload_len)
+{
+	struct ip_hdr *ip;
+	int eth_hdr_size;
 
-		/* size of the waiting packet */
-		arp_wait_tx_packet_size = pkt_hdr_size + payload_len;
+	assert(net_tx_packet != NULL);
+	if (net_tx_packet == NULL)
+		return -1;
 
-		/* and do the ARP request */
-		arp_wait_try = 1;
-		arp_wait_timer_start = get_timer(0);
-		arp_request();
-		return 1;	/* waiting */
-	} else {
-		debug_cond(DEBUG_DEV_PKT, "sending UDP to %pI4/%pM\n",
-			   &dest, ether);
-		net_send_packet(net_tx_packet, pkt_hdr_size + payload_len);
-		return 0;	/* transmitted */
-	}
+	eth_hdr_size = net_set_ether(net_tx_packet, ether, PROT_IP);
+	ip = (struct ip_hdr *)(net_tx_packet + eth_hdr_size);
+	net_set_ip_header((uchar *)ip, dest, net_ip);
+	ip->ip_len = htons(IP_HDR_SIZE + payload_len);
+	ip->ip_p = proto;
+	ip->ip_sum = compute_ip_checksum(ip, IP_HDR_SIZE);
+
+	return net_send_or_arp(ether, dest,
+			       eth_hdr_size + IP_HDR_SIZE + payload_len);
 }
 
 #ifdef CONFIG_IP_DEFRAG
@@ -858,9 +900,6 @@ int net_send_udp_packet(uchar *ether, struct in_addr dest, int dport, int sport,
  * to the algorithm in RFC815. It returns NULL or the pointer to
  * a complete packet, in static storage
  */
-#ifndef CONFIG_NET_MAXDEFRAG
-#define CONFIG_NET_MAXDEFRAG 16384
-#endif
 #define IP_PKTSIZE (CONFIG_NET_MAXDEFRAG)
 
 #define IP_MAXUDP (IP_PKTSIZE - IP_HDR_SIZE)
@@ -1233,6 +1272,11 @@ void net_process_received_packet(uchar *in_packet, int len)
 		if (ip->ip_p == IPPROTO_ICMP) {
 			receive_icmp(ip, len, src_ip, et);
 			return;
+#ifdef CONFIG_PROT_TCP
+		} else if (ip->ip_p == IPPROTO_TCP) {
+			tcp_receive((struct ip_hdr *)ip, len);
+			return;
+#endif
 		} else if (ip->ip_p != IPPROTO_UDP) {	/* Only UDP packets */
 			return;
 		}
@@ -1339,6 +1383,9 @@ static int net_check_prereq(enum proto_t protocol)
 #endif
 #if defined(CONFIG_CMD_NFS)
 	case NFS:
+#endif
+#if defined(CONFIG_CMD_WGET)
+	case WGET:
 #endif
 		/* Fall through */
 	case TFTPGET:
@@ -0,0 +1,669 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Minimal TCP client
+ *
+ * Enough of RFC 793 for a client to stream a file from a server, with
+ * window scaling (RFC 7323) and Reno congestion control (RFC 5681) for the
+ * data we send. There is no SACK: a segment which arrives out of order is
+ * dropped and answered with a duplicate ACK at once, so that the server
+ * retransmits the missing segment without waiting for its timer.
+ *
+ * Received data is handed on as soon as it arrives in order, so the
+ * receive window never closes and is simply the size of the buffer we
+ * advertise (CONFIG_NET_TCP_RCVBUF or $tcprcvbuf).
+ */
+
+#include <common.h>
+#include <net.h>
+#include <net/tcp.h>
+#include <asm/unaligned.h>
+#include "net_rand.h"
+
+/* Data we send waits here until it is acknowledged */
+#define TCP_TX_BUF_SIZE		4096
+
+#define TCP_RTO_INITIAL		1000	/* ms, RFC 6298 */
+#define TCP_RTO_MIN		200
+#define TCP_RTO_MAX		8000
+#define TCP_RETRIES		8
+/* RFC 1122: ACK every second full segment, and never wait longer */
+#define TCP_DELACK_MS		40
+/* Give up when the server sends nothing for this long */
+#define TCP_IDLE_MS		30000
+#define TCP_WSCALE_MAX		14
+/* MSS to assume when the server does not give one (RFC 1122) */
+#define TCP_DEFAULT_MSS		536
+
+#define TCPOPT_END		0
+#define TCPOPT_NOP		1
+#define TCPOPT_MSS		2
+#define TCPOPT_WSCALE		3
+
+#define SEQ_LT(a, b)		((s32)((a) - (b)) < 0)
+#define SEQ_LEQ(a, b)		((s32)((a) - (b)) <= 0)
+
+enum tcp_state {
+	TCP_CLOSED,
+	TCP_SYN_SENT,
+	TCP_ESTABLISHED,
+	TCP_FIN_WAIT_1,		/* We sent a FIN which is not acked yet */
+	TCP_FIN_WAIT_2,		/* Our FIN was acked, waiting for the server's */
+	TCP_CLOSE_WAIT,		/* The server sent a FIN, we have not */
+	TCP_LAST_ACK,		/* Both sent a FIN, waiting for ours to be acked */
+};
+
+static enum tcp_state tcp_state;
+static struct in_addr tcp_remote_ip;
+static uchar tcp_remote_ethaddr[ARP_HLEN];
+static int tcp_remote_port;
+static int tcp_local_port;
+static tcp_rx_f *tcp_rx_handler;
+static tcp_event_f *tcp_event_handler;
+
+/* Send side: snd_max is the highest sequence number sent so far */
+static u32 tcp_iss, tcp_snd_una, tcp_snd_nxt, tcp_snd_max;
+static u32 tcp_snd_wnd;
+static int tcp_snd_wscale;
+static uint tcp_smss;
+static u32 tcp_cwnd, tcp_ssthresh;
+static int tcp_dupacks;
+static uchar tcp_tx_buf[TCP_TX_BUF_SIZE];
+static uint tcp_tx_len;		/* Bytes in tcp_tx_buf, from snd_una */
+static bool tcp_fin_queued, tcp_fin_sent;
+static u32 tcp_fin_seq;
+
+/* Receive side */
+static u32 tcp_rcv_nxt;
+static u32 tcp_rcv_wnd;
+static int tcp_rcv_wscale;
+static int tcp_ack_pending;	/* Segments received but not acked */
+
+/* Timers, in get_timer() ms */
+static ulong tcp_rto;
+static ulong tcp_rto_at;
+static ulong tcp_delack_at;
+static ulong tcp_last_rx;
+static int tcp_retries;
+
+/* Round trip time of one segment at a time, not retransmitted (Karn) */
+static bool tcp_rtt_timing;
+static u32 tcp_rtt_seq;
+static ulong tcp_rtt_start;
+static ulong tcp_srtt, tcp_rttvar;
+
+static struct tcp_stats tcp_stats;
+
+static void tcp_timeout_handler(void);
+
+static u16 tcp_checksum(struct in_addr src, struct in_addr dst,
+			const void *seg, uint len)
+{
+	struct {
+		struct in_addr src;
+		struct in_addr dst;
+		u8 zero;
+		u8 proto;
+		u16 len;
+	} __attribute__((packed)) pseudo;
+
+	pseudo.src = src;
+	pseudo.dst = dst;
+	pseudo.zero = 0;
+	pseudo.proto = IPPROTO_TCP;
+	pseudo.len = htons(len);
+
+	return add_ip_checksums(sizeof(pseudo),
+				compute_ip_checksum(&pseudo, sizeof(pseudo)),
+				compute_ip_checksum(seg, len));
+}
+
+static void tcp_send_segment(u8 flags, u32 seq, const void *data, uint len)
+{
+	uchar *pkt = net_tx_packet + net_eth_hdr_size() + IP_HDR_SIZE;
+	struct tcp_hdr *tcp = (struct tcp_hdr *)pkt;
+	uchar *opt = pkt + TCP_HDR_SIZE;
+	uint hlen = TCP_HDR_SIZE;
+	u32 wnd;
+
+	if (flags & TCP_SYN) {
+		/* MSS, then our window scale after a NOP to align it */
+		opt[0] = TCPOPT_MSS;
+		opt[1] = 4;
+		put_unaligned_be16(TCP_MSS, opt + 2);
+		opt[4] = TCPOPT_NOP;
+		opt[5] = TCPOPT_WSCALE;
+		opt[6] = 3;
+		opt[7] = tcp_rcv_wscale;
+		hlen += 8;
+		/* The window in a SYN is never scaled */
+		wnd = min_t(u32, tcp_rcv_wnd, 0xffff);
+	} else {
+		wnd = min_t(u32, tcp_rcv_wnd >> tcp_rcv_wscale, 0xffff);
+	}
+	if (len)
+		memcpy(pkt + hlen, data, len);
+
+	tcp->tcp_src = htons(tcp_local_port);
+	tcp->tcp_dst = htons(tcp_remote_port);
+	tcp->tcp_seq = htonl(seq);
+	tcp->tcp_ack = flags & TCP_ACK ? htonl(tcp_rcv_nxt) : 0;
+	tcp->tcp_hlen = (hlen / 4) << 4;
+	tcp->tcp_flags = flags;
+	tcp->tcp_win = htons(wnd);
+	tcp->tcp_xsum = 0;
+	tcp->tcp_urg = 0;
+	tcp->tcp_xsum = tcp_checksum(net_ip, tcp_remote_ip, pkt, hlen + len);
+
+	if (flags & TCP_ACK)
+		tcp_ack_pending = 0;
+	tcp_stats.segs_out++;
+	net_send_ip_packet(tcp_remote_ethaddr, tcp_remote_ip, IPPROTO_TCP,
+			   hlen + len);
+}
+
+static void tcp_send_ack(void)
+{
+	tcp_send_segment(TCP_ACK, tcp_snd_nxt, NULL, 0);
+}
+
+/* Arm the net_loop() timeout for whichever of our timers is due first */
+static void tcp_set_timer(void)
+{
+	ulong now = get_timer(0);
+	ulong next = tcp_last_rx + TCP_IDLE_MS;
+
+	if (tcp_snd_max != tcp_snd_una && tcp_rto_at < next)
+		next = tcp_rto_at;
+	if (tcp_ack_pending && tcp_delack_at < next)
+		next = tcp_delack_at;
+
+	/* A zero interval would cancel the timeout */
+	net_set_timeout_handler(next > now ? next - now : 1,
+				tcp_timeout_handler);
+}
+
+static void tcp_finish(enum tcp_event event)
+{
+	tcp_state = TCP_CLOSED;
+	net_set_timeout_handler(0, NULL);
+	tcp_event_handler(event);
+}
+
+/* Send data and, once it has all gone, our FIN, as far as the window allows */
+static void tcp_output(void)
+{
+	u32 data_end, wnd, flight;
+	uint len;
+
+	if (tcp_state == TCP_SYN_SENT) {
+		if (tcp_snd_nxt == tcp_iss) {
+			tcp_send_segment(TCP_SYN, tcp_iss, NULL, 0);
+			tcp_snd_nxt = tcp_iss + 1;
+			if (tcp_snd_max == tcp_iss) {
+				tcp_snd_max = tcp_snd_nxt;
+				tcp_rto_at = get_timer(0) + tcp_rto;
+			}
+		}
+		return;
+	}
+
+	data_end = tcp_snd_una + tcp_tx_len;
+	while (SEQ_LT(tcp_snd_nxt, data_end)) {
+		wnd = min(tcp_cwnd, tcp_snd_wnd);
+		flight = tcp_snd_nxt - tcp_snd_una;
+		if (flight >= wnd)
+			break;
+		len = min3(data_end - tcp_snd_nxt, (u32)tcp_smss, wnd - flight);
+
+		if (tcp_snd_una == tcp_snd_max)
+			tcp_rto_at = get_timer(0) + tcp_rto;
+		if (!tcp_rtt_timing && tcp_snd_nxt == tcp_snd_max) {
+			tcp_rtt_timing = true;
+			tcp_rtt_seq = tcp_snd_nxt;
+			tcp_rtt_start = get_timer(0);
+		}
+		tcp_send_segment(TCP_ACK |
+				 (tcp_snd_nxt + len == data_end ? TCP_PSH : 0),
+				 tcp_snd_nxt,
+				 tcp_tx_buf + (tcp_snd_nxt - tcp_snd_una), len);
+		tcp_snd_nxt += len;
+		if (SEQ_LT(tcp_snd_max, tcp_snd_nxt))
+			tcp_snd_max = tcp_snd_nxt;
+	}
+
+	if (tcp_fin_queued && tcp_snd_nxt == data_end &&
+	    (!tcp_fin_sent || tcp_snd_nxt == tcp_fin_seq)) {
+		if (tcp_snd_una == tcp_snd_max)
+			tcp_rto_at = get_timer(0) + tcp_rto;
+		tcp_send_segment(TCP_FIN | TCP_ACK, data_end, NULL, 0);
+		tcp_fin_seq = data_end;
+		tcp_fin_sent = true;
+		tcp_snd_nxt = data_end + 1;
+		if (SEQ_LT(tcp_snd_max, tcp_snd_nxt))
+			tcp_snd_max = tcp_snd_nxt;
+		if (tcp_state == TCP_ESTABLISHED)
+			tcp_state = TCP_FIN_WAIT_1;
+		else if (tcp_state == TCP_CLOSE_WAIT)
+			tcp_state = TCP_LAST_ACK;
+	}
+}
+
+/* Go back to the first unacknowledged byte after a timeout */
+static void tcp_rto_expired(void)
+{
+	if (++tcp_retries > TCP_RETRIES) {
+		debug("TCP: no answer from server\n");
+		tcp_finish(TCP_EV_TIMEOUT);
+		return;
+	}
+
+	/* RFC 5681 3.1: a loss found by the timer restarts slow start */
+	tcp_ssthresh = max_t(u32, (tcp_snd_max - tcp_snd_una) / 2,
+			     2 * tcp_smss);
+	tcp_cwnd = tcp_smss;
+	tcp_dupacks = 0;
+	tcp_rtt_timing = false;
+	tcp_rto = min_t(ulong, tcp_rto * 2, TCP_RTO_MAX);
+	tcp_rto_at = get_timer(0) + tcp_rto;
+	tcp_stats.retransmits++;
+
+	tcp_snd_nxt = tcp_state == TCP_SYN_SENT ? tcp_iss : tcp_snd_una;
+	tcp_output();
+}
+
+static void tcp_timeout_handler(void)
+{
+	ulong now = get_timer(0);
+
+	if (tcp_ack_pending && now >= tcp_delack_at)
+		tcp_send_ack();
+	if (tcp_snd_max != tcp_snd_una && now >= tcp_rto_at) {
+		tcp_rto_expired();
+	} else if (now >= tcp_last_rx + TCP_IDLE_MS) {
+		debug("TCP: connection idle\n");
+		tcp_finish(TCP_EV_TIMEOUT);
+	}
+
+	if (tcp_state != TCP_CLOSED)
+		tcp_set_timer();
+}
+
+static void tcp_rtt_sample(ulong rtt)
+{
+	/* RFC 6298 2.2 and 2.3 */
+	if (!tcp_srtt) {
+		tcp_srtt = rtt;
+		tcp_rttvar = rtt / 2;
+	} else {
+		ulong delta = tcp_srtt > rtt ? tcp_srtt - rtt : rtt - tcp_srtt;
+
+		tcp_rttvar = (3 * tcp_rttvar + delta) / 4;
+		tcp_srtt = (7 * tcp_srtt + rtt) / 8;
+	}
+	tcp_rto = clamp_t(ulong, tcp_srtt + 4 * tcp_rttvar, TCP_RTO_MIN,
+			  TCP_RTO_MAX);
+}
+
+/* Read the MSS and window scale options from a SYN */
+static void tcp_parse_syn_options(struct tcp_hdr *tcp, uint hlen)
+{
+	uchar *opt = (uchar *)tcp + TCP_HDR_SIZE;
+	uchar *end = (uchar *)tcp + hlen;
+
+	tcp_smss = TCP_DEFAULT_MSS;
+	tcp_snd_wscale = -1;
+	while (opt < end && *opt != TCPOPT_END) {
+		if (*opt == TCPOPT_NOP) {
+			opt++;
+			continue;
+		}
+		if (opt + 2 > end || opt[1] < 2 || opt + opt[1] > end)
+			break;
+		if (*opt == TCPOPT_MSS && opt[1] == 4)
+			tcp_smss = clamp_t(uint, get_unaligned_be16(opt + 2),
+					   64, TCP_MSS);
+		else if (*opt == TCPOPT_WSCALE && opt[1] == 3)
+			tcp_snd_wscale = min_t(int, opt[2],
+					       TCP_WSCALE_MAX);
+		opt += opt[1];
+	}
+}
+
+static void tcp_syn_received(struct tcp_hdr *tcp, uint hlen, u32 seq, u32 ack)
+{
+	tcp_parse_syn_options(tcp, hlen);
+	/* Windows are only scaled if both sides asked for it */
+	if (tcp_snd_wscale < 0) {
+		tcp_snd_wscale = 0;
+		tcp_rcv_wscale = 0;
+	}
+
+	if (!tcp_retries)
+		tcp_rtt_sample(get_timer(tcp_rtt_start));
+	tcp_rtt_timing = false;
+	tcp_retries = 0;
+
+	tcp_rcv_nxt = seq + 1;
+	tcp_snd_una = ack;
+	tcp_snd_nxt = ack;
+	tcp_snd_max = ack;
+	tcp_snd_wnd = ntohs(tcp->tcp_win);
+	/* RFC 5681 3.1: initial window */
+	tcp_cwnd = min(4 * tcp_smss, max(2 * tcp_smss, 4380U));
+	tcp_ssthresh = ~0U >> 1;
+	tcp_state = TCP_ESTABLISHED;
+	debug("TCP: connected, MSS %u, window scale %d/%d\n", tcp_smss,
+	      tcp_snd_wscale, tcp_rcv_wscale);
+
+	tcp_send_ack();
+	tcp_event_handler(TCP_EV_CONNECTED);
+}
+
+/* Process the ACK field; returns false if the segment should be dropped */
+static bool tcp_process_ack(u32 ack, u32 wnd, uint dlen, u8 flags)
+{
+	u32 acked, data_acked;
+
+	if (SEQ_LT(tcp_snd_max, ack)) {
+		/* Acks something we never sent */
+		tcp_send_ack();
+		return false;
+	}
+
+	if (SEQ_LEQ(ack, tcp_snd_una)) {
+		/* RFC 5681 2: what counts as a duplicate ACK */
+		if (ack == tcp_snd_una && !dlen && !(flags & TCP_FIN) &&
+		    wnd == tcp_snd_wnd && tcp_snd_max != tcp_snd_una) {
+			tcp_dupacks++;
+			if (tcp_dupacks == 3) {
+				/* Fast retransmit, then fast recovery */
+				tcp_ssthresh = max_t(u32, (tcp_snd_max -
+							   tcp_snd_una) / 2,
+						     2 * tcp_smss);
+				tcp_rtt_timing = false;
+				tcp_stats.retransmits++;
+				if (tcp_tx_len)
+					tcp_send_segment(TCP_ACK, tcp_snd_una,
+							 tcp_tx_buf,
+							 min(tcp_tx_len,
+							     tcp_smss));
+				else if (tcp_fin_sent)
+					tcp_send_segment(TCP_FIN | TCP_ACK,
+							 tcp_fin_seq, NULL, 0);
+				tcp_cwnd = tcp_ssthresh + 3 * tcp_smss;
+			} else if (tcp_dupacks > 3) {
+				tcp_cwnd += tcp_smss;
+			}
+		} else if (ack == tcp_snd_una) {
+			tcp_snd_wnd = wnd;
+		}
+		return true;
+	}
+
+	/* New data acked */
+	acked = ack - tcp_snd_una;
+	if (tcp_rtt_timing && SEQ_LT(tcp_rtt_seq, ack)) {
+		tcp_rtt_sample(get_timer(tcp_rtt_start));
+		tcp_rtt_timing = false;
+	}
+
+	/* A FIN takes a sequence number but no room in the buffer */
+	data_acked = min(acked, (u32)tcp_tx_len);
+	memmove(tcp_tx_buf, tcp_tx_buf + data_acked, tcp_tx_len - data_acked);
+	tcp_tx_len -= data_acked;
+
+	tcp_snd_una = ack;
+	if (SEQ_LT(tcp_snd_nxt, ack))
+		tcp_snd_nxt = ack;
+	tcp_snd_wnd = wnd;
+
+	if (tcp_dupacks >= 3)
+		tcp_cwnd = tcp_ssthresh;	/* Leave fast recovery */
+	else if (tcp_cwnd < tcp_ssthresh)
+		tcp_cwnd += min(acked, (u32)tcp_smss);
+	else
+		tcp_cwnd += max(tcp_smss * tcp_smss / tcp_cwnd, 1U);
+	tcp_dupacks = 0;
+	tcp_retries = 0;
+	tcp_rto_at = get_timer(0) + tcp_rto;
+
+	if (tcp_fin_sent && SEQ_LT(tcp_fin_seq, ack)) {
+		if (tcp_state == TCP_FIN_WAIT_1) {
+			tcp_state = TCP_FIN_WAIT_2;
+		} else if (tcp_state == TCP_LAST_ACK) {
+			tcp_finish(TCP_EV_CLOSED);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void tcp_process_data(u32 seq, const uchar *data, uint dlen, u8 flags)
+{
+	uint old;
+
+	if (flags & TCP_SYN) {
+		/* The SYN-ACK again: our ACK of it was lost */
+		tcp_send_ack();
+		return;
+	}
+
+	/* Trim off anything we have had already */
+	if (SEQ_LT(seq, tcp_rcv_nxt)) {
+		old = tcp_rcv_nxt - seq;
+		if (old >= dlen + (flags & TCP_FIN ? 1 : 0)) {
+			/* The server missed our ACK */
+			tcp_send_ack();
+			return;
+		}
+		data += old;
+		dlen -= old;
+		seq = tcp_rcv_nxt;
+	}
+
+	if (seq != tcp_rcv_nxt) {
+		/* A segment was lost: ask for it with a duplicate ACK */
+		tcp_stats.ooo_dropped++;
+		tcp_send_ack();
+		return;
+	}
+
+	/* Nothing may follow the server's FIN */
+	if (dlen && (tcp_state == TCP_ESTABLISHED ||
+		     tcp_state == TCP_FIN_WAIT_1 ||
+		     tcp_state == TCP_FIN_WAIT_2)) {
+		tcp_rcv_nxt += dlen;
+		tcp_stats.bytes_in += dlen;
+		if (!tcp_ack_pending)
+			tcp_delack_at = get_timer(0) + TCP_DELACK_MS;
+		tcp_ack_pending++;
+		if (tcp_rx_handler(data, dlen) < 0) {
+			tcp_abort();
+			return;
+		}
+		if (tcp_state == TCP_CLOSED)
+			return;
+	}
+
+	if (flags & TCP_FIN) {
+		tcp_rcv_nxt++;
+		tcp_send_ack();
+		switch (tcp_state) {
+		case TCP_ESTABLISHED:
+			tcp_state = TCP_CLOSE_WAIT;
+			tcp_event_handler(TCP_EV_FIN);
+			break;
+		case TCP_FIN_WAIT_1:
+			/* Both closing at once: wait for our FIN to be acked */
+			tcp_state = TCP_LAST_ACK;
+			tcp_event_handler(TCP_EV_FIN);
+			break;
+		case TCP_FIN_WAIT_2:
+			/* We never reuse the port, so skip TIME-WAIT */
+			tcp_event_handler(TCP_EV_FIN);
+			tcp_finish(TCP_EV_CLOSED);
+			break;
+		default:
+			break;
+		}
+		return;
+	}
+
+	if (tcp_ack_pending >= 2 || (tcp_ack_pending && (flags & TCP_PSH)))
+		tcp_send_ack();
+}
+
+void tcp_receive(struct ip_hdr *ip, int len)
+{
+	struct tcp_hdr *tcp = (struct tcp_hdr *)((uchar *)ip + IP_HDR_SIZE);
+	uint seglen = len - IP_HDR_SIZE;
+	uint hlen, dlen;
+	u32 seq, ack;
+	u8 flags;
+
+	if (tcp_state == TCP_CLOSED || len < IP_HDR_SIZE + TCP_HDR_SIZE)
+		return;
+	if (net_read_ip(&ip->ip_src).s_addr != tcp_remote_ip.s_addr ||
+	    ntohs(tcp->tcp_src) != tcp_remote_port ||
+	    ntohs(tcp->tcp_dst) != tcp_local_port)
+		return;
+	hlen = (tcp->tcp_hlen >> 4) * 4;
+	if (hlen < TCP_HDR_SIZE || hlen > seglen)
+		return;
+	if (tcp_checksum(net_read_ip(&ip->ip_src), net_read_ip(&ip->ip_dst),
+			 tcp, seglen) & 0xfffe) {
+		debug("TCP: bad checksum\n");
+		return;
+	}
+
+	tcp_stats.segs_in++;
+	tcp_last_rx = get_timer(0);
+	seq = ntohl(tcp->tcp_seq);
+	ack = ntohl(tcp->tcp_ack);
+	flags = tcp->tcp_flags;
+	dlen = seglen - hlen;
+
+	if (flags & TCP_RST) {
+		/* Only believe a reset for this connection */
+		if (tcp_state == TCP_SYN_SENT ?
+		    (flags & TCP_ACK) && ack == tcp_iss + 1 :
+		    SEQ_LEQ(tcp_rcv_nxt, seq) &&
+		    SEQ_LT(seq, tcp_rcv_nxt + tcp_rcv_wnd)) {
+			debug("TCP: connection reset\n");
+			tcp_finish(TCP_EV_RESET);
+		}
+		return;
+	}
+
+	if (tcp_state == TCP_SYN_SENT) {
+		if ((flags & (TCP_SYN | TCP_ACK)) != (TCP_SYN | TCP_ACK) ||
+		    ack != tcp_iss + 1)
+			return;
+		tcp_syn_received(tcp, hlen, seq, ack);
+	} else {
+		if (!(flags & TCP_ACK))
+			return;
+		if (!tcp_process_ack(ack, (u32)ntohs(tcp->tcp_win) <<
+				     tcp_snd_wscale, dlen, flags))
+			return;
+		if (dlen || (flags & (TCP_SYN | TCP_FIN)))
+			tcp_process_data(seq, (uchar *)tcp + hlen, dlen,
+					 flags);
+	}
+
+	if (tcp_state != TCP_CLOSED) {
+		tcp_output();
+		tcp_set_timer();
+	}
+}
+
+int tcp_connect(struct in_addr dest, int dport, tcp_rx_f *rx,
+		tcp_event_f *event)
+{
+	ulong rcvbuf = env_get_ulong("tcprcvbuf", 10, CONFIG_NET_TCP_RCVBUF);
+
+	memset(&tcp_stats, '\0', sizeof(tcp_stats));
+	tcp_remote_ip = dest;
+	memcpy(tcp_remote_ethaddr, net_null_ethaddr, ARP_HLEN);
+	tcp_remote_port = dport;
+	tcp_rx_handler = rx;
+	tcp_event_handler = event;
+
+	srand(seed_mac() ^ get_timer(0));
+	tcp_local_port = 1024 + rand() % 0x4000;
+	tcp_iss = rand();
+
+	/* Use the smallest scale which lets us advertise the whole buffer */
+	tcp_rcv_wnd = clamp_t(ulong, rcvbuf, TCP_MSS,
+			      0xffffUL << TCP_WSCALE_MAX);
+	for (tcp_rcv_wscale = 0; tcp_rcv_wnd >> tcp_rcv_wscale > 0xffff;)
+		tcp_rcv_wscale++;
+	tcp_ack_pending = 0;
+
+	tcp_snd_una = tcp_iss;
+	tcp_snd_nxt = tcp_iss;
+	tcp_snd_max = tcp_iss;
+	tcp_smss = TCP_DEFAULT_MSS;
+	tcp_tx_len = 0;
+	tcp_fin_queued = false;
+	tcp_fin_sent = false;
+	tcp_dupacks = 0;
+	tcp_retries = 0;
+	tcp_rto = TCP_RTO_INITIAL;
+	tcp_srtt = 0;
+	tcp_rtt_timing = true;
+	tcp_rtt_start = get_timer(0);
+	tcp_last_rx = get_timer(0);
+
+	tcp_state = TCP_SYN_SENT;
+	debug("TCP: connecting to %pI4:%d from port %d\n", &dest, dport,
+	      tcp_local_port);
+	tcp_output();
+	tcp_set_timer();
+
+	return 0;
+}
+
+int tcp_send(const void *data, unsigned int len)
+{
+	if ((tcp_state != TCP_ESTABLISHED && tcp_state != TCP_CLOSE_WAIT) ||
+	    tcp_fin_queued)
+		return -ENOTCONN;
+	if (len > TCP_TX_BUF_SIZE - tcp_tx_len)
+		return -ENOSPC;
+
+	memcpy(tcp_tx_buf + tcp_tx_len, data, len);
+	tcp_tx_len += len;
+	tcp_output();
+	tcp_set_timer();
+
+	return 0;
+}
+
+void tcp_close(void)
+{
+	if (tcp_state == TCP_SYN_SENT) {
+		tcp_abort();
+	} else if ((tcp_state == TCP_ESTABLISHED ||
+		    tcp_state == TCP_CLOSE_WAIT) && !tcp_fin_queued) {
+		tcp_fin_queued = true;
+		tcp_output();
+		tcp_set_timer();
+	}
+}
+
+void tcp_abort(void)
+{
+	if (tcp_state == TCP_CLOSED)
+		return;
+	if (tcp_state != TCP_SYN_SENT)
+		tcp_send_segment(TCP_RST | TCP_ACK, tcp_snd_nxt, NULL, 0);
+	tcp_state = TCP_CLOSED;
+	net_set_timeout_handler(0, NULL);
+}
+
+void tcp_get_stats(struct tcp_stats *stats)
+{
+	*stats = tcp_stats;
+}
@@ -69,6 +69,8 @@ enum {
 static struct in_addr tftp_remote_ip;
 /* The UDP port at their end */
 static int	tftp_remote_port;
+/* The UDP port the read or write request is sent to */
+static int	tftp_server_port;
 /* The UDP port at our end */
 static int	tftp_our_port;
 static int	timeout_count;
@@ -123,17 +125,36 @@ static char tftp_filename[MAX_LEN];
 /* 512 is poor choice for ethernet, MTU is typically 1500.
  * Minus eth.hdrs thats 1468.  Can get 2x better throughput with
  * almost-MTU block sizes.  At least try... fall back to 512 if need be.
- * (but those using CONFIG_IP_DEFRAG may want to set a larger block in cfg file)
+ */
+#define TFTP_ETH_BLOCKSIZE	(1500 - IP_UDP_HDR_SIZE - 4)
+
+/*
+ * With CONFIG_IP_DEFRAG a block may be as large as the reassembly buffer
+ * in net.c. If the fragments do not make it through, tftp_timeout_handler()
+ * drops back to TFTP_ETH_BLOCKSIZE.
  */
 #ifdef CONFIG_TFTP_BLOCKSIZE
 #define TFTP_MTU_BLOCKSIZE CONFIG_TFTP_BLOCKSIZE
+#elif defined(CONFIG_IP_DEFRAG)
+#define TFTP_MTU_BLOCKSIZE	(CONFIG_NET_MAXDEFRAG - IP_UDP_HDR_SIZE - 4)
 #else
-#define TFTP_MTU_BLOCKSIZE 1468
+#define TFTP_MTU_BLOCKSIZE	TFTP_ETH_BLOCKSIZE
 #endif
 
 static unsigned short tftp_block_size = TFTP_BLOCK_SIZE;
 static unsigned short tftp_block_size_option = TFTP_MTU_BLOCKSIZE;
 
+/*
+ * RFC 7440 windowsize: the server sends tftp_windowsize blocks back to back
+ * and we only acknowledge the last one. tftp_next_ack is the block number
+ * due for the next ACK, tftp_last_nack the block we last re-acknowledged
+ * after a loss so that a burst of out-of-order blocks triggers one resend.
+ */
+static unsigned short tftp_window_size_option = CONFIG_TFTP_WINDOWSIZE;
+static unsigned short tftp_windowsize = 1;
+static ulong tftp_next_ack;
+static ulong tftp_last_nack;
+
 #ifdef CONFIG_MCAST_TFTP
 #include <malloc.h>
 #define MTFTP_BITMAPSIZE	0x1000
@@ -372,6 +393,10 @@ static void tftp_send(void)
 		/* try for more effic. blk size */
 		pkt += sprintf((char *)pkt, "blksize%c%d%c",
 				0, tftp_block_size_option, 0);
+		/* and for fewer round trips */
+		if (tftp_state == STATE_SEND_RRQ && tftp_window_size_option > 1)
+			pkt += sprintf((char *)pkt, "windowsize%c%d%c",
+					0, tftp_window_size_option, 0);
 #ifdef CONFIG_MCAST_TFTP
 		/* Check all preconditions before even trying the option */
 		if (!tftp_mcast_disabled) {
@@ -457,6 +482,23 @@ static void icmp_handler(unsigned type, unsigned code, unsigned dest,
 }
 #endif
 
+/*
+ * A block of the current window was lost or arrived out of order, or the
+ * server resent a window whose ACK it missed. Ack the last block received
+ * in order, once, so that the server carries on from there instead of
+ * waiting for its timeout (RFC 7440 section 4).
+ */
+static void tftp_resync_window(void)
+{
+	tftp_cur_block = tftp_prev_block;
+	if (tftp_cur_block == tftp_last_nack)
+		return;
+
+	tftp_last_nack = tftp_cur_block;
+	tftp_next_ack = (unsigned short)(tftp_cur_block + tftp_windowsize);
+	tftp_send();
+}
+
 static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			 unsigned src, unsigned len)
 {
@@ -541,6 +583,13 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 				debug("Blocksize ack: %s, %d\n",
 				      (char *)pkt + i + 8, tftp_block_size);
 			}
+			if (strcmp((char *)pkt + i, "windowsize") == 0) {
+				tftp_windowsize = (unsigned short)
+					simple_strtoul((char *)pkt + i + 11,
+						       NULL, 10);
+				debug("Windowsize ack: %s, %d\n",
+				      (char *)pkt + i + 11, tftp_windowsize);
+			}
 #ifdef CONFIG_TFTP_TSIZE
 			if (strcmp((char *)pkt+i, "tsize") == 0) {
 				tftp_tsize = simple_strtoul((char *)pkt + i + 6,
@@ -550,8 +599,17 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			}
 #endif
 		}
+		/* The server may only shrink the window we asked for */
+		if (!tftp_windowsize ||
+		    tftp_windowsize > tftp_window_size_option)
+			tftp_windowsize = 1;
+		tftp_prev_block = 0;
+		tftp_next_ack = tftp_windowsize;
+		tftp_last_nack = TFTP_SEQUENCE_SIZE;
 #ifdef CONFIG_MCAST_TFTP
 		parse_multicast_oack((char *)pkt, len - 1);
+		if (tftp_mcast_active)
+			tftp_windowsize = 1;
 		if ((tftp_mcast_active) && (!tftp_mcast_master_client))
 			tftp_state = STATE_DATA;	/* passive.. */
 		else
@@ -571,11 +629,30 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		len -= 2;
 		tftp_cur_block = ntohs(*(__be16 *)pkt);
 
-		update_block_number();
-
 		if (tftp_state == STATE_SEND_RRQ)
 			debug("Server did not acknowledge timeout option!\n");
 
+		/*
+		 * Within a window, a block past the next one means that one
+		 * was lost and a block before it is a duplicate from a resent
+		 * window. Both are answered with an ACK of the last block in
+		 * order, and must be caught before update_block_number() so
+		 * that a stray block 0 is not taken for a wraparound.
+		 */
+		if (tftp_windowsize > 1) {
+			unsigned short gap;
+
+			gap = tftp_cur_block - tftp_prev_block - 1;
+			if (gap) {
+				debug("Got block %ld after %ld\n",
+				      tftp_cur_block, tftp_prev_block);
+				tftp_resync_window();
+				break;
+			}
+		}
+
+		update_block_number();
+
 		if (tftp_state == STATE_SEND_RRQ || tftp_state == STATE_OACK ||
 		    tftp_state == STATE_RECV_WRQ) {
 			/* first block received */
@@ -639,7 +716,12 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			}
 		}
 #endif
-		tftp_send();
+		if (tftp_windowsize == 1 || len < tftp_block_size ||
+		    tftp_cur_block == tftp_next_ack) {
+			tftp_send();
+			tftp_next_ack = (unsigned short)(tftp_cur_block +
+							 tftp_windowsize);
+		}
 
 #ifdef CONFIG_MCAST_TFTP
 		if (tftp_mcast_active) {
@@ -688,9 +770,34 @@ static void tftp_timeout_handler(void)
 {
 	if (++timeout_count > timeout_count_max) {
 		restart("Retry count exceeded");
+	} else if (tftp_state == STATE_OACK && timeout_count > 1 &&
+		   tftp_block_size > TFTP_ETH_BLOCKSIZE) {
+		/*
+		 * The server agreed to a block size that needs IP
+		 * fragmentation but no block has arrived: something on the
+		 * path drops fragments. Stick to frame-sized blocks.
+		 */
+		printf("\nNo data with %d byte blocks, retrying with %d\n",
+		       tftp_block_size, (int)TFTP_ETH_BLOCKSIZE);
+		tftp_block_size_option = TFTP_ETH_BLOCKSIZE;
+		tftp_block_size = TFTP_BLOCK_SIZE;
+		tftp_windowsize = 1;
+		tftp_state = STATE_SEND_RRQ;
+		tftp_remote_port = tftp_server_port;
+		/* Ignore whatever the abandoned transfer still sends */
+		tftp_our_port = 1024 + (tftp_our_port + 1) % 3072;
+		timeout_count = 0;
+		net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
+		tftp_send();
 	} else {
 		puts("T ");
 		net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
+		if (tftp_state == STATE_DATA && tftp_windowsize > 1) {
+			/* Have the server resend the window after our ACK */
+			tftp_last_nack = tftp_cur_block;
+			tftp_next_ack = (unsigned short)(tftp_cur_block +
+							 tftp_windowsize);
+		}
 		if (tftp_state != STATE_RECV_WRQ)
 			tftp_send();
 	}
@@ -711,6 +818,10 @@ void tftp_start(enum proto_t protocol)
 	if (ep != NULL)
 		tftp_block_size_option = simple_strtol(ep, NULL, 10);
 
+	ep = env_get("tftpwindowsize");
+	if (ep != NULL)
+		tftp_window_size_option = simple_strtol(ep, NULL, 10);
+
 	ep = env_get("tftptimeout");
 	if (ep != NULL)
 		timeout_ms = simple_strtol(ep, NULL, 10);
@@ -732,8 +843,8 @@ void tftp_start(enum proto_t protocol)
 	}
 #endif
 
-	debug("TFTP blocksize = %i, timeout = %ld ms\n",
-	      tftp_block_size_option, timeout_ms);
+	debug("TFTP blocksize = %i, windowsize = %i, timeout = %ld ms\n",
+	      tftp_block_size_option, tftp_window_size_option, timeout_ms);
 
 	tftp_remote_ip = net_server_ip;
 	if (!net_parse_bootfile(&tftp_remote_ip, tftp_filename, MAX_LEN)) {
@@ -821,12 +932,14 @@ void tftp_start(enum proto_t protocol)
 	if (ep != NULL)
 		tftp_our_port = simple_strtol(ep, NULL, 10);
 #endif
+	tftp_server_port = tftp_remote_port;
 	tftp_cur_block = 0;
 
 	/* zero out server ether in case the server ip has changed */
 	memset(net_server_ethaddr, 0, 6);
-	/* Revert tftp_block_size to dflt */
+	/* Revert tftp_block_size and tftp_windowsize to dflt */
 	tftp_block_size = TFTP_BLOCK_SIZE;
+	tftp_windowsize = 1;
 #ifdef CONFIG_MCAST_TFTP
 	mcast_cleanup();
 #endif
@@ -854,8 +967,9 @@ void tftp_start_server(void)
 	timeout_ms = TIMEOUT;
 	net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
 
-	/* Revert tftp_block_size to dflt */
+	/* Revert tftp_block_size and tftp_windowsize to dflt */
 	tftp_block_size = TFTP_BLOCK_SIZE;
+	tftp_windowsize = 1;
 	tftp_cur_block = 0;
 	tftp_our_port = WELL_KNOWN_PORT;
 
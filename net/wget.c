@@ -0,0 +1,268 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * HTTP download over TCP
+ *
+ * One HTTP/1.1 GET per transfer. The body of the response is streamed to
+ * load_addr as it arrives, or to the handler given to wget_set_sink(). The
+ * body must be sent as it is, without chunked encoding; its length is
+ * checked against Content-Length when the server gives one, otherwise the
+ * body ends when the server closes the connection.
+ */
+
+#include <common.h>
+#include <mapmem.h>
+#include <net.h>
+#include <net/tcp.h>
+#include <net/wget.h>
+#include <linux/sizes.h>
+
+#define WGET_PORT		80
+/* Longest response header we accept */
+#define WGET_HDR_SIZE		2048
+/* Print one hash mark per this many bytes */
+#define WGET_HASH_BYTES		SZ_64K
+#define HASHES_PER_LINE		65
+
+enum wget_state {
+	WGET_CONNECTING,
+	WGET_HEADER,		/* Waiting for the end of the response header */
+	WGET_BODY,
+	WGET_DONE,		/* The whole body has arrived */
+	WGET_FAILED,
+};
+
+static enum wget_state wget_state;
+static struct in_addr wget_server_ip;
+static char wget_path[1024];
+static char wget_hdr[WGET_HDR_SIZE + 1];
+static uint wget_hdr_len;
+static long wget_content_len;	/* -1 if the server did not say */
+static ulong wget_body_len;
+static ulong wget_time_start;
+static int wget_hashes;
+
+static wget_sink_f *wget_next_sink, *wget_sink;
+static void *wget_next_priv, *wget_sink_priv;
+
+void wget_set_sink(wget_sink_f *sink, void *priv)
+{
+	wget_next_sink = sink;
+	wget_next_priv = priv;
+}
+
+static void wget_fail(const char *msg)
+{
+	printf("\n%s\n", msg);
+	wget_state = WGET_FAILED;
+	net_set_state(NETLOOP_FAIL);
+}
+
+static void wget_complete(void)
+{
+	struct tcp_stats stats;
+	ulong ms = get_timer(wget_time_start);
+
+	net_boot_file_size = wget_body_len;
+	if (ms > 0) {
+		puts("\n\t ");	/* Line up with "Loading: " */
+		print_size(wget_body_len / ms * 1000, "/s");
+	}
+	tcp_get_stats(&stats);
+	debug("\nTCP: %lu segments in, %lu out, %lu retransmitted, %lu out of order\n",
+	      stats.segs_in, stats.segs_out, stats.retransmits,
+	      stats.ooo_dropped);
+	puts("\ndone\n");
+	net_set_state(NETLOOP_SUCCESS);
+}
+
+/* Check the status and find the length of the body */
+static int wget_parse_header(void)
+{
+	char *line, *end, *value;
+	ulong status;
+
+	if (strncmp(wget_hdr, "HTTP/1.", 7)) {
+		wget_fail("Not an HTTP response");
+		return -EPROTO;
+	}
+	status = simple_strtoul(wget_hdr + 9, NULL, 10);
+	if (status != 200) {
+		end = strstr(wget_hdr, "\r\n");
+		*end = '\0';
+		wget_fail(wget_hdr);
+		return -ENOENT;
+	}
+
+	wget_content_len = -1;
+	for (line = strstr(wget_hdr, "\r\n") + 2; *line != '\r'; line = end + 2) {
+		end = strstr(line, "\r\n");
+		*end = '\0';
+		value = strchr(line, ':');
+		if (!value)
+			continue;
+		for (value++; *value == ' ' || *value == '\t'; value++)
+			;
+		if (!strncasecmp(line, "Content-Length:", 15)) {
+			wget_content_len = simple_strtoul(value, NULL, 10);
+		} else if (!strncasecmp(line, "Transfer-Encoding:", 18) &&
+			   strcasecmp(value, "identity")) {
+			wget_fail("Chunked transfer encoding is not supported");
+			return -EPROTONOSUPPORT;
+		}
+	}
+
+	return 0;
+}
+
+static int wget_store(const uchar *data, unsigned int len)
+{
+	void *ptr;
+	int ret;
+
+	if (wget_sink) {
+		ret = wget_sink(wget_body_len, data, len, wget_sink_priv);
+		if (ret) {
+			wget_fail("Download aborted");
+			return ret;
+		}
+	} else {
+		ptr = map_sysmem(load_addr + wget_body_len, len);
+		memcpy(ptr, data, len);
+		unmap_sysmem(ptr);
+	}
+
+	wget_body_len += len;
+	while (wget_body_len >= (wget_hashes + 1) * WGET_HASH_BYTES) {
+		putc('#');
+		if (!(++wget_hashes % HASHES_PER_LINE))
+			puts("\n\t ");
+	}
+
+	return 0;
+}
+
+static int wget_rx(const uchar *data, unsigned int len)
+{
+	uint n, hdr_len;
+	char *end;
+
+	if (wget_state == WGET_HEADER) {
+		n = min(len, WGET_HDR_SIZE - wget_hdr_len);
+		memcpy(wget_hdr + wget_hdr_len, data, n);
+		wget_hdr_len += n;
+		wget_hdr[wget_hdr_len] = '\0';
+
+		end = strstr(wget_hdr, "\r\n\r\n");
+		if (!end) {
+			if (wget_hdr_len < WGET_HDR_SIZE)
+				return 0;
+			wget_fail("HTTP response header too long");
+			return -E2BIG;
+		}
+		if (wget_parse_header())
+			return -EPROTO;
+		wget_state = WGET_BODY;
+
+		/* The rest of this segment is the start of the body */
+		hdr_len = end + 4 - wget_hdr;
+		n = hdr_len - (wget_hdr_len - n);
+		data += n;
+		len -= n;
+	}
+
+	if (wget_state != WGET_BODY)
+		return 0;
+
+	if (wget_content_len >= 0)
+		len = min_t(ulong, len, wget_content_len - wget_body_len);
+	if (len && wget_store(data, len))
+		return -EIO;
+
+	if (wget_content_len >= 0 && wget_body_len == wget_content_len) {
+		wget_state = WGET_DONE;
+		tcp_close();
+	}
+
+	return 0;
+}
+
+static void wget_event(enum tcp_event event)
+{
+	char req[sizeof(wget_path) + 128];
+	int len;
+
+	if (wget_state == WGET_FAILED)
+		return;
+
+	switch (event) {
+	case TCP_EV_CONNECTED:
+		len = snprintf(req, sizeof(req),
+			       "GET %s HTTP/1.1\r\nHost: %pI4\r\nUser-Agent: U-Boot\r\nConnection: close\r\n\r\n",
+			       wget_path, &wget_server_ip);
+		if (tcp_send(req, len)) {
+			tcp_abort();
+			wget_fail("Cannot send HTTP request");
+			return;
+		}
+		wget_state = WGET_HEADER;
+		break;
+	case TCP_EV_FIN:
+		/* Without a Content-Length, the body ends with the stream */
+		if (wget_state == WGET_BODY && wget_content_len < 0)
+			wget_state = WGET_DONE;
+		tcp_close();
+		break;
+	case TCP_EV_CLOSED:
+	case TCP_EV_RESET:
+		if (wget_state == WGET_DONE)
+			wget_complete();
+		else
+			wget_fail(event == TCP_EV_RESET ? "Connection reset" :
+				  "Connection closed early");
+		break;
+	case TCP_EV_TIMEOUT:
+		wget_fail("Timeout");
+		break;
+	}
+}
+
+void wget_start(void)
+{
+	int port = env_get_ulong("httpport", 10, WGET_PORT);
+
+	wget_sink = wget_next_sink;
+	wget_sink_priv = wget_next_priv;
+	wget_next_sink = NULL;
+	wget_next_priv = NULL;
+
+	wget_server_ip = net_server_ip;
+	wget_path[0] = '/';
+	if (!net_parse_bootfile(&wget_server_ip, wget_path + 1,
+				sizeof(wget_path) - 1)) {
+		wget_fail("*** ERROR: no file name given");
+		return;
+	}
+	/* Allow the path to be given with or without its leading slash */
+	if (wget_path[1] == '/')
+		memmove(wget_path, wget_path + 1, strlen(wget_path));
+
+	printf("Using %s device\n", eth_get_name());
+	printf("HTTP from server %pI4:%d; our IP address is %pI4\n",
+	       &wget_server_ip, port, &net_ip);
+	printf("Filename '%s'.\n", wget_path);
+	if (wget_sink)
+		puts("Load address: (handler)\n");
+	else
+		printf("Load address: 0x%lx\n", load_addr);
+	puts("Loading: *\b");
+
+	wget_state = WGET_CONNECTING;
+	wget_hdr_len = 0;
+	wget_content_len = -1;
+	wget_body_len = 0;
+	wget_hashes = 0;
+	wget_time_start = get_timer(0);
+
+	if (tcp_connect(wget_server_ip, port, wget_rx, wget_event))
+		wget_fail("Cannot connect");
+}
@@ -49,6 +49,13 @@ static cmd_tbl_t cmd_ut_sub[] = {
 #ifdef CONFIG_UT_TIME
 	U_BOOT_CMD_MKENT(time, CONFIG_SYS_MAXARGS, 1, do_ut_time, "", ""),
 #endif
+#ifdef CONFIG_UT_INITCALL
+	U_BOOT_CMD_MKENT(initcall, CONFIG_SYS_MAXARGS, 1, do_ut_initcall, "",
+			 ""),
+#endif
+#ifdef CONFIG_UT_TASK
+	U_BOOT_CMD_MKENT(task, CONFIG_SYS_MAXARGS, 1, do_ut_task, "", ""),
+#endif
 #ifdef CONFIG_SANDBOX
 	U_BOOT_CMD_MKENT(compression, CONFIG_SYS_MAXARGS, 1, do_ut_compression,
 			 "", ""),
@@ -105,6 +112,12 @@ static char ut_help_text[] =
 #ifdef CONFIG_UT_TIME
 	"ut time - Very basic test of time functions\n"
 #endif
+#ifdef CONFIG_UT_INITCALL
+	"ut initcall [test-name]\n"
+#endif
+#ifdef CONFIG_UT_TASK
+	"ut task [test-name]\n"
+#endif
 #ifdef CONFIG_SANDBOX
 	"ut compression - Test compressors and bootm decompression\n"
 #endif
@@ -6,11 +6,70 @@
 #define DEBUG
 
 #include <common.h>
+#include <cli_hush.h>
 
 static const char test_cmd[] = "setenv list 1\n setenv list ${list}2; "
 		"setenv list ${list}3\0"
 		"setenv list ${list}4";
 
+/* Check that find_cmd() matches a search of the whole command list */
+static void check_find_cmd(void)
+{
+	cmd_tbl_t *start = ll_entry_start(cmd_tbl_t, cmd);
+	const int count = ll_entry_count(cmd_tbl_t, cmd);
+	cmd_tbl_t *cmdtp;
+	char name[40];
+	int len;
+
+	for (cmdtp = start; cmdtp != start + count; cmdtp++) {
+		for (len = 1; len <= strlen(cmdtp->name) &&
+		     len < sizeof(name) - 2; len++) {
+			strlcpy(name, cmdtp->name, len + 1);
+			assert(find_cmd(name) == find_cmd_tbl(name, start, count));
+			strcat(name, ".b");
+			assert(find_cmd(name) == find_cmd_tbl(name, start, count));
+		}
+	}
+	assert(!find_cmd("no_such_command"));
+	assert(find_cmd_indexed());
+	assert(!strcmp(find_cmd("?")->name, "?"));
+}
+
+#ifdef CONFIG_HUSH_CACHE
+/* Time a distro-style boot script, parsed each time and then cached */
+static void hush_cache_bench(void)
+{
+	const int runs = 200;
+	ulong start, parsed, cached;
+	int i;
+
+	run_command("setenv boot_targets 'mmc0 usb0 pxe'; "
+		    "setenv bootcmd_mmc0 'false'; "
+		    "setenv bootcmd_usb0 'false'; "
+		    "setenv bootcmd_pxe 'true'", 0);
+	run_command("setenv bench 'for target in ${boot_targets}; do "
+		    "if test ${target} = none; then echo no; "
+		    "elif run bootcmd_${target}; then setenv found ${target}; "
+		    "fi; done'", 0);
+
+	start = timer_get_us();
+	for (i = 0; i < runs; i++) {
+		hush_cache_flush();
+		run_command("run bench", 0);
+	}
+	parsed = timer_get_us() - start;
+
+	start = timer_get_us();
+	for (i = 0; i < runs; i++)
+		run_command("run bench", 0);
+	cached = timer_get_us() - start;
+	assert(!strcmp("pxe", env_get("found")));
+
+	printf("%s: %d runs took %lu us parsing each time, %lu us cached\n",
+	       __func__, runs, parsed, cached);
+}
+#endif
+
 static int do_ut_cmd(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
 	printf("%s: Testing commands\n", __func__);
@@ -51,6 +110,22 @@ static int do_ut_cmd(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 	assert(!strcmp("2", env_get("adder")));
 #endif
 
+#ifdef CONFIG_HUSH_CACHE
+	/* a cached script must see changes to the variables it runs */
+	run_command("setenv list", 0);
+	run_command("setenv foo 'for i in 1 2; do setenv list ${list}$i; done'",
+		    0);
+	run_command("run foo; run foo", 0);
+	assert(!strcmp("1212", env_get("list")));
+	run_command("setenv foo 'setenv list ${list}3'", 0);
+	run_command("run foo", 0);
+	assert(!strcmp("12123", env_get("list")));
+
+	hush_cache_bench();
+#endif
+
+	check_find_cmd();
+
 	assert(run_command("", 0) == 0);
 	assert(run_command(" ", 0) == 0);
 
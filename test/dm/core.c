@@ -6,11 +6,14 @@
  */
 
 #include <common.h>
+#include <bootstage.h>
 #include <errno.h>
 #include <dm.h>
 #include <fdtdec.h>
 #include <malloc.h>
 #include <dm/device-internal.h>
+#include <dm/lazy.h>
+#include <dm/lists.h>
 #include <dm/root.h>
 #include <dm/util.h>
 #include <dm/test.h>
@@ -870,3 +873,240 @@ static int dm_test_uclass_names(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_uclass_names, DM_TESTF_SCAN_PDATA);
+
+/* Find the driver for a compatible string as lists_bind_fdt() used to */
+static struct driver *scan_compat(const char *compat,
+				  const struct udevice_id **of_idp)
+{
+	struct driver *drv = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *of_id;
+	struct driver *entry;
+
+	for (entry = drv; entry != drv + n_ents; entry++) {
+		for (of_id = entry->of_match; of_id && of_id->compatible;
+		     of_id++) {
+			if (!strcmp(of_id->compatible, compat)) {
+				*of_idp = of_id;
+				return entry;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+/* Lookups through the driver index find what a scan of the lists finds */
+static int dm_test_lists_lookup(struct unit_test_state *uts)
+{
+	struct driver *drv = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	struct uclass_driver *uc = ll_entry_start(struct uclass_driver, uclass);
+	const int n_uclass = ll_entry_count(struct uclass_driver, uclass);
+	const struct udevice_id *of_id, *found_id, *scan_id;
+	struct driver *entry, *first;
+	struct uclass_driver *uc_entry;
+
+	for (entry = drv; entry != drv + n_ents; entry++) {
+		for (of_id = entry->of_match; of_id && of_id->compatible;
+		     of_id++) {
+			ut_asserteq_ptr(scan_compat(of_id->compatible,
+						    &scan_id),
+					lists_driver_lookup_compat(
+						of_id->compatible, &found_id));
+			ut_asserteq_ptr(scan_id, found_id);
+		}
+
+		for (first = drv; strcmp(first->name, entry->name); first++)
+			;
+		ut_asserteq_ptr(first, lists_driver_lookup_name(entry->name));
+	}
+	ut_assertnull(lists_driver_lookup_compat("denx,u-boot-no-such",
+						 &found_id));
+	ut_assertnull(lists_driver_lookup_name("no_such_driver"));
+
+	for (uc_entry = uc; uc_entry != uc + n_uclass; uc_entry++)
+		ut_asserteq(uc_entry->id,
+			    lists_uclass_lookup(uc_entry->id)->id);
+	ut_assertnull(lists_uclass_lookup(UCLASS_INVALID));
+	ut_assertnull(lists_uclass_lookup(UCLASS_COUNT));
+
+	return 0;
+}
+DM_TEST(dm_test_lists_lookup, 0);
+
+/* Time the driver lookups needed to bind every node of the test tree */
+static int dm_test_lists_bind_speed(struct unit_test_state *uts)
+{
+	const void *blob = gd->fdt_blob;
+	const struct udevice_id *of_id;
+	const char *list, *compat;
+	ulong start, index_us, scan_us;
+	int offset, depth, len, round;
+	uint lookups = 0;
+
+	/* The first lookup builds the index, which is not part of binding */
+	lists_driver_lookup_compat("", &of_id);
+
+	for (start = timer_get_us(), round = 0; round < 100; round++) {
+		depth = 0;
+		for (offset = fdt_next_node(blob, -1, &depth); offset >= 0;
+		     offset = fdt_next_node(blob, offset, &depth)) {
+			list = fdt_getprop(blob, offset, "compatible", &len);
+			for (compat = list; list && compat < list + len;
+			     compat += strlen(compat) + 1) {
+				lists_driver_lookup_compat(compat, &of_id);
+				lookups++;
+			}
+		}
+	}
+	index_us = timer_get_us() - start;
+
+	for (start = timer_get_us(), round = 0; round < 100; round++) {
+		depth = 0;
+		for (offset = fdt_next_node(blob, -1, &depth); offset >= 0;
+		     offset = fdt_next_node(blob, offset, &depth)) {
+			list = fdt_getprop(blob, offset, "compatible", &len);
+			for (compat = list; list && compat < list + len;
+			     compat += strlen(compat) + 1)
+				scan_compat(compat, &of_id);
+		}
+	}
+	scan_us = timer_get_us() - start;
+
+	printf("%u lookups of %d drivers: %lu us indexed, %lu us scanned\n",
+	       lookups, ll_entry_count(struct driver, driver), index_us,
+	       scan_us);
+	ut_assert(lookups > 0);
+	if (CONFIG_IS_ENABLED(DM_DRIVER_INDEX))
+		ut_assert(index_us < scan_us);
+
+	return 0;
+}
+DM_TEST(dm_test_lists_bind_speed, 0);
+
+/* Count the devices in a uclass without binding any deferred nodes */
+static int count_bound(enum uclass_id id)
+{
+	struct uclass *uc = uclass_find(id);
+
+	return uc ? list_count_items(&uc->dev_head) : 0;
+}
+
+static int check_lazy_bind(struct unit_test_state *uts)
+{
+	struct udevice *dev;
+	int eager_heap, lazy_heap, count;
+	u32 eager_us, lazy_us;
+
+	/* Bind the whole tree, as a normal scan does */
+	dm_leak_check_start(uts);
+	bootstage_start(BOOTSTAGE_ID_ALLOC, "dm_scan_eager");
+	ut_assertok(dm_scan_fdt(gd->fdt_blob, false));
+	eager_us = bootstage_accum(BOOTSTAGE_ID_ALLOC);
+	eager_heap = mallinfo().uordblks - uts->start.uordblks;
+	count = count_bound(UCLASS_TEST_FDT);
+	ut_assert(count > 1);
+	ut_assertok(dm_leak_check_end(uts));
+
+	/* Now only record the nodes */
+	dm_set_lazy_bind(true);
+	dm_leak_check_start(uts);
+	bootstage_start(BOOTSTAGE_ID_ALLOC, "dm_scan_lazy");
+	ut_assertok(dm_scan_fdt(gd->fdt_blob, false));
+	lazy_us = bootstage_accum(BOOTSTAGE_ID_ALLOC);
+	lazy_heap = mallinfo().uordblks - uts->start.uordblks;
+	ut_assert(dm_lazy_pending() > 0);
+	ut_assert(list_empty(&gd->dm_root->child_head));
+	ut_assert(lazy_heap < eager_heap);
+	printf("Scan: eager %u us, %d bytes; lazy %u us, %d bytes\n",
+	       eager_us, eager_heap, lazy_us, lazy_heap);
+
+	/* Looking up a node binds it and its bus, but nothing else */
+	ut_assertok(device_find_global_by_ofnode(
+			ofnode_path("/some-bus/c-test@5"), &dev));
+	ut_asserteq_str("c-test@5", dev->name);
+	ut_asserteq_str("some-bus", dev->parent->name);
+	ut_asserteq(1, count_bound(UCLASS_TEST_FDT));
+	ut_asserteq(1, count_bound(UCLASS_TEST_BUS));
+
+	/* Looking in the uclass binds the rest of it */
+	ut_assertok(uclass_find_first_device(UCLASS_TEST_FDT, &dev));
+	ut_asserteq(count, count_bound(UCLASS_TEST_FDT));
+	ut_assert(dm_lazy_pending() > 0);
+
+	return 0;
+}
+
+/* Test binding device tree nodes when they are first looked up */
+static int dm_test_lazy_bind(struct unit_test_state *uts)
+{
+	int ret;
+
+	if (!CONFIG_IS_ENABLED(DM_LAZY_BIND))
+		return 0;
+	ret = check_lazy_bind(uts);
+	dm_set_lazy_bind(false);
+	dm_lazy_forget(NULL);
+
+	return ret;
+}
+DM_TEST(dm_test_lazy_bind, 0);
+
+#ifdef ENABLE_BOOTSTAGE_PROFILE
+/* Most time each profile event may add, on sandbox */
+#define PROFILE_BUDGET_US	2
+#define PROFILE_BUDGET_EVENTS	10000
+
+/* Test that probing a device is recorded in the boot profile */
+static int dm_test_bootstage_profile(struct unit_test_state *uts)
+{
+	struct udevice *dev;
+	char *buf, small[20];
+	int len;
+
+	ut_assertok(uclass_get_device(UCLASS_TEST, 0, &dev));
+	ut_asserteq_str("test_drv", dev->driver->name);
+
+	len = bootstage_event_export(NULL, 0);
+	ut_assert(len > 0);
+	buf = malloc(len + 1);
+	ut_assertnonnull(buf);
+	ut_asserteq(len, bootstage_event_export(buf, len + 1));
+	ut_asserteq(len, strlen(buf));
+	ut_assertnonnull(strstr(buf, "{\"name\":\"test_drv\",\"cat\":\"probe\","));
+	ut_asserteq_str("}}\n", buf + len - 3);
+	free(buf);
+
+	/* A short buffer gets as much as fits */
+	ut_asserteq(len, bootstage_event_export(small, sizeof(small)));
+	ut_asserteq(sizeof(small) - 1, strlen(small));
+
+	return 0;
+}
+DM_TEST(dm_test_bootstage_profile, DM_TESTF_SCAN_PDATA);
+
+/* Check that recording an event stays within the budget */
+static int dm_test_bootstage_profile_overhead(struct unit_test_state *uts)
+{
+	ulong start, elapsed;
+	void *save;
+	int i;
+
+	/* Keep the boot's events, which these would otherwise replace */
+	save = bootstage_event_save();
+	ut_assertnonnull(save);
+	start = timer_get_us();
+	for (i = 0; i < PROFILE_BUDGET_EVENTS; i++)
+		bootstage_event_add(BOOTSTAGE_EVENT_CMD, "budget",
+				    bootstage_event_start());
+	elapsed = timer_get_us() - start;
+	bootstage_event_restore(save);
+
+	printf("%d profile events: %lu us\n", PROFILE_BUDGET_EVENTS, elapsed);
+	ut_assert(elapsed < PROFILE_BUDGET_EVENTS * PROFILE_BUDGET_US);
+
+	return 0;
+}
+DM_TEST(dm_test_bootstage_profile_overhead, 0);
+#endif
@@ -2,6 +2,8 @@
 
 #include <common.h>
 #include <dm.h>
+#include <fdt_cache.h>
+#include <malloc.h>
 #include <dm/test.h>
 #include <test/ut.h>
 
@@ -42,3 +44,97 @@ static int dm_test_ofnode_by_prop_value(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_ofnode_by_prop_value, DM_TESTF_SCAN_FDT);
+
+/* Find the node with a phandle by searching the whole tree */
+static int search_phandle(const void *blob, uint32_t phandle)
+{
+	int offset;
+
+	for (offset = fdt_next_node(blob, -1, NULL); offset >= 0;
+	     offset = fdt_next_node(blob, offset, NULL)) {
+		if (fdt_get_phandle(blob, offset) == phandle)
+			return offset;
+	}
+
+	return offset;
+}
+
+static int dm_test_ofnode_fdt_cache(struct unit_test_state *uts)
+{
+	const void *blob = gd->fdt_blob;
+	struct fdt_cache_stats stats;
+	int offset, node, moved, found, renamed, size, count = 0;
+	uint32_t phandle, last = 0;
+	void *buf;
+
+	fdt_cache_reset();
+
+	/* Each phandle leads to the node a search finds */
+	for (offset = fdt_next_node(blob, -1, NULL); offset >= 0;
+	     offset = fdt_next_node(blob, offset, NULL)) {
+		phandle = fdt_get_phandle(blob, offset);
+		if (!phandle)
+			continue;
+		ut_asserteq(offset, fdt_node_offset_by_phandle(blob, phandle));
+		ut_asserteq(offset, fdt_node_offset_by_phandle(blob, phandle));
+		last = phandle;
+		count++;
+	}
+	ut_assert(count > 0);
+	ut_asserteq(-FDT_ERR_NOTFOUND,
+		    fdt_node_offset_by_phandle(blob, 0xfffff));
+
+	/* A second lookup starts from the node found by the first */
+	node = fdt_path_offset(blob, "/some-bus/c-test@5");
+	ut_assert(node > 0);
+	ut_asserteq_str("c-test@5", fdt_get_name(blob, node, NULL));
+	ut_asserteq(node, fdt_path_offset(blob, "/some-bus/c-test@5"));
+	ut_asserteq(node, fdt_path_offset(blob, "testfdt5"));
+	ut_asserteq(fdt_parent_offset(blob, node),
+		    fdt_path_offset(blob, "/some-bus"));
+	ut_asserteq(-FDT_ERR_NOTFOUND,
+		    fdt_path_offset(blob, "/some-bus/no-such-node"));
+
+	fdt_cache_get_stats(&stats);
+	printf("%lu phandle lookups, %lu hits; %lu path lookups, %lu hits\n",
+	       stats.phandle_lookups, stats.phandle_hits, stats.path_lookups,
+	       stats.path_hits);
+	if (CONFIG_IS_ENABLED(OF_LIBFDT_CACHE)) {
+		ut_asserteq(2 * count + 1, stats.phandle_lookups);
+		ut_asserteq(2 * count, stats.phandle_hits);
+		ut_asserteq(1, stats.builds);
+		ut_assert(stats.path_hits >= 3);
+	}
+
+	/* Adding a node moves the others, so the cache must be dropped */
+	size = fdt_totalsize(blob) + 1024;
+	buf = malloc(size);
+	ut_assertnonnull(buf);
+	ut_assertok(fdt_open_into(blob, buf, size));
+	gd->fdt_blob = buf;
+	fdt_path_offset(buf, "/some-bus/c-test@5");
+	fdt_node_offset_by_phandle(buf, last);
+	offset = fdt_add_subnode(buf, 0, "cache-test");
+	moved = fdt_path_offset(buf, "/some-bus/c-test@5");
+	node = fdt_node_offset_by_phandle(buf, last);
+	found = search_phandle(buf, last);
+
+	/* Renaming a node in place keeps the cache but must not fool it */
+	ut_assertok(fdt_set_name(buf, fdt_path_offset(buf, "/some-bus"),
+				 "same-bus"));
+	renamed = fdt_path_offset(buf, "/some-bus/c-test@5");
+	gd->fdt_blob = blob;
+
+	ut_assert(offset > 0);
+	ut_asserteq_str("c-test@5", fdt_get_name(buf, moved, NULL));
+	ut_asserteq(found, node);
+	ut_asserteq(-FDT_ERR_NOTFOUND, renamed);
+	free(buf);
+	fdt_cache_get_stats(&stats);
+	if (CONFIG_IS_ENABLED(OF_LIBFDT_CACHE))
+		ut_assert(stats.invalidations >= 2);
+	fdt_cache_reset();
+
+	return 0;
+}
+DM_TEST(dm_test_ofnode_fdt_cache, 0);
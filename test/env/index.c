@@ -0,0 +1,221 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Tests for the indexed binary environment
+ */
+
+#include <common.h>
+#include <env_index.h>
+#include <malloc.h>
+#include <search.h>
+#include <test/env.h>
+#include <test/ut.h>
+
+#define INDEX_TEST_VARS		200
+#define INDEX_TEST_SIZE		0x4000
+
+/* Hash table entries for INDEX_TEST_SIZE, as himport_r() works it out */
+#define INDEX_TEST_NENT		512
+
+/* Write a text environment with some variables set twice or removed */
+static int make_text_env(char *buf, int size)
+{
+	char *p = buf;
+	int i;
+
+	for (i = 0; i < INDEX_TEST_VARS; i++)
+		p += sprintf(p, "var%d=value of variable %d", i, i) + 1;
+	p += sprintf(p, "escaped=a\\\\b\\c") + 1;
+	p += sprintf(p, "  # comment") + 1;
+	p += sprintf(p, "var5=changed") + 1;
+	p += sprintf(p, "var6=") + 1;
+	*p++ = '\0';
+	memset(p, '\0', buf + size - p);
+
+	return p - buf;
+}
+
+static int check_vars(struct unit_test_state *uts, struct hsearch_data *htab)
+{
+	char name[20], value[40];
+	ENTRY e, *ep;
+	int i;
+
+	for (i = 0; i < INDEX_TEST_VARS; i++) {
+		snprintf(name, sizeof(name), "var%d", i);
+		e.key = name;
+		e.data = NULL;
+		hsearch_r(e, FIND, &ep, htab, 0);
+		if (i == 6) {
+			ut_assertnull(ep);
+			continue;
+		}
+		ut_assertnonnull(ep);
+		if (i == 5)
+			strcpy(value, "changed");
+		else
+			snprintf(value, sizeof(value), "value of variable %d",
+				 i);
+		ut_asserteq_str(value, ep->data);
+	}
+	e.key = "escaped";
+	hsearch_r(e, FIND, &ep, htab, 0);
+	ut_assertnonnull(ep);
+	ut_asserteq_str("a\\bc", ep->data);
+	ut_asserteq(INDEX_TEST_VARS, htab->filled);
+
+	return 0;
+}
+
+/* Test importing an index, then changing and removing variables */
+static int env_test_index_import(struct unit_test_state *uts)
+{
+	struct hsearch_data htab = {};
+	char *text, *index;
+	ENTRY e, *ep;
+
+	text = malloc(INDEX_TEST_SIZE);
+	index = calloc(1, INDEX_TEST_SIZE);
+	ut_assertnonnull(text);
+	ut_assertnonnull(index);
+	make_text_env(text, INDEX_TEST_SIZE);
+	ut_assert(env_index_build(index, INDEX_TEST_SIZE, text,
+				  INDEX_TEST_SIZE, INDEX_TEST_NENT, false) > 0);
+	ut_assert(env_index_is_valid(index, INDEX_TEST_SIZE));
+	ut_assert(!env_index_is_valid(text, INDEX_TEST_SIZE));
+
+	ut_asserteq(1, himport_index_r(&htab, index, INDEX_TEST_SIZE, 0));
+	ut_assertnonnull(htab.pool);
+	ut_assertok(check_vars(uts, &htab));
+
+	/* Values from the index are replaced and removed as usual */
+	e.key = "var7";
+	e.data = "new value";
+	hsearch_r(e, ENTER, &ep, &htab, 0);
+	ut_assertnonnull(ep);
+	ut_asserteq_str("new value", ep->data);
+	ut_asserteq(1, hdelete_r("var8", &htab, 0));
+	e.key = "var8";
+	e.data = NULL;
+	hsearch_r(e, FIND, &ep, &htab, 0);
+	ut_assertnull(ep);
+	ut_asserteq(INDEX_TEST_VARS - 1, htab.filled);
+
+	/* Importing text over the top drops the strings of the index */
+	ut_asserteq(1, himport_r(&htab, text, INDEX_TEST_SIZE, '\0', 0, 0, 0,
+				 NULL));
+	ut_assertnull(htab.pool);
+	ut_assertok(check_vars(uts, &htab));
+
+	hdestroy_r(&htab);
+	free(index);
+	free(text);
+
+	return 0;
+}
+ENV_TEST(env_test_index_import, 0);
+
+/* Test the fallbacks when the index cannot be used directly */
+static int env_test_index_fallback(struct unit_test_state *uts)
+{
+	struct hsearch_data htab = {};
+	struct env_index_header hdr;
+	struct env_index_entry *ents;
+	char *text, *index;
+	ENTRY e, *ep;
+	uint idx;
+
+	text = malloc(INDEX_TEST_SIZE);
+	index = calloc(1, INDEX_TEST_SIZE);
+	ut_assertnonnull(text);
+	ut_assertnonnull(index);
+	make_text_env(text, INDEX_TEST_SIZE);
+
+	/* Made for a different table size, so entered one by one */
+	ut_assert(env_index_build(index, INDEX_TEST_SIZE, text,
+				  INDEX_TEST_SIZE, 300, false) > 0);
+	ut_asserteq(1, himport_index_r(&htab, index, INDEX_TEST_SIZE, 0));
+	ut_assertnull(htab.pool);
+	ut_assertok(check_vars(uts, &htab));
+
+	/* Added to a table which is not cleared */
+	ut_assert(env_index_build(index, INDEX_TEST_SIZE, "extra=1\0",
+				  INDEX_TEST_SIZE, INDEX_TEST_NENT, false) > 0);
+	ut_asserteq(1, himport_index_r(&htab, index, INDEX_TEST_SIZE,
+				       H_NOCLEAR));
+	ut_assertnull(htab.pool);
+	e.key = "extra";
+	e.data = NULL;
+	hsearch_r(e, FIND, &ep, &htab, 0);
+	ut_assertnonnull(ep);
+	ut_asserteq(INDEX_TEST_VARS + 1, htab.filled);
+
+	/* A bad index leaves the table alone */
+	memcpy(&hdr, index, sizeof(hdr));
+	hdr.pool_size = INDEX_TEST_SIZE;
+	memcpy(index, &hdr, sizeof(hdr));
+	ut_asserteq(0, himport_index_r(&htab, index, INDEX_TEST_SIZE, 0));
+	ut_asserteq(INDEX_TEST_VARS + 1, htab.filled);
+
+	/* Slots which do not match their keys are entered one by one */
+	ut_assert(env_index_build(index, INDEX_TEST_SIZE, text,
+				  INDEX_TEST_SIZE, INDEX_TEST_NENT, false) > 0);
+	ents = (struct env_index_entry *)(index + sizeof(hdr));
+	ents[0].hval++;
+	idx = ents[1].idx;
+	ents[1].idx = ents[2].idx;
+	ents[2].idx = idx;
+	ut_asserteq(1, himport_index_r(&htab, index, INDEX_TEST_SIZE, 0));
+	ut_assertnonnull(htab.pool);
+	ut_assertok(check_vars(uts, &htab));
+
+	/* Not enough room */
+	ut_asserteq(-ENOSPC, env_index_build(index, 64, text, INDEX_TEST_SIZE,
+					     INDEX_TEST_NENT, false));
+
+	hdestroy_r(&htab);
+	free(index);
+	free(text);
+
+	return 0;
+}
+ENV_TEST(env_test_index_fallback, 0);
+
+/* Compare the time taken to import the text and the index */
+static int env_test_index_speed(struct unit_test_state *uts)
+{
+	struct hsearch_data htab = {};
+	ulong start, text_us, index_us;
+	char *text, *index;
+	int round;
+
+	text = malloc(INDEX_TEST_SIZE);
+	index = calloc(1, INDEX_TEST_SIZE);
+	ut_assertnonnull(text);
+	ut_assertnonnull(index);
+	make_text_env(text, INDEX_TEST_SIZE);
+	ut_assert(env_index_build(index, INDEX_TEST_SIZE, text,
+				  INDEX_TEST_SIZE, INDEX_TEST_NENT, false) > 0);
+
+	for (start = timer_get_us(), round = 0; round < 20; round++)
+		ut_asserteq(1, himport_r(&htab, text, INDEX_TEST_SIZE, '\0', 0,
+					 0, 0, NULL));
+	text_us = timer_get_us() - start;
+	ut_assertok(check_vars(uts, &htab));
+
+	for (start = timer_get_us(), round = 0; round < 20; round++)
+		ut_asserteq(1, himport_index_r(&htab, index, INDEX_TEST_SIZE,
+					       0));
+	index_us = timer_get_us() - start;
+	ut_assertok(check_vars(uts, &htab));
+
+	printf("20 imports of %d variables: %lu us text, %lu us indexed\n",
+	       INDEX_TEST_VARS, text_us, index_us);
+	ut_assert(index_us < text_us);
+
+	hdestroy_r(&htab);
+	free(index);
+	free(text);
+
+	return 0;
+}
+ENV_TEST(env_test_index_speed, 0);
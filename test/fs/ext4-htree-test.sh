@@ -0,0 +1,106 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0+
+
+# This script tests ext4 path lookups through hashed directory (htree)
+# indexes and the lookup cache on sandbox host-file images.
+#
+# To execute the test, simply run it from the U-Boot source root directory:
+#
+#    cd u-boot
+#    ./test/fs/ext4-htree-test.sh
+#
+# An image is generated with a directory big enough for mkfs.ext4 to give it
+# a two-level hash index, next to a small unindexed one. Files at the start,
+# middle and end of the big directory are loaded and their CRC compared with
+# the one computed on the host; lookups of missing names must fail. The time
+# of the whole run is printed so that it can be compared with a build that
+# has CONFIG_EXT4_DIR_INDEX disabled. Each check prints PASS or FAILURE; the
+# last line summarises the run.
+#
+# All temporary files used by this script are created in ./sandbox to avoid
+# polluting the source tree, like the other tests in this directory.
+
+odir=sandbox
+src=${odir}/ext4-htree-src
+img=${odir}/ext4-htree.img
+out=${odir}/ext4-htree-test.out
+crcaddr=0
+loadaddr=1000
+nfiles=20000
+
+for prereq in mkfs.ext4 e2fsck debugfs crc32; do
+    if [ ! -x "`which $prereq`" ]; then
+        echo "Missing $prereq binary. Exiting!"
+        exit 1
+    fi
+done
+
+make O=${odir} -s sandbox_defconfig && make O=${odir} -s -j8
+
+# crc32 prints the CRC big-endian, U-Boot stores it little-endian in memory
+function le_crc() {
+    local crc=0x`crc32 $1`
+
+    printf %02x%02x%02x%02x \
+        $((${crc} & 0xff)) \
+        $(((${crc} >> 8) & 0xff)) \
+        $(((${crc} >> 16) & 0xff)) \
+        $((${crc} >> 24))
+}
+
+function check_load() {
+    local path=$1
+
+    echo "load host 0:0 ${loadaddr} ${path}"
+    echo "crc32 ${loadaddr} \$filesize ${crcaddr}"
+    echo "if itest.l *${crcaddr} != `le_crc ${src}${path}`; then" \
+        "echo FAILURE ${path}; else echo PASS ${path}; fi"
+}
+
+function check_missing() {
+    echo "if test -e host 0:0 $1; then echo FAILURE missing $1;" \
+        "else echo PASS missing $1; fi"
+}
+
+if [ ! -d ${src} ]; then
+    mkdir -p ${src}/big-dir ${src}/small-dir
+    for ((i = 0; i < ${nfiles}; i++)); do
+        echo "entry ${i}" > ${src}/big-dir/a-fairly-long-file-name-${i}
+    done
+    dd if=/dev/urandom of=${src}/big-dir/blob.bin bs=1K count=512 \
+        >/dev/null 2>&1
+    echo "small" > ${src}/small-dir/file
+fi
+
+rm -f ${img}
+mkfs.ext4 -q -b 1024 -d ${src} ${img} 256M
+# mkfs.ext4 -d does not index directories, e2fsck -D does
+e2fsck -fyD ${img} >/dev/null 2>&1
+if ! debugfs -R "htree /big-dir" ${img} 2>/dev/null | grep -q "Indirect levels: 1"; then
+    echo "big-dir does not have a two-level index, check e2fsck"
+fi
+
+(
+echo "host bind 0 ${img}"
+check_load /big-dir/a-fairly-long-file-name-0
+check_load /big-dir/a-fairly-long-file-name-$((nfiles / 2))
+check_load /big-dir/a-fairly-long-file-name-$((nfiles - 1))
+check_load /big-dir/blob.bin
+check_load /small-dir/file
+check_load /small-dir/../big-dir/./a-fairly-long-file-name-1234
+# Twice, the second lookup is served from the cache
+check_load /big-dir/a-fairly-long-file-name-4321
+check_load /big-dir/a-fairly-long-file-name-4321
+check_missing /big-dir/a-fairly-long-file-name-${nfiles}
+check_missing /big-dir/nonexistent
+check_missing /small-dir/nonexistent
+echo "reset"
+) > ${odir}/ext4-htree-test.cmd
+
+time ./${odir}/u-boot < ${odir}/ext4-htree-test.cmd > ${out} 2>&1
+
+pass=`grep -c "^PASS" ${out}`
+fail=`grep -c "^FAILURE" ${out}`
+grep "FAILURE" ${out}
+echo "Total Summary: TOTAL PASS: ${pass} TOTAL FAIL: ${fail}"
+[ ${fail} -eq 0 ]
@@ -0,0 +1,115 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0+
+
+# This script tests the ext4 write path on sandbox host-file images and
+# reports its throughput.
+#
+# To execute the test, simply run it from the U-Boot source root directory:
+#
+#    cd u-boot
+#    ./test/fs/ext4-write-test.sh
+#
+# A large file is written with ext4write (timed with the "time" command)
+# to a fresh filesystem, overwritten, and then written again to a
+# filesystem with small uninitialised block groups and to one whose free
+# space is badly fragmented. Each file is read back
+# and its CRC compared with the one computed on the host, and e2fsck must
+# find every image clean afterwards. debugfs is used to check that the
+# file on the fresh filesystem was laid out as a few large extents. Each
+# check prints PASS or FAILURE; the last line summarises the run.
+#
+# All temporary files used by this script are created in ./sandbox to avoid
+# polluting the source tree, like the other tests in this directory.
+
+odir=sandbox
+img=${odir}/ext4-write.img
+data=${odir}/ext4-write.bin
+out=${odir}/ext4-write-test.out
+crcaddr=0
+loadaddr=1000
+readaddr=3000000
+# Sandbox has 128MiB of RAM by default
+size=$((32 * 1024 * 1024))
+
+for prereq in mkfs.ext4 e2fsck debugfs crc32; do
+    if [ ! -x "`which $prereq`" ]; then
+        echo "Missing $prereq binary. Exiting!"
+        exit 1
+    fi
+done
+
+make O=${odir} -s sandbox_defconfig && make O=${odir} -s -j8
+
+# crc32 prints the CRC big-endian, U-Boot stores it little-endian in memory
+function le_crc() {
+    local crc=0x`crc32 $1`
+
+    printf %02x%02x%02x%02x \
+        $((${crc} & 0xff)) \
+        $(((${crc} >> 8) & 0xff)) \
+        $(((${crc} >> 16) & 0xff)) \
+        $((${crc} >> 24))
+}
+
+# 1st parameter is the image, 2nd the name of the test
+function write_and_check() {
+    (
+    echo "host bind 0 $1"
+    echo "load hostfs - ${loadaddr} ${data}"
+    echo "time ext4write host 0:0 ${loadaddr} /dump.bin `printf %x ${size}`"
+    echo "time ext4write host 0:0 ${loadaddr} /dump.bin `printf %x ${size}`"
+    echo "load host 0:0 ${readaddr} /dump.bin"
+    echo "crc32 ${readaddr} \$filesize ${crcaddr}"
+    echo "if itest.l *${crcaddr} != `le_crc ${data}`; then" \
+        "echo FAILURE $2 readback; else echo PASS $2 readback; fi"
+    echo "reset"
+    ) | ./${odir}/u-boot >> ${out} 2>&1
+
+    if e2fsck -fn $1 >> ${out} 2>&1; then
+        echo "PASS $2 e2fsck" >> ${out}
+    else
+        echo "FAILURE $2 e2fsck" >> ${out}
+    fi
+}
+
+dd if=/dev/urandom of=${data} bs=1M count=$((size >> 20)) >/dev/null 2>&1
+rm -f ${out}
+
+# A fresh filesystem, the file should land in a handful of extents
+rm -f ${img}
+mkfs.ext4 -q -O ^metadata_csum ${img} 256M
+write_and_check ${img} fresh
+extents=`debugfs -R "ex /dump.bin" ${img} 2>/dev/null | grep -c "^ *0/"`
+if [ ${extents} -ge 1 -a ${extents} -le 4 ]; then
+    echo "PASS fresh extents" >> ${out}
+else
+    echo "FAILURE fresh extents (${extents})" >> ${out}
+fi
+
+# 8MiB groups whose bitmaps are not initialised yet, so the file spans
+# several of them and each has its metadata marked before it is used
+rm -f ${img}
+mkfs.ext4 -q -O ^metadata_csum,uninit_bg -b 1024 ${img} 64M
+write_and_check ${img} multigroup
+
+# Free space in three block holes, too many for an inode extent tree
+rm -f ${img}
+mkfs.ext4 -q -O ^metadata_csum -b 1024 -N 16384 ${img} 64M
+dd if=/dev/urandom of=${odir}/ext4-write-small bs=3K count=1 >/dev/null 2>&1
+(
+echo "mkdir /junk"
+for ((i = 0; i < 10000; i++)); do
+    echo "write ${odir}/ext4-write-small /junk/f${i}"
+done
+for ((i = 0; i < 10000; i += 2)); do
+    echo "rm /junk/f${i}"
+done
+) | debugfs -w ${img} >/dev/null 2>&1
+write_and_check ${img} fragmented
+
+grep "^time:\|seconds" ${out}
+pass=`grep -c "^PASS" ${out}`
+fail=`grep -c "^FAILURE" ${out}`
+grep "FAILURE" ${out}
+echo "Total Summary: TOTAL PASS: ${pass} TOTAL FAIL: ${fail}"
+[ ${fail} -eq 0 ]
@@ -0,0 +1,146 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0+
+
+# This script tests U-Boot's SquashFS support through the generic fs
+# commands (ls, size, load, test -e) on sandbox host-file images.
+#
+# To execute the test, simply run it from the U-Boot source root directory:
+#
+#    cd u-boot
+#    ./test/fs/squashfs-test.sh
+#
+# A source tree is generated with small files (packed into fragments),
+# multi-block files (read with one request per readahead window), a sparse
+# file, a large directory (extended directory index), nested directories
+# and symbolic links. One image is built per compressor supported by both
+# mksquashfs and U-Boot, and the CRC of every loaded file is compared with
+# the one computed on the host. Each check prints PASS or FAILURE; the last
+# line summarises the run.
+#
+# All temporary files used by this script are created in ./sandbox to avoid
+# polluting the source tree, like the other tests in this directory.
+
+odir=sandbox
+src=${odir}/squashfs-src
+img=${odir}/squashfs
+crcaddr=0
+loadaddr=1000
+comps="gzip lzma lzo lz4"
+
+for prereq in mksquashfs dd crc32; do
+    if [ ! -x "`which $prereq`" ]; then
+        echo "Missing $prereq binary. Exiting!"
+        exit 1
+    fi
+done
+
+make O=${odir} -s sandbox_defconfig && make O=${odir} -s -j8
+
+# crc32 prints the CRC big-endian, U-Boot stores it little-endian in memory
+function le_crc() {
+    local crc=0x`crc32 $1`
+
+    printf %02x%02x%02x%02x \
+        $((${crc} & 0xff)) \
+        $(((${crc} >> 8) & 0xff)) \
+        $(((${crc} >> 16) & 0xff)) \
+        $((${crc} >> 24))
+}
+
+# 1st parameter is the path of the file in the image, 2nd the host copy,
+# optional 3rd and 4th the length and offset to load
+function check_load() {
+    local path=$1
+    local host=$2
+    local crc
+
+    if [ -n "$3" ]; then
+        dd if=${host} of=${odir}/squashfs-part bs=1 skip=$4 count=$3 \
+            >/dev/null 2>&1
+        crc=`le_crc ${odir}/squashfs-part`
+        echo "load host 0:0 ${loadaddr} ${path} $3 $4"
+    else
+        crc=`le_crc ${host}`
+        echo "load host 0:0 ${loadaddr} ${path}"
+    fi
+    echo "crc32 ${loadaddr} \$filesize ${crcaddr}"
+    echo "if itest.l *${crcaddr} != ${crc}; then echo FAILURE ${path};" \
+        "else echo PASS ${path}; fi"
+}
+
+function check_size() {
+    local path=$1
+    local size=`stat -c %s $2`
+
+    echo "size host 0:0 ${path}"
+    echo "if itest \$filesize != `printf %x ${size}`; then" \
+        "echo FAILURE size ${path}; else echo PASS size ${path}; fi"
+}
+
+if [ ! -d ${src} ]; then
+    mkdir -p ${src}/dir/subdir ${src}/big-dir
+    echo "hello squashfs" > ${src}/small.txt
+    dd if=/dev/urandom of=${src}/dir/frag.bin bs=1000 count=3 \
+        >/dev/null 2>&1
+    # Multi-block files, one with a tail in a fragment
+    dd if=/dev/urandom of=${src}/dir/subdir/blocks.bin bs=128K count=40 \
+        >/dev/null 2>&1
+    dd if=/dev/urandom of=${src}/dir/tail.bin bs=4097 count=300 \
+        >/dev/null 2>&1
+    # Half random, half zero: the zero blocks are stored sparse
+    dd if=/dev/urandom of=${src}/sparse.bin bs=128K count=4 \
+        >/dev/null 2>&1
+    dd if=/dev/zero of=${src}/sparse.bin bs=128K count=4 seek=4 \
+        >/dev/null 2>&1
+    for ((i = 0; i < 2000; i++)); do
+        echo "entry ${i}" > ${src}/big-dir/file-${i}
+    done
+    ln -s dir/subdir/blocks.bin ${src}/link-abs
+    ln -s ../tail.bin ${src}/dir/subdir/link-rel
+fi
+
+total_pass=0
+total_fail=0
+for comp in ${comps}; do
+    rm -f ${img}-${comp}.img
+    if ! mksquashfs ${src} ${img}-${comp}.img -comp ${comp} -noappend \
+        -no-xattrs >/dev/null 2>&1; then
+        echo "mksquashfs does not support ${comp}, skipping"
+        continue
+    fi
+
+    (
+    echo "host bind 0 ${img}-${comp}.img"
+    echo "ls host 0:0 /dir"
+    echo "if test -e host 0:0 /big-dir/file-1999; then echo PASS exists;" \
+        "else echo FAILURE exists; fi"
+    echo "if test -e host 0:0 /nonexistent; then echo FAILURE missing;" \
+        "else echo PASS missing; fi"
+    check_size /dir/tail.bin ${src}/dir/tail.bin
+    check_size /link-abs ${src}/dir/subdir/blocks.bin
+    check_load /small.txt ${src}/small.txt
+    check_load /dir/frag.bin ${src}/dir/frag.bin
+    check_load /dir/subdir/blocks.bin ${src}/dir/subdir/blocks.bin
+    check_load /dir/tail.bin ${src}/dir/tail.bin
+    check_load /sparse.bin ${src}/sparse.bin
+    check_load /big-dir/file-1234 ${src}/big-dir/file-1234
+    check_load /link-abs ${src}/dir/subdir/blocks.bin
+    check_load /dir/subdir/link-rel ${src}/dir/tail.bin
+    check_load /dir/./subdir/../tail.bin ${src}/dir/tail.bin
+    # Partial reads starting and ending inside blocks and fragments
+    check_load /dir/subdir/blocks.bin ${src}/dir/subdir/blocks.bin \
+        300000 70000
+    check_load /dir/tail.bin ${src}/dir/tail.bin 5000 1225000
+    echo "reset"
+    ) | ./${odir}/u-boot > ${odir}/squashfs-test-${comp}.out 2>&1
+
+    pass=`grep -c "^PASS" ${odir}/squashfs-test-${comp}.out`
+    fail=`grep -c "^FAILURE" ${odir}/squashfs-test-${comp}.out`
+    grep "FAILURE" ${odir}/squashfs-test-${comp}.out
+    echo "${comp}: PASS: ${pass} FAIL: ${fail}"
+    total_pass=$((total_pass + pass))
+    total_fail=$((total_fail + fail))
+done
+
+echo "Total Summary: TOTAL PASS: ${total_pass} TOTAL FAIL: ${total_fail}"
+[ ${total_fail} -eq 0 ]
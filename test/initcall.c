@@ -0,0 +1,185 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for starting initcalls early
+ */
+
+#include <common.h>
+#include <command.h>
+#include <initcall.h>
+#include <test/suites.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define INITCALL_TEST(_name, _flags) UNIT_TEST(_name, _flags, initcall_test)
+
+/* How long the pretend hardware takes, and each other initcall */
+#define HW_DELAY_US	30000
+#define STEP_DELAY_US	10000
+
+static char order[40];
+static ulong hw_ready_us;
+static int start_ret;
+
+static void note(char ch)
+{
+	int len = strlen(order);
+
+	order[len] = ch;
+	order[len + 1] = '\0';
+}
+
+static int step_a(void)
+{
+	note('a');
+	return 0;
+}
+
+static int step_b(void)
+{
+	note('b');
+	udelay(STEP_DELAY_US);
+	return 0;
+}
+
+static int step_c(void)
+{
+	note('c');
+	udelay(STEP_DELAY_US);
+	return 0;
+}
+
+/* Fails unless the hardware has finished */
+static int step_d(void)
+{
+	note('d');
+	return hw_ready_us && timer_get_us() >= hw_ready_us ? 0 : -EIO;
+}
+
+static int hw_start(void)
+{
+	note('S');
+	hw_ready_us = timer_get_us() + HW_DELAY_US;
+	return start_ret;
+}
+
+static int hw_join(void)
+{
+	note('J');
+	while (timer_get_us() < hw_ready_us)
+		;
+	return 0;
+}
+
+/* The whole job in one, as it would be without an async initcall */
+static int hw_init(void)
+{
+	int ret;
+
+	ret = hw_start();
+	if (!ret)
+		ret = hw_join();
+
+	return ret;
+}
+
+static int step_unused(void)
+{
+	return 0;
+}
+
+static const init_fnc_t sequence[] = {
+	step_a,
+	step_b,
+	step_c,
+	hw_init,
+	step_d,
+	NULL,
+};
+
+static void reset(void)
+{
+	order[0] = '\0';
+	hw_ready_us = 0;
+	start_ret = 0;
+}
+
+/* Test that the work is started early, finished in place and overlapped */
+static int initcall_test_async(struct unit_test_state *uts)
+{
+	struct initcall_async async[] = {
+		INITCALL_ASYNC(hw_init, hw_start, hw_join, step_a),
+	};
+	ulong start, serial_us, async_us;
+
+	reset();
+	start = timer_get_us();
+	ut_assertok(initcall_run_list(sequence));
+	serial_us = timer_get_us() - start;
+	ut_asserteq_str("abcSJd", order);
+
+	reset();
+	start = timer_get_us();
+	ut_assertok(initcall_run_list_async(sequence, async,
+					    ARRAY_SIZE(async)));
+	async_us = timer_get_us() - start;
+	ut_asserteq_str("aSbcJd", order);
+	ut_asserteq(INITCALL_ASYNC_DONE, async[0].state);
+	ut_assert(async[0].start_us <= async[0].started_us);
+	ut_assert(async[0].started_us <= async[0].join_us);
+	ut_assert(async[0].join_us <= async[0].done_us);
+	ut_assert(async[0].join_us - async[0].started_us >= 2 * STEP_DELAY_US);
+
+	initcall_async_report(async, ARRAY_SIZE(async));
+	printf("Sequence took %lu us in order, %lu us with async\n",
+	       serial_us, async_us);
+	ut_assert(async_us + STEP_DELAY_US < serial_us);
+
+	return 0;
+}
+INITCALL_TEST(initcall_test_async, 0);
+
+/* Test entries whose constraints cannot be met */
+static int initcall_test_async_order(struct unit_test_state *uts)
+{
+	struct initcall_async async[] = {
+		INITCALL_ASYNC(hw_init, hw_start, hw_join, step_d),
+		INITCALL_ASYNC(step_unused, step_unused, step_unused, step_a),
+	};
+
+	reset();
+	ut_assertok(initcall_run_list_async(sequence, async,
+					    ARRAY_SIZE(async)));
+	ut_asserteq_str("abcSJd", order);
+	ut_asserteq(INITCALL_ASYNC_IN_ORDER, async[0].state);
+	ut_asserteq(INITCALL_ASYNC_UNUSED, async[1].state);
+
+	return 0;
+}
+INITCALL_TEST(initcall_test_async_order, 0);
+
+/* Test that a failure to start stops the sequence */
+static int initcall_test_async_fail(struct unit_test_state *uts)
+{
+	struct initcall_async async[] = {
+		INITCALL_ASYNC(hw_init, hw_start, hw_join, step_a),
+	};
+
+	reset();
+	start_ret = -ETIMEDOUT;
+	ut_asserteq(-1, initcall_run_list_async(sequence, async,
+						ARRAY_SIZE(async)));
+	ut_asserteq_str("aS", order);
+	ut_asserteq(INITCALL_ASYNC_WAITING, async[0].state);
+
+	return 0;
+}
+INITCALL_TEST(initcall_test_async_fail, 0);
+
+int do_ut_initcall(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	struct unit_test *tests = ll_entry_start(struct unit_test,
+						 initcall_test);
+	const int n_ents = ll_entry_count(struct unit_test, initcall_test);
+
+	return cmd_ut_category("initcall", tests, n_ents, argc, argv);
+}
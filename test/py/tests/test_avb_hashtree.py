@@ -0,0 +1,133 @@
+# SPDX-License-Identifier: GPL-2.0+
+
+# Test the avb_hashtree command, which checks a partition against the
+# dm-verity hash tree described by the AVB footer at its end.
+
+import hashlib
+import os
+import pytest
+import re
+import struct
+import u_boot_utils as util
+
+"""
+These tests rely on a 16 MB disk image with a 12 MB 'system' partition, which
+is automatically created by the test. The partition holds random data, its
+hash tree and a vbmeta image laid out as avbtool add_hashtree_footer does.
+"""
+
+PART_START = 2048
+PART_BLOCKS = 24576
+BLOCK_SIZE = 4096
+IMAGE_SIZE = 10 * 1024 * 1024 + 1000
+
+def pad(data, size):
+    return data + b'\0' * (-len(data) % size)
+
+def hash_level(salt, data):
+    return b''.join(hashlib.sha256(salt + data[i:i + BLOCK_SIZE]).digest()
+                    for i in range(0, len(data), BLOCK_SIZE))
+
+def make_tree(salt, data):
+    """Return the root digest and the levels of the tree, top first."""
+    levels = []
+    level = pad(data, BLOCK_SIZE)
+    while len(level) > BLOCK_SIZE:
+        level = pad(hash_level(salt, level), BLOCK_SIZE)
+        levels.insert(0, level)
+    return hashlib.sha256(salt + level).digest(), b''.join(levels)
+
+def make_vbmeta(salt, root, tree_offset, tree_size):
+    name = b'system'
+    desc = struct.pack('!LQQQLLLQQ32sLLLL60s', 1, IMAGE_SIZE, tree_offset,
+                       tree_size, BLOCK_SIZE, BLOCK_SIZE, 0, 0, 0, b'sha256',
+                       len(name), len(salt), len(root), 0, b'')
+    desc = pad(desc + name + salt + root, 8)
+    desc = struct.pack('!QQ', 1, len(desc)) + desc
+    aux = pad(desc, 64)
+    header = struct.pack('!4s2L2QL11QL4s48s80s', b'AVB0', 1, 0, 0, len(aux),
+                         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, len(desc), 0, 0, b'',
+                         b'u-boot test', b'')
+    assert len(header) == 256
+    return header + aux
+
+def make_footer(vbmeta_offset, vbmeta_size):
+    return struct.pack('!4s2L3Q28s', b'AVBf', 1, 0, IMAGE_SIZE,
+                       vbmeta_offset, vbmeta_size, b'')
+
+def make_disk(cons):
+    """Create the disk and return its path and where the tree is."""
+    path = cons.config.result_dir + '/avb_hashtree_disk.bin'
+    with open(path, 'wb') as fd:
+        fd.truncate(16 << 20)
+    util.run_and_log(cons, ['sgdisk', '--new=1:%d:%d' %
+                            (PART_START, PART_START + PART_BLOCKS - 1),
+                            '-c 1:system', path])
+
+    data = os.urandom(IMAGE_SIZE)
+    salt = os.urandom(32)
+    root, tree = make_tree(salt, data)
+    tree_offset = (IMAGE_SIZE + BLOCK_SIZE - 1) // BLOCK_SIZE * BLOCK_SIZE
+    vbmeta = make_vbmeta(salt, root, tree_offset, len(tree))
+    vbmeta_offset = tree_offset + len(tree)
+    with open(path, 'r+b') as fd:
+        part = PART_START * 512
+        fd.seek(part)
+        fd.write(data)
+        fd.seek(part + tree_offset)
+        fd.write(tree)
+        fd.seek(part + vbmeta_offset)
+        fd.write(vbmeta)
+        fd.seek(part + PART_BLOCKS * 512 - 64)
+        fd.write(make_footer(vbmeta_offset, len(vbmeta)))
+    return path, tree_offset, len(tree)
+
+def corrupt(path, offset):
+    with open(path, 'r+b') as fd:
+        fd.seek(PART_START * 512 + offset)
+        byte = fd.read(1)
+        fd.seek(PART_START * 512 + offset)
+        fd.write(bytes([byte[0] ^ 0xff]))
+
+def check(cons, disk):
+    cons.run_command('host bind 0 ' + disk)
+    return cons.run_command('avb_hashtree host 0 system')
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_avb_hashtree')
+@pytest.mark.requiredtool('sgdisk')
+def test_avb_hashtree(u_boot_console):
+    """Test checking a good partition."""
+
+    cons = u_boot_console
+    disk, tree_offset, tree_size = make_disk(cons)
+    output = check(cons, disk)
+    m = re.search(r'system: (\d+) bytes, (\d+) levels, (\d+) ms, '
+                  r'(\d+) MB/s', output)
+    assert m, output
+    assert int(m.group(1)) == IMAGE_SIZE + tree_size
+    assert int(m.group(2)) == 2
+    cons.log.info('%s MB/s' % m.group(4))
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_avb_hashtree')
+@pytest.mark.requiredtool('sgdisk')
+def test_avb_hashtree_bad(u_boot_console):
+    """Test that corrupted data and tree blocks are found."""
+
+    cons = u_boot_console
+    disk, tree_offset, _ = make_disk(cons)
+    corrupt(disk, 1234 * BLOCK_SIZE + 5)
+    output = check(cons, disk)
+    assert 'Data block 1234 does not match the hash tree' in output
+
+    # The top level is a single block; corrupt the lowest one instead
+    disk, tree_offset, _ = make_disk(cons)
+    corrupt(disk, tree_offset + BLOCK_SIZE + 100)
+    output = check(cons, disk)
+    assert 'Hash tree level 0 block 0 does not match' in output
+
+    disk, tree_offset, _ = make_disk(cons)
+    corrupt(disk, PART_BLOCKS * 512 - 64)
+    output = check(cons, disk)
+    assert 'No hash tree in the AVB footer' in output
@@ -0,0 +1,123 @@
+# SPDX-License-Identifier: GPL-2.0+
+
+# Test the bootimg command, which loads a boot image from a partition
+# reading only the bytes its header accounts for.
+
+import os
+import pytest
+import re
+import zlib
+import u_boot_utils as util
+
+"""
+These tests rely on a 16 MB disk image with a 10 MB 'boot' partition, which
+is automatically created by the test. Each test writes an image to the start
+of the partition and checks how much of the partition bootimg read.
+"""
+
+PART_START = 2048
+PART_BLOCKS = 20480
+LOAD_ADDR = 0x1000000
+KERNEL_LOAD = 0x2000000
+
+def make_disk(cons):
+    path = cons.config.result_dir + '/bootimg_disk.bin'
+    with open(path, 'wb') as fd:
+        fd.truncate(16 << 20)
+    util.run_and_log(cons, ['sgdisk', '--new=1:%d:%d' %
+                            (PART_START, PART_START + PART_BLOCKS - 1),
+                            '-c 1:boot', path])
+    return path
+
+def make_kernel(cons, size):
+    path = cons.config.result_dir + '/bootimg_kernel.bin'
+    with open(path, 'wb') as fd:
+        fd.write(os.urandom(size))
+    return path
+
+def write_image(disk, image):
+    with open(image, 'rb') as fd:
+        data = fd.read()
+    with open(disk, 'r+b') as fd:
+        fd.seek(PART_START * 512)
+        fd.write(data)
+    return data
+
+def load(cons, disk, args):
+    """Run bootimg load and return the number of bytes it read."""
+    cons.run_command('host bind 0 ' + disk)
+    output = cons.run_command('bootimg load ' + args)
+    m = re.search(r'(\d+) bytes read of (\d+) byte partition', output)
+    assert m, output
+    assert int(m.group(2)) == PART_BLOCKS * 512
+    return int(m.group(1))
+
+def check_crc(cons, addr, data):
+    output = cons.run_command('crc32 %x %x' % (addr, len(data)))
+    assert output.endswith('%08x' % (zlib.crc32(data) & 0xffffffff))
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_bootimg')
+@pytest.mark.requiredtool('sgdisk')
+def test_bootimg_legacy(u_boot_console):
+    """Test loading a legacy image by partition name and in place."""
+
+    cons = u_boot_console
+    mkimage = cons.config.build_dir + '/tools/mkimage'
+    disk = make_disk(cons)
+    kernel = make_kernel(cons, 300000)
+    image = cons.config.result_dir + '/bootimg_legacy.img'
+    util.run_and_log(cons, [mkimage, '-A', 'sandbox', '-O', 'linux',
+                            '-T', 'kernel', '-C', 'none',
+                            '-a', '%x' % KERNEL_LOAD, '-e', '%x' % KERNEL_LOAD,
+                            '-d', kernel, image])
+    data = write_image(disk, image)
+
+    read = load(cons, disk, 'host 0 boot %x' % LOAD_ADDR)
+    assert read == (len(data) + 511) // 512 * 512
+    assert read < PART_BLOCKS * 512 // 10
+    check_crc(cons, LOAD_ADDR, data)
+    assert cons.run_command('echo $filesize') == '%x' % len(data)
+
+    # By partition number, with the kernel data at its load address
+    load(cons, disk, '-x host 0 1')
+    assert cons.run_command('echo $fileaddr') == '%x' % (KERNEL_LOAD - 64)
+    check_crc(cons, KERNEL_LOAD - 64, data)
+    output = cons.run_command('iminfo %x' % (KERNEL_LOAD - 64))
+    assert 'Verifying Checksum ... OK' in output
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_bootimg')
+@pytest.mark.buildconfigspec('fit')
+@pytest.mark.requiredtool('sgdisk')
+def test_bootimg_fit_external(u_boot_console):
+    """Test loading a FIT whose image data follows the FDT."""
+
+    cons = u_boot_console
+    mkimage = cons.config.build_dir + '/tools/mkimage'
+    disk = make_disk(cons)
+    kernel = make_kernel(cons, 1000000)
+    image = cons.config.result_dir + '/bootimg_fit.img'
+    util.run_and_log(cons, [mkimage, '-f', 'auto', '-E', '-A', 'sandbox',
+                            '-O', 'linux', '-T', 'kernel', '-C', 'none',
+                            '-a', '%x' % KERNEL_LOAD, '-e', '%x' % KERNEL_LOAD,
+                            '-d', kernel, image])
+    data = write_image(disk, image)
+
+    read = load(cons, disk, 'host 0 boot %x' % LOAD_ADDR)
+    assert read == (len(data) + 511) // 512 * 512
+    check_crc(cons, LOAD_ADDR, data)
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_bootimg')
+@pytest.mark.requiredtool('sgdisk')
+def test_bootimg_bad(u_boot_console):
+    """Test that an unknown image or missing partition is rejected."""
+
+    cons = u_boot_console
+    disk = make_disk(cons)
+    cons.run_command('host bind 0 ' + disk)
+    output = cons.run_command('bootimg load host 0 boot %x' % LOAD_ADDR)
+    assert 'Unknown image format' in output
+    output = cons.run_command('bootimg load host 0 nosuchpart %x' % LOAD_ADDR)
+    assert 'Cannot find partition' in output
@@ -0,0 +1,44 @@
+# SPDX-License-Identifier: GPL-2.0+
+
+# Cross-check the hash command against Python's hashlib and zlib, at
+# unaligned addresses and lengths around the block and word sizes that the
+# SHA and CRC32 implementations handle separately.
+
+import hashlib
+import os
+import pytest
+import zlib
+
+LOAD_ADDR = 0x1000000
+SIZES = [0, 1, 7, 8, 9, 55, 56, 63, 64, 65, 127, 1000, 4096, 65537, 300001]
+
+def expected(algo, data):
+    if algo == 'crc32':
+        return '%08x' % (zlib.crc32(data) & 0xffffffff)
+    return hashlib.new(algo, data).hexdigest()
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_hash')
+def test_hash(u_boot_console):
+    """Test sha1, sha256 and crc32 over a range of offsets and sizes."""
+
+    cons = u_boot_console
+    path = cons.config.result_dir + '/hash_data.bin'
+    data = os.urandom(max(SIZES) + 8)
+    with open(path, 'wb') as fd:
+        fd.write(data)
+    cons.run_command('sb load hostfs 0 %x %s' % (LOAD_ADDR, path))
+
+    algos = ['crc32']
+    if cons.config.buildconfig.get('config_sha1', 'n') == 'y':
+        algos.append('sha1')
+    if cons.config.buildconfig.get('config_sha256', 'n') == 'y':
+        algos.append('sha256')
+    for algo in algos:
+        for size in SIZES:
+            for offset in (0, 1, 3, 4):
+                output = cons.run_command('hash %s %x %x' %
+                                          (algo, LOAD_ADDR + offset, size))
+                want = expected(algo, data[offset:offset + size])
+                assert output.endswith('==> ' + want), \
+                    '%s at +%d, %d bytes: %s' % (algo, offset, size, output)
@@ -159,3 +159,16 @@ def test_hush_if_test_host_file_exists(u_boot_console):
 
     expr = 'test -e hostfs - ' + test_file
     exec_hush_if(u_boot_console, expr, False)
+
+@pytest.mark.buildconfigspec('cmd_echo')
+def test_hush_if_test_run_again(u_boot_console):
+    """Test that a script run again sees the variables as they are now."""
+
+    u_boot_console.run_command('setenv ut_script \'if test "${ut_var}" = ' +
+        'yes; then echo true; else echo false; fi\'')
+    for value, result in (('yes', 'true'), ('no', 'false'), ('yes', 'true')):
+        u_boot_console.run_command('setenv ut_var ' + value)
+        response = u_boot_console.run_command('run ut_script')
+        assert response.strip() == result
+    u_boot_console.run_command('setenv ut_script')
+    u_boot_console.run_command('setenv ut_var')
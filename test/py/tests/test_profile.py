@@ -0,0 +1,36 @@
+# SPDX-License-Identifier: GPL-2.0
+
+import pytest
+import u_boot_utils
+
+@pytest.mark.buildconfigspec('cmd_profile')
+@pytest.mark.buildconfigspec('cmd_crc32')
+def test_profile(u_boot_console):
+    """Test that the profiler samples a busy command and names the function
+    it spends its time in."""
+
+    cons = u_boot_console
+    ram_base = u_boot_utils.find_ram_base(cons)
+    cons.run_command('profile reset')
+    cons.run_command('profile start 1000')
+    for i in range(4):
+        cons.run_command('crc32 %x 4000000' % ram_base)
+    response = cons.run_command('profile stop')
+    assert('Stopped' in response)
+    assert(not ' 0 samples' in response)
+
+    # Each line is the functions separated by ';', then the count
+    response = cons.run_command('profile show')
+    lines = response.splitlines()
+    assert(lines)
+    for line in lines:
+        stack, count = line.rsplit(' ', 1)
+        assert(int(count) > 0)
+    assert('crc32' in response)
+
+    response = cons.run_command('profile top 5')
+    assert('crc32' in response)
+
+    cons.run_command('profile reset')
+    response = cons.run_command('profile stats')
+    assert('0 samples in 0 stacks' in response)
@@ -21,12 +21,14 @@ For configuration verification:
 - Corrupt the signature
 - Check that image verification no-longer works
 
-Tests run with both SHA1 and SHA256 hashing.
+Tests run with both SHA1 and SHA256 hashing, then again with SHA256 and an
+ECDSA P-256 key in place of RSA.
 """
 
 import pytest
 import sys
 import struct
+import time
 import u_boot_utils as util
 
 @pytest.mark.boardspec('sandbox')
@@ -81,6 +83,26 @@ def test_vboot(u_boot_console):
         if boots:
             assert('sandbox: continuing, as we cannot run' in ''.join(output))
 
+    def time_verify(sha_algo, count):
+        """Time checking the signatures in the FIT a number of times.
+
+        The first check prepares the public key; later ones reuse it.
+
+        Args:
+            sha_algo: Either 'sha1' or 'sha256', to select the algorithm to
+                    use.
+            count: Number of times to check the signatures
+        """
+        cons.restart_uboot()
+        cons.run_command('sb load hostfs - 100 %stest.fit' % tmpdir)
+        tstart = time.time()
+        for i in range(count):
+            output = cons.run_command('iminfo 100')
+            assert 'dev+' in output
+        verify_time = time.time() - tstart
+        cons.log.info('%s: %d signature checks: %.3fs' %
+                      (sha_algo, count, verify_time))
+
     def make_fit(its):
         """Make a new FIT from the .its source file.
 
@@ -126,7 +148,7 @@ def test_vboot(u_boot_console):
             handle.write(struct.pack(">I", size))
         return struct.unpack(">I", total_size)[0]
 
-    def test_with_algo(sha_algo):
+    def test_with_algo(sha_algo, key_algo='rsa'):
         """Test verified boot with the given hash algorithm.
 
         This is the main part of the test code. The same procedure is followed
@@ -135,7 +157,11 @@ def test_vboot(u_boot_console):
         Args:
             sha_algo: Either 'sha1' or 'sha256', to select the algorithm to
                     use.
+            key_algo: Either 'rsa' or 'ecdsa', to select the key type. The
+                    .its files for ECDSA have an '-ecdsa' suffix.
         """
+        its_algo = sha_algo if key_algo == 'rsa' else '%s-%s' % (sha_algo,
+                                                                key_algo)
         # Compile our device tree files for kernel and U-Boot. These are
         # regenerated here since mkimage will modify them (by adding a
         # public key) below.
@@ -144,18 +170,19 @@ def test_vboot(u_boot_console):
 
         # Build the FIT, but don't sign anything yet
         cons.log.action('%s: Test FIT with signed images' % sha_algo)
-        make_fit('sign-images-%s.its' % sha_algo)
+        make_fit('sign-images-%s.its' % its_algo)
         run_bootm(sha_algo, 'unsigned images', 'dev-', True)
 
         # Sign images with our dev keys
         sign_fit(sha_algo)
         run_bootm(sha_algo, 'signed images', 'dev+', True)
+        time_verify(its_algo, 20)
 
         # Create a fresh .dtb without the public keys
         dtc('sandbox-u-boot.dts')
 
         cons.log.action('%s: Test FIT with signed configuration' % sha_algo)
-        make_fit('sign-configs-%s.its' % sha_algo)
+        make_fit('sign-configs-%s.its' % its_algo)
         run_bootm(sha_algo, 'unsigned config', '%s+ OK' % sha_algo, True)
 
         # Sign images with our dev keys
@@ -217,6 +244,10 @@ def test_vboot(u_boot_console):
     util.run_and_log(cons, 'openssl req -batch -new -x509 -key %sdev.key -out '
                      '%sdev.crt' % (tmpdir, tmpdir))
 
+    # Create a P-256 key pair, for the ECDSA tests
+    util.run_and_log(cons, 'openssl ecparam -name prime256v1 -genkey -noout '
+                     '-out %sdev.pem' % tmpdir)
+
     # Create a number kernel image with zeroes
     with open('%stest-kernel.bin' % tmpdir, 'w') as fd:
         fd.write(5000 * chr(0))
@@ -228,6 +259,7 @@ def test_vboot(u_boot_console):
         cons.config.dtb = dtb
         test_with_algo('sha1')
         test_with_algo('sha256')
+        test_with_algo('sha256', 'ecdsa')
     finally:
         # Go back to the original U-Boot with the correct dtb.
         cons.config.dtb = old_dtb
@@ -0,0 +1,166 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for cooperative tasks
+ */
+
+#include <common.h>
+#include <command.h>
+#include <task.h>
+#include <linux/iopoll.h>
+#include <test/suites.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define TASK_TEST(_name, _flags) UNIT_TEST(_name, _flags, task_test)
+
+#define DELAY_US	20000
+
+static char order[40];
+
+static void note(char ch)
+{
+	int len = strlen(order);
+
+	order[len] = ch;
+	order[len + 1] = '\0';
+}
+
+/* Notes its name and a step number three times, yielding after each */
+static int step_task(void *arg)
+{
+	const char *name = task_name();
+	int i;
+
+	for (i = 1; i <= 3; i++) {
+		note(*name);
+		note('0' + i);
+		task_yield();
+	}
+
+	return *name;
+}
+
+/* Test that tasks take turns in the order they were created */
+static int task_test_order(struct unit_test_state *uts)
+{
+	struct task *a, *b, *c;
+
+	order[0] = '\0';
+	ut_assertok(task_create("A", step_task, NULL, &a));
+	ut_assertok(task_create("B", step_task, NULL, &b));
+	ut_assertok(task_create("C", step_task, NULL, &c));
+	ut_asserteq_str("", order);
+
+	ut_asserteq('A', task_join(a));
+	ut_asserteq_str("A1B1C1A2B2C2A3B3C3", order);
+	ut_asserteq('B', task_join(b));
+	ut_asserteq('C', task_join(c));
+	ut_asserteq_str("main", task_name());
+
+	/* With no tasks left, yielding does nothing */
+	task_yield();
+	ut_asserteq_str("A1B1C1A2B2C2A3B3C3", order);
+
+	return 0;
+}
+TASK_TEST(task_test_order, 0);
+
+static int delay_task(void *arg)
+{
+	ulong start = timer_get_us();
+
+	udelay(DELAY_US);
+
+	return timer_get_us() - start >= DELAY_US ? 0 : -ETIME;
+}
+
+/* Test that delays in separate tasks overlap */
+static int task_test_delay(struct unit_test_state *uts)
+{
+	struct task *a, *b;
+	ulong start, taken;
+
+	start = timer_get_us();
+	ut_assertok(task_create("a", delay_task, NULL, &a));
+	ut_assertok(task_create("b", delay_task, NULL, &b));
+	ut_assertok(task_join(a));
+	ut_assertok(task_join(b));
+	taken = timer_get_us() - start;
+	printf("Two delays of %d us took %lu us\n", DELAY_US, taken);
+	ut_assert(taken >= DELAY_US);
+	ut_assert(taken < DELAY_US * 3 / 2);
+
+	return 0;
+}
+TASK_TEST(task_test_delay, 0);
+
+static int set_bit_task(void *arg)
+{
+	u32 *reg = arg;
+
+	udelay(DELAY_US);
+	*reg |= BIT(3);
+
+	return 0;
+}
+
+static u32 read_reg(u32 *reg)
+{
+	return *(volatile u32 *)reg;
+}
+
+/* Test that a polling helper lets the task which ends the wait run */
+static int task_test_poll(struct unit_test_state *uts)
+{
+	struct task *task;
+	u32 reg = 0, val;
+
+	ut_assertok(task_create("bit", set_bit_task, &reg, &task));
+	ut_assertok(readx_poll_timeout(read_reg, &reg, val, val & BIT(3),
+				       DELAY_US * 5));
+	ut_assertok(task_join(task));
+
+	return 0;
+}
+TASK_TEST(task_test_poll, 0);
+
+/* Creates two tasks of its own and joins them */
+static int parent_task(void *arg)
+{
+	struct task *x, *y;
+	int ret;
+
+	note('P');
+	ret = task_create("x", step_task, NULL, &x);
+	if (ret)
+		return ret;
+	ret = task_create("y", step_task, NULL, &y);
+	if (ret)
+		return ret;
+	ret = task_join(x) + task_join(y);
+	note('Q');
+
+	return ret;
+}
+
+/* Test that tasks can create and join tasks */
+static int task_test_nested(struct unit_test_state *uts)
+{
+	struct task *parent;
+
+	order[0] = '\0';
+	ut_assertok(task_create("parent", parent_task, NULL, &parent));
+	ut_asserteq('x' + 'y', task_join(parent));
+	ut_asserteq_str("Px1y1x2y2x3y3Q", order);
+
+	return 0;
+}
+TASK_TEST(task_test_nested, 0);
+
+int do_ut_task(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	struct unit_test *tests = ll_entry_start(struct unit_test, task_test);
+	const int n_ents = ll_entry_count(struct unit_test, task_test);
+
+	return cmd_ut_category("task", tests, n_ents, argc, argv);
+}
@@ -37,6 +37,9 @@
 
 #include <mtd/ubi-user.h>
 
+#include <stdbool.h>
+#include <env_index.h>
+
 #include "fw_env_private.h"
 #include "fw_env.h"
 
@@ -1381,6 +1384,62 @@ static int flash_io(int mode)
 /*
  * Prevent confusion if running from erased flash memory
  */
+/*
+ * An indexed environment, written by mkenvimage -i, holds no text. Turn it
+ * into the text form so that it can be printed and changed; saving it then
+ * writes text, which U-Boot reads as well.
+ */
+static int env_index_to_text(void)
+{
+	struct env_index_header hdr;
+	struct env_index_entry ent;
+	const char *entries, *pool, *key, *data;
+	char *text, *p;
+	size_t max_count, len;
+	uint32_t i;
+
+	memcpy(&hdr, environment.data, sizeof(hdr));
+	max_count = (ENV_SIZE - sizeof(hdr)) / sizeof(ent);
+	if (hdr.count > max_count ||
+	    hdr.pool_size > ENV_SIZE - sizeof(hdr) - hdr.count * sizeof(ent))
+		goto err_inval;
+	entries = environment.data + sizeof(hdr);
+	pool = entries + hdr.count * sizeof(ent);
+	if (hdr.pool_size && pool[hdr.pool_size - 1])
+		goto err_inval;
+
+	text = calloc(1, ENV_SIZE);
+	if (!text)
+		return -ENOMEM;
+	p = text;
+	for (i = 0; i < hdr.count; i++) {
+		memcpy(&ent, entries + i * sizeof(ent), sizeof(ent));
+		if (ent.key >= hdr.pool_size || ent.data >= hdr.pool_size) {
+			free(text);
+			goto err_inval;
+		}
+		key = pool + ent.key;
+		data = pool + ent.data;
+		len = strlen(key) + 1 + strlen(data) + 1;
+		/* Leave room for the second NUL that ends the text */
+		if (len >= ENV_SIZE - (p - text)) {
+			free(text);
+			fprintf(stderr,
+				"Error: indexed environment too large for text\n");
+			return -ENOSPC;
+		}
+		p += sprintf(p, "%s=%s", key, data) + 1;
+	}
+	memcpy(environment.data, text, ENV_SIZE);
+	free(text);
+
+	return 0;
+
+err_inval:
+	fprintf(stderr, "Error: bad indexed environment\n");
+	return -EINVAL;
+}
+
 int fw_env_open(struct env_opts *opts)
 {
 	int crc0, crc0_ok;
@@ -1559,6 +1618,16 @@ int fw_env_open(struct env_opts *opts)
 		fprintf(stderr, "Selected env in %s\n", DEVNAME(dev_current));
 #endif
 	}
+
+	if (env_index_is_valid(environment.data, ENV_SIZE)) {
+		ret = env_index_to_text();
+		if (ret) {
+			free(environment.image);
+			environment.image = NULL;
+			return ret;
+		}
+	}
+
 	return 0;
 
  open_cleanup:
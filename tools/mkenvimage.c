@@ -10,6 +10,7 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
@@ -22,13 +23,18 @@
 
 #include "compiler.h"
 #include <u-boot/crc.h>
+#include <env_index.h>
 #include <version.h>
 
 #define CRC_SIZE sizeof(uint32_t)
 
+/* The defaults for CONFIG_ENV_MIN_ENTRIES and CONFIG_ENV_MAX_ENTRIES */
+#define ENV_MIN_ENTRIES	64
+#define ENV_MAX_ENTRIES	512
+
 static void usage(const char *exec_name)
 {
-	fprintf(stderr, "%s [-h] [-r] [-b] [-p <byte>] -s <environment partition size> -o <output> <input file>\n"
+	fprintf(stderr, "%s [-h] [-r] [-b] [-i [-e <entries>]] [-p <byte>] -s <environment partition size> -o <output> <input file>\n"
 	       "\n"
 	       "This tool takes a key=value input file (same as would a `printenv' show) and generates the corresponding environment image, ready to be flashed.\n"
 	       "\n"
@@ -41,6 +47,10 @@ static void usage(const char *exec_name)
 	       "\t-r : the environment has multiple copies in flash\n"
 	       "\t-b : the target is big endian (default is little endian)\n"
 	       "\t-p <byte> : fill the image with <byte> bytes instead of 0xff bytes\n"
+	       "\t-i : write an indexed environment, for U-Boot with CONFIG_ENV_INDEX\n"
+	       "\t-e <entries> : number of hash table entries U-Boot creates for the\n"
+	       "\t\tenvironment (default is worked out from the size, as U-Boot\n"
+	       "\t\tdoes with the default CONFIG_ENV_MIN/MAX_ENTRIES)\n"
 	       "\t-V : print version information and exit\n"
 	       "\n"
 	       "If the input file is \"-\", data is read from standard input\n",
@@ -75,6 +85,8 @@ int main(int argc, char **argv)
 	unsigned int filesize = 0, envsize = 0, datasize = 0;
 	int bigendian = 0;
 	int redundant = 0;
+	int indexed = 0;
+	unsigned int entries = 0;
 	unsigned char padbyte = 0xff;
 
 	int option;
@@ -91,7 +103,7 @@ int main(int argc, char **argv)
 	opterr = 0;
 
 	/* Parse the cmdline */
-	while ((option = getopt(argc, argv, ":s:o:rbp:hV")) != -1) {
+	while ((option = getopt(argc, argv, ":s:o:rbp:ie:hV")) != -1) {
 		switch (option) {
 		case 's':
 			datasize = xstrtol(optarg);
@@ -112,6 +124,12 @@ int main(int argc, char **argv)
 		case 'p':
 			padbyte = xstrtol(optarg);
 			break;
+		case 'i':
+			indexed = 1;
+			break;
+		case 'e':
+			entries = xstrtol(optarg);
+			break;
 		case 'h':
 			usage(prg);
 			return EXIT_SUCCESS;
@@ -282,6 +300,37 @@ int main(int argc, char **argv)
 		envptr[ep] = '\0';
 	}
 
+	if (indexed) {
+		unsigned char *textptr = malloc(envsize);
+
+		if (!textptr) {
+			fprintf(stderr, "Can't alloc %d bytes for the index.\n",
+				envsize);
+			return EXIT_FAILURE;
+		}
+		memcpy(textptr, envptr, envsize);
+		memset(envptr, padbyte, envsize);
+
+		if (!entries) {
+			entries = ENV_MIN_ENTRIES + envsize / 8;
+			if (entries > ENV_MAX_ENTRIES)
+				entries = ENV_MAX_ENTRIES;
+		}
+		ret = env_index_build((char *)envptr, envsize,
+				      (char *)textptr, ep + 1, entries,
+				      bigendian);
+		free(textptr);
+		if (ret == -ENOSPC) {
+			fprintf(stderr, "The environment file is too large for the target environment storage\n");
+			return EXIT_FAILURE;
+		} else if (ret < 0) {
+			fprintf(stderr, "Can't build the index: %s\n",
+				ret == -ENOMEM ? "too many variables" :
+				strerror(-ret));
+			return EXIT_FAILURE;
+		}
+	}
+
 	/* Computes the CRC and put it at the beginning of the data */
 	crc = crc32(0, envptr, envsize);
 	targetendian_crc = bigendian ? cpu_to_be32(crc) : cpu_to_le32(crc);